@@ -6,18 +6,26 @@ Implementation based on Henderson & Solomon (DAFx 2019)
 This implements the FULL optimal transport algorithm, not just spectral blending.
 The key insight: treat magnitude spectra as probability distributions and compute
 the optimal transport map to "move" frequencies from source to target.
+
+The transport runs in the C++ engines through the _audio_transport
+extension (python/audio_transport_module.cpp, built with -DBUILD_PYTHON=ON).
 """
 
 import os
 import json
 import numpy as np
-from scipy import signal
 from scipy.io import wavfile
-from scipy.interpolate import interp1d
+
+try:
+    import _audio_transport
+except ImportError as e:
+    raise ImportError(
+        "audio_transport.py runs on the native _audio_transport module: build it with "
+        "cmake -DBUILD_PYTHON=ON and put the build directory on PYTHONPATH") from e
 
 
 class AudioTransport:
-    def __init__(self, sample_rate=44100, window_ms=100, hop_divisor=4, fft_mult=2):
+    def __init__(self, sample_rate=44100, window_ms=100, hop_divisor=4, fft_mult=2, engine="cdf"):
         """
         Initialize the Audio Transport processor.
 
@@ -27,216 +35,27 @@ class AudioTransport:
                        but worse time resolution). Default 100ms for high fidelity.
             hop_divisor: Hop size as fraction of window (4 = 75% overlap, 8 = 87.5%)
             fft_mult: FFT size multiplier (2 = 2x zero-padding for smoother spectrum)
+            engine: "cdf" for RealtimeAudioTransport (the CDF transport map),
+                    "reassignment" for RealtimeReassignmentTransport
         """
         self.sr = sample_rate
-        self.nperseg = int(window_ms * sample_rate / 1000)
-        self.hop = self.nperseg // hop_divisor
-        self.noverlap = self.nperseg - self.hop
-
-        # Zero-pad FFT for smoother spectral interpolation
-        self.nfft = int(2 ** np.ceil(np.log2(self.nperseg))) * fft_mult
-
-        # Hann window - good for OLA reconstruction
-        self.window = signal.windows.hann(self.nperseg, sym=False)
-
-        # Precompute frequency bin centers
-        self.freqs = np.fft.rfftfreq(self.nfft, 1 / self.sr)
-        self.num_bins = len(self.freqs)
-
-        freq_res = self.sr / self.nfft
-        print(f"Spectral resolution: {freq_res:.1f} Hz per bin, {self.num_bins} bins")
-
-    def _stft(self, audio):
-        """Compute STFT."""
-        f, t, Zxx = signal.stft(
-            audio,
-            fs=self.sr,
-            window=self.window,
-            nperseg=self.nperseg,
-            noverlap=self.noverlap,
-            nfft=self.nfft,
-        )
-        return Zxx
-
-    def _istft(self, Zxx):
-        """Compute inverse STFT."""
-        _, audio = signal.istft(
-            Zxx,
-            fs=self.sr,
-            window=self.window,
-            nperseg=self.nperseg,
-            noverlap=self.noverlap,
-            nfft=self.nfft,
-        )
-        return audio
-
-    def _compute_transport_map(self, mag_X, mag_Y):
-        """
-        Compute 1D optimal transport map from distribution X to Y.
-
-        For 1D distributions, optimal transport has a closed-form solution:
-        T(x) = F_Y^{-1}(F_X(x)) where F_X and F_Y are CDFs.
-
-        Returns: transport_map where transport_map[i] is the target bin index
-                 that bin i should move towards.
-        """
-        eps = 1e-10
-
-        # Normalize to probability distributions
-        p_X = mag_X / (mag_X.sum() + eps)
-        p_Y = mag_Y / (mag_Y.sum() + eps)
-
-        # Compute CDFs
-        cdf_X = np.cumsum(p_X)
-        cdf_Y = np.cumsum(p_Y)
-
-        # For each bin in X, find where it maps to in Y
-        # T(x) = F_Y^{-1}(F_X(x))
-        # We need to invert F_Y: find the bin where cdf_Y >= cdf_X[i]
-        transport_map = np.zeros(len(mag_X))
-
-        for i in range(len(mag_X)):
-            # Find smallest j where cdf_Y[j] >= cdf_X[i]
-            target_indices = np.where(cdf_Y >= cdf_X[i] - eps)[0]
-            if len(target_indices) > 0:
-                transport_map[i] = target_indices[0]
-            else:
-                transport_map[i] = len(mag_Y) - 1
-
-        return transport_map
-
-    def _interpolate_spectrum(self, mag_X, phase_X, mag_Y, phase_Y, k):
-        """
-        Interpolate spectrum using optimal transport.
-
-        Instead of just blending magnitudes, we:
-        1. Compute transport map from X to Y
-        2. Move each frequency bin along the transport path
-        3. Accumulate energy at interpolated positions
-        """
-        num_bins = len(mag_X)
-        bin_indices = np.arange(num_bins)
-
-        # Compute transport map
-        transport_map = self._compute_transport_map(mag_X, mag_Y)
-
-        # Interpolated bin positions: each bin moves from its position toward its target
-        interp_positions = (1 - k) * bin_indices + k * transport_map
-
-        # Output spectrum - accumulate energy at interpolated positions
-        mag_out = np.zeros(num_bins)
-        phase_out = np.zeros(num_bins)
-        weight_sum = np.zeros(num_bins) + 1e-10  # For weighted phase averaging
-
-        for i in range(num_bins):
-            # Where does bin i end up?
-            target_pos = interp_positions[i]
-
-            # Interpolate magnitude: blend source and target magnitudes
-            interp_mag = (1 - k) * mag_X[i] + k * mag_Y[int(transport_map[i])]
-
-            # Distribute energy to neighboring bins (linear interpolation)
-            low_bin = int(np.floor(target_pos))
-            high_bin = int(np.ceil(target_pos))
-            frac = target_pos - low_bin
-
-            if low_bin >= 0 and low_bin < num_bins:
-                mag_out[low_bin] += (1 - frac) * interp_mag
-                weight_sum[low_bin] += (1 - frac) * interp_mag
-                # Phase: weighted combination
-                phase_out[low_bin] += (1 - frac) * interp_mag * phase_X[i]
-
-            if high_bin >= 0 and high_bin < num_bins and high_bin != low_bin:
-                mag_out[high_bin] += frac * interp_mag
-                weight_sum[high_bin] += frac * interp_mag
-                phase_out[high_bin] += frac * interp_mag * phase_X[i]
-
-        # Normalize phase by weights
-        phase_out = phase_out / weight_sum
-
-        # Where we have little energy from transport, blend in target phase
-        low_energy_mask = weight_sum < 1e-8
-        phase_out[low_energy_mask] = phase_Y[low_energy_mask]
-
-        return mag_out, phase_out
-
-    def _interpolate_spectrum_vectorized(self, mag_X, phase_X, mag_Y, phase_Y, k):
-        """
-        Vectorized version of spectrum interpolation using optimal transport.
-        Faster than the loop version.
-        """
-        num_bins = len(mag_X)
-        bin_indices = np.arange(num_bins, dtype=np.float64)
-        eps = 1e-10
-
-        # Normalize to probability distributions
-        total_X = mag_X.sum() + eps
-        total_Y = mag_Y.sum() + eps
-        p_X = mag_X / total_X
-        p_Y = mag_Y / total_Y
-
-        # Compute CDFs
-        cdf_X = np.cumsum(p_X)
-        cdf_Y = np.cumsum(p_Y)
-
-        # Compute transport map using searchsorted (vectorized)
-        # For each bin i, find where cdf_Y first exceeds cdf_X[i]
-        transport_map = np.searchsorted(cdf_Y, cdf_X, side='left')
-        transport_map = np.clip(transport_map, 0, num_bins - 1).astype(np.float64)
-
-        # Interpolated positions
-        interp_positions = (1 - k) * bin_indices + k * transport_map
-
-        # Interpolated magnitudes along transport
-        target_indices = transport_map.astype(int)
-        interp_mag = (1 - k) * mag_X + k * mag_Y[target_indices]
-
-        # Scatter energy to output bins
-        low_bins = np.floor(interp_positions).astype(int)
-        high_bins = np.ceil(interp_positions).astype(int)
-        fracs = interp_positions - low_bins
-
-        # Clip to valid range
-        low_bins = np.clip(low_bins, 0, num_bins - 1)
-        high_bins = np.clip(high_bins, 0, num_bins - 1)
-
-        # Accumulate using np.add.at for proper handling of duplicate indices
-        mag_out = np.zeros(num_bins)
-        phase_num = np.zeros(num_bins)  # Numerator for weighted phase
-        weight_sum = np.zeros(num_bins)
-
-        low_weights = (1 - fracs) * interp_mag
-        high_weights = fracs * interp_mag
-
-        np.add.at(mag_out, low_bins, low_weights)
-        np.add.at(mag_out, high_bins, high_weights)
-
-        np.add.at(weight_sum, low_bins, low_weights)
-        np.add.at(weight_sum, high_bins, high_weights)
-
-        # Weighted phase (circular mean would be better, but this works reasonably)
-        np.add.at(phase_num, low_bins, low_weights * phase_X)
-        np.add.at(phase_num, high_bins, high_weights * phase_X)
-
-        # Compute output phase
-        weight_sum = np.maximum(weight_sum, eps)
-        phase_out = phase_num / weight_sum
-
-        # Blend in target phase where transport didn't contribute much
-        blend_factor = np.clip(weight_sum / (mag_Y + eps), 0, 1)
-        phase_out = blend_factor * phase_out + (1 - blend_factor) * phase_Y
-
-        return mag_out, phase_out
+        if engine == "cdf":
+            self.engine = _audio_transport.RealtimeAudioTransport(
+                sample_rate, window_ms, hop_divisor, fft_mult)
+        elif engine == "reassignment":
+            self.engine = _audio_transport.RealtimeReassignmentTransport(
+                sample_rate, window_ms, hop_divisor, fft_mult, fft_sizing="smooth")
+        else:
+            raise ValueError(f"engine must be 'cdf' or 'reassignment', not {engine!r}")
 
     def process(self, audio_X, audio_Y, k=None, k_envelope=None):
         """
         Apply audio transport effect using optimal transport.
 
-        This is the FULL algorithm:
-        1. Compute STFT of both signals
-        2. For each frame, compute optimal transport map between magnitude spectra
-        3. Interpolate frequencies along the transport path
-        4. Reconstruct audio from transported spectra
+        Both signals run through the native engine in one call (the GIL
+        is released meanwhile), with a factor per sample when k varies.
+        The engine's latency is flushed with zeros and cut from the
+        start, so the output lines up with the input.
 
         Args:
             audio_X: Source audio signal
@@ -248,16 +67,14 @@ class AudioTransport:
         Returns:
             Interpolated audio signal
         """
-        # Ensure equal length
+        # Ensure equal length, plus the latency to flush
         max_len = max(len(audio_X), len(audio_Y))
-        audio_X = np.pad(audio_X, (0, max_len - len(audio_X)))
-        audio_Y = np.pad(audio_Y, (0, max_len - len(audio_Y)))
-
-        print("Computing STFTs...")
-        X = self._stft(audio_X)
-        Y = self._stft(audio_Y)
-
-        num_bins, num_frames = X.shape
+        latency = self.engine.latency
+        total = max_len + latency
+        main = np.zeros(total, np.float32)
+        sidechain = np.zeros(total, np.float32)
+        main[:len(audio_X)] = audio_X
+        sidechain[:len(audio_Y)] = audio_Y
 
         # Sort envelope by percent if provided
         if k_envelope is not None:
@@ -271,43 +88,23 @@ class AudioTransport:
                 if k_envelope[0]["percent"] > 0:
                     k_envelope.insert(0, {"percent": 0, "k": 0})
 
-            print(f"Processing {num_frames} frames with time-varying k...")
+            print(f"Processing {max_len} samples with time-varying k...")
             print(f"  Keyframes: {k_envelope}")
-        else:
-            print(f"Processing {num_frames} frames with k={k}...")
-
-        # Get magnitudes and phases
-        mag_X = np.abs(X)
-        mag_Y = np.abs(Y)
-        phase_X = np.angle(X)
-        phase_Y = np.angle(Y)
-
-        # Process each frame with optimal transport
-        output_stft = np.zeros_like(X)
-
-        for frame in range(num_frames):
-            # Calculate k for this frame
-            if k_envelope:
-                percent = (frame / (num_frames - 1)) * 100 if num_frames > 1 else 0
-                frame_k = interpolate_k(percent, k_envelope)
-            else:
-                frame_k = k
-
-            if frame % 100 == 0:
-                print(f"  Frame {frame}/{num_frames} (k={frame_k:.3f})")
 
-            mag_out, phase_out = self._interpolate_spectrum_vectorized(
-                mag_X[:, frame], phase_X[:, frame],
-                mag_Y[:, frame], phase_Y[:, frame],
-                frame_k
-            )
-
-            output_stft[:, frame] = mag_out * np.exp(1j * phase_out)
+            # interpolate_k() at every sample, held past the end
+            percent = np.arange(total) * (100.0 / max(max_len - 1, 1))
+            k_samples = np.interp(percent,
+                                  [p["percent"] for p in k_envelope],
+                                  [p["k"] for p in k_envelope]).astype(np.float32)
+        else:
+            k = 0.5 if k is None else k
+            print(f"Processing {max_len} samples with k={k}...")
+            k_samples = float(k)
 
-        print("Reconstructing audio...")
-        output = self._istft(output_stft)
+        self.engine.reset()
+        output = np.asarray(self.engine.process(main, sidechain, k_samples))
 
-        return output
+        return output[latency:].astype(np.float64)
 
 
 def create_test_signals(duration=2.0, sr=44100):
@@ -406,6 +203,7 @@ JSON Parameter File (-f):
     "window": 100,                       # Window size in ms (default: 100)
     "hop_div": 4,                        # Hop divisor (default: 4 = 75%% overlap)
     "fft_mult": 2,                       # FFT multiplier (default: 2, use powers of 2)
+    "engine": "cdf",                     # "cdf" or "reassignment" (default: cdf)
     "output": "output.wav"               # Output filename (optional, auto-generated)
   }
 
@@ -463,6 +261,9 @@ Examples:
     parser.add_argument("--fft-mult", type=int, default=None, metavar="N",
                         help="FFT size multiplier for zero-padding (default: 2). "
                              "Use powers of 2 (1,2,4,8). Higher = smoother spectral interpolation.")
+    parser.add_argument("--engine", choices=["cdf", "reassignment"], default=None,
+                        help="Transport engine (default: cdf). reassignment uses spectral "
+                             "reassignment for sharper partials, at a higher cost.")
     parser.add_argument("--demo", action="store_true",
                         help="Run demo with sine waves (A4=440Hz to C#5=554Hz)")
 
@@ -475,6 +276,7 @@ Examples:
         "window": 100,
         "hop_div": 4,
         "fft_mult": 2,
+        "engine": "cdf",
         "output": None,
         "source": None,
         "target": None,
@@ -503,6 +305,8 @@ Examples:
         defaults["hop_div"] = args.hop_div
     if args.fft_mult is not None:
         defaults["fft_mult"] = args.fft_mult
+    if args.engine is not None:
+        defaults["engine"] = args.engine
     if args.demo:
         defaults["demo"] = True
 
@@ -515,6 +319,7 @@ Examples:
     args.window = defaults["window"]
     args.hop_div = defaults["hop_div"]
     args.fft_mult = defaults["fft_mult"]
+    args.engine = defaults["engine"]
     args.demo = defaults["demo"]
 
     # CLI -k overrides k_envelope from file
@@ -536,7 +341,8 @@ Examples:
             sample_rate=sr,
             window_ms=args.window,
             hop_divisor=args.hop_div,
-            fft_mult=args.fft_mult
+            fft_mult=args.fft_mult,
+            engine=args.engine
         )
 
         if args.k_envelope is not None:
@@ -592,7 +398,8 @@ Examples:
             sample_rate=sr,
             window_ms=args.window,
             hop_divisor=args.hop_div,
-            fft_mult=args.fft_mult
+            fft_mult=args.fft_mult,
+            engine=args.engine
         )
 
         start = time.time()
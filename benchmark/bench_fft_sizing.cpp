@@ -0,0 +1,156 @@
+/**
+ * Reassignment engine cost under each FFT sizing policy
+ *
+ * For common sample rates and window sizes this times, per policy
+ * (exact, power_of_two, smooth):
+ *   fft       the transforms of one hop: both inputs' three forward
+ *             transforms in one batch and the inverse
+ *   engine    process() of a mono morph at k = 0.5, in percent of
+ *             realtime, and its speedup over the exact size
+ *
+ * Plans are measured before timing, as an engine's constructor does.
+ *
+ * Usage: bench_fft_sizing [seconds]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/fftw_traits.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+typedef std::chrono::steady_clock clock_type;
+
+const int HOP_DIVISOR = 4;
+const int FFT_PADDING = 2;
+const int BLOCK_SIZE = 512;
+
+static double elapsed_seconds(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// The engines log their configuration on construction
+struct silence_cout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    silence_cout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~silence_cout() { std::cout.rdbuf(saved); }
+};
+
+static const char* policy_name(fft_plans::sizing policy) {
+    switch (policy) {
+    case fft_plans::exact: return "exact";
+    case fft_plans::power_of_two: return "power_of_two";
+    case fft_plans::smooth: return "smooth";
+    }
+    return "";
+}
+
+// Microseconds for one hop's transforms of size n, repeated for at
+// least 0.1 s
+static double hop_fft_us(int n) {
+    typedef fftw_traits<double> fft;
+    size_t real_distance = fft_plans::real_distance(n);
+    size_t complex_distance = fft_plans::complex_distance(n);
+    fft::plan forward = fft_plans::get<double>(n, fft_plans::forward, 6);
+    fft::plan inverse = fft_plans::get<double>(n, fft_plans::inverse);
+
+    double* windows = fft::alloc_real(6 * real_distance);
+    fft::complex* spectra = fft::alloc_complex(6 * complex_distance);
+    double* output = fft::alloc_real(n);
+    std::fill(windows, windows + 6 * real_distance, 0.25);
+
+    int runs = 0;
+    clock_type::time_point start = clock_type::now();
+    double seconds = 0;
+    do {
+        fft::execute_r2c(forward, windows, spectra);
+        fft::execute_c2r(inverse, spectra, output);
+        runs++;
+        seconds = elapsed_seconds(start);
+    } while (seconds < 0.1);
+
+    fft::free(windows);
+    fft::free(spectra);
+    fft::free(output);
+    return seconds / runs * 1e6;
+}
+
+// Seconds of processing per second of audio
+static double engine_load(RealtimeReassignmentTransport& engine, double sample_rate,
+                          double audio_seconds) {
+    int samples = static_cast<int>(audio_seconds * sample_rate);
+    std::vector<float> main(samples), sidechain(samples), output(BLOCK_SIZE);
+    for (int i = 0; i < samples; i++) {
+        double t = i / sample_rate;
+        main[i] = static_cast<float>(0.5 * std::sin(2.0 * M_PI * 220.0 * t)
+                                   + 0.2 * std::sin(2.0 * M_PI * 1870.0 * t));
+        sidechain[i] = static_cast<float>(0.4 * std::sin(2.0 * M_PI * 330.0 * t));
+    }
+
+    clock_type::time_point start = clock_type::now();
+    for (int pos = 0; pos + BLOCK_SIZE <= samples; pos += BLOCK_SIZE) {
+        engine.process(main.data() + pos, sidechain.data() + pos, output.data(), BLOCK_SIZE, 0.5f);
+    }
+    return elapsed_seconds(start) / audio_seconds;
+}
+
+int main(int argc, char** argv) {
+    double audio_seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    if (!(audio_seconds > 0)) audio_seconds = 2.0;
+
+    std::cout << "Reassignment engine, hop divisor " << HOP_DIVISOR << ", " << FFT_PADDING
+              << "x padding, " << audio_seconds << " s per engine run\n" << std::endl;
+    std::cout << std::left << std::setw(8) << "rate"
+              << std::right << std::setw(6) << "ms"
+              << "  " << std::left << std::setw(14) << "policy"
+              << std::right << std::setw(8) << "fft"
+              << std::setw(12) << "fft us"
+              << std::setw(12) << "engine %"
+              << std::setw(10) << "speedup" << std::endl;
+
+    const double sample_rates[] = { 44100.0, 48000.0, 88200.0, 96000.0 };
+    const double windows_ms[] = { 20.0, 50.0, 100.0, 200.0 };
+    const fft_plans::sizing policies[] = {
+        fft_plans::exact, fft_plans::power_of_two, fft_plans::smooth
+    };
+
+    for (double sample_rate : sample_rates) {
+        for (double window_ms : windows_ms) {
+            double exact_load = 0;
+            for (fft_plans::sizing policy : policies) {
+                double load;
+                int size;
+                {
+                    silence_cout quiet;
+                    RealtimeReassignmentTransport engine(sample_rate, window_ms, HOP_DIVISOR,
+                                                         FFT_PADDING, 0.0, policy);
+                    size = engine.getFFTSize();
+                    load = engine_load(engine, sample_rate, audio_seconds);
+                }
+                if (policy == fft_plans::exact) exact_load = load;
+
+                std::cout << std::fixed << std::setprecision(0)
+                          << std::left << std::setw(8) << sample_rate
+                          << std::right << std::setw(6) << window_ms
+                          << "  " << std::left << std::setw(14) << policy_name(policy)
+                          << std::right << std::setw(8) << size
+                          << std::setprecision(1)
+                          << std::setw(12) << hop_fft_us(size)
+                          << std::setw(12) << 100.0 * load
+                          << std::setprecision(2)
+                          << std::setw(9) << exact_load / load << "x" << std::endl;
+            }
+        }
+    }
+    return 0;
+}
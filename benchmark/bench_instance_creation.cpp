@@ -0,0 +1,164 @@
+/**
+ * Engine construction cost with and without the shared plan registry
+ *
+ * For each window size this times, per engine:
+ *   legacy    the FFTW_MEASURE plans every instance used to make
+ *             for itself (in a process with no wisdom yet)
+ *   cold      first instance, registry empty and no wisdom on disk
+ *   wisdom    first instance in a "new process" that loads the wisdom
+ *             file the cold run wrote
+ *   warm      any later instance of the same size
+ *
+ * Usage: bench_instance_creation [iterations]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+
+#include <unistd.h>
+
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/fftw_traits.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+typedef std::chrono::steady_clock clock_type;
+
+const double SAMPLE_RATE = 44100.0;
+const int HOP_DIVISOR = 4;
+const int FFT_PADDING = 2;
+
+static double elapsed_ms(clock_type::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+// The engines log their configuration on construction
+struct silence_cout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    silence_cout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~silence_cout() { std::cout.rdbuf(saved); }
+};
+
+// Transform sizes each engine plans for a window size (mirrors
+// computeSizes() and the reassignment constructor)
+static int cdf_fft_size(double window_ms) {
+    int samples = static_cast<int>(window_ms * SAMPLE_RATE / 1000.0);
+    int next_pow2 = static_cast<int>(std::pow(2, std::ceil(std::log2(samples))));
+    return next_pow2 * FFT_PADDING;
+}
+
+static int reassignment_fft_size(double window_ms) {
+    int samples = static_cast<int>(std::round(window_ms / 1000.0 * SAMPLE_RATE));
+    while (samples % (2 * HOP_DIVISOR) != 0) samples++;
+    return samples * (1 + FFT_PADDING);
+}
+
+// What the constructors did before the registry: dedicated plans
+template <typename Real>
+static double legacy_planning_ms(int n, int forward_plans) {
+    typedef fftw_traits<Real> fft;
+    fft::forget_wisdom();
+
+    Real* real = fft::alloc_real(n);
+    typename fft::complex* spectrum = fft::alloc_complex(n / 2 + 1);
+
+    clock_type::time_point start = clock_type::now();
+    std::vector<typename fft::plan> plans;
+    for (int i = 0; i < forward_plans; i++) {
+        plans.push_back(fft::plan_r2c(n, real, spectrum, FFTW_MEASURE));
+    }
+    plans.push_back(fft::plan_c2r(n, spectrum, real, FFTW_MEASURE));
+    double ms = elapsed_ms(start);
+
+    for (size_t i = 0; i < plans.size(); i++) fft::destroy(plans[i]);
+    fft::free(real);
+    fft::free(spectrum);
+    return ms;
+}
+
+template <typename Engine>
+static double construct_ms(double window_ms) {
+    silence_cout quiet;
+    clock_type::time_point start = clock_type::now();
+    std::unique_ptr<Engine> engine(new Engine(SAMPLE_RATE, window_ms, HOP_DIVISOR, FFT_PADDING));
+    return elapsed_ms(start);
+}
+
+template <typename Engine, typename Real>
+static void run(const char* name, double window_ms, int fft_size, int forward_plans,
+                int iterations) {
+    double legacy = legacy_planning_ms<Real>(fft_size, forward_plans);
+
+    fft_plans::clear();
+    double cold = construct_ms<Engine>(window_ms);
+
+    // Drop the in-memory plans and wisdom; the file stays
+    fft_plans::clear();
+    double wisdom = construct_ms<Engine>(window_ms);
+
+    double warm = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        warm += construct_ms<Engine>(window_ms);
+    }
+    warm /= iterations;
+
+    std::cout << std::fixed << std::setprecision(0)
+              << std::left << std::setw(22) << name
+              << std::right << std::setw(6) << window_ms
+              << std::setw(8) << fft_size
+              << std::setprecision(3)
+              << std::setw(12) << legacy
+              << std::setw(12) << cold
+              << std::setw(12) << wisdom
+              << std::setw(12) << warm << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    // Keep the user's real cache out of the measurement
+    char dir_template[] = "/tmp/audio_transport_bench_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::cerr << "Could not create a cache directory" << std::endl;
+        return 1;
+    }
+    fft_plans::set_cache_directory(dir_template);
+
+    std::cout << "Instance creation (ms), " << iterations << " warm iterations\n" << std::endl;
+    std::cout << std::left << std::setw(22) << "engine"
+              << std::right << std::setw(6) << "ms"
+              << std::setw(8) << "fft"
+              << std::setw(12) << "legacy"
+              << std::setw(12) << "cold"
+              << std::setw(12) << "wisdom"
+              << std::setw(12) << "warm" << std::endl;
+
+    const double windows_ms[] = { 20.0, 50.0, 100.0, 200.0 };
+    for (double window_ms : windows_ms) {
+        run<RealtimeAudioTransport, double>(
+            "cdf double", window_ms, cdf_fft_size(window_ms), 1, iterations);
+        run<RealtimeReassignmentTransport, double>(
+            "reassignment double", window_ms, reassignment_fft_size(window_ms), 3, iterations);
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+        run<RealtimeAudioTransportFloat, float>(
+            "cdf float", window_ms, cdf_fft_size(window_ms), 1, iterations);
+        run<RealtimeReassignmentTransportFloat, float>(
+            "reassignment float", window_ms, reassignment_fft_size(window_ms), 3, iterations);
+#endif
+    }
+
+    fft_plans::clear();
+    std::system((std::string("rm -rf '") + dir_template + "'").c_str());
+    return 0;
+}
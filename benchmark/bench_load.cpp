@@ -0,0 +1,417 @@
+/**
+ * Load test: many engine instances across host threads
+ *
+ * Runs --instances engines of one kind, dealt round-robin to --threads
+ * threads that each play a host's audio thread: every block period it
+ * calls process() once for each of its instances, one after another.
+ * Inputs are stereo sines and noise, the same for every instance.
+ *
+ * Reported:
+ *   callback   the time of one instance's process() call, as
+ *              percentiles over every call of every instance
+ *   cycle      the time a thread takes for all its instances in one
+ *              period; a cycle longer than the period is a deadline
+ *              miss, as a host would drop out
+ *   load       busy time over elapsed time, per thread
+ *   instances per core  the instances one core runs at 100% load, from
+ *              the audio processed per busy second
+ *
+ * By default --paced runs each thread on the wall clock, sleeping to
+ * the start of its next period as a host does and counting a cycle
+ * that ends past the next period's start as a miss. --unpaced runs
+ * flat out, which measures throughput; misses then compare each
+ * cycle's time with the period. --sweep repeats the run at 1, 2, 4 ...
+ * --threads threads to show how throughput scales.
+ *
+ * --max-miss-rate=percent makes the run fail (exit 2) when more of the
+ * cycles than that miss, for catching regressions.
+ *
+ * Usage: bench_load [--engine=cdf|reassignment] [--instances=N]
+ *                   [--threads=M] [--block-size=512] [--sample-rate=48000]
+ *                   [--window-ms=50] [--channels=2] [--seconds=5]
+ *                   [--paced|--unpaced] [--sweep] [--format=console|json]
+ *                   [--max-miss-rate=percent]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+typedef std::chrono::steady_clock clock_type;
+
+const double SIGNAL_SECONDS = 2.0; // looped
+
+struct settings {
+    std::string engine = "cdf";
+    int instances = 0; // 0 = two per hardware thread
+    int threads = 0;   // 0 = std::thread::hardware_concurrency()
+    int block_size = 512;
+    double sample_rate = 48000.0;
+    double window_ms = 50.0;
+    int channels = 2;
+    double seconds = 5.0; // of host time
+    bool paced = true;
+    bool sweep = false;
+    std::string format = "console";
+    double max_miss_rate = -1; // percent, < 0 never fails
+};
+
+struct percentiles {
+    double p50, p90, p99, p999, max; // microseconds
+};
+
+struct result {
+    int threads;
+    int instances;
+    size_t cycles;
+    size_t misses;
+    percentiles callback;
+    percentiles cycle;
+    double period_us;
+    double mean_load;     // busy / elapsed, averaged over threads
+    double max_load;
+    double instances_per_core;
+
+    double miss_rate() const { return cycles ? 100.0 * misses / cycles : 0.0; }
+};
+
+// The engines log their configuration on construction
+struct silence_cout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    silence_cout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~silence_cout() { std::cout.rdbuf(saved); }
+};
+
+static double elapsed_us(clock_type::time_point start, clock_type::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+static percentiles summarize(std::vector<double>& times) {
+    percentiles p = { 0, 0, 0, 0, 0 };
+    if (times.empty()) return p;
+    std::sort(times.begin(), times.end());
+    size_t n = times.size();
+    p.p50 = times[n / 2];
+    p.p90 = times[std::min(n - 1, n * 90 / 100)];
+    p.p99 = times[std::min(n - 1, n * 99 / 100)];
+    p.p999 = times[std::min(n - 1, n * 999 / 1000)];
+    p.max = times.back();
+    return p;
+}
+
+// Planar main and sidechain signals; channel c of instance i starts at
+// a different point of the loop so instances do not run in lockstep
+struct signals {
+    std::vector<std::vector<float>> main, sidechain;
+    size_t length;
+};
+
+static signals make_signals(const settings& s) {
+    signals sig;
+    sig.length = static_cast<size_t>(SIGNAL_SECONDS * s.sample_rate);
+    sig.main.assign(s.channels, std::vector<float>(sig.length));
+    sig.sidechain.assign(s.channels, std::vector<float>(sig.length));
+    unsigned int seed = 1234;
+    for (int c = 0; c < s.channels; c++) {
+        for (size_t i = 0; i < sig.length; i++) {
+            double t = i / s.sample_rate;
+            seed = seed * 1664525u + 1013904223u;
+            double noise = (seed >> 8) / double(1 << 24) - 0.5;
+            sig.main[c][i] = static_cast<float>(0.4 * std::sin(2 * M_PI * (220.0 + 5 * c) * t)
+                                              + 0.2 * std::sin(2 * M_PI * 1870.0 * t));
+            sig.sidechain[c][i] = static_cast<float>(0.3 * std::sin(2 * M_PI * 330.0 * t)
+                                                   + 0.1 * noise);
+        }
+    }
+    return sig;
+}
+
+static std::unique_ptr<RealtimeEngine> make_engine(const settings& s) {
+    silence_cout quiet;
+    std::unique_ptr<RealtimeEngine> engine;
+    if (s.engine == "reassignment") {
+        engine.reset(new RealtimeReassignmentTransport(s.sample_rate, s.window_ms, 4, 2, 0.0,
+                                                       fft_plans::smooth));
+    } else {
+        engine.reset(new RealtimeAudioTransport(s.sample_rate, s.window_ms, 4, 2));
+    }
+    engine->setNumChannels(s.channels);
+    return engine;
+}
+
+// One host thread's instances and what it measured
+struct host_thread {
+    std::vector<std::unique_ptr<RealtimeEngine>> engines;
+    std::vector<size_t> offsets; // into the signal loop, per engine
+    std::vector<double> callback_us;
+    std::vector<double> cycle_us;
+    size_t misses = 0;
+    double busy_us = 0;
+    double elapsed_us = 0;
+};
+
+static void run_host_thread(const settings& s, const signals& sig, size_t periods,
+                            clock_type::time_point start, host_thread& h) {
+    const int block = s.block_size;
+    const std::chrono::duration<double> period(block / s.sample_rate);
+    std::vector<std::vector<float>> output(s.channels, std::vector<float>(block));
+    std::vector<const float*> main(s.channels), sidechain(s.channels);
+    std::vector<float*> out(s.channels);
+    for (int c = 0; c < s.channels; c++) out[c] = output[c].data();
+
+    h.callback_us.reserve(periods * h.engines.size());
+    h.cycle_us.reserve(periods);
+
+    for (size_t p = 0; p < periods; p++) {
+        clock_type::time_point deadline = start + std::chrono::duration_cast<clock_type::duration>(
+            period * static_cast<double>(p + 1));
+        if (s.paced) {
+            std::this_thread::sleep_until(deadline - std::chrono::duration_cast<clock_type::duration>(period));
+        }
+
+        clock_type::time_point cycle_start = clock_type::now();
+        clock_type::time_point call_start = cycle_start;
+        for (size_t e = 0; e < h.engines.size(); e++) {
+            size_t pos = (h.offsets[e] + p * block) % (sig.length - block);
+            for (int c = 0; c < s.channels; c++) {
+                main[c] = sig.main[c].data() + pos;
+                sidechain[c] = sig.sidechain[c].data() + pos;
+            }
+            h.engines[e]->process(main.data(), sidechain.data(), out.data(), s.channels, block, 0.5f);
+            clock_type::time_point call_end = clock_type::now();
+            h.callback_us.push_back(elapsed_us(call_start, call_end));
+            call_start = call_end;
+        }
+
+        double cycle = elapsed_us(cycle_start, call_start);
+        h.cycle_us.push_back(cycle);
+        h.busy_us += cycle;
+        // A paced thread must finish before the next period starts; an
+        // unpaced one within a period of its own start
+        if (s.paced ? call_start > deadline : cycle > period.count() * 1e6) h.misses++;
+    }
+    h.elapsed_us = elapsed_us(start, clock_type::now());
+}
+
+static result run(const settings& s, int threads) {
+    signals sig = make_signals(s);
+    std::vector<host_thread> hosts(threads);
+    for (int i = 0; i < s.instances; i++) {
+        host_thread& h = hosts[i % threads];
+        h.engines.push_back(make_engine(s));
+        h.offsets.push_back((static_cast<size_t>(i) * 7919 * s.block_size) % (sig.length - s.block_size));
+    }
+
+    // Prime every engine past its latency so the timed hops are steady
+    {
+        std::vector<std::vector<float>> output(s.channels, std::vector<float>(s.block_size));
+        std::vector<const float*> main(s.channels), sidechain(s.channels);
+        std::vector<float*> out(s.channels);
+        for (int c = 0; c < s.channels; c++) {
+            main[c] = sig.main[c].data();
+            sidechain[c] = sig.sidechain[c].data();
+            out[c] = output[c].data();
+        }
+        for (host_thread& h : hosts) {
+            for (auto& engine : h.engines) {
+                for (int done = 0; done < engine->getLatencySamples() + s.block_size; done += s.block_size) {
+                    engine->process(main.data(), sidechain.data(), out.data(), s.channels, s.block_size, 0.5f);
+                }
+            }
+        }
+    }
+
+    size_t periods = static_cast<size_t>(std::ceil(s.seconds * s.sample_rate / s.block_size));
+    clock_type::time_point start = clock_type::now() + std::chrono::milliseconds(20);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() { run_host_thread(s, sig, periods, start, hosts[t]); });
+    }
+    for (std::thread& w : workers) w.join();
+
+    result r;
+    r.threads = threads;
+    r.instances = s.instances;
+    r.cycles = 0;
+    r.misses = 0;
+    r.period_us = s.block_size / s.sample_rate * 1e6;
+    r.mean_load = 0;
+    r.max_load = 0;
+    std::vector<double> callbacks, cycles;
+    double busy_us = 0;
+    for (host_thread& h : hosts) {
+        callbacks.insert(callbacks.end(), h.callback_us.begin(), h.callback_us.end());
+        cycles.insert(cycles.end(), h.cycle_us.begin(), h.cycle_us.end());
+        r.cycles += h.cycle_us.size();
+        r.misses += h.misses;
+        busy_us += h.busy_us;
+        double load = h.elapsed_us > 0 ? h.busy_us / h.elapsed_us : 0;
+        r.mean_load += load / threads;
+        r.max_load = std::max(r.max_load, load);
+    }
+    r.callback = summarize(callbacks);
+    r.cycle = summarize(cycles);
+
+    // Seconds of audio per instance, over the busy seconds it took
+    double audio_seconds = double(periods) * s.block_size / s.sample_rate;
+    r.instances_per_core = busy_us > 0 ? s.instances * audio_seconds / (busy_us * 1e-6) : 0;
+    return r;
+}
+
+static void write_console(std::ostream& out, const settings& s, const std::vector<result>& results) {
+    out << s.engine << " engine, " << s.channels << " channels, " << s.window_ms << " ms windows, "
+        << s.block_size << "-sample blocks at " << s.sample_rate << " Hz, " << s.seconds << " s "
+        << (s.paced ? "paced" : "unpaced") << " (period " << std::fixed << std::setprecision(0)
+        << s.block_size / s.sample_rate * 1e6 << " us)\n\n";
+    out << std::right << std::setw(8) << "threads" << std::setw(10) << "instances"
+        << std::setw(11) << "call p50" << std::setw(11) << "call p99" << std::setw(11) << "call p99.9"
+        << std::setw(11) << "call max" << std::setw(11) << "cycle p99" << std::setw(11) << "cycle max"
+        << std::setw(9) << "misses" << std::setw(9) << "miss %" << std::setw(8) << "load"
+        << std::setw(11) << "inst/core" << "\n";
+    for (const result& r : results) {
+        out << std::setw(8) << r.threads << std::setw(10) << r.instances
+            << std::setprecision(1)
+            << std::setw(11) << r.callback.p50 << std::setw(11) << r.callback.p99
+            << std::setw(11) << r.callback.p999 << std::setw(11) << r.callback.max
+            << std::setw(11) << r.cycle.p99 << std::setw(11) << r.cycle.max
+            << std::setw(9) << r.misses << std::setprecision(2) << std::setw(9) << r.miss_rate()
+            << std::setprecision(0) << std::setw(7) << 100 * r.mean_load << "%"
+            << std::setprecision(1) << std::setw(11) << r.instances_per_core << "\n";
+    }
+    out << "\n(times in us; load is the mean over threads)\n";
+}
+
+static void write_percentiles(std::ostream& out, const char* name, const percentiles& p) {
+    out << "\"" << name << "\": {\"p50_us\": " << p.p50 << ", \"p90_us\": " << p.p90
+        << ", \"p99_us\": " << p.p99 << ", \"p999_us\": " << p.p999
+        << ", \"max_us\": " << p.max << "}";
+}
+
+static void write_json(std::ostream& out, const settings& s, const std::vector<result>& results) {
+    out << std::setprecision(9);
+    out << "{\n  \"context\": {\n"
+        << "    \"engine\": \"" << s.engine << "\",\n"
+        << "    \"sample_rate\": " << s.sample_rate << ",\n"
+        << "    \"block_size\": " << s.block_size << ",\n"
+        << "    \"window_ms\": " << s.window_ms << ",\n"
+        << "    \"channels\": " << s.channels << ",\n"
+        << "    \"seconds\": " << s.seconds << ",\n"
+        << "    \"paced\": " << (s.paced ? "true" : "false") << ",\n"
+        << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "\n"
+        << "  },\n  \"runs\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const result& r = results[i];
+        out << (i ? "," : "") << "\n    {"
+            << "\"threads\": " << r.threads << ", "
+            << "\"instances\": " << r.instances << ", "
+            << "\"period_us\": " << r.period_us << ", "
+            << "\"cycles\": " << r.cycles << ", "
+            << "\"misses\": " << r.misses << ", "
+            << "\"miss_rate\": " << r.miss_rate() << ", ";
+        write_percentiles(out, "callback", r.callback);
+        out << ", ";
+        write_percentiles(out, "cycle", r.cycle);
+        out << ", \"mean_load\": " << r.mean_load << ", "
+            << "\"max_load\": " << r.max_load << ", "
+            << "\"instances_per_core\": " << r.instances_per_core << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static bool option(const char* arg, const char* name, std::string& value) {
+    size_t n = std::strlen(name);
+    if (std::strncmp(arg, name, n) != 0 || arg[n] != '=') return false;
+    value = arg + n + 1;
+    return true;
+}
+
+static int usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--engine=cdf|reassignment] [--instances=N]"
+              << " [--threads=M] [--block-size=512] [--sample-rate=48000] [--window-ms=50]"
+              << " [--channels=2] [--seconds=5] [--paced|--unpaced] [--sweep]"
+              << " [--format=console|json] [--max-miss-rate=percent]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    settings s;
+    std::string value;
+    for (int i = 1; i < argc; i++) {
+        if (option(argv[i], "--engine", s.engine) || option(argv[i], "--format", s.format)) {
+            continue;
+        } else if (option(argv[i], "--instances", value)) {
+            s.instances = std::atoi(value.c_str());
+        } else if (option(argv[i], "--threads", value)) {
+            s.threads = std::atoi(value.c_str());
+        } else if (option(argv[i], "--block-size", value)) {
+            s.block_size = std::atoi(value.c_str());
+        } else if (option(argv[i], "--sample-rate", value)) {
+            s.sample_rate = std::atof(value.c_str());
+        } else if (option(argv[i], "--window-ms", value)) {
+            s.window_ms = std::atof(value.c_str());
+        } else if (option(argv[i], "--channels", value)) {
+            s.channels = std::atoi(value.c_str());
+        } else if (option(argv[i], "--seconds", value)) {
+            s.seconds = std::atof(value.c_str());
+        } else if (option(argv[i], "--max-miss-rate", value)) {
+            s.max_miss_rate = std::atof(value.c_str());
+        } else if (std::strcmp(argv[i], "--paced") == 0) {
+            s.paced = true;
+        } else if (std::strcmp(argv[i], "--unpaced") == 0) {
+            s.paced = false;
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+            s.sweep = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    if (s.threads <= 0) s.threads = cores;
+    if (s.instances <= 0) s.instances = 2 * s.threads;
+    if ((s.engine != "cdf" && s.engine != "reassignment") ||
+        (s.format != "console" && s.format != "json") ||
+        s.block_size < 1 || !(s.sample_rate > 0) || !(s.window_ms > 0) ||
+        s.channels < 1 || !(s.seconds > 0) ||
+        s.block_size >= static_cast<int>(SIGNAL_SECONDS * s.sample_rate)) {
+        return usage(argv[0]);
+    }
+
+    std::vector<int> thread_counts;
+    if (s.sweep) {
+        for (int t = 1; t < s.threads; t *= 2) thread_counts.push_back(t);
+    }
+    thread_counts.push_back(s.threads);
+
+    std::vector<result> results;
+    for (int t : thread_counts) results.push_back(run(s, std::min(t, s.instances)));
+
+    if (s.format == "json") write_json(std::cout, s, results);
+    else write_console(std::cout, s, results);
+
+    if (s.max_miss_rate >= 0) {
+        for (const result& r : results) {
+            if (r.miss_rate() > s.max_miss_rate) {
+                std::cerr << r.threads << " threads missed " << r.miss_rate() << "% of periods (limit "
+                          << s.max_miss_rate << "%)" << std::endl;
+                return 2;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * Offline render throughput against thread count
+ *
+ * Times, on synthetic input of the given length:
+ *   serial      analysis_frames, the interpolate loop and synthesis,
+ *               as example/transport.cpp runs them
+ *   N threads   offline_renderer::transport with a pool of N
+ *
+ * and checks every threaded render is bit-identical to the serial one.
+ *
+ * Usage: bench_offline_render [seconds] [max_threads]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+
+#include "audio_transport/offline_renderer.hpp"
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/equal_loudness.hpp"
+
+using namespace audio_transport;
+
+typedef std::chrono::steady_clock clock_type;
+
+const double SAMPLE_RATE = 44100.0;
+const double WINDOW_SIZE = 0.05;
+const unsigned int PADDING = 7; // as example/transport.cpp
+
+static double elapsed_ms(clock_type::time_point start) {
+    return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+}
+
+static std::vector<double> chirp(double f0, double f1, size_t samples) {
+    std::vector<double> audio(samples);
+    double phase = 0;
+    for (size_t i = 0; i < samples; i++) {
+        double f = f0 + (f1 - f0) * i / samples;
+        phase += 2.0 * M_PI * f / SAMPLE_RATE;
+        audio[i] = 0.5 * std::sin(phase) + 0.1 * std::sin(2.7 * phase);
+    }
+    return audio;
+}
+
+static double ramp(size_t w, size_t num_windows) {
+    return w / (double) num_windows;
+}
+
+static std::vector<double> serial_transport(const std::vector<double>& left,
+                                            const std::vector<double>& right) {
+    auto left_frames = spectral::analysis_frames(left, SAMPLE_RATE, WINDOW_SIZE, PADDING);
+    auto right_frames = spectral::analysis_frames(right, SAMPLE_RATE, WINDOW_SIZE, PADDING);
+    equal_loudness::apply(left_frames);
+    equal_loudness::apply(right_frames);
+
+    size_t num_windows = std::min(left_frames.size(), right_frames.size());
+    size_t num_bins = left_frames[0].size();
+    std::vector<double> phases(num_bins, 0);
+    interpolate_workspace workspace(num_bins);
+    std::vector<spectral::frame> output(num_windows);
+    for (size_t w = 0; w < num_windows; w++) {
+        interpolate(left_frames[w], right_frames[w], phases, WINDOW_SIZE,
+                    ramp(w, num_windows), output[w], workspace);
+    }
+
+    equal_loudness::remove(output);
+    return spectral::synthesis(output, PADDING);
+}
+
+int main(int argc, char** argv) {
+    double seconds = argc > 1 ? std::atof(argv[1]) : 10.0;
+    unsigned int max_threads = argc > 2 ? std::atoi(argv[2]) : std::thread::hardware_concurrency();
+    if (seconds <= 0) seconds = 10.0;
+    if (max_threads < 1) max_threads = 1;
+
+    size_t samples = static_cast<size_t>(seconds * SAMPLE_RATE);
+    std::vector<double> left = chirp(110.0, 880.0, samples);
+    std::vector<double> right = chirp(1760.0, 220.0, samples);
+
+    // Plan (and measure) the transforms outside the timings
+    spectral::get_analysis_layout(samples, SAMPLE_RATE, WINDOW_SIZE, PADDING);
+
+    clock_type::time_point start = clock_type::now();
+    std::vector<double> expected = serial_transport(left, right);
+    double serial = elapsed_ms(start);
+
+    std::cout << "Offline transport of " << seconds << " s, padding " << PADDING << "\n" << std::endl;
+    std::cout << std::left << std::setw(12) << "threads"
+              << std::right << std::setw(12) << "ms"
+              << std::setw(10) << "speedup"
+              << std::setw(12) << "x realtime" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << std::left << std::setw(12) << "serial"
+              << std::right << std::setw(12) << serial
+              << std::setw(10) << 1.0
+              << std::setw(12) << seconds * 1000.0 / serial << std::endl;
+
+    transport_settings settings;
+    settings.window_size = WINDOW_SIZE;
+    settings.padding = PADDING;
+    settings.interpolation = ramp;
+
+    bool identical = true;
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        offline_renderer renderer(threads);
+
+        start = clock_type::now();
+        std::vector<double> audio = renderer.transport(left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+        double ms = elapsed_ms(start);
+        identical = identical && audio == expected;
+
+        std::cout << std::left << std::setw(12) << threads
+                  << std::right << std::setw(12) << ms
+                  << std::setw(10) << serial / ms
+                  << std::setw(12) << seconds * 1000.0 / ms << std::endl;
+
+        if (threads < max_threads && threads * 2 > max_threads) threads = max_threads / 2;
+    }
+
+    std::cout << "\nThreaded output " << (identical ? "identical to" : "DIFFERS from")
+              << " serial" << std::endl;
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,469 @@
+/**
+ * Micro and macro benchmarks of the offline and realtime paths
+ *
+ * Each benchmark runs for every signal type (sines, noise, silence,
+ * transients) at a base configuration of 50 ms windows, padding 2, hop
+ * divisor 4 and blocks of 512 samples, and then sweeps one parameter
+ * at a time away from it:
+ *   window_ms    10, 25, 50, 100, 200
+ *   padding      0, 1, 2, 3 (the realtime engines' fft multiplier or
+ *                padding; spectral:: takes it as is)
+ *   hop_divisor  2, 4 (overlap 1 and 2 offline)
+ *   block_size   32, 128, 512, 2048 (realtime engines only)
+ *
+ * The silence signal shows the engines' silence gate at work, and the
+ * /frozen engine cases hold the sidechain once the engine is primed.
+ * The /low-latency cases resynthesize 6 ms per hop (the reassignment
+ * engine at hop divisor 1, which that mode needs).
+ *
+ * Every case repeats its operation for at least --min-time seconds and
+ * reports the mean, median, 99th percentile and maximum time per
+ * iteration, the audio one iteration stands for, and from that the
+ * realtime factor: how many seconds of audio one core gets through per
+ * second, which for the realtime engines is also how many instances
+ * one core can run.
+ *
+ * Usage: bench_suite [--format=console|csv|json] [--out=file]
+ *                    [--filter=substring] [--min-time=seconds]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+typedef std::chrono::steady_clock clock_type;
+
+const double SAMPLE_RATE = 44100.0;
+const double SIGNAL_SECONDS = 0.5;
+const double LOW_LATENCY_SYNTHESIS_MS = 6.0;
+
+struct config {
+    std::string signal;
+    double window_ms;
+    int padding;
+    int hop_divisor;
+    int block_size; // 0 where it does not apply
+};
+
+struct result {
+    std::string benchmark;
+    config c;
+    size_t iterations;
+    double mean_ns, median_ns, p99_ns, max_ns;
+    double audio_seconds; // per iteration
+
+    double realtime_factor() const { return audio_seconds * 1e9 / mean_ns; }
+    long instances_per_core() const { return static_cast<long>(std::floor(realtime_factor())); }
+};
+
+static double min_time = 0.2;
+
+// The engines log their configuration on construction
+struct silence_cout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    silence_cout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~silence_cout() { std::cout.rdbuf(saved); }
+};
+
+// Deterministic test signals; other selects a second, different one
+// of the same kind for the far side of a transport
+static std::vector<double> make_signal(const std::string& type, size_t samples, bool other) {
+    std::vector<double> audio(samples, 0.0);
+    unsigned int seed = other ? 4242 : 1234;
+    double f0 = other ? 330.0 : 220.0;
+
+    for (size_t i = 0; i < samples; i++) {
+        double t = i / SAMPLE_RATE;
+        if (type == "sines") {
+            audio[i] = 0.4 * std::sin(2 * M_PI * f0 * t)
+                     + 0.2 * std::sin(2 * M_PI * 2.5 * f0 * t)
+                     + 0.1 * std::sin(2 * M_PI * 7.1 * f0 * t);
+        } else if (type == "noise") {
+            seed = seed * 1664525u + 1013904223u;
+            audio[i] = 0.5 * ((seed >> 8) / double(1 << 24) - 0.5);
+        } else if (type == "transients") {
+            // Decaying noise bursts every 125 ms (offset for other)
+            seed = seed * 1664525u + 1013904223u;
+            double since = std::fmod(t + (other ? 0.06 : 0.0), 0.125);
+            audio[i] = std::exp(-since * 80.0) * ((seed >> 8) / double(1 << 24) - 0.5);
+        }
+        // silence stays 0
+    }
+    return audio;
+}
+
+template <typename Operation>
+static result measure(const std::string& name, const config& c, double audio_seconds,
+                      Operation operation) {
+    operation(); // warm up caches, plans and lazily sized buffers
+
+    std::vector<double> times;
+    times.reserve(1 << 16);
+    clock_type::time_point begin = clock_type::now();
+    for (;;) {
+        clock_type::time_point start = clock_type::now();
+        operation();
+        clock_type::time_point end = clock_type::now();
+        times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+
+        double elapsed = std::chrono::duration<double>(end - begin).count();
+        if ((elapsed >= min_time && times.size() >= 3) || times.size() >= (1u << 20)) break;
+    }
+
+    result r;
+    r.benchmark = name;
+    r.c = c;
+    r.iterations = times.size();
+    r.audio_seconds = audio_seconds;
+
+    double sum = 0;
+    for (double t : times) sum += t;
+    r.mean_ns = sum / times.size();
+    std::sort(times.begin(), times.end());
+    r.median_ns = times[times.size() / 2];
+    r.p99_ns = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+    r.max_ns = times.back();
+    return r;
+}
+
+// Offline analysis settings for a config
+static double window_seconds(const config& c) { return c.window_ms / 1000.0; }
+static unsigned int overlap(const config& c) { return c.hop_divisor / 2; }
+
+// The frames of both signals, as the micro benchmarks consume them
+struct analysed {
+    std::vector<spectral::frame> left, right;
+    double hop_seconds;
+};
+
+static analysed analyse(const config& c) {
+    size_t samples = static_cast<size_t>(SIGNAL_SECONDS * SAMPLE_RATE);
+    analysed a;
+    a.left = spectral::analysis_frames(make_signal(c.signal, samples, false), SAMPLE_RATE,
+                                       window_seconds(c), c.padding, overlap(c));
+    a.right = spectral::analysis_frames(make_signal(c.signal, samples, true), SAMPLE_RATE,
+                                        window_seconds(c), c.padding, overlap(c));
+    size_t n = std::min(a.left.size(), a.right.size());
+    a.left.resize(n);
+    a.right.resize(n);
+    spectral::analysis_layout layout = spectral::get_analysis_layout(
+        samples, SAMPLE_RATE, window_seconds(c), c.padding, overlap(c));
+    a.hop_seconds = layout.hop_size / SAMPLE_RATE;
+    return a;
+}
+
+static void magnitudes(const spectral::frame& f, std::vector<double>& out) {
+    out.resize(f.size());
+    for (size_t i = 0; i < f.size(); i++) out[i] = std::abs(f.value(i));
+}
+
+static result bench_analysis(const config& c) {
+    size_t samples = static_cast<size_t>(SIGNAL_SECONDS * SAMPLE_RATE);
+    std::vector<double> audio = make_signal(c.signal, samples, false);
+    return measure("spectral::analysis", c, SIGNAL_SECONDS, [&]() {
+        std::vector<spectral::frame> frames = spectral::analysis_frames(
+            audio, SAMPLE_RATE, window_seconds(c), c.padding, overlap(c));
+        if (frames.empty()) std::abort();
+    });
+}
+
+static result bench_synthesis(const config& c) {
+    analysed a = analyse(c);
+    return measure("spectral::synthesis", c, SIGNAL_SECONDS, [&]() {
+        std::vector<double> audio = spectral::synthesis(a.left, c.padding, overlap(c));
+        if (audio.empty()) std::abort();
+    });
+}
+
+static result bench_group_spectrum(const config& c) {
+    analysed a = analyse(c);
+    std::vector<std::vector<double>> mags(a.left.size());
+    for (size_t w = 0; w < a.left.size(); w++) magnitudes(a.left[w], mags[w]);
+
+    std::vector<spectral_mass> masses;
+    masses.reserve(a.left[0].size());
+    size_t w = 0;
+    return measure("group_spectrum", c, a.hop_seconds, [&]() {
+        const spectral::frame& f = a.left[w];
+        group_spectrum(mags[w].data(), f.freq.data(), f.freq_reassigned.data(), f.size(), masses);
+        w = (w + 1) % a.left.size();
+    });
+}
+
+static result bench_transport_matrix(const config& c) {
+    analysed a = analyse(c);
+    size_t n = a.left.size();
+    std::vector<std::vector<spectral_mass>> left(n), right(n);
+    std::vector<double> mags;
+    for (size_t w = 0; w < n; w++) {
+        magnitudes(a.left[w], mags);
+        group_spectrum(mags.data(), a.left[w].freq.data(), a.left[w].freq_reassigned.data(),
+                       a.left[w].size(), left[w]);
+        magnitudes(a.right[w], mags);
+        group_spectrum(mags.data(), a.right[w].freq.data(), a.right[w].freq_reassigned.data(),
+                       a.right[w].size(), right[w]);
+    }
+
+    std::vector<std::tuple<size_t, size_t, double>> T;
+    size_t w = 0;
+    return measure("transport_matrix", c, a.hop_seconds, [&]() {
+        transport_matrix(left[w], right[w], T);
+        w = (w + 1) % n;
+    });
+}
+
+static result bench_interpolate(const config& c) {
+    analysed a = analyse(c);
+    size_t num_bins = a.left[0].size();
+    std::vector<double> phases(num_bins, 0.0);
+    interpolate_workspace workspace(num_bins);
+    spectral::frame output;
+    output.reserve(num_bins);
+
+    size_t w = 0;
+    return measure("interpolate", c, a.hop_seconds, [&]() {
+        interpolate(a.left[w], a.right[w], phases, window_seconds(c), 0.5, output, workspace);
+        w = (w + 1) % a.left.size();
+    });
+}
+
+// frozen freezes the sidechain once the latency is filled
+template <typename Engine>
+static result bench_engine(const std::string& name, const config& c, bool frozen = false,
+                           double synthesis_ms = 0.0) {
+    std::unique_ptr<Engine> engine;
+    {
+        silence_cout quiet;
+        engine.reset(new Engine(SAMPLE_RATE, c.window_ms, c.hop_divisor, c.padding, synthesis_ms));
+    }
+
+    size_t samples = static_cast<size_t>(SIGNAL_SECONDS * SAMPLE_RATE);
+    std::vector<double> main_signal = make_signal(c.signal, samples, false);
+    std::vector<double> sidechain_signal = make_signal(c.signal, samples, true);
+    std::vector<float> main(main_signal.begin(), main_signal.end());
+    std::vector<float> sidechain(sidechain_signal.begin(), sidechain_signal.end());
+    std::vector<float> output(c.block_size);
+
+    // Fill the engine's latency before timing
+    size_t position = 0;
+    auto block = [&]() {
+        if (position + c.block_size > samples) position = 0;
+        engine->process(main.data() + position, sidechain.data() + position,
+                        output.data(), c.block_size, 0.5f);
+        position += c.block_size;
+    };
+    for (int filled = 0; filled < engine->getLatencySamples(); filled += c.block_size) block();
+    engine->setSidechainFrozen(frozen);
+
+    return measure(name, c, c.block_size / SAMPLE_RATE, block);
+}
+
+struct benchmark {
+    std::string name;
+    bool realtime;
+    std::function<result(const config&)> run;
+};
+
+static std::vector<benchmark> benchmarks() {
+    std::vector<benchmark> list;
+    list.push_back({ "spectral::analysis", false, bench_analysis });
+    list.push_back({ "spectral::synthesis", false, bench_synthesis });
+    list.push_back({ "group_spectrum", false, bench_group_spectrum });
+    list.push_back({ "transport_matrix", false, bench_transport_matrix });
+    list.push_back({ "interpolate", false, bench_interpolate });
+    list.push_back({ "RealtimeAudioTransport::process", true, [](const config& c) {
+        return bench_engine<RealtimeAudioTransport>("RealtimeAudioTransport::process", c);
+    } });
+    list.push_back({ "RealtimeReassignmentTransport::process", true, [](const config& c) {
+        return bench_engine<RealtimeReassignmentTransport>("RealtimeReassignmentTransport::process", c);
+    } });
+    list.push_back({ "RealtimeAudioTransport::process/frozen", true, [](const config& c) {
+        return bench_engine<RealtimeAudioTransport>("RealtimeAudioTransport::process/frozen", c, true);
+    } });
+    list.push_back({ "RealtimeReassignmentTransport::process/frozen", true, [](const config& c) {
+        return bench_engine<RealtimeReassignmentTransport>("RealtimeReassignmentTransport::process/frozen", c, true);
+    } });
+    list.push_back({ "RealtimeAudioTransport::process/low-latency", true, [](const config& c) {
+        return bench_engine<RealtimeAudioTransport>("RealtimeAudioTransport::process/low-latency", c,
+                                                    false, LOW_LATENCY_SYNTHESIS_MS);
+    } });
+    list.push_back({ "RealtimeReassignmentTransport::process/low-latency", true, [](const config& c) {
+        config low = c; low.hop_divisor = 1;
+        return bench_engine<RealtimeReassignmentTransport>("RealtimeReassignmentTransport::process/low-latency", low,
+                                                           false, LOW_LATENCY_SYNTHESIS_MS);
+    } });
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    list.push_back({ "RealtimeAudioTransportFloat::process", true, [](const config& c) {
+        return bench_engine<RealtimeAudioTransportFloat>("RealtimeAudioTransportFloat::process", c);
+    } });
+    list.push_back({ "RealtimeReassignmentTransportFloat::process", true, [](const config& c) {
+        return bench_engine<RealtimeReassignmentTransportFloat>("RealtimeReassignmentTransportFloat::process", c);
+    } });
+#endif
+    return list;
+}
+
+// The base configuration and one-parameter sweeps away from it
+static std::vector<config> configs(bool realtime) {
+    const char* signals[] = { "sines", "noise", "silence", "transients" };
+    const double windows[] = { 10, 25, 50, 100, 200 };
+    const int paddings[] = { 0, 1, 2, 3 };
+    const int hop_divisors[] = { 2, 4 };
+    const int block_sizes[] = { 32, 128, 512, 2048 };
+
+    std::vector<config> list;
+    for (const char* signal : signals) {
+        config base = { signal, 50, 2, 4, realtime ? 512 : 0 };
+        list.push_back(base);
+        for (double w : windows) {
+            config c = base; c.window_ms = w;
+            if (w != base.window_ms) list.push_back(c);
+        }
+        for (int p : paddings) {
+            config c = base; c.padding = p;
+            // The CDF engine's fft multiplier must be at least 1
+            if (p != base.padding && !(realtime && p == 0)) list.push_back(c);
+        }
+        for (int h : hop_divisors) {
+            config c = base; c.hop_divisor = h;
+            if (h != base.hop_divisor) list.push_back(c);
+        }
+        if (realtime) {
+            for (int b : block_sizes) {
+                config c = base; c.block_size = b;
+                if (b != base.block_size) list.push_back(c);
+            }
+        }
+    }
+    return list;
+}
+
+static void write_console(std::ostream& out, const std::vector<result>& results) {
+    out << std::left << std::setw(44) << "benchmark" << std::setw(11) << "signal"
+        << std::right << std::setw(7) << "ms" << std::setw(5) << "pad" << std::setw(5) << "hop"
+        << std::setw(7) << "block" << std::setw(10) << "iters"
+        << std::setw(12) << "mean us" << std::setw(12) << "p99 us"
+        << std::setw(12) << "x realtime" << "\n";
+    for (const result& r : results) {
+        out << std::left << std::setw(44) << r.benchmark << std::setw(11) << r.c.signal
+            << std::right << std::fixed << std::setprecision(0)
+            << std::setw(7) << r.c.window_ms << std::setw(5) << r.c.padding
+            << std::setw(5) << r.c.hop_divisor << std::setw(7) << r.c.block_size
+            << std::setw(10) << r.iterations
+            << std::setprecision(2)
+            << std::setw(12) << r.mean_ns / 1000 << std::setw(12) << r.p99_ns / 1000
+            << std::setprecision(1) << std::setw(12) << r.realtime_factor() << "\n";
+    }
+}
+
+static void write_csv(std::ostream& out, const std::vector<result>& results) {
+    out << "benchmark,signal,window_ms,padding,hop_divisor,block_size,iterations,"
+           "mean_ns,median_ns,p99_ns,max_ns,audio_seconds,realtime_factor,instances_per_core\n";
+    out << std::setprecision(9);
+    for (const result& r : results) {
+        out << r.benchmark << ',' << r.c.signal << ',' << r.c.window_ms << ','
+            << r.c.padding << ',' << r.c.hop_divisor << ',' << r.c.block_size << ','
+            << r.iterations << ',' << r.mean_ns << ',' << r.median_ns << ','
+            << r.p99_ns << ',' << r.max_ns << ',' << r.audio_seconds << ','
+            << r.realtime_factor() << ',' << r.instances_per_core() << '\n';
+    }
+}
+
+static void write_json(std::ostream& out, const std::vector<result>& results) {
+    out << std::setprecision(9);
+    out << "{\n  \"context\": {\n"
+        << "    \"sample_rate\": " << SAMPLE_RATE << ",\n"
+        << "    \"min_time\": " << min_time << ",\n"
+        << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << "\n"
+        << "  },\n  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const result& r = results[i];
+        out << (i ? "," : "") << "\n    {"
+            << "\"benchmark\": \"" << r.benchmark << "\", "
+            << "\"signal\": \"" << r.c.signal << "\", "
+            << "\"window_ms\": " << r.c.window_ms << ", "
+            << "\"padding\": " << r.c.padding << ", "
+            << "\"hop_divisor\": " << r.c.hop_divisor << ", "
+            << "\"block_size\": " << r.c.block_size << ", "
+            << "\"iterations\": " << r.iterations << ", "
+            << "\"mean_ns\": " << r.mean_ns << ", "
+            << "\"median_ns\": " << r.median_ns << ", "
+            << "\"p99_ns\": " << r.p99_ns << ", "
+            << "\"max_ns\": " << r.max_ns << ", "
+            << "\"audio_seconds\": " << r.audio_seconds << ", "
+            << "\"realtime_factor\": " << r.realtime_factor() << ", "
+            << "\"instances_per_core\": " << r.instances_per_core() << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static bool option(const char* arg, const char* name, std::string& value) {
+    size_t n = std::strlen(name);
+    if (std::strncmp(arg, name, n) != 0 || arg[n] != '=') return false;
+    value = arg + n + 1;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string format = "console", out_path, filter, value;
+    for (int i = 1; i < argc; i++) {
+        if (option(argv[i], "--format", format) || option(argv[i], "--out", out_path) ||
+            option(argv[i], "--filter", filter)) {
+            continue;
+        } else if (option(argv[i], "--min-time", value)) {
+            min_time = std::atof(value.c_str());
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--format=console|csv|json] [--out=file]"
+                      << " [--filter=substring] [--min-time=seconds]" << std::endl;
+            return 1;
+        }
+    }
+    if (format != "console" && format != "csv" && format != "json") {
+        std::cerr << "Unknown format " << format << std::endl;
+        return 1;
+    }
+
+    std::vector<result> results;
+    for (const benchmark& b : benchmarks()) {
+        if (b.name.find(filter) == std::string::npos) continue;
+        for (const config& c : configs(b.realtime)) {
+            std::cerr << b.name << " " << c.signal << " " << c.window_ms << " ms\r" << std::flush;
+            results.push_back(b.run(c));
+        }
+    }
+    std::cerr << std::string(72, ' ') << "\r";
+
+    std::ofstream file;
+    if (!out_path.empty()) {
+        file.open(out_path.c_str());
+        if (!file) {
+            std::cerr << "Could not open " << out_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = out_path.empty() ? std::cout : file;
+
+    if (format == "csv") write_csv(out, results);
+    else if (format == "json") write_json(out, results);
+    else write_console(out, results);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <audiorw.hpp>
+
+#include "audio_transport/morph_cache.hpp"
+
+double window_size = 0.05; // seconds
+unsigned int padding = 7; // multiplies window size
+
+int main(int argc, char ** argv) {
+
+  if (argc < 7 || (argc - 4) % 3 != 0) {
+    std::cout <<
+      "Usage: " << argv[0] << " left_file right_file cache_file"
+      " start_percent end_percent output_file [start_percent end_percent output_file ...]"
+      << std::endl <<
+      "Analyzes the pair once (or reuses cache_file.<channel> from an earlier run)"
+      " and renders every envelope from it." << std::endl;
+    return 1;
+  }
+
+  // Open the audio files
+  double sample_rate_left;
+  std::vector<std::vector<double>> audio_left =
+    audiorw::read(argv[1], sample_rate_left);
+  double sample_rate_right;
+  std::vector<std::vector<double>> audio_right =
+    audiorw::read(argv[2], sample_rate_right);
+
+  audio_transport::transport_settings settings;
+  settings.window_size = window_size;
+  settings.padding = padding;
+
+  // One cache per channel, loaded if it was made from files of these
+  // lengths with these settings
+  size_t num_channels = std::min(audio_left.size(), audio_right.size());
+  std::vector<audio_transport::morph_cache> caches(num_channels);
+  for (size_t c = 0; c < num_channels; c++) {
+    std::string path = std::string(argv[3]) + "." + std::to_string(c);
+    audio_transport::morph_cache & cache = caches[c];
+    if (cache.load(path) &&
+        cache.left_length() == audio_left[c].size() &&
+        cache.right_length() == audio_right[c].size() &&
+        cache.left_sample_rate() == sample_rate_left &&
+        cache.right_sample_rate() == sample_rate_right &&
+        cache.window_size() == window_size && cache.padding() == padding) {
+      std::cout << "Reusing " << path << std::endl;
+      continue;
+    }
+
+    std::cout << "Analyzing channel " << c << std::endl;
+    cache = audio_transport::morph_cache(
+        audio_left[c], sample_rate_left, audio_right[c], sample_rate_right, settings);
+    if (!cache.save(path)) {
+      std::cout << "Could not write " << path << std::endl;
+    }
+  }
+
+  // Render each envelope from the caches
+  for (int arg = 4; arg + 2 < argc; arg += 3) {
+    double start_fraction = std::atof(argv[arg])/100.;
+    double end_fraction = std::atof(argv[arg + 1])/100.;
+    auto interpolation = [&](size_t w, size_t num_windows) {
+      double interpolation_factor = w/(double) num_windows;
+      interpolation_factor = (interpolation_factor - start_fraction)/(end_fraction - start_fraction);
+      return std::min(1.,std::max(0.,interpolation_factor));
+    };
+
+    std::vector<std::vector<double>> audio_interpolated(num_channels);
+    for (size_t c = 0; c < num_channels; c++) {
+      audio_interpolated[c] = caches[c].render(interpolation);
+    }
+
+    std::cout << "Writing to file " << argv[arg + 2] << std::endl;
+    audiorw::write(audio_interpolated, argv[arg + 2], sample_rate_left);
+  }
+}
@@ -3,8 +3,8 @@
 #include <audiorw.hpp>
 
 #include "audio_transport/spectral.hpp"
-#include "audio_transport/audio_transport.hpp"
-#include "audio_transport/equal_loudness.hpp"
+#include "audio_transport/offline_renderer.hpp"
+#include "audio_transport/diagnostics.hpp"
 
 double window_size = 0.05; // seconds
 unsigned int padding = 7; // multiplies window size
@@ -43,75 +43,63 @@ int main(int argc, char ** argv) {
   size_t num_channels = std::min(audio_left.size(), audio_right.size());
   std::vector<std::vector<double>> audio_interpolated(num_channels);
 
+  // Render each channel on every core
+  audio_transport::offline_renderer renderer;
+  std::cout << "Rendering on " << renderer.num_threads() << " threads" << std::endl;
+
+  audio_transport::transport_settings settings;
+  settings.window_size = window_size;
+  settings.padding = padding;
+  settings.interpolation = [&](size_t w, size_t num_windows) {
+    double interpolation_factor = w/(double) num_windows;
+    interpolation_factor = (interpolation_factor - start_fraction)/(end_fraction - start_fraction);
+    return std::min(1.,std::max(0.,interpolation_factor));
+  };
+
+  // Log windows whose output energy significantly exceeds the input
+  settings.on_window = [&](size_t w,
+                           const audio_transport::spectral::frame & left,
+                           const audio_transport::spectral::frame & right,
+                           const audio_transport::spectral::frame & output) {
+    double left_energy = 0, right_energy = 0, output_energy = 0;
+    for (size_t i = 0; i < left.size(); i++) {
+      left_energy += std::abs(left.value(i));
+    }
+    for (size_t i = 0; i < right.size(); i++) {
+      right_energy += std::abs(right.value(i));
+    }
+    for (size_t i = 0; i < output.size(); i++) {
+      output_energy += std::abs(output.value(i));
+    }
+    double max_input_energy = std::max(left_energy, right_energy);
+
+    double ratio = (max_input_energy > 0) ? output_energy / max_input_energy : 0;
+    if (ratio > 2.0) {
+      double time_sec = w * window_size / 2.0;  // approximate time
+      std::cout << "BLOWUP: window " << w << " (t=" << time_sec << "s) "
+                << "ratio=" << ratio << " "
+                << "left_e=" << left_energy << " right_e=" << right_energy
+                << " out_e=" << output_energy << std::endl;
+    }
+  };
+
   // Iterate over the channels
   for (size_t c = 0; c < num_channels; c++) {
 
     std::cout << "Processing channel " << c << std::endl;
+    audio_interpolated[c] = renderer.transport(
+        audio_left[c], sample_rate_left,
+        audio_right[c], sample_rate_right,
+        settings);
+  }
 
-    std::cout << "Converting left input to the spectral domain" << std::endl;
-    std::vector<std::vector<audio_transport::spectral::point>> points_left =
-      audio_transport::spectral::analysis(audio_left[c], sample_rate_left, window_size, padding);
-    std::cout << "Converting right input to the spectral domain" << std::endl;
-    std::vector<std::vector<audio_transport::spectral::point>> points_right =
-      audio_transport::spectral::analysis(audio_right[c], sample_rate_right, window_size, padding);
-
-    std::cout << "Applying equal loudness filters" << std::endl;
-    audio_transport::equal_loudness::apply(points_left);
-    audio_transport::equal_loudness::apply(points_right);
-
-    // Initialize phases
-    std::vector<double> phases(points_left[0].size(), 0);
-
-    std::cout << "Performing optimal transport based interpolation" << std::endl;
-    size_t num_windows = std::min(points_left.size(), points_right.size());
-    std::vector<std::vector<audio_transport::spectral::point>> points_interpolated(num_windows);
-    for (size_t w = 0; w < num_windows; w++) {
-      double interpolation_factor = w/(double) num_windows;
-      interpolation_factor = (interpolation_factor - start_fraction)/(end_fraction - start_fraction);
-      interpolation_factor = std::min(1.,std::max(0.,interpolation_factor));
-
-      // Compute input spectral energy for this window
-      double left_energy = 0, right_energy = 0;
-      for (size_t i = 0; i < points_left[w].size(); i++) {
-        left_energy += std::abs(points_left[w][i].value);
-      }
-      for (size_t i = 0; i < points_right[w].size(); i++) {
-        right_energy += std::abs(points_right[w][i].value);
-      }
-      double max_input_energy = std::max(left_energy, right_energy);
-
-      points_interpolated[w] =
-        audio_transport::interpolate(
-          points_left[w],
-          points_right[w],
-          phases,
-          window_size,
-          interpolation_factor);
-
-      // Compute output spectral energy
-      double output_energy = 0;
-      for (size_t i = 0; i < points_interpolated[w].size(); i++) {
-        output_energy += std::abs(points_interpolated[w][i].value);
-      }
-
-      // Log if output energy significantly exceeds input
-      double ratio = (max_input_energy > 0) ? output_energy / max_input_energy : 0;
-      if (ratio > 2.0) {
-        double time_sec = w * window_size / 2.0;  // approximate time
-        std::cout << "BLOWUP: window " << w << " (t=" << time_sec << "s) "
-                  << "ratio=" << ratio << " "
-                  << "left_e=" << left_energy << " right_e=" << right_energy
-                  << " out_e=" << output_energy
-                  << " interp=" << interpolation_factor << std::endl;
-      }
+  // Summarize the numerical warnings the transport ran into
+  for (size_t e = 0; e < audio_transport::diagnostics::num_events; e++) {
+    audio_transport::diagnostics::event type = (audio_transport::diagnostics::event) e;
+    if (audio_transport::diagnostics::total(type) > 0) {
+      std::cout << "Diagnostics: " << audio_transport::diagnostics::name(type)
+                << " x" << audio_transport::diagnostics::total(type) << std::endl;
     }
-
-    std::cout << "Removing equal loudness filters" << std::endl;
-    audio_transport::equal_loudness::remove(points_interpolated);
-
-    std::cout << "Converting the interpolation to the time domain" << std::endl;
-    audio_interpolated[c] = 
-      audio_transport::spectral::synthesis(points_interpolated, padding);
   }
 
   // Write the file
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "audio_transport/RealtimeEngine.hpp"
+#include "audio_transport/diagnostics.hpp"
+
+namespace audio_transport {
+
+/**
+ * Runs another realtime engine's hops on a worker thread, so that the
+ * audio callback only copies samples in and out instead of paying for
+ * a whole hop whenever its buffer crosses a hop boundary.
+ *
+ * The callback collects each hop of input into a job and hands it to
+ * the worker through a lock-free ring of jobs. The worker feeds the
+ * engine one hop at a time, so its hops line up with the jobs. Output
+ * comes back through the same jobs and is heard
+ * getPipelineLatency() samples later than the engine alone would give
+ * it. That is two hops plus one block less a sample: a hop completed
+ * in one callback has at least a hop's time to be computed before a
+ * callback needs it.
+ *
+ * A job the worker has not finished in time is heard as silence and
+ * its output discarded when it arrives; output stays aligned and
+ * getLateHops() counts them. If the worker falls so far behind that
+ * every job is in use, new hops are not handed to it at all (see
+ * getDroppedHops()).
+ *
+ * The callback makes no system calls. The worker is not woken but
+ * polls for jobs while it has none, every getPollInterval(): a quarter
+ * of a hop, clamped to [50 us, 1 ms]. The poll adds nothing to the
+ * pipeline latency. In the worst case a hop waits one interval before
+ * the worker starts it, which leaves at least three quarters of the
+ * hop's time to compute it (less only for hops under 200 us, where the
+ * floor applies).
+ *
+ * The worker asks for realtime scheduling, which the system may refuse
+ * (it then runs at normal priority). Its diagnostics reports go to
+ * getDiagnostics(), which a non-realtime thread can drain. Channel
+ * mode, silence threshold and freeze apply per hop, from the values
+ * set when the hop's last sample came in.
+ */
+class PipelinedEngine : public RealtimeEngine {
+public:
+    /**
+     * @param engine The engine to run; owned from here on
+     * @param max_block_size The largest buffer_size process() will be
+     *        called with. Larger blocks still work, but can make hops late.
+     */
+    PipelinedEngine(std::unique_ptr<RealtimeEngine> engine, int max_block_size);
+    ~PipelinedEngine();
+
+    PipelinedEngine(const PipelinedEngine&) = delete;
+    PipelinedEngine& operator=(const PipelinedEngine&) = delete;
+
+    void process(
+        const float* input_main,
+        const float* input_sidechain,
+        float* output,
+        int buffer_size,
+        float k
+    ) override;
+
+    void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        float k
+    ) override;
+
+    void process(
+        const float* input_main,
+        const float* input_sidechain,
+        float* output,
+        int buffer_size,
+        const float* k
+    ) override;
+
+    void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        const float* k
+    ) override;
+
+    // Stops the worker while the engine reallocates
+    void setNumChannels(int num_channels) override;
+    int getNumChannels() const override { return num_channels_; }
+
+    void setChannelMode(ChannelMode mode) override { channel_mode_ = mode; }
+    ChannelMode getChannelMode() const override { return channel_mode_; }
+
+    void setSilenceThreshold(float threshold) override { silence_threshold_ = threshold; }
+    float getSilenceThreshold() const override { return silence_threshold_; }
+
+    void setSidechainFrozen(bool frozen) override { sidechain_frozen_ = frozen; }
+    bool isSidechainFrozen() const override { return sidechain_frozen_; }
+
+    // Handed to the engine; both stop the worker while it changes
+    std::shared_ptr<const target_spectrum> makeTarget(
+        const float* audio, size_t num_samples, target_spectrum::mode playback) override;
+    bool setTarget(std::shared_ptr<const target_spectrum> target) override;
+    const target_spectrum* getTarget() const override { return engine_->getTarget(); }
+    target_spectrum::analysis getTargetAnalysis() const override { return engine_->getTargetAnalysis(); }
+
+    /**
+     * Handed to the engine, which records from the worker: block
+     * timings then cover its hop-sized calls, not the callbacks.
+     * Stops the worker while it changes.
+     */
+    void setInstrumentation(instrumentation::recorder* recorder) override;
+    instrumentation::recorder* getInstrumentation() const override { return engine_->getInstrumentation(); }
+
+    // Stops the worker while the engine and the jobs are cleared
+    void reset() override;
+
+    // The engine's latency plus getPipelineLatency()
+    int getLatencySamples() const override;
+    int getHopSize() const override { return hop_size_; }
+
+    /**
+     * While set, a callback whose output is due waits for the worker
+     * instead of handing out silence, for offline rendering where
+     * callbacks come faster than realtime. The callback then spins
+     * until the worker catches up, so this is for offline rendering
+     * and tests only, never a realtime audio thread. Safe to change
+     * between process() calls.
+     */
+    void setWaitForWorker(bool wait) { wait_for_worker_ = wait; }
+    bool getWaitForWorker() const { return wait_for_worker_; }
+
+    // Delay added by the worker, in samples
+    int getPipelineLatency() const { return pipeline_latency_; }
+
+    // How often an idle worker looks for a new job
+    std::chrono::microseconds getPollInterval() const { return poll_interval_; }
+
+    // Hops heard as silence because the worker had not finished them
+    // (or dropped because every job was in use) since the last reset
+    std::uint64_t getLateHops() const { return late_hops_.load(std::memory_order_relaxed); }
+
+    /**
+     * Hops never handed to the worker because every job was in use,
+     * since the last reset. The engine's history would join the hops
+     * either side of a gap as if they were adjacent, so the worker
+     * resets the engine before the first hop after one instead: output
+     * is silent for the engine's latency and then fades back in, rather
+     * than glitching.
+     */
+    std::uint64_t getDroppedHops() const { return dropped_hops_.load(std::memory_order_relaxed); }
+
+    diagnostics::channel& getDiagnostics() { return diagnostics_; }
+
+    RealtimeEngine& getEngine() { return *engine_; }
+
+private:
+    // One hop of every channel's input and, once the worker is done
+    // with it, output. Planar pointers into the buffers for the engine.
+    struct job {
+        std::uint64_t hop; // input samples [hop * hop_size_, + hop_size_)
+        std::vector<std::vector<float>> main, sidechain, output;
+        std::vector<const float*> main_pointers, sidechain_pointers;
+        std::vector<float*> output_pointers;
+        std::vector<float> k;
+        ChannelMode mode;
+        float silence_threshold;
+        bool sidechain_frozen;
+        bool restart;      // hops before this one were dropped
+    };
+
+    void processChannels(const float* const* input_main,
+                         const float* const* input_sidechain,
+                         float* const* output, int num_channels,
+                         int buffer_size, float k_value, const float* k_samples);
+
+    void allocateJobs();
+    void clearJobs();
+    void startWorker();
+    void stopWorker();
+    void workerLoop();
+
+    std::unique_ptr<RealtimeEngine> engine_;
+    int num_channels_;
+    int hop_size_;
+    int max_block_size_;
+    int pipeline_latency_;
+    std::chrono::microseconds poll_interval_;
+    ChannelMode channel_mode_;
+    float silence_threshold_;
+    bool sidechain_frozen_;
+    bool wait_for_worker_;
+
+    // Jobs in order of their index: the callback fills job tail_ and
+    // publishes it by advancing tail_, the worker advances done_ past
+    // each job it has run, and the callback advances read_ past jobs
+    // whose output it has used or discarded, which frees them
+    std::vector<job> jobs_;
+    std::atomic<std::uint64_t> tail_;
+    std::atomic<std::uint64_t> done_;
+    std::uint64_t read_;      // callback only
+    std::uint64_t position_;  // samples taken in (and handed out) since reset
+    bool filling_;            // the hop under position_ has a job
+    bool reading_;            // job read_ holds the output being handed out
+    bool dropped_;            // a hop was dropped since the last job
+    std::atomic<std::uint64_t> late_hops_;
+    std::atomic<std::uint64_t> dropped_hops_;
+
+    // The worker polls on a timed wait of wake_ while there is nothing
+    // to do; only stopWorker() notifies it
+    std::thread worker_;
+    std::atomic<bool> running_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+
+    diagnostics::channel diagnostics_;
+};
+
+} // namespace audio_transport
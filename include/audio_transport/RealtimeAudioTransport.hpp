@@ -3,7 +3,10 @@
 #include <vector>
 #include <complex>
 #include <memory>
-#include <fftw3.h>
+#include "audio_transport/fftw_traits.hpp"
+#include "audio_transport/RealtimeEngine.hpp"
+#include "audio_transport/silence_gate.hpp"
+#include "audio_transport/k_history.hpp"
 
 namespace audio_transport {
 
@@ -14,8 +17,12 @@ namespace audio_transport {
  * suitable for real-time processing with sidechain input.
  *
  * Based on Henderson & Solomon (DAFx 2019) - simplified Python implementation
+ *
+ * Real is the precision of the internal buffers and FFTs: double uses
+ * fftw_*, float uses fftwf_*. Input and output are float either way.
  */
-class RealtimeAudioTransport {
+template <typename Real>
+class BasicRealtimeAudioTransport : public RealtimeEngine {
 public:
     /**
      * Constructor
@@ -24,19 +31,29 @@ public:
      * @param window_ms Window size in milliseconds (default: 100ms)
      * @param hop_divisor Hop size as fraction of window (4 = 75% overlap)
      * @param fft_mult FFT size multiplier for zero-padding (2 = 2x zero-padding)
+     * @param synthesis_ms Low-latency synthesis length in milliseconds,
+     *                     or 0 for the full window
+     *
+     * With synthesis_ms shorter than the window, frames are analysed
+     * with the asymmetric window of spectral::asymmetric and only their
+     * last synthesis_ms is resynthesized, through a window that makes
+     * the pair overlap-add like the symmetric Hann pair. Latency and
+     * hop follow synthesis_ms; the CDFs keep the resolution of
+     * window_ms.
      */
-    RealtimeAudioTransport(
+    BasicRealtimeAudioTransport(
         double sample_rate = 44100.0,
         double window_ms = 100.0,
         int hop_divisor = 4,
-        int fft_mult = 2
+        int fft_mult = 2,
+        double synthesis_ms = 0.0
     );
 
-    ~RealtimeAudioTransport();
+    ~BasicRealtimeAudioTransport();
 
     // Prevent copying (due to FFTW plans)
-    RealtimeAudioTransport(const RealtimeAudioTransport&) = delete;
-    RealtimeAudioTransport& operator=(const RealtimeAudioTransport&) = delete;
+    BasicRealtimeAudioTransport(const BasicRealtimeAudioTransport&) = delete;
+    BasicRealtimeAudioTransport& operator=(const BasicRealtimeAudioTransport&) = delete;
 
     /**
      * Process a buffer of audio samples
@@ -53,12 +70,70 @@ public:
         float* output,
         int buffer_size,
         float k_value = 0.5f
-    );
+    ) override;
+
+    /**
+     * Process planar multichannel audio (see RealtimeEngine). In Linked
+     * mode one transport map, computed from the channels' summed
+     * magnitudes, is applied to every channel.
+     */
+    void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        float k_value
+    ) override;
+
+    /**
+     * Process with one interpolation factor per sample (see
+     * RealtimeEngine)
+     */
+    void process(
+        const float* input_main,
+        const float* input_sidechain,
+        float* output,
+        int buffer_size,
+        const float* k
+    ) override;
+
+    void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        const float* k
+    ) override;
+
+    void setNumChannels(int num_channels) override;
+    int getNumChannels() const override { return num_channels_; }
+
+    void setChannelMode(ChannelMode mode) override { channel_mode_ = mode; }
+    ChannelMode getChannelMode() const override { return channel_mode_; }
+
+    void setSilenceThreshold(float threshold) override { silence_threshold_ = threshold; }
+    float getSilenceThreshold() const override { return silence_threshold_; }
+
+    void setSidechainFrozen(bool frozen) override { sidechain_frozen_ = frozen; }
+    bool isSidechainFrozen() const override { return sidechain_frozen_; }
+
+    void setInstrumentation(instrumentation::recorder* recorder) override { instrumentation_ = recorder; }
+    instrumentation::recorder* getInstrumentation() const override { return instrumentation_; }
+
+    // Targets (see RealtimeEngine); setSampleRate() drops a target
+    // of the old rate
+    std::shared_ptr<const target_spectrum> makeTarget(
+        const float* audio, size_t num_samples, target_spectrum::mode playback) override;
+    bool setTarget(std::shared_ptr<const target_spectrum> target) override;
+    const target_spectrum* getTarget() const override { return target_.get(); }
+    target_spectrum::analysis getTargetAnalysis() const override;
 
     /**
      * Reset the processor state (clear buffers, reset phase tracking)
      */
-    void reset();
+    void reset() override;
 
     /**
      * Set sample rate (requires reconstruction of FFTW plans)
@@ -68,88 +143,265 @@ public:
     /**
      * Get current latency in samples
      */
-    int getLatencySamples() const { return window_size_ / 2; }
+    int getLatencySamples() const override { return synthesis_size_ - 1; }
+
+    /**
+     * Get hop size in samples
+     */
+    int getHopSize() const override { return hop_size_; }
+
+    /**
+     * How source bins are mapped onto the target distribution
+     */
+    enum class TransportMapMode {
+        Nearest,    // First target bin whose CDF reaches F_X(x)
+        Fractional  // Sub-bin position on the piecewise linear inverse CDF
+    };
+
+    void setTransportMapMode(TransportMapMode mode) { map_mode_ = mode; }
+    TransportMapMode getTransportMapMode() const { return map_mode_; }
+
+    /**
+     * T(x) = F_Y^{-1}(F_X(x)) for two monotone CDFs of equal length,
+     * computed with a single two-pointer merge in O(N).
+     *
+     * transport_map[i] is the smallest j with cdf_Y[j] >= cdf_X[i]
+     * (within eps), or the last bin if there is none.
+     */
+    static void mergeTransportMap(
+        const std::vector<Real>& cdf_X,
+        const std::vector<Real>& cdf_Y,
+        std::vector<int>& transport_map
+    );
+
+    /**
+     * Fractional form of mergeTransportMap: positions[i] interpolates
+     * linearly between the two target bins whose CDF values bracket
+     * cdf_X[i].
+     */
+    static void mergeFractionalTransportMap(
+        const std::vector<Real>& cdf_X,
+        const std::vector<Real>& cdf_Y,
+        std::vector<Real>& positions
+    );
 
 private:
     // Parameters
     double sample_rate_;
+    double window_ms_;     // Window size in milliseconds
+    double synthesis_ms_;  // Low-latency synthesis length, 0 if off
+    int hop_divisor_;
+    int fft_mult_;
     int window_size_;      // Window size in samples
+    int synthesis_size_;   // Samples resynthesized per frame
     int hop_size_;         // Hop size in samples
     int fft_size_;         // FFT size (with zero-padding)
     int num_bins_;         // Number of frequency bins (fft_size/2 + 1)
+    TransportMapMode map_mode_;
+    int num_channels_;
+    ChannelMode channel_mode_;
+    float silence_threshold_;
+    bool sidechain_frozen_;
+    instrumentation::recorder* instrumentation_;
 
-    // Buffers for input accumulation
-    std::vector<double> main_buffer_;
-    std::vector<double> sidechain_buffer_;
-    std::vector<double> output_buffer_;
+    // Input history as mirrored rings of 2 * window_size_, one per
+    // channel: every sample is stored at p and p + window_size_, so the
+    // latest window is always the contiguous span starting at
+    // buffer_write_pos_ (oldest first). All channels move in step.
+    std::vector<std::vector<Real>> main_buffers_;
+    std::vector<std::vector<Real>> sidechain_buffers_;
     int buffer_write_pos_;
-    int buffer_read_pos_;
-    int samples_in_buffer_;
+    int samples_in_buffer_; // since the last hop
 
-    // Hann window
-    std::vector<double> window_;
+    // How long each input has been silent, per channel
+    std::vector<silence_gate> main_gates_;
+    std::vector<silence_gate> sidechain_gates_;
 
-    // FFTW plans and buffers
-    fftw_plan fft_plan_;
-    fftw_plan ifft_plan_;
-    double* fft_input_;
-    fftw_complex* fft_output_;
-    fftw_complex* ifft_input_;
-    double* ifft_output_;
+    // Analysis window (Hann, or asymmetric in low-latency mode) and the
+    // synthesis window for the last synthesis_size_ samples of a frame
+    std::vector<Real> window_;
+    std::vector<Real> synthesis_window_;
+
+    // FFTW buffers and plans (plans are shared, see fft_plans.hpp).
+    // fft_input_ holds the main then the sidechain frame,
+    // real_distance_ apart, and fft_output_ their spectra,
+    // complex_distance_ apart, for paired_fft_plan_ to transform both.
+    typedef fftw_traits<Real> fft;
+    typename fft::plan fft_plan_;
+    typename fft::plan paired_fft_plan_;
+    typename fft::plan ifft_plan_;
+    size_t real_distance_;
+    size_t complex_distance_;
+    Real* fft_input_;
+    typename fft::complex* fft_output_;
+    typename fft::complex* ifft_input_;
+    Real* ifft_output_;
 
     // Spectral buffers for processing
-    std::vector<std::complex<double>> spectrum_main_;
-    std::vector<std::complex<double>> spectrum_sidechain_;
-    std::vector<std::complex<double>> spectrum_output_;
+    std::vector<std::complex<Real>> spectrum_main_;
+    std::vector<std::complex<Real>> spectrum_sidechain_;
+    std::vector<std::complex<Real>> spectrum_output_;
+
+    // Low-latency mode only (empty otherwise), per channel: the phases
+    // of the last analysed spectra, how far each bin's phase turned
+    // over that hop, and the phase each main bin's partial has gained
+    // from being moved. moved_phase_ is phase_X_ plus that gain.
+    std::vector<std::vector<Real>> last_phase_X_, last_phase_Y_;
+    std::vector<std::vector<Real>> advance_X_, advance_Y_;
+    std::vector<std::vector<Real>> phases_;
+    std::vector<Real> moved_phase_;
 
-    // Phase tracking for coherence
-    std::vector<double> phases_;
+    // The factor of every recent input sample, for hops of a per-sample
+    // process() to read at the centre of their frame
+    k_history k_history_;
 
-    // Overlap-add buffer for output
-    std::vector<double> ola_buffer_;
+    // Overlap-add rings for output (2 * window_size_, one per channel);
+    // ola_write_pos_ is the next sample handed to the caller
+    std::vector<std::vector<Real>> ola_buffers_;
     int ola_write_pos_;
 
+    // Per-hop working storage. Everything process() touches is sized
+    // by allocateBuffers() so the audio callback never allocates.
+    // Polar spectra are kept per channel for the linked map.
+    std::vector<std::vector<Real>> mag_X_, mag_Y_;
+    std::vector<std::vector<Real>> phase_X_, phase_Y_;
+    std::vector<Real> mag_X_sum_, mag_Y_sum_;
+    std::vector<Real> mag_out_, phase_out_;
+    std::vector<Real> output_frame_;
+    std::vector<int> transport_map_;
+    std::vector<Real> transport_positions_;
+    std::vector<Real> interp_positions_;
+    std::vector<Real> weight_sum_;
+    std::vector<Real> phase_num_;
+    std::vector<Real> cdf_X_, cdf_Y_;
+
+    // The target played instead of the sidechain, if any, the hop of
+    // it the next processHop() plays and the frame installed last hop
+    // (nullptr once mag_Y_ and phase_Y_ change otherwise)
+    std::shared_ptr<const target_spectrum> target_;
+    size_t target_hop_;
+    const target_spectrum::frame* installed_target_;
+
     // Helper functions
+    void computeSizes();
+    void allocateBuffers();
     void initializeFFTW();
     void destroyFFTW();
-    void computeSTFT(const std::vector<double>& input_buffer,
-                     std::vector<std::complex<double>>& spectrum);
-    void computeISTFT(const std::vector<std::complex<double>>& spectrum,
-                      std::vector<double>& output_frame);
+    // Analysis in three steps, so both inputs share one batched FFT:
+    // window a frame (side 0 is main, 1 the sidechain), transform the
+    // windowed frames, and read out a side's spectrum
+    void windowFrame(const Real* input_frame, int side);
+    void transformFrames(bool main, bool sidechain);
+    void readSpectrum(int side, std::vector<std::complex<Real>>& spectrum);
+    // Both process() overloads: k_samples gives a factor per sample,
+    // or is nullptr for k_value throughout
+    void processChannels(const float* const* input_main,
+                         const float* const* input_sidechain,
+                         float* const* output, int num_channels,
+                         int buffer_size, float k_value, const float* k_samples);
+
+    // Transform one hop of every channel and add the results into the
+    // overlap-add rings starting at ola_position
+    void processHop(float k_value, int ola_position);
+
+    // Low-latency mode: per-hop phase advances of a new spectrum, and
+    // the main phases of channel advanced to follow transport_positions_
+    void measureAdvance(const std::vector<Real>& phase,
+                        std::vector<Real>& last_phase,
+                        std::vector<Real>& advance);
+    const std::vector<Real>& movedPhases(int channel, Real k);
+
+    // Make frame every channel's sidechain spectrum. A frame installed
+    // again has its phases advanced by a hop.
+    void installTarget(const target_spectrum::frame& frame);
+
+    // Resynthesize mag_out_/phase_out_ into channel's ring at position
+    void synthesizeChannel(int channel, int position,
+                           instrumentation::hop_timer& timer);
+
+    // Add output_frame_ into channel's overlap-add ring at position
+    void overlapAdd(int channel, int position);
+    void computeISTFT(const std::vector<std::complex<Real>>& spectrum,
+                      std::vector<Real>& output_frame);
 
     /**
      * Compute 1D optimal transport map from X to Y using CDFs
      *
      * @param mag_X Source magnitude spectrum
+     * @param sum_X Its total, which must not be silent
      * @param mag_Y Target magnitude spectrum
-     * @param transport_map Output: transport_map[i] is the target bin for source bin i
+     * @param sum_Y Its total, likewise
+     * @param positions Output: positions[i] is the (possibly fractional)
+     *                  target bin for source bin i, per map_mode_
      */
     void computeTransportMap(
-        const std::vector<double>& mag_X,
-        const std::vector<double>& mag_Y,
-        std::vector<int>& transport_map
+        const std::vector<Real>& mag_X,
+        double sum_X,
+        const std::vector<Real>& mag_Y,
+        double sum_Y,
+        std::vector<Real>& positions
+    );
+
+    /**
+     * mag_out = scale * mag, phase_out = phase: the whole morph when
+     * the other side is silent and there is nothing to transport
+     */
+    void scaleSpectrum(
+        const std::vector<Real>& mag,
+        const std::vector<Real>& phase,
+        Real scale,
+        std::vector<Real>& mag_out,
+        std::vector<Real>& phase_out
     );
 
     /**
-     * Interpolate spectrum using optimal transport
+     * Move one spectrum along a transport map from computeTransportMap()
      *
      * @param mag_X Source magnitude spectrum
      * @param phase_X Source phase spectrum
      * @param mag_Y Target magnitude spectrum
      * @param phase_Y Target phase spectrum
+     * @param transport_map Target bin positions from computeTransportMap()
+     * @param k Interpolation factor (0.0 = source, 1.0 = target)
+     * @param mag_out Output magnitude spectrum
+     * @param phase_out Output phase spectrum
+     */
+    void applyTransportMap(
+        const std::vector<Real>& mag_X,
+        const std::vector<Real>& phase_X,
+        const std::vector<Real>& mag_Y,
+        const std::vector<Real>& phase_Y,
+        const std::vector<Real>& transport_map,
+        Real k,
+        std::vector<Real>& mag_out,
+        std::vector<Real>& phase_out
+    );
+
+    /**
+     * Interpolate a channel's spectrum using optimal transport, or
+     * scale the side with content if the other is silent. Returns
+     * false, leaving the output alone, if both are.
+     *
+     * @param channel Channel whose mag_X_/phase_X_ (source) and
+     *                mag_Y_/phase_Y_ (target) are interpolated
      * @param k Interpolation factor (0.0 = source, 1.0 = target)
      * @param mag_out Output magnitude spectrum
      * @param phase_out Output phase spectrum
      */
-    void interpolateSpectrum(
-        const std::vector<double>& mag_X,
-        const std::vector<double>& phase_X,
-        const std::vector<double>& mag_Y,
-        const std::vector<double>& phase_Y,
-        double k,
-        std::vector<double>& mag_out,
-        std::vector<double>& phase_out
+    bool interpolateSpectrum(
+        int channel,
+        Real k,
+        std::vector<Real>& mag_out,
+        std::vector<Real>& phase_out
     );
 };
 
+extern template class BasicRealtimeAudioTransport<double>;
+typedef BasicRealtimeAudioTransport<double> RealtimeAudioTransport;
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+extern template class BasicRealtimeAudioTransport<float>;
+typedef BasicRealtimeAudioTransport<float> RealtimeAudioTransportFloat;
+#endif
+
 } // namespace audio_transport
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include "audio_transport/instrumentation.hpp"
+#include "audio_transport/target_spectrum.hpp"
+
+namespace audio_transport {
+
+/**
+ * Interface shared by the realtime engines so that hosts can choose
+ * the algorithm and sample precision at runtime and hold the result
+ * through a single pointer.
+ */
+class RealtimeEngine {
+public:
+    /**
+     * How the channels of a multichannel process() are transported
+     */
+    enum class ChannelMode {
+        Independent, // Every channel gets its own transport plan
+        Linked       // One plan from the summed channels moves them all
+    };
+
+    virtual ~RealtimeEngine() {}
+
+    /**
+     * Process a buffer of audio samples
+     *
+     * Only valid with getNumChannels() == 1.
+     *
+     * @param input_main Main input buffer
+     * @param input_sidechain Sidechain input buffer (same size as input_main)
+     * @param output Output buffer (same size as input_main); may be
+     *        input_main or input_sidechain to process in place
+     * @param buffer_size Number of samples to process
+     * @param k Interpolation factor (0.0 = main, 1.0 = sidechain)
+     */
+    virtual void process(
+        const float* input_main,
+        const float* input_sidechain,
+        float* output,
+        int buffer_size,
+        float k
+    ) = 0;
+
+    /**
+     * Process planar multichannel audio: input_main[c] is channel c and
+     * so on. num_channels must equal getNumChannels(), and every channel
+     * is processed on every call so that they stay in step.
+     *
+     * Each output[c] may be its channel's input_main[c] or
+     * input_sidechain[c], and channels may share an input array: each
+     * span of input is buffered for every channel before the output
+     * over it is written.
+     */
+    virtual void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        float k
+    ) = 0;
+
+    /**
+     * Process with one interpolation factor per sample, k[i] for
+     * sample i, in either channel layout above. Each hop takes the
+     * factor at the centre of the frame it resynthesizes, wherever the
+     * hops fall in the buffer, so a host can pass smooth automation
+     * for a whole block instead of splitting it. Factors that stay
+     * constant give the output of the scalar overloads.
+     */
+    virtual void process(
+        const float* input_main,
+        const float* input_sidechain,
+        float* output,
+        int buffer_size,
+        const float* k
+    ) = 0;
+
+    virtual void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        const float* k
+    ) = 0;
+
+    /**
+     * Set the number of channels process() handles (1 by default).
+     * Allocates and resets, so not for the audio thread.
+     */
+    virtual void setNumChannels(int num_channels) = 0;
+    virtual int getNumChannels() const = 0;
+
+    /**
+     * Independent by default. Safe to change between process() calls;
+     * a single channel is processed the same way in either mode.
+     */
+    virtual void setChannelMode(ChannelMode mode) = 0;
+    virtual ChannelMode getChannelMode() const = 0;
+
+    /**
+     * Reset internal state (clear buffers)
+     */
+    virtual void reset() = 0;
+
+    /**
+     * Get the latency introduced by the engine in samples
+     */
+    virtual int getLatencySamples() const = 0;
+
+    /**
+     * Get the number of samples between analysis frames
+     */
+    virtual int getHopSize() const = 0;
+
+    /**
+     * An input window whose samples all lie within ±threshold counts as
+     * silent: its FFTs are skipped and the transport takes its silent-
+     * side shortcut, and a hop with both inputs silent outputs silence
+     * without an inverse FFT. 0, the default, gates digital silence
+     * only, which gives the same output as analysing it; 1e-4 (-80
+     * dBFS) also gates a noise floor, a negative threshold nothing.
+     * Safe to change between process() calls.
+     */
+    virtual void setSilenceThreshold(float threshold) = 0;
+    virtual float getSilenceThreshold() const = 0;
+
+    /**
+     * While frozen the sidechain input is ignored and every hop reuses
+     * the last sidechain spectrum analysed (for the reassignment engine
+     * its grouping too), so a held or looped sidechain costs no
+     * analysis. The sidechain is still buffered, so unfreezing follows
+     * the live input again from the next hop. Safe to change between
+     * process() calls.
+     */
+    virtual void setSidechainFrozen(bool frozen) = 0;
+    virtual bool isSidechainFrozen() const = 0;
+
+    /**
+     * Analyse a mono recording at the engine's sample rate into a
+     * target (see target_spectrum) for this engine or any built with
+     * the same settings; nullptr if it is shorter than one analysis
+     * window. Allocates and uses the engine's analysis buffers: not
+     * for the audio thread, and never during process().
+     */
+    virtual std::shared_ptr<const target_spectrum> makeTarget(
+        const float* audio, size_t num_samples, target_spectrum::mode playback) = 0;
+
+    /**
+     * Morph toward target instead of the sidechain from the next hop
+     * on. The sidechain input is then ignored and its spectrum neither
+     * computed nor grouped; a frozen sidechain holds the target's
+     * current frame. nullptr follows the sidechain again. Returns
+     * false and keeps the current target if target was analysed with
+     * other settings than getTargetAnalysis(). May free the previous
+     * target, so not for the audio thread.
+     */
+    virtual bool setTarget(std::shared_ptr<const target_spectrum> target) = 0;
+    virtual const target_spectrum* getTarget() const = 0;
+
+    // The settings targets for this engine are analysed with
+    virtual target_spectrum::analysis getTargetAnalysis() const = 0;
+
+    /**
+     * Record stage timings and transport counters into recorder while
+     * it is enabled (see instrumentation.hpp); nullptr, the default,
+     * records nothing. The recorder must outlive the engine or be
+     * replaced first, and is not to be changed during process().
+     */
+    virtual void setInstrumentation(instrumentation::recorder* recorder) = 0;
+    virtual instrumentation::recorder* getInstrumentation() const = 0;
+};
+
+} // namespace audio_transport
@@ -2,10 +2,14 @@
 
 #include <vector>
 #include <complex>
-#include <fftw3.h>
 #include <memory>
+#include "audio_transport/fftw_traits.hpp"
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/RealtimeEngine.hpp"
 #include "audio_transport/spectral.hpp"
 #include "audio_transport/audio_transport.hpp"
+#include "audio_transport/silence_gate.hpp"
+#include "audio_transport/k_history.hpp"
 
 namespace audio_transport {
 
@@ -19,8 +23,12 @@ namespace audio_transport {
  * Usage:
  *   1. Create instance with desired sample rate and window parameters
  *   2. Call process() for each audio buffer with interpolation factor k
+ *
+ * Real is the precision of the windowing, FFT and overlap-add stages.
+ * The transport itself runs on spectral::frame and is always double.
  */
-class RealtimeReassignmentTransport {
+template <typename Real>
+class BasicRealtimeReassignmentTransport : public RealtimeEngine {
 public:
     /**
      * Constructor
@@ -28,15 +36,36 @@ public:
      * @param window_ms Window size in milliseconds
      * @param hop_divisor Hop divisor (4 = 75% overlap, 2 = 50% overlap)
      * @param fft_padding FFT padding multiplier (2 = 2x padding)
+     * @param synthesis_ms Low-latency synthesis length in milliseconds,
+     *                     or 0 for the full window (see below)
+     * @param fft_sizing How the padded window length is rounded up to
+     *                   a transform size (see fft_plans::sizing)
+     *
+     * With synthesis_ms shorter than the window, analysis uses the
+     * asymmetric window of spectral::asymmetric and each hop is
+     * resynthesized from the last synthesis_ms of it only. Latency and
+     * hop then follow synthesis_ms while the spectra keep the
+     * resolution of window_ms, at the cost of more hops per second.
+     *
+     * A rounded transform only adds zero padding: the window stays
+     * centred in it, bins are spaced sample_rate / getFFTSize() apart
+     * and the overlap-add scales by the transform size, so every
+     * policy resynthesizes the same signal to rounding.
      */
-    RealtimeReassignmentTransport(
+    BasicRealtimeReassignmentTransport(
         double sample_rate,
         double window_ms,
         int hop_divisor = 4,
-        int fft_padding = 2
+        int fft_padding = 2,
+        double synthesis_ms = 0.0,
+        fft_plans::sizing fft_sizing = fft_plans::exact
     );
 
-    ~RealtimeReassignmentTransport();
+    ~BasicRealtimeReassignmentTransport();
+
+    // Prevent copying (due to FFTW plans)
+    BasicRealtimeReassignmentTransport(const BasicRealtimeReassignmentTransport&) = delete;
+    BasicRealtimeReassignmentTransport& operator=(const BasicRealtimeReassignmentTransport&) = delete;
 
     /**
      * Process a buffer of audio samples
@@ -52,73 +81,239 @@ public:
         float* output,
         int buffer_size,
         float k
-    );
+    ) override;
+
+    /**
+     * Process planar multichannel audio (see RealtimeEngine). In Linked
+     * mode one transport plan (plan_transport) is grouped from all
+     * channels and every channel is placed along it.
+     */
+    void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        float k
+    ) override;
+
+    /**
+     * Process with one interpolation factor per sample (see
+     * RealtimeEngine)
+     */
+    void process(
+        const float* input_main,
+        const float* input_sidechain,
+        float* output,
+        int buffer_size,
+        const float* k
+    ) override;
+
+    void process(
+        const float* const* input_main,
+        const float* const* input_sidechain,
+        float* const* output,
+        int num_channels,
+        int buffer_size,
+        const float* k
+    ) override;
+
+    void setNumChannels(int num_channels) override;
+    int getNumChannels() const override { return num_channels_; }
+
+    void setChannelMode(ChannelMode mode) override { channel_mode_ = mode; }
+    ChannelMode getChannelMode() const override { return channel_mode_; }
+
+    void setSilenceThreshold(float threshold) override { silence_threshold_ = threshold; }
+    float getSilenceThreshold() const override { return silence_threshold_; }
+
+    void setSidechainFrozen(bool frozen) override { sidechain_frozen_ = frozen; }
+    bool isSidechainFrozen() const override { return sidechain_frozen_; }
+
+    /**
+     * Sparse transport (see mass_pruning), off by default: fewer,
+     * heavier masses make grouping's output cheaper to transport and
+     * place on dense or noisy input. Applies from the next hop; the
+     * instrumentation counts the masses it removes.
+     */
+    void setMassPruning(const mass_pruning& pruning);
+    const mass_pruning& getMassPruning() const { return plan_.pruning; }
 
     /**
-     * Get the latency introduced by this processor in samples
+     * Targets (see RealtimeEngine) from this engine keep the masses of
+     * every frame, grouped without pruning: mass pruning applies to
+     * the main input only while one plays.
      */
-    int getLatencySamples() const;
+    std::shared_ptr<const target_spectrum> makeTarget(
+        const float* audio, size_t num_samples, target_spectrum::mode playback) override;
+    bool setTarget(std::shared_ptr<const target_spectrum> target) override;
+    const target_spectrum* getTarget() const override { return target_.get(); }
+    target_spectrum::analysis getTargetAnalysis() const override;
+
+    void setInstrumentation(instrumentation::recorder* recorder) override { instrumentation_ = recorder; }
+    instrumentation::recorder* getInstrumentation() const override { return instrumentation_; }
+
+    /**
+     * Get the latency introduced by this processor in samples: an
+     * input sample is first heard this many samples later
+     */
+    int getLatencySamples() const override;
+
+    /**
+     * Get the hop size in samples
+     */
+    int getHopSize() const override { return hop_size_; }
+
+    /**
+     * Get the transform size: the padded window after rounding
+     */
+    int getFFTSize() const { return window_padded_; }
 
     /**
      * Reset internal state (clear buffers)
      */
-    void reset();
+    void reset() override;
 
 private:
     // Audio parameters
     double sample_rate_;
     double window_size_; // in seconds
+    double phase_window_; // window_size passed to interpolate()
     int window_samples_;
-    int window_padded_;
+    int synthesis_samples_; // window_samples_ unless low-latency
+    int window_padded_; // transform size
     int hop_size_;
     int hop_divisor_;
     int fft_padding_;
     int fft_size_;
+    int num_channels_;
+    ChannelMode channel_mode_;
+    float silence_threshold_;
+    bool sidechain_frozen_;
+    instrumentation::recorder* instrumentation_;
 
-    // Input buffers (accumulate samples until we have a full hop)
-    std::vector<float> main_buffer_;
-    std::vector<float> sidechain_buffer_;
+    // Input buffers, one per channel (accumulate samples until we have
+    // a full hop). All channels share the positions.
+    std::vector<std::vector<float>> main_buffers_;
+    std::vector<std::vector<float>> sidechain_buffers_;
     int input_write_pos_;
 
-    // Output buffer (stores processed samples waiting to be output)
-    std::vector<float> output_buffer_;
+    // How long each input has been silent, per channel
+    std::vector<silence_gate> main_gates_;
+    std::vector<silence_gate> sidechain_gates_;
+
+    // The factor of every recent input sample, for hops of a per-sample
+    // process() to read at the centre of their frame
+    k_history k_history_;
+
+    // Output rings of two hops: each hop is written starting at the
+    // slot of its last input sample, and output_read_pos_ is the next
+    // slot handed to the caller
+    std::vector<std::vector<float>> output_buffers_;
     int output_read_pos_;
 
-    // Spectral analysis windows
-    std::vector<double> window_;
-    std::vector<double> window_t_;
-    std::vector<double> window_d_;
+    // Spectral analysis windows: the main input's hann, hann_t and
+    // hann_d windows, then the sidechain's, real_distance_ apart as a
+    // batched plan wants them (see fft_plans), with their spectra
+    // complex_distance_ apart in spectra_
+    size_t real_distance_;
+    size_t complex_distance_;
+    aligned_vector<Real> windows_;
+    aligned_vector<Real> synthesized_; // inverse FFT output
 
-    // FFT plans
-    fftw_plan fft_plan_;
-    fftw_plan fft_plan_t_;
-    fftw_plan fft_plan_d_;
-    fftw_plan ifft_plan_;
+    // FFT plans, shared through fft_plans: one input's three analysis
+    // transforms, both inputs' six, and the inverse
+    typedef fftw_traits<Real> fft;
+    typename fft::plan analysis_plan_;
+    typename fft::plan paired_plan_;
+    typename fft::plan ifft_plan_;
 
     // FFT buffers
-    fftw_complex* fft_;
-    fftw_complex* fft_t_;
-    fftw_complex* fft_d_;
-    fftw_complex* ifft_;
+    typename fft::complex* spectra_;
+    typename fft::complex* ifft_;
 
-    // Phase continuity tracking
-    std::vector<double> phases_;
+    // Phase continuity tracking per channel (linked mode uses the first)
+    std::vector<std::vector<double>> phases_;
 
-    // Overlap-add state
-    std::vector<double> overlap_buffer_;
+    // Shared analysis (and low-latency synthesis) tables
+    std::shared_ptr<const spectral::window_tables> window_tables_;
+
+    // Overlap-add state per channel
+    std::vector<std::vector<Real>> overlap_buffers_;
+
+    // Per-hop working storage, sized by allocateChannels() so that
+    // processHop() never allocates on the audio thread
+    std::vector<spectral::frame> main_spectra_;
+    std::vector<spectral::frame> sidechain_spectra_;
+    std::vector<spectral::frame> morphed_spectra_;
+    std::vector<float> hop_output_;
+    transport_plan plan_;
+
+    // One workspace per channel (linked mode uses the first), so each
+    // keeps the polar form and masses of its channel's sidechain
+    std::vector<interpolate_workspace> workspaces_;
+
+    // Per channel: spectra zeroed by the silence gate this hop (main)
+    // or since they were last analysed (sidechain), and whether
+    // workspaces_[c] was last grouped on sidechain_spectra_[c]. The
+    // linked flag is the same for plan_.
+    std::vector<bool> main_silent_;
+    std::vector<bool> sidechain_silent_;
+    std::vector<bool> sidechain_grouped_;
+    bool linked_sidechain_grouped_;
+
+    // The target played instead of the sidechain, if any, the hop of
+    // it the next processHop() plays, the frame installed last hop
+    // (nullptr once the sidechain spectra change otherwise) and the
+    // phases it was installed with
+    std::shared_ptr<const target_spectrum> target_;
+    size_t target_hop_;
+    const target_spectrum::frame* installed_target_;
+    std::vector<double> target_phases_;
 
     // Helper methods
-    void analyzeWindow(
-        const float* input,
-        std::vector<spectral::point>& spectrum
-    );
+    void allocateChannels();
+
+    // Analysis in three steps, so both inputs share one batch of
+    // transforms: window an input (side 0 is main, 1 the sidechain),
+    // transform the windowed inputs, and build a side's frame
+    void windowInput(const float* input, int side);
+    void transformWindows(bool main, bool sidechain);
+    void buildSpectrum(int side, spectral::frame& spectrum);
+
+    // The spectrum buildSpectrum() gives for a window of zeros
+    void clearSpectrum(spectral::frame& spectrum) const;
+
+    // Make frame every channel's sidechain spectrum, already grouped.
+    // A frame installed again has its phases advanced by a hop.
+    void installTarget(const target_spectrum::frame& frame);
 
     void synthesizeWindow(
-        const std::vector<spectral::point>& spectrum,
+        const spectral::frame& spectrum,
+        std::vector<Real>& overlap_buffer,
         float* output
     );
 
-    void processHop(float k);
+    // Copy out the finished hop and advance the overlap-add buffer
+    void emitHop(std::vector<Real>& overlap_buffer, float* output);
+
+    // Both process() overloads: k_samples gives a factor per sample,
+    // or is nullptr for k_value throughout
+    void processChannels(const float* const* input_main,
+                         const float* const* input_sidechain,
+                         float* const* output, int num_channels,
+                         int buffer_size, float k_value, const float* k_samples);
+
+    // Transform one hop and write its output from output_position on
+    void processHop(float k, int output_position);
 };
 
+extern template class BasicRealtimeReassignmentTransport<double>;
+typedef BasicRealtimeReassignmentTransport<double> RealtimeReassignmentTransport;
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+extern template class BasicRealtimeReassignmentTransport<float>;
+typedef BasicRealtimeReassignmentTransport<float> RealtimeReassignmentTransportFloat;
+#endif
+
 } // namespace audio_transport
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace audio_transport {
+
+/**
+ * Allocator returning storage aligned to Alignment bytes (a power of
+ * two, at least alignof(void*)), so SIMD kernels can rely on full-width
+ * loads never splitting a cache line at the start of an array.
+ *
+ * Memory comes from ::operator new, so it is visible to hosts that
+ * hook allocation (see realtime_check.hpp).
+ */
+template <typename T, std::size_t Alignment = 64>
+struct aligned_allocator {
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind {
+    typedef aligned_allocator<U, Alignment> other;
+  };
+
+  aligned_allocator() noexcept {}
+
+  template <typename U>
+  aligned_allocator(const aligned_allocator<U, Alignment> &) noexcept {}
+
+  T * allocate(std::size_t n) {
+    if (n > (std::size_t(-1) - Alignment - sizeof(void *)) / sizeof(T)) {
+      throw std::bad_alloc();
+    }
+
+    // Over-allocate and keep the original pointer just below the
+    // aligned block for deallocate()
+    void * raw = ::operator new(n * sizeof(T) + Alignment + sizeof(void *));
+    std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void *);
+    std::uintptr_t aligned = (start + Alignment - 1) & ~std::uintptr_t(Alignment - 1);
+    reinterpret_cast<void **>(aligned)[-1] = raw;
+    return reinterpret_cast<T *>(aligned);
+  }
+
+  void deallocate(T * p, std::size_t) noexcept {
+    if (p) ::operator delete(reinterpret_cast<void **>(p)[-1]);
+  }
+};
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator==(const aligned_allocator<T, Alignment> &, const aligned_allocator<U, Alignment> &) {
+  return true;
+}
+
+template <typename T, typename U, std::size_t Alignment>
+bool operator!=(const aligned_allocator<T, Alignment> &, const aligned_allocator<U, Alignment> &) {
+  return false;
+}
+
+template <typename T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+}
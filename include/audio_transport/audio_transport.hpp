@@ -15,6 +15,104 @@ struct spectral_mass {
   double mass;
 };
 
+/**
+ * Optional sparse transport. Grouping splits the spectrum at every
+ * sign change of the reassignment, so the noise floor alone gives
+ * hundreds of tiny masses, each costing transport entries and a
+ * place_mass() of its own. With pruning on, only masses of at least
+ * min_mass (a fraction of the total) and, if max_masses is set, only
+ * the max_masses heaviest are kept. Each run of masses between two
+ * kept ones merges into one residual mass over their bins, centred
+ * where the heaviest of them was, so coverage and total mass stay the
+ * same and a plan holds at most 2 * max_masses + 1 masses.
+ *
+ * Both fields zero (the default) leaves grouping as it is.
+ */
+struct mass_pruning {
+  size_t max_masses;
+  double min_mass;
+
+  mass_pruning() : max_masses(0), min_mass(0) {}
+  mass_pruning(size_t max_masses, double min_mass)
+    : max_masses(max_masses), min_mass(min_mass) {}
+
+  bool enabled() const { return max_masses > 0 || min_mass > 0; }
+};
+
+/**
+ * The masses of two spectra and the transport matrix between
+ * them. interpolate() builds one per call; linked multichannel
+ * interpolation builds one for all channels (see plan_transport).
+ */
+struct transport_plan {
+  std::vector<spectral_mass> left_masses;
+  std::vector<spectral_mass> right_masses;
+  std::vector<std::tuple<size_t, size_t, double>> transport;
+
+  // With a silent side there is no transport, only scaling
+  bool left_silent;
+  bool right_silent;
+
+  // Applied to both sides as they are grouped. The counts are the
+  // masses each side had before pruning (the sizes above when off).
+  mass_pruning pruning;
+  size_t left_grouped;
+  size_t right_grouped;
+  std::vector<double> ranked_masses; // top-K scratch
+
+  // Linked plans only: the combined spectra the masses were grouped
+  // on, with their summed magnitudes and the phases of their sums
+  spectral::frame left;
+  spectral::frame right;
+  std::vector<double> left_magnitudes;
+  std::vector<double> left_phases;
+  std::vector<double> right_magnitudes;
+  std::vector<double> right_phases;
+
+  transport_plan()
+    : left_silent(false), right_silent(false), left_grouped(0), right_grouped(0) {}
+
+  void reserve(size_t num_bins);
+};
+
+/**
+ * Scratch storage for the allocation-free interpolate().
+ * Reserve it once for the largest spectrum that will be passed
+ * in; after that interpolation does not touch the heap.
+ */
+struct interpolate_workspace {
+  // Set plan.pruning to make interpolate() sparse
+  transport_plan plan;
+  std::vector<double> new_amplitudes;
+  std::vector<double> new_phases;
+
+  // Polar form of the left and right spectra
+  std::vector<double> left_magnitudes;
+  std::vector<double> left_phases;
+  std::vector<double> right_magnitudes;
+  std::vector<double> right_phases;
+
+  // Batched rotation scratch (vector_math kernels)
+  std::vector<double> rotated_phases;
+  std::vector<double> sines;
+  std::vector<double> cosines;
+
+  // Frame copies used by the point-based interpolate()
+  spectral::frame left_frame;
+  spectral::frame right_frame;
+  spectral::frame output_frame;
+
+  // Set when right is the same spectrum as in the previous call
+  // with this workspace (a held sidechain, say): its polar form
+  // and masses are kept instead of being recomputed
+  bool reuse_right;
+
+  interpolate_workspace() : reuse_right(false) {}
+  explicit interpolate_workspace(size_t num_bins) : reuse_right(false) { reserve(num_bins); }
+
+  void reserve(size_t num_bins);
+};
+
 std::vector<audio_transport::spectral::point> interpolate(
     const std::vector<audio_transport::spectral::point> & left,
     const std::vector<audio_transport::spectral::point> & right,
@@ -22,13 +120,157 @@ std::vector<audio_transport::spectral::point> interpolate(
     double window_size,
     double interpolation_factor);
 
+/**
+ * Same as above but writes into a caller-owned output spectrum
+ * using the buffers in workspace. If output and workspace have
+ * enough capacity for left.size() bins no allocation occurs.
+ */
+void interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    std::vector<audio_transport::spectral::point> & output,
+    interpolate_workspace & workspace);
+
+/**
+ * Same again on the structure-of-arrays layout, which the above
+ * converts to. Output frames share the bin frequencies of left.
+ */
+void interpolate(
+    const audio_transport::spectral::frame & left,
+    const audio_transport::spectral::frame & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    audio_transport::spectral::frame & output,
+    interpolate_workspace & workspace);
+
+/**
+ * Linked multichannel interpolation. plan_transport() groups one
+ * set of masses for all channels: bins are split on the
+ * magnitude-weighted mean of the channels' reassigned frequencies
+ * and weighted by their summed magnitudes. The overload of
+ * interpolate() below then moves every channel along that plan.
+ *
+ * Each channel's bins are rotated by the same phase as the summed
+ * spectrum, so level and phase differences between channels (the
+ * stereo image) survive the transport. A plan therefore costs one
+ * grouping and one transport_matrix() however many channels there
+ * are, plus a placement per channel.
+ *
+ * left and right hold one frame per channel, all of the same size.
+ * Reserve the plan and workspace for that size and the output
+ * frames likewise to keep this allocation-free.
+ *
+ * With reuse_right the right frames must be the ones plan was last
+ * made from; their combined spectrum and masses are kept.
+ */
+void plan_transport(
+    const std::vector<audio_transport::spectral::frame> & left,
+    const std::vector<audio_transport::spectral::frame> & right,
+    transport_plan & plan,
+    bool reuse_right = false);
+
+// phases is shared by all channels; output needs left.size() frames
+void interpolate(
+    const transport_plan & plan,
+    const std::vector<audio_transport::spectral::frame> & left,
+    const std::vector<audio_transport::spectral::frame> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    std::vector<audio_transport::spectral::frame> & output,
+    interpolate_workspace & workspace);
+
+/**
+ * A spectrum reduced to what interpolation along a kept plan reads:
+ * its polar form and reassigned frequencies.
+ */
+struct polar_frame {
+  std::vector<double> magnitudes;
+  std::vector<double> phases;
+  std::vector<double> freq_reassigned;
+
+  size_t size() const { return magnitudes.size(); }
+};
+
+/**
+ * Mono plans that outlive their spectra (see morph_cache). This
+ * plan_transport() groups left and right into plan as interpolate()
+ * does and writes their polar forms to left_polar and right_polar;
+ * plan.left, plan.right and their polar fields are left alone.
+ *
+ * The interpolate() below then redoes interpolate() on the frames
+ * with only the placement: no grouping, transport matrix or polar
+ * conversion. left_freq and right_freq are the frames' bin
+ * frequencies. The output is identical, except that where a side is
+ * silent the other is scaled from its polar form, which agrees to
+ * rounding. The polar form of a silent side is not read.
+ */
+void plan_transport(
+    const audio_transport::spectral::frame & left,
+    const audio_transport::spectral::frame & right,
+    transport_plan & plan,
+    polar_frame & left_polar,
+    polar_frame & right_polar);
+
+void interpolate(
+    const transport_plan & plan,
+    const polar_frame & left,
+    const aligned_vector<double> & left_freq,
+    const polar_frame & right,
+    const aligned_vector<double> & right_freq,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation_factor,
+    audio_transport::spectral::frame & output,
+    interpolate_workspace & workspace);
+
 std::vector<std::tuple<size_t, size_t, double>> transport_matrix(
     const std::vector<spectral_mass> & left,
     const std::vector<spectral_mass> & right);
 
+/**
+ * Same as above into caller-owned storage. T holds at most
+ * left.size() + right.size() - 1 entries; with that capacity
+ * (transport_plan::reserve gives it) nothing is allocated.
+ */
+void transport_matrix(
+    const std::vector<spectral_mass> & left,
+    const std::vector<spectral_mass> & right,
+    std::vector<std::tuple<size_t, size_t, double>> & T);
+
 std::vector<spectral_mass> group_spectrum(
     const std::vector<audio_transport::spectral::point> & spectrum);
 
+void group_spectrum(
+    const std::vector<audio_transport::spectral::point> & spectrum,
+    std::vector<spectral_mass> & masses);
+
+// magnitudes[i] is |spectrum.value(i)|, e.g. from vector_math::hypot
+void group_spectrum(
+    const audio_transport::spectral::frame & spectrum,
+    const std::vector<double> & magnitudes,
+    std::vector<spectral_mass> & masses);
+
+/**
+ * The grouping kernel the overloads above and interpolate() share:
+ * a single pass over precomputed magnitudes and the bin and reassigned
+ * frequencies writes the normalised masses into masses and returns the
+ * summed magnitude. A near-silent spectrum (total below 1e-10) gets
+ * one uniform mass, without the diagnostic the overloads above report.
+ * Once masses has capacity for num_bins entries nothing is allocated,
+ * so it is safe on the audio thread.
+ */
+double group_spectrum(
+    const double * magnitudes,
+    const double * freq,
+    const double * freq_reassigned,
+    size_t num_bins,
+    std::vector<spectral_mass> & masses);
+
 void place_mass(
     const spectral_mass & mass,
     int center_bin,
@@ -41,4 +283,24 @@ void place_mass(
     std::vector<double> & phases,
     std::vector<double> & amplitudes);
 
+/**
+ * Same as above with the input spectrum given in polar form, as
+ * produced by vector_math::magnitude_phase. The shifted bins are
+ * rotated with one batched sincos using the workspace scratch.
+ * The overload above converts the whole input on every call.
+ */
+void place_mass(
+    const spectral_mass & mass,
+    int center_bin,
+    double scale,
+    double interpolated_freq,
+    double center_phase,
+    const std::vector<double> & input_magnitudes,
+    const std::vector<double> & input_phases,
+    audio_transport::spectral::frame & output,
+    double next_phase,
+    std::vector<double> & phases,
+    std::vector<double> & amplitudes,
+    interpolate_workspace & workspace);
+
 }
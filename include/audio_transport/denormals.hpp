@@ -0,0 +1,34 @@
+#pragma once
+
+namespace audio_transport {
+namespace denormals {
+
+/**
+ * Flushes denormal results and inputs to zero on the calling thread
+ * for the lifetime of the object, then restores the previous mode.
+ * Decaying overlap-add tails and near-silent spectra otherwise run
+ * into denormals, which cost up to a hundred times a normal operation
+ * on x86. The realtime engines hold one for each process() call, so a
+ * host need not set the mode itself.
+ *
+ * On x86 this sets FTZ and DAZ in MXCSR, on AArch64 FZ in FPCR; on
+ * other targets it does nothing. Scopes nest. Non-finite values are
+ * not affected: see vector_math::sanitize() for those.
+ */
+class scoped_flush_denormals {
+public:
+    scoped_flush_denormals();
+    ~scoped_flush_denormals();
+
+    scoped_flush_denormals(const scoped_flush_denormals&) = delete;
+    scoped_flush_denormals& operator=(const scoped_flush_denormals&) = delete;
+
+private:
+    unsigned long long saved_;
+};
+
+// Whether scoped_flush_denormals changes anything on this target
+bool flush_supported();
+
+} // namespace denormals
+} // namespace audio_transport
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace audio_transport {
+namespace diagnostics {
+
+/**
+ * Numerical events the transport code used to print to std::cerr.
+ * They are now reported through report() below, which never blocks,
+ * allocates or touches a stream, so it is safe on the audio thread.
+ */
+enum class event : unsigned char {
+    invalid_phase,        // carried phases not finite, reset to 0
+    small_mass,           // mass under the threshold, scale clamped
+    invalid_scale,        // mass placement skipped
+    invalid_frequency,    // mass placement skipped
+    low_frequency,        // mass attenuated below 30 Hz
+    invalid_phase_shift,  // mass placement skipped
+    invalid_magnitude,    // bins of a spectrum not finite, zeroed
+    invalid_bin_phase,    // phases of a spectrum not finite, zeroed
+    invalid_next_phase,   // previous phase kept
+    near_silent_spectrum, // grouped as one uniform mass
+    invalid_sample        // synthesized samples not finite, zeroed
+};
+
+const size_t num_events = 11;
+
+/**
+ * One event. bin is the bin it concerns (-1 for none); value and
+ * detail are the offending quantities, see describe(). Events of the
+ * sanitation passes (invalid_phase, invalid_magnitude,
+ * invalid_bin_phase, invalid_sample) are one per pass, with the number
+ * of values zeroed as value.
+ */
+struct record {
+    event type;
+    long bin;
+    double value;
+    double detail;
+};
+
+/**
+ * Fixed-capacity single-producer single-consumer queue. push() and
+ * pop() are wait-free; push() fails rather than overwrite when full.
+ * Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class spsc_ring {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                  "spsc_ring capacity must be a power of two");
+
+public:
+    spsc_ring() : head_(0), tail_(0) {}
+
+    // Producer thread only
+    bool push(const T& value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) == Capacity) return false;
+        items_[head & (Capacity - 1)] = value;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool pop(T& value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        value = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate unless called from the consumer
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+    static size_t capacity() { return Capacity; }
+
+private:
+    T items_[Capacity];
+    // Padded onto separate cache lines so producer and consumer do not
+    // invalidate each other (padding rather than alignas, so that
+    // objects holding a ring can still be allocated with new in C++11)
+    char pad0_[64];
+    std::atomic<size_t> head_;
+    char pad1_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+    char pad2_[64 - sizeof(std::atomic<size_t>)];
+};
+
+/**
+ * Where the events of one realtime thread go: a ring of records for
+ * a non-realtime thread to drain, and per-event counters that keep
+ * counting when the ring is full. One producer (the thread it is bound
+ * to with a scope) and one consumer at a time.
+ */
+class channel {
+public:
+    static const size_t capacity = 256;
+
+    channel();
+
+    // Producer side; called by report()
+    void push(const record& r);
+
+    // Consumer side
+    bool pop(record& r) { return ring_.pop(r); }
+
+    // Events reported to this channel, including dropped ones
+    std::uint64_t count(event type) const;
+    // Records lost because the ring was full
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    spsc_ring<record, capacity> ring_;
+    std::atomic<std::uint64_t> counts_[num_events];
+    std::atomic<std::uint64_t> dropped_;
+
+    friend size_t drain(channel& c, std::ostream& out);
+    std::uint64_t dropped_logged_ = 0; // consumer only
+};
+
+/**
+ * Binds a channel to the calling thread for the lifetime of the
+ * object; scopes nest. Reports from a thread with no channel bound
+ * only reach the process-wide totals.
+ */
+class scope {
+public:
+    explicit scope(channel& c);
+    ~scope();
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+
+private:
+    channel* previous_;
+};
+
+/**
+ * Count an event in the process-wide totals and, if the calling
+ * thread has a channel bound, queue a record on it. Compiled out
+ * entirely with AUDIO_TRANSPORT_NO_DIAGNOSTICS (CMake -DDIAGNOSTICS=OFF).
+ */
+#ifdef AUDIO_TRANSPORT_NO_DIAGNOSTICS
+inline void report(event, long, double, double = 0) {}
+#else
+void report(event type, long bin, double value, double detail = 0);
+#endif
+
+// Events reported by any thread since the last reset_totals()
+std::uint64_t total(event type);
+void reset_totals();
+
+// Short identifier, e.g. "low_frequency"
+const char* name(event type);
+
+// The warning the library used to print for r, without a newline
+std::string describe(const record& r);
+
+/**
+ * Write every record queued on c to out, one line each, plus a note
+ * of any records dropped since the last drain. Returns the number of
+ * records written. Consumer thread only; it formats and may block.
+ */
+size_t drain(channel& c, std::ostream& out);
+
+} // namespace diagnostics
+} // namespace audio_transport
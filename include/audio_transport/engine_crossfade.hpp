@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+
+namespace audio_transport {
+
+/**
+ * Hands a host's output over from one realtime engine to a newly
+ * built one that has been fed the same input since start().
+ *
+ * The old engine's output is kept until the new engine's latency has
+ * passed and its output is valid. With equal latencies the two
+ * outputs are then faded linearly over four of the new engine's hops.
+ * They describe the same input at the same delay, so the fade is
+ * smooth. How well it keeps the level depends on how closely the new
+ * engine's resynthesized phases, which build up from its own start,
+ * agree with the old one's.
+ *
+ * With different latencies the outputs are offset by the difference
+ * and a fade would comb-filter. The handover is then a switch instead,
+ * at the end of the block where the fade would have ended. By then the
+ * new engine is past the transient of its first hops, and the host
+ * moves its dry delay and reported latency at the same block boundary.
+ *
+ * One handover at a time; realtime safe.
+ */
+class engine_crossfade {
+public:
+    engine_crossfade() : active_(false), prime_(0), position_(0), length_(0) {}
+
+    void start(int old_latency, int new_latency, int new_hop) {
+        const int fade = std::max(1, 4 * new_hop);
+        active_ = true;
+        position_ = 0;
+        length_ = old_latency == new_latency ? fade : 0;
+        prime_ = std::max(new_latency, 0) + (length_ > 0 ? 0 : fade);
+    }
+
+    // A handover is under way
+    bool active() const { return active_; }
+
+    // The handover fades rather than switches
+    bool fades() const { return length_ > 0; }
+
+    /**
+     * Fade one block of the new engine's output, incoming[c], into the
+     * old engine's, output[c], in place. Returns true once the new
+     * engine is to produce all output from the next block on; the
+     * handover is then over.
+     */
+    bool mix(float* const* output, const float* const* incoming, int num_channels, int num_samples) {
+        if (!active_) return false;
+
+        int i = std::min(prime_, num_samples);
+        prime_ -= i;
+        if (length_ > 0) {
+            for (; i < num_samples && position_ < length_; i++, position_++) {
+                float fade = static_cast<float>(position_) / static_cast<float>(length_);
+                for (int c = 0; c < num_channels; c++) {
+                    output[c][i] += (incoming[c][i] - output[c][i]) * fade;
+                }
+            }
+            for (int c = 0; c < num_channels; c++) {
+                std::copy(incoming[c] + i, incoming[c] + num_samples, output[c] + i);
+            }
+        }
+
+        active_ = prime_ > 0 || position_ < length_;
+        return !active_;
+    }
+
+    // Abandon the handover, as when the new engine takes over at once
+    void cancel() { active_ = false; }
+
+private:
+    bool active_;
+    int prime_;     // new engine's samples left before the fade or switch
+    int position_;  // into the fade
+    int length_;    // of the fade, 0 to switch instead
+};
+
+} // namespace audio_transport
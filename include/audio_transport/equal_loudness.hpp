@@ -14,4 +14,13 @@ void apply(
 void remove(
     std::vector<std::vector<spectral::point>> & points);
 
+void apply(
+    std::vector<spectral::frame> & frames);
+void remove(
+    std::vector<spectral::frame> & frames);
+
+// One frame at a time, for callers streaming windows
+void apply(spectral::frame & frame);
+void remove(spectral::frame & frame);
+
 }}
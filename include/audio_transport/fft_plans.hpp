@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "audio_transport/fftw_traits.hpp"
+
+namespace audio_transport {
+namespace fft_plans {
+
+/**
+ * Process-wide registry of real FFT plans, shared by every engine
+ * instance and by spectral::analysis/synthesis.
+ *
+ * A plan is measured (FFTW_MEASURE) the first time a (size, direction,
+ * precision) is requested and reused for the life of the process, so
+ * creating another engine of the same size costs no planning at all.
+ * Plans are made on fftw_malloc'd scratch arrays and must be run
+ * through the new-array interface (fftw_traits::execute_r2c and
+ * execute_c2r) on out-of-place buffers with the same SIMD alignment,
+ * i.e. from fftw_malloc or aligned_vector. Never destroy a shared plan.
+ *
+ * Wisdom is loaded from cache_directory() before the first plan of each
+ * precision and written back whenever a new plan is measured, so later
+ * processes skip the measurement too.
+ *
+ * Everything here is thread safe (planning is serialised behind one
+ * lock) but blocks, so none of it may be called from the audio thread.
+ */
+enum direction {
+    forward, // real to complex
+    inverse  // complex to real (unnormalised, destroys its input)
+};
+
+template <typename Real>
+typename fftw_traits<Real>::plan get(int n, direction dir);
+
+/**
+ * A plan running howmany transforms of size n in one execute call,
+ * for the analysis stages that transform several windows of the same
+ * size at once. Consecutive real arrays lie real_distance(n) elements
+ * apart and consecutive spectra complex_distance(n) bins apart, which
+ * keeps each of them as aligned as the first. Execute it through
+ * execute_r2c or execute_c2r with the first array of each block, on
+ * buffers laid out that way. howmany = 1 is the same plan as get().
+ */
+template <typename Real>
+typename fftw_traits<Real>::plan get(int n, direction dir, int howmany);
+
+size_t real_distance(int n);
+size_t complex_distance(int n);
+
+/**
+ * How an engine rounds the length of its zero-padded window up to a
+ * transform size. FFTW is fastest on powers of two and close to it on
+ * products of small primes, but sizes with a large prime factor (13230
+ * = 2 * 3^3 * 5 * 7^2 for 100 ms at 44.1 kHz with 2x padding) can take
+ * several times as long.
+ */
+enum sizing {
+    exact,        // the padded length itself
+    power_of_two, // the next power of two
+    smooth        // the next even 2^a 3^b 5^c
+};
+
+// The transform size for a padded window of n samples; never less
+// than n, and even whenever n is
+int transform_size(int n, sizing policy);
+
+/**
+ * Directory holding fftw3.wisdom and fftw3f.wisdom. Defaults to
+ * $AUDIO_TRANSPORT_CACHE_DIR, else the platform user cache directory
+ * ($XDG_CACHE_HOME or ~/.cache, ~/Library/Caches, %LOCALAPPDATA%) plus
+ * "audio_transport". An empty path disables wisdom persistence.
+ *
+ * Changing it only affects wisdom not yet loaded.
+ */
+void set_cache_directory(const std::string& path);
+std::string cache_directory();
+
+// Number of plans held, over both precisions and all batch sizes
+size_t size();
+
+/**
+ * Destroy every plan and forget in-memory wisdom so the next request
+ * plans (or loads wisdom) from scratch. Only for benchmarks and tests:
+ * no engine may be alive and no other thread may be using FFTW.
+ */
+void clear();
+
+} // namespace fft_plans
+} // namespace audio_transport
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <fftw3.h>
+
+namespace audio_transport {
+
+/**
+ * Maps a sample type onto the matching FFTW API so the realtime
+ * engines can be written once for both precisions.
+ *
+ * double uses the fftw_* functions (libfftw3), float uses the
+ * fftwf_* functions (libfftw3f).
+ */
+template <typename Real>
+struct fftw_traits;
+
+template <>
+struct fftw_traits<double> {
+    typedef fftw_plan plan;
+    typedef fftw_complex complex;
+
+    static plan plan_r2c(int n, double* in, complex* out, unsigned flags) {
+        return fftw_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static plan plan_c2r(int n, complex* in, double* out, unsigned flags) {
+        return fftw_plan_dft_c2r_1d(n, in, out, flags);
+    }
+    // howmany contiguous transforms, each array the given distance
+    // from the last (in elements)
+    static plan plan_many_r2c(int n, int howmany, double* in, int in_distance,
+                              complex* out, int out_distance, unsigned flags) {
+        return fftw_plan_many_dft_r2c(1, &n, howmany, in, nullptr, 1, in_distance,
+                                    out, nullptr, 1, out_distance, flags);
+    }
+    static plan plan_many_c2r(int n, int howmany, complex* in, int in_distance,
+                              double* out, int out_distance, unsigned flags) {
+        return fftw_plan_many_dft_c2r(1, &n, howmany, in, nullptr, 1, in_distance,
+                                    out, nullptr, 1, out_distance, flags);
+    }
+    static void execute(const plan p) { fftw_execute(p); }
+    static void execute_r2c(const plan p, double* in, complex* out) {
+        fftw_execute_dft_r2c(p, in, out);
+    }
+    static void execute_c2r(const plan p, complex* in, double* out) {
+        fftw_execute_dft_c2r(p, in, out);
+    }
+    static void destroy(plan p) { fftw_destroy_plan(p); }
+
+    static double* alloc_real(std::size_t n) { return fftw_alloc_real(n); }
+    static complex* alloc_complex(std::size_t n) { return fftw_alloc_complex(n); }
+    static void free(void* p) { fftw_free(p); }
+
+    static bool import_wisdom(const char* path) { return fftw_import_wisdom_from_filename(path) != 0; }
+    static bool export_wisdom(const char* path) { return fftw_export_wisdom_to_filename(path) != 0; }
+    static void forget_wisdom() { fftw_forget_wisdom(); }
+};
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+template <>
+struct fftw_traits<float> {
+    typedef fftwf_plan plan;
+    typedef fftwf_complex complex;
+
+    static plan plan_r2c(int n, float* in, complex* out, unsigned flags) {
+        return fftwf_plan_dft_r2c_1d(n, in, out, flags);
+    }
+    static plan plan_c2r(int n, complex* in, float* out, unsigned flags) {
+        return fftwf_plan_dft_c2r_1d(n, in, out, flags);
+    }
+    // howmany contiguous transforms, each array the given distance
+    // from the last (in elements)
+    static plan plan_many_r2c(int n, int howmany, float* in, int in_distance,
+                              complex* out, int out_distance, unsigned flags) {
+        return fftwf_plan_many_dft_r2c(1, &n, howmany, in, nullptr, 1, in_distance,
+                                     out, nullptr, 1, out_distance, flags);
+    }
+    static plan plan_many_c2r(int n, int howmany, complex* in, int in_distance,
+                              float* out, int out_distance, unsigned flags) {
+        return fftwf_plan_many_dft_c2r(1, &n, howmany, in, nullptr, 1, in_distance,
+                                     out, nullptr, 1, out_distance, flags);
+    }
+    static void execute(const plan p) { fftwf_execute(p); }
+    static void execute_r2c(const plan p, float* in, complex* out) {
+        fftwf_execute_dft_r2c(p, in, out);
+    }
+    static void execute_c2r(const plan p, complex* in, float* out) {
+        fftwf_execute_dft_c2r(p, in, out);
+    }
+    static void destroy(plan p) { fftwf_destroy_plan(p); }
+
+    static float* alloc_real(std::size_t n) { return fftwf_alloc_real(n); }
+    static complex* alloc_complex(std::size_t n) { return fftwf_alloc_complex(n); }
+    static void free(void* p) { fftwf_free(p); }
+
+    static bool import_wisdom(const char* path) { return fftwf_import_wisdom_from_filename(path) != 0; }
+    static bool export_wisdom(const char* path) { return fftwf_export_wisdom_to_filename(path) != 0; }
+    static void forget_wisdom() { fftwf_forget_wisdom(); }
+};
+#endif
+
+} // namespace audio_transport
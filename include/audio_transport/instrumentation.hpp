@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace audio_transport {
+namespace instrumentation {
+
+typedef std::uint64_t ticks;
+
+/**
+ * A cheap monotonic tick count: the time stamp counter on x86, the
+ * virtual counter on arm64, nanoseconds elsewhere. Only differences
+ * mean anything; ticks_per_second() converts them.
+ */
+inline ticks now() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    ticks t;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * Rate of now(), measured against the steady clock on the first call
+ * (which sleeps for a few milliseconds, so not on the audio thread).
+ */
+double ticks_per_second();
+
+/**
+ * The parts of a hop the realtime engines time. For the CDF engine,
+ * interpolate is the transport map plus moving the spectrum along it.
+ */
+enum class stage : unsigned char {
+    analyze_main,      // windowing, FFTs and polar/reassignment of the main input
+    analyze_sidechain, // the same for the sidechain
+    interpolate,       // grouping, transport plan and mass placement
+    synthesize         // inverse FFT and overlap-add
+};
+
+const size_t num_stages = 4;
+
+// Hop times are binned by powers of two: bucket b counts hops that
+// took [2^b, 2^(b+1)) ticks (bucket 0 also takes 0 and 1)
+const size_t histogram_buckets = 40;
+
+size_t bucket(ticks t);
+
+const char* name(stage s);
+
+/**
+ * A copy of a recorder's counters. Everything is cumulative since the
+ * recorder was made; subtract an earlier snapshot to look at a window.
+ */
+struct snapshot {
+    // process() calls, the samples they covered and their total time
+    std::uint64_t blocks = 0;
+    std::uint64_t block_samples = 0;
+    ticks block_ticks = 0;
+    ticks block_max = 0;
+
+    // Hops, their total time and its distribution
+    std::uint64_t hops = 0;
+    ticks hop_ticks = 0;
+    ticks hop_max = 0;
+    std::uint64_t hop_histogram[histogram_buckets] = {};
+
+    // Per-stage totals over all hops and the slowest single hop's share
+    ticks stage_ticks[num_stages] = {};
+    ticks stage_max[num_stages] = {};
+
+    // Reassignment engine only: transport plans made (one per channel
+    // per hop, or one per hop when linked), masses grouped on both
+    // sides, transport matrix entries, and plans that skipped the
+    // transport because a side was silent
+    std::uint64_t plans = 0;
+    std::uint64_t masses = 0;
+    std::uint64_t transport_entries = 0;
+    std::uint64_t silent_shortcuts = 0;
+
+    // Masses mass pruning merged away (see mass_pruning), counted like
+    // masses: masses + pruned_masses is what grouping gave
+    std::uint64_t pruned_masses = 0;
+
+    // Input windows (one side of one channel) never transformed because
+    // the silence gate found them silent or the sidechain was frozen
+    std::uint64_t skipped_analyses = 0;
+
+    double mean_hop_seconds() const;
+    double mean_stage_seconds(stage s) const;
+    double mean_masses() const;           // per plan, both sides
+    double mean_transport_entries() const; // per non-silent plan
+    double pruned_fraction() const;        // of the masses grouped
+
+    /**
+     * Processing time over the duration of the audio processed, at
+     * sample_rate; above 1 the engine cannot keep up on this machine.
+     */
+    double load(double sample_rate) const;
+};
+
+/**
+ * Counters since earlier, for example between two UI refreshes. The
+ * maxima cannot be taken apart, so they are later's.
+ */
+snapshot operator-(const snapshot& later, const snapshot& earlier);
+
+/**
+ * Print s as a readable table, e.g. from a test binary.
+ */
+void write(std::ostream& out, const snapshot& s, double sample_rate);
+
+/**
+ * Where an engine records its timings; see
+ * RealtimeEngine::setInstrumentation. Recording is lock-free and never
+ * allocates, several engines may share a recorder (a plugin cross-
+ * fading between two, say) and read() can run on any thread at any
+ * time. Off until set_enabled(true); while off an engine pays one
+ * relaxed load per process() call.
+ *
+ * Building with AUDIO_TRANSPORT_NO_INSTRUMENTATION (CMake
+ * -DINSTRUMENTATION=OFF) makes enabled() always false.
+ */
+class recorder {
+public:
+    recorder();
+
+    recorder(const recorder&) = delete;
+    recorder& operator=(const recorder&) = delete;
+
+    void set_enabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    bool enabled() const {
+#ifdef AUDIO_TRANSPORT_NO_INSTRUMENTATION
+        return false;
+#else
+        return enabled_.load(std::memory_order_relaxed);
+#endif
+    }
+
+    // Audio thread: one finished hop with its per-stage times
+    void add_hop(ticks total, const ticks (&stages)[num_stages]);
+
+    // Audio thread: one transport plan, with the masses pruning
+    // removed from it
+    void add_plan(size_t left_masses, size_t right_masses,
+                  size_t transport_entries, bool silent,
+                  size_t pruned_masses = 0);
+
+    // Audio thread: input windows a hop did not analyse
+    void add_skipped(size_t analyses);
+
+    // Audio thread: one process() call
+    void add_block(size_t samples, ticks total);
+
+    snapshot read() const;
+
+private:
+    std::atomic<bool> enabled_;
+
+    std::atomic<std::uint64_t> blocks_;
+    std::atomic<std::uint64_t> block_samples_;
+    std::atomic<ticks> block_ticks_;
+    std::atomic<ticks> block_max_;
+
+    std::atomic<std::uint64_t> hops_;
+    std::atomic<ticks> hop_ticks_;
+    std::atomic<ticks> hop_max_;
+    std::atomic<std::uint64_t> hop_histogram_[histogram_buckets];
+    std::atomic<ticks> stage_ticks_[num_stages];
+    std::atomic<ticks> stage_max_[num_stages];
+
+    std::atomic<std::uint64_t> plans_;
+    std::atomic<std::uint64_t> masses_;
+    std::atomic<std::uint64_t> transport_entries_;
+    std::atomic<std::uint64_t> silent_shortcuts_;
+    std::atomic<std::uint64_t> pruned_masses_;
+    std::atomic<std::uint64_t> skipped_analyses_;
+};
+
+/**
+ * Times the stages of one hop for a recorder, or does nothing if it
+ * is null or disabled. Construct at the start of the hop, call lap()
+ * as each stage ends (a stage can be lapped several times, once per
+ * channel) and finish() at the end.
+ */
+class hop_timer {
+public:
+    explicit hop_timer(recorder* r)
+        : recorder_(r && r->enabled() ? r : nullptr),
+          start_(recorder_ ? now() : 0), last_(start_), stages_() {}
+
+    void lap(stage s) {
+        if (!recorder_) return;
+        ticks t = now();
+        stages_[static_cast<size_t>(s)] += t - last_;
+        last_ = t;
+    }
+
+    void finish() {
+        if (recorder_) recorder_->add_hop(now() - start_, stages_);
+    }
+
+    // Count input windows this hop did not analyse
+    void skipped(size_t analyses) {
+        if (recorder_ && analyses) recorder_->add_skipped(analyses);
+    }
+
+    bool active() const { return recorder_ != nullptr; }
+
+private:
+    recorder* recorder_;
+    ticks start_;
+    ticks last_;
+    ticks stages_[num_stages];
+};
+
+/**
+ * Times one process() call the same way
+ */
+class block_timer {
+public:
+    explicit block_timer(recorder* r)
+        : recorder_(r && r->enabled() ? r : nullptr),
+          start_(recorder_ ? now() : 0) {}
+
+    void finish(size_t samples) {
+        if (recorder_) recorder_->add_block(samples, now() - start_);
+    }
+
+private:
+    recorder* recorder_;
+    ticks start_;
+};
+
+} // namespace instrumentation
+} // namespace audio_transport
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+namespace audio_transport {
+
+/**
+ * The interpolation factors of the latest input samples, so a realtime
+ * engine given one k per sample can take each hop's k at the centre of
+ * the frame it resynthesizes, which may lie in an earlier block. One
+ * per engine, fed in step with the input.
+ */
+class k_history {
+public:
+    k_history() : pos_(0), primed_(false) {}
+
+    // Hold the last length factors. Allocates.
+    void resize(int length) {
+        ring_.assign(std::max(length, 1), 0.0f);
+        reset();
+    }
+
+    // Forget the factors; until the next push or fill every age reads
+    // its first one, as if it had always applied
+    void reset() {
+        pos_ = 0;
+        primed_ = false;
+    }
+
+    // Append one factor per sample
+    void push(const float* k, int count) {
+        if (count <= 0) return;
+        prime(k[0]);
+        const int size = static_cast<int>(ring_.size());
+        if (count >= size) {
+            std::copy(k + count - size, k + count, ring_.begin());
+            pos_ = 0;
+            return;
+        }
+        int first = std::min(count, size - pos_);
+        std::copy(k, k + first, ring_.begin() + pos_);
+        std::copy(k + first, k + count, ring_.begin());
+        pos_ = (pos_ + count) % size;
+    }
+
+    // Append count samples of the same factor
+    void fill(float k, int count) {
+        if (count <= 0) return;
+        prime(k);
+        const int size = static_cast<int>(ring_.size());
+        if (count >= size) {
+            std::fill(ring_.begin(), ring_.end(), k);
+            pos_ = 0;
+            return;
+        }
+        int first = std::min(count, size - pos_);
+        std::fill(ring_.begin() + pos_, ring_.begin() + pos_ + first, k);
+        std::fill(ring_.begin(), ring_.begin() + (count - first), k);
+        pos_ = (pos_ + count) % size;
+    }
+
+    // The factor of the sample age samples before the latest (0 is the
+    // latest); age must be less than the length
+    float at(int age) const {
+        int i = pos_ - 1 - age;
+        if (i < 0) i += static_cast<int>(ring_.size());
+        return ring_[i];
+    }
+
+private:
+    void prime(float k) {
+        if (!primed_) std::fill(ring_.begin(), ring_.end(), k);
+        primed_ = true;
+    }
+
+    std::vector<float> ring_;
+    int pos_;
+    bool primed_;
+};
+
+} // namespace audio_transport
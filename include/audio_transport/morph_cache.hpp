@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/offline_renderer.hpp"
+
+namespace audio_transport {
+
+/**
+ * Everything offline_renderer::transport() computes before the
+ * interpolation factor comes in, kept so that one pair of inputs can
+ * be rendered at many factors or envelopes.
+ *
+ * Building a cache analyzes both inputs, applies the equal loudness
+ * weighting and groups and plans the transport of every window. Each
+ * render() afterwards only places the masses along the kept plans and
+ * synthesizes, on the calling thread. Its output matches transport()
+ * with the same settings and interpolation curve: exactly in windows
+ * where both inputs sound, to rounding in windows where one is silent.
+ *
+ * A window keeps its plan and the magnitudes, phases and reassigned
+ * frequencies of each input that is not silent: 24 bytes per bin of
+ * each input plus the masses, against 40 for an analysis frame. save()
+ * writes the cache to a file of flat native-endian arrays that load()
+ * reads back, so a session can reuse the analysis across runs.
+ */
+class morph_cache {
+public:
+    // An empty cache, to load() into
+    morph_cache() {}
+
+    /**
+     * Analyze and plan left into right with settings' window_size,
+     * padding, overlap and equal_loudness. interpolation and on_window
+     * are not used; render() takes the curve instead.
+     */
+    morph_cache(const std::vector<double>& left, double left_sample_rate,
+                const std::vector<double>& right, double right_sample_rate,
+                const transport_settings& settings);
+
+    /**
+     * Render with interpolation(w, num_windows()) as the factor of
+     * window w. The result has the length transport() gives, or is
+     * empty if the cache is.
+     */
+    std::vector<double> render(
+        const std::function<double(size_t w, size_t num_windows)>& interpolation) const;
+
+    /**
+     * Write the cache to path or read one written by save(). Both
+     * return false if the file cannot be opened or, for load(), is
+     * not a cache of this format; a failed load() leaves the cache empty.
+     */
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    size_t num_windows() const { return windows_.size(); }
+    bool empty() const { return windows_.empty(); }
+
+    // What the cache was built from, for callers checking a loaded one
+    size_t left_length() const { return left_length_; }
+    size_t right_length() const { return right_length_; }
+    double left_sample_rate() const { return left_sample_rate_; }
+    double right_sample_rate() const { return right_sample_rate_; }
+    double window_size() const { return window_size_; }
+    unsigned int padding() const { return padding_; }
+    unsigned int overlap() const { return overlap_; }
+    bool equal_loudness() const { return equal_loudness_; }
+
+private:
+    struct window {
+        transport_plan plan; // masses and transport only
+        polar_frame left;    // empty where left is silent
+        polar_frame right;   // empty where right is silent
+    };
+
+    size_t left_length_ = 0;
+    size_t right_length_ = 0;
+    double left_sample_rate_ = 0;
+    double right_sample_rate_ = 0;
+    double window_size_ = 0;
+    unsigned int padding_ = 0;
+    unsigned int overlap_ = 1;
+    bool equal_loudness_ = true;
+
+    // Bin frequencies, the same in every window
+    aligned_vector<double> left_freq_;
+    aligned_vector<double> right_freq_;
+
+    std::vector<window> windows_;
+};
+
+} // namespace audio_transport
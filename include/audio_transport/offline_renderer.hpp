@@ -0,0 +1,119 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+
+namespace audio_transport {
+
+struct synthesis_lanes;
+
+/**
+ * Settings for offline_renderer::transport(). window_size, padding
+ * and overlap are passed to the analysis of both inputs.
+ */
+struct transport_settings {
+    double window_size = 0.05; // seconds
+    unsigned int padding = 0;
+    unsigned int overlap = 1;
+
+    // A-weight both inputs before interpolating and undo it on the
+    // output, as the transport example does
+    bool equal_loudness = true;
+
+    // Interpolation factor for window w of num_windows, in [0, 1]
+    std::function<double(size_t w, size_t num_windows)> interpolation;
+
+    // Called for each window in order, on the interpolating thread,
+    // with the (weighted) inputs and the interpolated output. Optional.
+    std::function<void(size_t w,
+                       const spectral::frame& left,
+                       const spectral::frame& right,
+                       const spectral::frame& output)> on_window;
+};
+
+/**
+ * Multithreaded offline rendering on a fixed pool of worker threads.
+ *
+ * analysis() and synthesis() split their windows across the pool;
+ * each thread runs the shared FFT plans through the new-array
+ * interface on its own buffers. Synthesis gives windows that can
+ * overlap separate accumulators and sums them in window order, so
+ * every result is bit-identical to spectral::analysis_frames() and
+ * spectral::synthesis() whatever the thread count.
+ *
+ * transport() renders a whole interpolation. The phases carried from
+ * window to window make interpolation sequential, so one thread steps
+ * through the windows in order while the others analyze ahead of it
+ * and synthesize behind it. Spectra are dropped as soon as they are
+ * used, and synthesized windows as soon as they are added to the
+ * output in order; both stages stay a bounded number of windows apart,
+ * so beyond the output itself memory does not grow with the length of
+ * the input.
+ *
+ * The calling thread takes part in every call, so a renderer of one
+ * thread starts no workers. One renderer runs one call at a time;
+ * use a renderer per thread to render several files concurrently.
+ */
+class offline_renderer {
+public:
+    // num_threads = 0 uses std::thread::hardware_concurrency()
+    explicit offline_renderer(unsigned int num_threads = 0);
+    ~offline_renderer();
+
+    offline_renderer(const offline_renderer&) = delete;
+    offline_renderer& operator=(const offline_renderer&) = delete;
+
+    unsigned int num_threads() const { return static_cast<unsigned int>(workers_.size()) + 1; }
+
+    std::vector<spectral::frame> analysis(
+        const std::vector<double>& audio,
+        double sample_rate,
+        double window_size = 0.05, // seconds
+        unsigned int padding = 0,
+        unsigned int overlap = 1);
+
+    std::vector<double> synthesis(
+        const std::vector<spectral::frame>& frames,
+        unsigned int padding = 0,
+        unsigned int overlap = 1);
+
+    /**
+     * Transport left into right over min(left, right) windows and
+     * synthesize the result; the same output as analysing both with
+     * spectral::analysis_frames(), calling interpolate() on each window
+     * with one phases vector and passing the frames to synthesis().
+     */
+    std::vector<double> transport(
+        const std::vector<double>& left,
+        double left_sample_rate,
+        const std::vector<double>& right,
+        double right_sample_rate,
+        const transport_settings& settings);
+
+private:
+    typedef std::function<void(unsigned int thread)> job;
+
+    // Run job on every thread (the caller is thread 0) and wait
+    void run(const job& work);
+    void worker_loop(unsigned int thread);
+
+    // Sum the overlap-add lanes into audio, in window order
+    void combine_lanes(const synthesis_lanes& lanes, std::vector<double>& audio);
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable finished_;
+    const job* job_ = nullptr;
+    unsigned long generation_ = 0;
+    unsigned int running_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace audio_transport
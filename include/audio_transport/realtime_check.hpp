@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+
+namespace audio_transport {
+namespace realtime_check {
+
+/**
+ * Marks the calling thread as running audio-callback code for the
+ * lifetime of the object. The realtime engines open one at the top
+ * of process().
+ */
+class scope {
+public:
+    scope();
+    ~scope();
+
+    scope(const scope&) = delete;
+    scope& operator=(const scope&) = delete;
+};
+
+/**
+ * True while a scope is open on the calling thread
+ */
+bool active();
+
+/**
+ * Report a heap allocation. Intended to be called from a replacement
+ * operator new installed by the host or test binary.
+ *
+ * Inside a scope the allocation is counted. When the library is built
+ * with AUDIO_TRANSPORT_REALTIME_CHECKS (the default for Debug builds)
+ * it aborts instead, so the offending call stack ends up in the core.
+ */
+void allocation(std::size_t size);
+
+/**
+ * Number of allocations reported inside a scope on this thread
+ */
+std::size_t allocation_count();
+
+} // namespace realtime_check
+} // namespace audio_transport
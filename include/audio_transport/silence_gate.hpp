@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cmath>
+
+namespace audio_transport {
+
+/**
+ * Counts how many of the latest input samples were within
+ * ±threshold, so a realtime engine can tell in O(hop) whether its
+ * whole analysis window is silent and skip transforming it. One per
+ * input channel, fed every sample in order.
+ *
+ * A negative threshold never gates. A new threshold applies to the
+ * samples pushed from then on.
+ */
+class silence_gate {
+public:
+    silence_gate() : quiet_(0) {}
+
+    template <typename T>
+    void push(const T* samples, int count, float threshold) {
+        int loud_end = count;
+        while (loud_end > 0 && std::abs(samples[loud_end - 1]) <= threshold) {
+            loud_end--;
+        }
+        if (loud_end > 0) {
+            quiet_ = count - loud_end;
+        } else if (quiet_ < (1 << 30)) {
+            quiet_ += count; // capped so hours of silence cannot overflow
+        }
+    }
+
+    // True if the last window samples were all quiet
+    bool silent(int window) const { return quiet_ >= window; }
+
+    void reset() { quiet_ = 0; }
+
+private:
+    int quiet_;
+};
+
+} // namespace audio_transport
@@ -2,6 +2,10 @@
 
 #include <vector>
 #include <complex>
+#include <memory>
+
+#include "audio_transport/aligned_allocator.hpp"
+#include "audio_transport/fftw_traits.hpp"
 
 namespace audio_transport {
 namespace spectral {
@@ -16,6 +20,47 @@ struct point {
   double freq_reassigned;
 };
 
+/**
+ * Structure-of-arrays form of one analysis window: each field of
+ * point is stored in its own contiguous, SIMD-aligned array so that
+ * scans over one or two fields only touch the cache lines they need.
+ * All bins of a frame share a single center time.
+ */
+struct frame {
+  aligned_vector<double> re;
+  aligned_vector<double> im;
+  aligned_vector<double> freq;
+  aligned_vector<double> time_reassigned;
+  aligned_vector<double> freq_reassigned;
+
+  double time = 0;
+
+  size_t size() const { return re.size(); }
+  void resize(size_t n);
+  void reserve(size_t n);
+
+  std::complex<double> value(size_t i) const {
+    return std::complex<double>(re[i], im[i]);
+  }
+
+  point get(size_t i) const;
+  void set(size_t i, const point & p);
+};
+
+/**
+ * Adapters between the point and frame layouts. to_frame takes the
+ * frame time from the first point. The in-place forms reuse the
+ * destination's storage.
+ */
+void to_frame(const std::vector<point> & points, frame & output);
+void to_points(const frame & input, std::vector<point> & output);
+
+frame to_frame(const std::vector<point> & points);
+std::vector<point> to_points(const frame & input);
+
+std::vector<frame> to_frames(const std::vector<std::vector<point>> & points);
+std::vector<std::vector<point>> to_points(const std::vector<frame> & frames);
+
 /**
  * Analyze an audio signal to produce an array of spectral points.
  * Points are reduced to mono.
@@ -28,6 +73,17 @@ std::vector<std::vector<point>> analysis(
     unsigned int overlap = 1
     );
 
+/**
+ * Same as above, producing one frame per window
+ */
+std::vector<frame> analysis_frames(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1
+    );
+
 /**
  * Synthesize an audio signal from an array of spectral points.
  */
@@ -37,6 +93,12 @@ std::vector<double> synthesis(
     unsigned int overlap = 1
     );
 
+std::vector<double> synthesis(
+    const std::vector<frame> & frames,
+    unsigned int padding = 0,
+    unsigned int overlap = 1
+    );
+
 /**
  * A Hamming window, chosen because it is COLA
  * and easy to compute
@@ -49,4 +111,166 @@ double hann(double n, double N);
 double hann_t (double n, double N, double sample_rate);
 double hann_d (double n, double N, double sample_rate);
 
+/**
+ * Low-latency analysis window for a transform of N samples that is
+ * resynthesized from its last L only (L even, 2 <= L <= N): the
+ * rising half of a sine window 2N - L long, then the falling half
+ * of one L long, so it peaks L/2 samples before its end. The
+ * frequency resolution is close to that of N while the output only
+ * waits for L samples (Mauler & Martin, ICASSP 2007).
+ *
+ * 0 <= i < N is the sample index, not centered like hann's n
+ */
+double asymmetric(double i, double N, double L);
+
+// Time-weighting (about the window's middle, as for hann_t) and
+// derivative of the asymmetric window
+double asymmetric_t(double i, double N, double L, double sample_rate);
+double asymmetric_d(double i, double N, double L, double sample_rate);
+
+/**
+ * hann, hann_t and hann_d sampled at n = i - (N - 1)/2
+ * for i in [0, N), i.e. the analysis windows of size N.
+ *
+ * Tables with L < N hold asymmetric, asymmetric_t and asymmetric_d
+ * in their place, and synthesis is the window for the last L
+ * samples of each inverse transform: hann(L) divided by the
+ * analysis window, so that the two multiply to a hann window of L
+ * that overlap-adds like the symmetric one. synthesis is empty
+ * for L == N, where output is taken unwindowed.
+ */
+struct window_tables {
+  size_t N;
+  size_t L;
+  double sample_rate;
+
+  aligned_vector<double> hann;
+  aligned_vector<double> hann_t;
+  aligned_vector<double> hann_d;
+  aligned_vector<double> synthesis;
+};
+
+/**
+ * Tables for (N, sample_rate, L), shared by every caller that asks
+ * for the same key while any of them still holds a reference.
+ * L = 0 means N. Thread-safe; builds the tables on first use so
+ * call it outside the audio callback.
+ */
+std::shared_ptr<const window_tables> get_window_tables(
+    size_t N,
+    double sample_rate,
+    size_t L = 0);
+
+/**
+ * Fill the three FFT inputs for one window of N samples in a
+ * single pass: window[i] = audio[i] * hann[i] and so on.
+ */
+template <typename In, typename Out>
+void apply_windows(
+    const window_tables & tables,
+    const In * audio,
+    Out * window,
+    Out * window_t,
+    Out * window_d) {
+  const double * h   = tables.hann.data();
+  const double * h_t = tables.hann_t.data();
+  const double * h_d = tables.hann_d.data();
+  for (size_t i = 0; i < tables.N; i++) {
+    double a = audio[i];
+    window  [i] = static_cast<Out>(a * h  [i]);
+    window_t[i] = static_cast<Out>(a * h_t[i]);
+    window_d[i] = static_cast<Out>(a * h_d[i]);
+  }
+}
+
+/**
+ * The per-window steps analysis and synthesis are built from, for
+ * callers that schedule windows themselves (see offline_renderer.hpp
+ * and transport_stream.hpp).
+ * Windows are independent given a layout, so any number of threads
+ * may analyze or synthesize at once as long as each uses its own
+ * workspace and, for synthesis, no two overlapping windows add into
+ * the same audio concurrently. The results match analysis_frames()
+ * and synthesis() exactly.
+ */
+struct analysis_layout {
+  double sample_rate;
+  size_t N;               // window size in samples
+  size_t N_padded;        // transform size
+  size_t padding_samples; // zeros either side of the window
+  size_t hop_size;        // N/(2 * overlap)
+  size_t num_windows;
+
+  std::shared_ptr<const window_tables> tables;
+  fftw_plan plan;         // shared plan of the three forward transforms
+                          // of N_padded, batched as in window_workspace
+};
+
+// Sizes analysis_frames() uses for num_samples of audio
+analysis_layout get_analysis_layout(
+    size_t num_samples,
+    double sample_rate,
+    double window_size = 0.05, // seconds
+    unsigned int padding = 0,
+    unsigned int overlap = 1
+    );
+
+struct synthesis_layout {
+  size_t N_padded;        // transform size
+  size_t window_size;     // samples kept from each transform
+  size_t padding_samples;
+  size_t hop_size;
+  unsigned int overlap;
+  size_t num_windows;
+  size_t num_samples;     // length of the synthesized audio
+
+  fftw_plan plan;         // shared inverse plan of N_padded
+};
+
+// Sizes synthesis() uses for num_windows windows of num_bins bins
+synthesis_layout get_synthesis_layout(
+    size_t num_bins,
+    size_t num_windows,
+    unsigned int padding = 0,
+    unsigned int overlap = 1
+    );
+
+/**
+ * Scratch for one thread's analyze_window()/synthesize_window()
+ * calls on transforms of N_padded.
+ */
+struct window_workspace {
+  explicit window_workspace(size_t N_padded);
+
+  // Windowed, zero padded transform inputs (hann, hann_t, hann_d),
+  // fft_plans::real_distance(N_padded) apart, so that one batched
+  // plan transforms all three
+  aligned_vector<double> windows;
+  // Their interleaved complex spectra of N_padded/2 + 1 bins,
+  // fft_plans::complex_distance(N_padded) bins apart
+  aligned_vector<double> spectra;
+  // Inverse transform output
+  aligned_vector<double> synthesized;
+};
+
+/**
+ * Window w as analysis_frames() computes it, from the N samples at
+ * audio_window (audio + w * hop_size for a whole signal in memory).
+ * w only sets the frame time.
+ */
+void analyze_window(
+    const double * audio_window,
+    const analysis_layout & layout,
+    size_t w,
+    frame & output,
+    window_workspace & workspace);
+
+// Overlap-add one window into output[0, window_size), where output
+// is audio + w * hop_size for window w
+void synthesize_window(
+    const frame & window,
+    const synthesis_layout & layout,
+    double * output,
+    window_workspace & workspace);
+
 }}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio_transport/audio_transport.hpp"
+
+namespace audio_transport {
+
+/**
+ * A fixed spectrum for a realtime engine to morph toward in place of
+ * its sidechain (see RealtimeEngine::setTarget()), so that each hop
+ * only analyses the main input.
+ *
+ * Targets are made by an engine's makeTarget() from a recording,
+ * analysed hop by hop the way the engine analyses its sidechain. An
+ * averaged target is a single frame: the mean magnitude of every bin,
+ * its magnitude-weighted reassigned frequency and the phase of the
+ * loudest hop. A time-indexed target keeps the frame of every hop,
+ * which the engine steps through one per hop and loops. Frames made by
+ * the reassignment engine also keep their grouped masses, so neither
+ * the transforms nor the grouping of the sidechain are left to do.
+ *
+ * Frames hold floats: 12 bytes per bin (8 for the CDF engine) plus the
+ * masses. save() writes them to a file of flat native-endian arrays
+ * that load() reads back, so a library of targets is analysed once.
+ */
+class target_spectrum {
+public:
+    enum class mode : uint32_t {
+        averaged,    // one frame for the whole recording
+        time_indexed // one frame per hop, looped
+    };
+
+    enum class algorithm : uint32_t {
+        cdf = 1,         // RealtimeAudioTransport
+        reassignment = 2 // RealtimeReassignmentTransport
+    };
+
+    /**
+     * What a target was analysed with. An engine only plays targets
+     * of its own analysis, in either precision.
+     */
+    struct analysis {
+        algorithm engine = algorithm::cdf;
+        double sample_rate = 0;
+        uint32_t fft_size = 0;       // transform length, padding included
+        uint32_t window_size = 0;    // analysis window in samples
+        uint32_t synthesis_size = 0; // samples resynthesized per hop
+        uint32_t hop_size = 0;
+
+        size_t num_bins() const { return fft_size / 2 + 1; }
+        bool operator==(const analysis& other) const;
+        bool operator!=(const analysis& other) const { return !(*this == other); }
+    };
+
+    struct frame {
+        std::vector<float> magnitudes;
+        std::vector<float> phases;
+
+        // Reassignment engine only, empty otherwise: each bin's
+        // reassigned frequency less its own, and the masses grouped
+        // from the frame (unpruned)
+        std::vector<float> freq_offsets;
+        std::vector<spectral_mass> masses;
+
+        bool silent = true;
+    };
+
+    // An empty target, to load() into
+    target_spectrum() {}
+
+    // Frames must all have settings.num_bins() bins
+    target_spectrum(const analysis& settings, mode playback, std::vector<frame> frames);
+
+    /**
+     * The frame an averaged target keeps for frames (see above), which
+     * must not be empty. It has no masses; it is silent only if every
+     * frame is.
+     */
+    static frame average(const std::vector<frame>& frames);
+
+    /**
+     * Write the target to path or read one written by save(). Both
+     * return false if the file cannot be opened or, for load(), is
+     * not a target of this format; a failed load() leaves it empty.
+     */
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    const analysis& settings() const { return settings_; }
+    mode playback() const { return playback_; }
+    size_t num_frames() const { return frames_.size(); }
+    bool empty() const { return frames_.empty(); }
+
+    // The frame of a hop counted from the start, looping
+    const frame& at(size_t hop) const { return frames_[hop % frames_.size()]; }
+
+private:
+    analysis settings_;
+    mode playback_ = mode::averaged;
+    std::vector<frame> frames_;
+};
+
+} // namespace audio_transport
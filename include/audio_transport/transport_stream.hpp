@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/offline_renderer.hpp"
+
+namespace audio_transport {
+
+/**
+ * Pull-based offline transport with constant memory.
+ *
+ * Each read() pulls just enough input from the two sources to analyze,
+ * interpolate and overlap-add the next windows, and hands back the
+ * audio no later window can change. Only the current window of each
+ * input, one frame per stage and one window of overlap-add are held,
+ * so memory does not depend on the length of the inputs; it is a few
+ * N_padded-sized buffers.
+ *
+ * The concatenated output is bit-identical to offline_renderer::
+ * transport() (and so to the serial analysis, interpolate, synthesis
+ * chain) on the same whole inputs, whatever the source and read sizes.
+ *
+ * Everything runs on the calling thread; use one stream per channel
+ * or file to render several at once.
+ */
+class transport_stream {
+public:
+    /**
+     * Fill buffer with up to count samples and return how many were
+     * written. Returning fewer than count, but not 0, just means "call
+     * again"; 0 ends the input.
+     */
+    typedef std::function<size_t(double* buffer, size_t count)> source;
+
+    /**
+     * num_windows is passed to settings.interpolation as is. Callers
+     * that know the input lengths can get it from num_windows() below;
+     * a stream of unknown length can pass 0 and use a curve of w only.
+     */
+    transport_stream(source left, double left_sample_rate,
+                     source right, double right_sample_rate,
+                     const transport_settings& settings,
+                     size_t num_windows = 0);
+
+    // Windows produced for inputs of these lengths (the shorter input's count)
+    static size_t num_windows(size_t left_length, double left_sample_rate,
+                              size_t right_length, double right_sample_rate,
+                              const transport_settings& settings);
+
+    /**
+     * Write up to count samples of output and return how many were
+     * written; fewer than count only once the output is complete.
+     * The total is (windows + 2 * overlap - 1) * hop_size samples of
+     * the left input's hop, or 0 if either input is shorter than a window.
+     */
+    size_t read(double* output, size_t count);
+
+    // True once read() has returned every sample
+    bool finished() const { return finished_ && pending_position_ == pending_.size(); }
+
+    // Windows interpolated so far
+    size_t windows() const { return window_; }
+
+private:
+    struct input {
+        input(source pull, double sample_rate, const transport_settings& settings);
+
+        // Make buffer hold the samples of window w; false at end of input
+        bool advance(size_t w);
+
+        source pull;
+        spectral::analysis_layout layout;
+        spectral::window_workspace workspace;
+        std::vector<double> buffer; // N samples, the current window
+        spectral::frame frame;
+    };
+
+    // Analyze, interpolate and synthesize the next window into pending_
+    void step();
+
+    transport_settings settings_;
+    size_t num_windows_;
+    input left_;
+    input right_;
+
+    spectral::synthesis_layout output_layout_;
+    spectral::window_workspace output_workspace_;
+    interpolate_workspace interpolate_workspace_;
+    std::vector<double> phases_;
+    spectral::frame output_frame_;
+
+    // Overlap-add of the windows still in progress, window_size samples
+    // from the start of the next window's hop
+    std::vector<double> overlap_;
+    // Finished samples not yet read
+    std::vector<double> pending_;
+    size_t pending_position_ = 0;
+
+    size_t window_ = 0;
+    bool finished_ = false;
+};
+
+} // namespace audio_transport
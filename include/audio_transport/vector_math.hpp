@@ -0,0 +1,57 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+
+namespace audio_transport {
+namespace vector_math {
+
+/**
+ * Batched transcendental kernels for the per-bin spectral loops.
+ *
+ * Each function processes n elements using the widest instruction set
+ * the library was compiled for (AVX2, SSE2 or NEON) with a scalar
+ * fallback for the tail, so results do not depend on n or alignment.
+ * Accuracy is within a few ulp of the <cmath> equivalents.
+ *
+ * The SoA variants take separate real/imaginary (or x/y) arrays; the
+ * interleaved variants work directly on std::complex buffers such as
+ * FFTW output. Input and output arrays must not overlap.
+ */
+
+// out[i] = sqrt(x[i]^2 + y[i]^2) (no overflow protection)
+void hypot(const double * x, const double * y, double * out, size_t n);
+void hypot(const float * x, const float * y, float * out, size_t n);
+
+// out[i] = atan2(y[i], x[i])
+void atan2(const double * y, const double * x, double * out, size_t n);
+void atan2(const float * y, const float * x, float * out, size_t n);
+
+// s[i] = sin(x[i]), c[i] = cos(x[i])
+// Arguments beyond |x| > 1e8 (double) or 8192 (float) use <cmath>.
+void sincos(const double * x, double * s, double * c, size_t n);
+void sincos(const float * x, float * s, float * c, size_t n);
+
+// mag[i] = std::abs(in[i]), phase[i] = std::arg(in[i])
+void magnitude_phase(const std::complex<double> * in,
+                     double * mag, double * phase, size_t n);
+void magnitude_phase(const std::complex<float> * in,
+                     float * mag, float * phase, size_t n);
+
+// out[i] = std::polar(mag[i], phase[i])
+void polar(const double * mag, const double * phase,
+           std::complex<double> * out, size_t n);
+void polar(const float * mag, const float * phase,
+           std::complex<float> * out, size_t n);
+
+// Replace every NaN and infinity in x with 0, returning how many were
+// replaced. Packs of finite values are left alone, so the cost on
+// clean data is one compare per pack.
+size_t sanitize(double * x, size_t n);
+size_t sanitize(float * x, size_t n);
+
+// Name of the instruction set the kernels were built for
+const char * isa();
+
+} // namespace vector_math
+} // namespace audio_transport
@@ -0,0 +1,828 @@
+/**
+ * _audio_transport: CPython bindings to the realtime engines and the
+ * offline analysis/interpolate/synthesis API
+ *
+ * Audio is passed through the buffer protocol: NumPy arrays, array.array,
+ * memoryviews and the like are read and written in place, never copied
+ * into Python objects. The engines take C-contiguous float32 of shape
+ * (samples,) or planar (channels, samples); the offline functions take
+ * 1-D float64 (or float32) and return float64. A returned buffer is a
+ * memoryview that NumPy wraps without a copy (numpy.asarray).
+ *
+ * Every call that processes audio releases the GIL, so Python threads
+ * transport several files at once. Each engine serialises its own
+ * calls; Frames are immutable once made and may be shared freely.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/offline_renderer.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeEngine.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+#include "audio_transport/spectral.hpp"
+
+using namespace audio_transport;
+
+namespace {
+
+//==============================================================================
+// Buffers
+
+// A buffer held for the length of a call and released with the GIL held
+struct buffer {
+    Py_buffer view;
+    bool held = false;
+
+    buffer() { std::memset(&view, 0, sizeof(view)); }
+    ~buffer() { if (held) PyBuffer_Release(&view); }
+    buffer(const buffer&) = delete;
+    buffer& operator=(const buffer&) = delete;
+
+    // Samples along the last axis, channels along the first if 2-D
+    Py_ssize_t samples() const { return view.ndim == 0 ? 1 : view.shape[view.ndim - 1]; }
+    Py_ssize_t channels() const { return view.ndim == 2 ? view.shape[0] : 1; }
+};
+
+// The type code of a buffer's format in native byte order, or 0
+static char native_type(const Py_buffer& view) {
+    const char* format = view.format ? view.format : "B";
+    if (format[0] == '@' || format[0] == '=') {
+        format++;
+    }
+#if PY_LITTLE_ENDIAN
+    else if (format[0] == '<') {
+        format++;
+    }
+#else
+    else if (format[0] == '>' || format[0] == '!') {
+        format++;
+    }
+#endif
+    return format[0] != '\0' && format[1] == '\0' ? format[0] : 0;
+}
+
+// Get a C-contiguous buffer of 1 or up to max_dims dimensions whose
+// type code is one of types. Sets a Python error and returns false
+// otherwise.
+static bool get_buffer(PyObject* object, const char* name, const char* types, int max_dims,
+                       bool writable, buffer& out) {
+    int flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT | (writable ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(object, &out.view, flags) != 0) {
+        PyErr_Format(PyExc_TypeError, "%s must be a C-contiguous%s buffer", name,
+                     writable ? " writable" : "");
+        return false;
+    }
+    out.held = true;
+
+    char type = native_type(out.view);
+    if (type == 0 || std::strchr(types, type) == nullptr) {
+        PyErr_Format(PyExc_TypeError, "%s must hold %s", name,
+                     std::strlen(types) > 1 ? "float64 or float32" : (types[0] == 'f' ? "float32" : "float64"));
+        return false;
+    }
+    if (out.view.ndim < 1 || out.view.ndim > max_dims) {
+        PyErr_Format(PyExc_ValueError, "%s must have %s dimension%s", name,
+                     max_dims == 1 ? "one" : "one or two", max_dims == 1 ? "" : "s");
+        return false;
+    }
+    if (out.samples() > INT_MAX) {
+        PyErr_Format(PyExc_ValueError, "%s is too long", name);
+        return false;
+    }
+    return true;
+}
+
+// A new zeroed buffer of the given type code and shape, as a memoryview
+static PyObject* new_buffer(char type, Py_ssize_t channels, Py_ssize_t samples, int ndim) {
+    Py_ssize_t item = type == 'f' ? sizeof(float) : sizeof(double);
+    PyObject* bytes = PyByteArray_FromStringAndSize(nullptr, channels * samples * item);
+    if (!bytes) return nullptr;
+    std::memset(PyByteArray_AS_STRING(bytes), 0, static_cast<size_t>(channels * samples * item));
+
+    PyObject* view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (!view) return nullptr;
+
+    PyObject* shape = ndim == 2 ? Py_BuildValue("(nn)", channels, samples) : Py_BuildValue("(n)", samples);
+    PyObject* cast = shape ? PyObject_CallMethod(view, "cast", "CO", type, shape) : nullptr;
+    Py_XDECREF(shape);
+    Py_DECREF(view);
+    return cast;
+}
+
+// Samples of a 1-D float64 or float32 buffer as doubles
+static std::vector<double> to_doubles(const buffer& b) {
+    std::vector<double> values(static_cast<size_t>(b.samples()));
+    if (native_type(b.view) == 'd') {
+        std::memcpy(values.data(), b.view.buf, values.size() * sizeof(double));
+    } else {
+        const float* samples = static_cast<const float*>(b.view.buf);
+        for (size_t i = 0; i < values.size(); i++) values[i] = samples[i];
+    }
+    return values;
+}
+
+// An interpolation factor per window from a number or a curve, which
+// is stretched linearly over the windows
+struct factors {
+    double constant = 0.5;
+    std::vector<double> curve;
+
+    double at(size_t w, size_t num_windows) const {
+        if (curve.empty()) return constant;
+        if (curve.size() == 1 || num_windows < 2) return curve.front();
+        double position = double(w) * (curve.size() - 1) / (num_windows - 1);
+        size_t i = static_cast<size_t>(position);
+        if (i + 1 >= curve.size()) return curve.back();
+        double t = position - i;
+        return curve[i] + t * (curve[i + 1] - curve[i]);
+    }
+};
+
+static bool get_factors(PyObject* object, factors& out) {
+    if (PyNumber_Check(object) && !PyObject_CheckBuffer(object)) {
+        out.constant = PyFloat_AsDouble(object);
+        return !PyErr_Occurred();
+    }
+    buffer curve;
+    if (!get_buffer(object, "k", "df", 1, false, curve)) return false;
+    if (curve.samples() == 0) {
+        PyErr_SetString(PyExc_ValueError, "k must not be empty");
+        return false;
+    }
+    out.curve = to_doubles(curve);
+    return true;
+}
+
+//==============================================================================
+// Engines
+
+struct EngineObject {
+    PyObject_HEAD
+    RealtimeEngine* engine;
+    std::mutex* lock; // held for every call into the engine
+};
+
+static PyObject* engine_new(PyTypeObject* type, PyObject*, PyObject*) {
+    EngineObject* self = reinterpret_cast<EngineObject*>(type->tp_alloc(type, 0));
+    if (!self) return nullptr;
+    self->engine = nullptr;
+    self->lock = new (std::nothrow) std::mutex();
+    if (!self->lock) {
+        Py_DECREF(self);
+        return PyErr_NoMemory();
+    }
+    return reinterpret_cast<PyObject*>(self);
+}
+
+static void engine_dealloc(PyObject* object) {
+    EngineObject* self = reinterpret_cast<EngineObject*>(object);
+    delete self->engine;
+    delete self->lock;
+    PyTypeObject* type = Py_TYPE(object);
+    type->tp_free(object);
+    Py_DECREF(type);
+}
+
+// Construction measures FFT plans, so it runs without the GIL too
+template <typename Make>
+static int construct(EngineObject* self, Make make) {
+    RealtimeEngine* engine = nullptr;
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        engine = make();
+    } catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    delete self->engine;
+    self->engine = engine;
+    return 0;
+}
+
+static bool check_precision(const char* precision, bool& single) {
+    single = std::strcmp(precision, "float") == 0;
+    if (!single && std::strcmp(precision, "double") != 0) {
+        PyErr_SetString(PyExc_ValueError, "precision must be 'double' or 'float'");
+        return false;
+    }
+#ifdef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    if (single) {
+        PyErr_SetString(PyExc_ValueError, "built without float engines");
+        return false;
+    }
+#endif
+    return true;
+}
+
+static bool check_settings(double sample_rate, double window_ms, int hop_divisor, int padding) {
+    if (!(sample_rate > 0) || !(window_ms > 0) || hop_divisor < 1 || padding < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "sample_rate and window_ms must be positive, hop_divisor and padding at least 1");
+        return false;
+    }
+    return true;
+}
+
+static int cdf_init(PyObject* object, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {
+        "sample_rate", "window_ms", "hop_divisor", "fft_mult", "synthesis_ms", "precision", nullptr
+    };
+    double sample_rate, window_ms, synthesis_ms = 0.0;
+    int hop_divisor = 4, fft_mult = 2;
+    const char* precision = "double";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "dd|iids", const_cast<char**>(keywords),
+                                     &sample_rate, &window_ms, &hop_divisor, &fft_mult,
+                                     &synthesis_ms, &precision)) return -1;
+    bool single;
+    if (!check_settings(sample_rate, window_ms, hop_divisor, fft_mult) ||
+        !check_precision(precision, single)) return -1;
+
+    return construct(reinterpret_cast<EngineObject*>(object), [&]() -> RealtimeEngine* {
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+        if (single) {
+            return new RealtimeAudioTransportFloat(sample_rate, window_ms, hop_divisor, fft_mult,
+                                                   synthesis_ms);
+        }
+#endif
+        return new RealtimeAudioTransport(sample_rate, window_ms, hop_divisor, fft_mult, synthesis_ms);
+    });
+}
+
+static int reassignment_init(PyObject* object, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {
+        "sample_rate", "window_ms", "hop_divisor", "fft_padding", "synthesis_ms", "fft_sizing",
+        "precision", nullptr
+    };
+    double sample_rate, window_ms, synthesis_ms = 0.0;
+    int hop_divisor = 4, fft_padding = 2;
+    const char* sizing_name = "exact";
+    const char* precision = "double";
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "dd|iidss", const_cast<char**>(keywords),
+                                     &sample_rate, &window_ms, &hop_divisor, &fft_padding,
+                                     &synthesis_ms, &sizing_name, &precision)) return -1;
+
+    fft_plans::sizing sizing;
+    if (std::strcmp(sizing_name, "exact") == 0) {
+        sizing = fft_plans::exact;
+    } else if (std::strcmp(sizing_name, "power_of_two") == 0) {
+        sizing = fft_plans::power_of_two;
+    } else if (std::strcmp(sizing_name, "smooth") == 0) {
+        sizing = fft_plans::smooth;
+    } else {
+        PyErr_SetString(PyExc_ValueError, "fft_sizing must be 'exact', 'power_of_two' or 'smooth'");
+        return -1;
+    }
+    bool single;
+    if (!check_settings(sample_rate, window_ms, hop_divisor, fft_padding + 1) ||
+        !check_precision(precision, single)) return -1;
+
+    return construct(reinterpret_cast<EngineObject*>(object), [&]() -> RealtimeEngine* {
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+        if (single) {
+            return new RealtimeReassignmentTransportFloat(sample_rate, window_ms, hop_divisor,
+                                                          fft_padding, synthesis_ms, sizing);
+        }
+#endif
+        return new RealtimeReassignmentTransport(sample_rate, window_ms, hop_divisor, fft_padding,
+                                                 synthesis_ms, sizing);
+    });
+}
+
+static RealtimeEngine* get_engine(PyObject* object) {
+    RealtimeEngine* engine = reinterpret_cast<EngineObject*>(object)->engine;
+    if (!engine) PyErr_SetString(PyExc_RuntimeError, "engine is not initialised");
+    return engine;
+}
+
+static PyObject* engine_process(PyObject* object, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = { "main", "sidechain", "k", "out", nullptr };
+    PyObject *main_object, *sidechain_object, *k_object = nullptr, *out_object = Py_None;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OO|OO", const_cast<char**>(keywords),
+                                     &main_object, &sidechain_object, &k_object, &out_object)) return nullptr;
+    RealtimeEngine* engine = get_engine(object);
+    if (!engine) return nullptr;
+
+    buffer main, sidechain, k_curve, out;
+    if (!get_buffer(main_object, "main", "f", 2, false, main) ||
+        !get_buffer(sidechain_object, "sidechain", "f", 2, false, sidechain)) return nullptr;
+    if (sidechain.view.ndim != main.view.ndim || sidechain.channels() != main.channels() ||
+        sidechain.samples() != main.samples()) {
+        PyErr_SetString(PyExc_ValueError, "main and sidechain must have the same shape");
+        return nullptr;
+    }
+    const int channels = static_cast<int>(main.channels());
+    const int samples = static_cast<int>(main.samples());
+    if (channels < 1) {
+        PyErr_SetString(PyExc_ValueError, "main must have at least one channel");
+        return nullptr;
+    }
+
+    // A factor per sample, or one for the buffer
+    float k = 0.5f;
+    if (k_object && PyObject_CheckBuffer(k_object)) {
+        if (!get_buffer(k_object, "k", "f", 1, false, k_curve)) return nullptr;
+        if (k_curve.samples() != samples) {
+            PyErr_SetString(PyExc_ValueError, "k must have one factor per sample");
+            return nullptr;
+        }
+    } else if (k_object) {
+        k = static_cast<float>(PyFloat_AsDouble(k_object));
+        if (PyErr_Occurred()) return nullptr;
+    }
+
+    // Written in place, which may be over either input
+    PyObject* result;
+    if (out_object == Py_None) {
+        result = new_buffer('f', channels, samples, main.view.ndim);
+        if (!result) return nullptr;
+    } else {
+        Py_INCREF(out_object);
+        result = out_object;
+    }
+    if (!get_buffer(result, "out", "f", 2, true, out)) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    if (out.view.ndim != main.view.ndim || out.channels() != channels || out.samples() != samples) {
+        PyErr_SetString(PyExc_ValueError, "out must have the shape of main");
+        Py_DECREF(result);
+        return nullptr;
+    }
+
+    std::vector<const float*> mains(channels), sidechains(channels);
+    std::vector<float*> outputs(channels);
+    for (int c = 0; c < channels; c++) {
+        mains[c] = static_cast<const float*>(main.view.buf) + static_cast<size_t>(c) * samples;
+        sidechains[c] = static_cast<const float*>(sidechain.view.buf) + static_cast<size_t>(c) * samples;
+        outputs[c] = static_cast<float*>(out.view.buf) + static_cast<size_t>(c) * samples;
+    }
+    const float* k_samples = k_curve.held ? static_cast<const float*>(k_curve.view.buf) : nullptr;
+    std::mutex* lock = reinterpret_cast<EngineObject*>(object)->lock;
+
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> guard(*lock);
+        try {
+            // The engines only reallocate when the width changes
+            if (engine->getNumChannels() != channels) engine->setNumChannels(channels);
+            if (k_samples) {
+                engine->process(mains.data(), sidechains.data(), outputs.data(), channels, samples, k_samples);
+            } else {
+                engine->process(mains.data(), sidechains.data(), outputs.data(), channels, samples, k);
+            }
+        } catch (const std::bad_alloc&) {
+            failed = true;
+        }
+    }
+    Py_END_ALLOW_THREADS
+
+    if (failed) {
+        Py_DECREF(result);
+        return PyErr_NoMemory();
+    }
+    return result;
+}
+
+static PyObject* engine_reset(PyObject* object, PyObject*) {
+    RealtimeEngine* engine = get_engine(object);
+    if (!engine) return nullptr;
+    std::mutex* lock = reinterpret_cast<EngineObject*>(object)->lock;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> guard(*lock);
+        engine->reset();
+    }
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+// Settings are read and written under the engine's lock, as a call on
+// another thread may be running
+template <typename Function>
+static auto locked(PyObject* object, Function function) -> decltype(function(std::declval<RealtimeEngine&>())) {
+    EngineObject* self = reinterpret_cast<EngineObject*>(object);
+    std::lock_guard<std::mutex> guard(*self->lock);
+    return function(*self->engine);
+}
+
+static PyObject* get_latency(PyObject* object, void*) {
+    if (!get_engine(object)) return nullptr;
+    return PyLong_FromLong(locked(object, [](RealtimeEngine& e) { return e.getLatencySamples(); }));
+}
+
+static PyObject* get_hop_size(PyObject* object, void*) {
+    if (!get_engine(object)) return nullptr;
+    return PyLong_FromLong(locked(object, [](RealtimeEngine& e) { return e.getHopSize(); }));
+}
+
+static PyObject* get_num_channels(PyObject* object, void*) {
+    if (!get_engine(object)) return nullptr;
+    return PyLong_FromLong(locked(object, [](RealtimeEngine& e) { return e.getNumChannels(); }));
+}
+
+static int set_num_channels(PyObject* object, PyObject* value, void*) {
+    if (!get_engine(object)) return -1;
+    long channels = value ? PyLong_AsLong(value) : -1;
+    if (PyErr_Occurred()) return -1;
+    if (channels < 1 || channels > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "num_channels must be at least 1");
+        return -1;
+    }
+    locked(object, [&](RealtimeEngine& e) { e.setNumChannels(static_cast<int>(channels)); });
+    return 0;
+}
+
+static PyObject* get_linked(PyObject* object, void*) {
+    if (!get_engine(object)) return nullptr;
+    return PyBool_FromLong(locked(object, [](RealtimeEngine& e) {
+        return e.getChannelMode() == RealtimeEngine::ChannelMode::Linked;
+    }));
+}
+
+static int set_linked(PyObject* object, PyObject* value, void*) {
+    if (!get_engine(object)) return -1;
+    int linked = value ? PyObject_IsTrue(value) : -1;
+    if (linked < 0) return -1;
+    locked(object, [&](RealtimeEngine& e) {
+        e.setChannelMode(linked ? RealtimeEngine::ChannelMode::Linked : RealtimeEngine::ChannelMode::Independent);
+    });
+    return 0;
+}
+
+static PyObject* get_silence_threshold(PyObject* object, void*) {
+    if (!get_engine(object)) return nullptr;
+    return PyFloat_FromDouble(locked(object, [](RealtimeEngine& e) { return e.getSilenceThreshold(); }));
+}
+
+static int set_silence_threshold(PyObject* object, PyObject* value, void*) {
+    if (!get_engine(object)) return -1;
+    double threshold = value ? PyFloat_AsDouble(value) : -1;
+    if (!value || PyErr_Occurred()) return -1;
+    locked(object, [&](RealtimeEngine& e) { e.setSilenceThreshold(static_cast<float>(threshold)); });
+    return 0;
+}
+
+static PyObject* get_sidechain_frozen(PyObject* object, void*) {
+    if (!get_engine(object)) return nullptr;
+    return PyBool_FromLong(locked(object, [](RealtimeEngine& e) { return e.isSidechainFrozen(); }));
+}
+
+static int set_sidechain_frozen(PyObject* object, PyObject* value, void*) {
+    if (!get_engine(object)) return -1;
+    int frozen = value ? PyObject_IsTrue(value) : -1;
+    if (frozen < 0) return -1;
+    locked(object, [&](RealtimeEngine& e) { e.setSidechainFrozen(frozen != 0); });
+    return 0;
+}
+
+static PyMethodDef engine_methods[] = {
+    { "process", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(engine_process)),
+      METH_VARARGS | METH_KEYWORDS,
+      "process(main, sidechain, k=0.5, out=None) -> out\n\n"
+      "Morph main toward sidechain, float32 of shape (samples,) or (channels, samples).\n"
+      "k is a number or one float32 factor per sample. out, allocated if None, may be\n"
+      "either input. The engine's state carries over from call to call." },
+    { "reset", engine_reset, METH_NOARGS, "Clear the engine's buffers and phases" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyGetSetDef engine_getset[] = {
+    { const_cast<char*>("latency"), get_latency, nullptr,
+      const_cast<char*>("Samples from an input sample to the output it is heard in"), nullptr },
+    { const_cast<char*>("hop_size"), get_hop_size, nullptr,
+      const_cast<char*>("Samples between analysis frames"), nullptr },
+    { const_cast<char*>("num_channels"), get_num_channels, set_num_channels,
+      const_cast<char*>("Channels process() handles; set from the buffers it is given"), nullptr },
+    { const_cast<char*>("linked"), get_linked, set_linked,
+      const_cast<char*>("Share one transport plan across channels"), nullptr },
+    { const_cast<char*>("silence_threshold"), get_silence_threshold, set_silence_threshold,
+      const_cast<char*>("Windows within +-threshold are treated as silent"), nullptr },
+    { const_cast<char*>("sidechain_frozen"), get_sidechain_frozen, set_sidechain_frozen,
+      const_cast<char*>("Hold the last sidechain spectrum"), nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static PyType_Slot cdf_slots[] = {
+    { Py_tp_new, reinterpret_cast<void*>(engine_new) },
+    { Py_tp_init, reinterpret_cast<void*>(cdf_init) },
+    { Py_tp_dealloc, reinterpret_cast<void*>(engine_dealloc) },
+    { Py_tp_methods, engine_methods },
+    { Py_tp_getset, engine_getset },
+    { Py_tp_doc, const_cast<char*>(
+        "RealtimeAudioTransport(sample_rate, window_ms, hop_divisor=4, fft_mult=2,\n"
+        "                       synthesis_ms=0.0, precision='double')\n\n"
+        "The CDF engine (RealtimeAudioTransport in C++)") },
+    { 0, nullptr }
+};
+
+static PyType_Slot reassignment_slots[] = {
+    { Py_tp_new, reinterpret_cast<void*>(engine_new) },
+    { Py_tp_init, reinterpret_cast<void*>(reassignment_init) },
+    { Py_tp_dealloc, reinterpret_cast<void*>(engine_dealloc) },
+    { Py_tp_methods, engine_methods },
+    { Py_tp_getset, engine_getset },
+    { Py_tp_doc, const_cast<char*>(
+        "RealtimeReassignmentTransport(sample_rate, window_ms, hop_divisor=4, fft_padding=2,\n"
+        "                              synthesis_ms=0.0, fft_sizing='exact', precision='double')\n\n"
+        "The reassignment engine (RealtimeReassignmentTransport in C++). fft_sizing is\n"
+        "'exact', 'power_of_two' or 'smooth' (see fft_plans::sizing)") },
+    { 0, nullptr }
+};
+
+static PyType_Spec cdf_spec = {
+    "_audio_transport.RealtimeAudioTransport", sizeof(EngineObject), 0,
+    Py_TPFLAGS_DEFAULT, cdf_slots
+};
+
+static PyType_Spec reassignment_spec = {
+    "_audio_transport.RealtimeReassignmentTransport", sizeof(EngineObject), 0,
+    Py_TPFLAGS_DEFAULT, reassignment_slots
+};
+
+//==============================================================================
+// Offline frames
+
+struct FramesObject {
+    PyObject_HEAD
+    std::vector<spectral::frame>* frames;
+};
+
+static PyObject* frames_type = nullptr;
+
+static PyObject* wrap_frames(std::vector<spectral::frame>* frames) {
+    PyTypeObject* type = reinterpret_cast<PyTypeObject*>(frames_type);
+    FramesObject* self = reinterpret_cast<FramesObject*>(type->tp_alloc(type, 0));
+    if (!self) {
+        delete frames;
+        return nullptr;
+    }
+    self->frames = frames;
+    return reinterpret_cast<PyObject*>(self);
+}
+
+static void frames_dealloc(PyObject* object) {
+    FramesObject* self = reinterpret_cast<FramesObject*>(object);
+    delete self->frames;
+    PyTypeObject* type = Py_TYPE(object);
+    type->tp_free(object);
+    Py_DECREF(type);
+}
+
+static Py_ssize_t frames_length(PyObject* object) {
+    return static_cast<Py_ssize_t>(reinterpret_cast<FramesObject*>(object)->frames->size());
+}
+
+static PyObject* frames_num_bins(PyObject* object, void*) {
+    const std::vector<spectral::frame>& frames = *reinterpret_cast<FramesObject*>(object)->frames;
+    return PyLong_FromSize_t(frames.empty() ? 0 : frames.front().size());
+}
+
+static bool get_frames(PyObject* object, const char* name, const std::vector<spectral::frame>*& out) {
+    if (!PyObject_TypeCheck(object, reinterpret_cast<PyTypeObject*>(frames_type))) {
+        PyErr_Format(PyExc_TypeError, "%s must be Frames from analysis() or interpolate()", name);
+        return false;
+    }
+    out = reinterpret_cast<FramesObject*>(object)->frames;
+    return true;
+}
+
+static PyGetSetDef frames_getset[] = {
+    { const_cast<char*>("num_bins"), frames_num_bins, nullptr,
+      const_cast<char*>("Bins per window"), nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+static PyType_Slot frames_slots[] = {
+    { Py_tp_dealloc, reinterpret_cast<void*>(frames_dealloc) },
+    { Py_tp_getset, frames_getset },
+    { Py_sq_length, reinterpret_cast<void*>(frames_length) },
+    { Py_tp_doc, const_cast<char*>(
+        "Spectral frames from analysis() or interpolate(), one per window (immutable)") },
+    { 0, nullptr }
+};
+
+static PyType_Spec frames_spec = {
+    "_audio_transport.Frames", sizeof(FramesObject), 0,
+    Py_TPFLAGS_DEFAULT, frames_slots
+};
+
+// Runs work without the GIL, turning a failed allocation into MemoryError
+template <typename Work>
+static bool without_gil(Work work) {
+    bool failed = false;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        work();
+    } catch (const std::bad_alloc&) {
+        failed = true;
+    }
+    Py_END_ALLOW_THREADS
+    if (failed) PyErr_NoMemory();
+    return !failed;
+}
+
+static PyObject* from_doubles(const std::vector<double>& values) {
+    PyObject* result = new_buffer('d', 1, static_cast<Py_ssize_t>(values.size()), 1);
+    if (!result) return nullptr;
+    buffer out;
+    if (!get_buffer(result, "result", "d", 1, true, out)) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    std::memcpy(out.view.buf, values.data(), values.size() * sizeof(double));
+    return result;
+}
+
+static PyObject* analysis(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {
+        "audio", "sample_rate", "window_size", "padding", "overlap", nullptr
+    };
+    PyObject* audio_object;
+    double sample_rate, window_size = 0.05;
+    unsigned int padding = 0, overlap = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Od|dII", const_cast<char**>(keywords),
+                                     &audio_object, &sample_rate, &window_size, &padding,
+                                     &overlap)) return nullptr;
+    if (!(sample_rate > 0) || !(window_size > 0) || overlap < 1) {
+        PyErr_SetString(PyExc_ValueError, "sample_rate and window_size must be positive, overlap at least 1");
+        return nullptr;
+    }
+    buffer audio;
+    if (!get_buffer(audio_object, "audio", "df", 1, false, audio)) return nullptr;
+    std::vector<double> samples = to_doubles(audio);
+
+    std::unique_ptr<std::vector<spectral::frame>> frames(new std::vector<spectral::frame>());
+    if (!without_gil([&] {
+        *frames = spectral::analysis_frames(samples, sample_rate, window_size, padding, overlap);
+    })) return nullptr;
+    return wrap_frames(frames.release());
+}
+
+static PyObject* interpolate(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = { "left", "right", "k", "window_size", nullptr };
+    PyObject *left_object, *right_object, *k_object;
+    double window_size;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOOd", const_cast<char**>(keywords),
+                                     &left_object, &right_object, &k_object, &window_size)) return nullptr;
+    const std::vector<spectral::frame> *left, *right;
+    factors k;
+    if (!get_frames(left_object, "left", left) || !get_frames(right_object, "right", right) ||
+        !get_factors(k_object, k)) return nullptr;
+    if (!left->empty() && !right->empty() && left->front().size() != right->front().size()) {
+        PyErr_SetString(PyExc_ValueError, "left and right must have the same number of bins");
+        return nullptr;
+    }
+
+    // One phases vector carried across the windows, as the examples do
+    std::unique_ptr<std::vector<spectral::frame>> output(new std::vector<spectral::frame>());
+    if (!without_gil([&] {
+        size_t num_windows = std::min(left->size(), right->size());
+        size_t num_bins = num_windows ? left->front().size() : 0;
+        std::vector<double> phases(num_bins, 0);
+        interpolate_workspace workspace(num_bins);
+        output->resize(num_windows);
+        for (size_t w = 0; w < num_windows; w++) {
+            audio_transport::interpolate((*left)[w], (*right)[w], phases, window_size,
+                                         k.at(w, num_windows), (*output)[w], workspace);
+        }
+    })) return nullptr;
+    return wrap_frames(output.release());
+}
+
+static PyObject* synthesis(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = { "frames", "padding", "overlap", nullptr };
+    PyObject* frames_object;
+    unsigned int padding = 0, overlap = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|II", const_cast<char**>(keywords),
+                                     &frames_object, &padding, &overlap)) return nullptr;
+    const std::vector<spectral::frame>* frames;
+    if (!get_frames(frames_object, "frames", frames)) return nullptr;
+    if (overlap < 1) {
+        PyErr_SetString(PyExc_ValueError, "overlap must be at least 1");
+        return nullptr;
+    }
+
+    std::vector<double> audio;
+    if (!without_gil([&] { audio = spectral::synthesis(*frames, padding, overlap); })) return nullptr;
+    return from_doubles(audio);
+}
+
+static PyObject* transport(PyObject*, PyObject* args, PyObject* kwargs) {
+    static const char* keywords[] = {
+        "left", "right", "sample_rate", "k", "window_size", "padding", "overlap",
+        "equal_loudness", "threads", nullptr
+    };
+    PyObject *left_object, *right_object, *k_object = nullptr;
+    double sample_rate;
+    transport_settings settings;
+    int weighted = 1;
+    unsigned int threads = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "OOd|OdIIpI", const_cast<char**>(keywords),
+                                     &left_object, &right_object, &sample_rate, &k_object,
+                                     &settings.window_size, &settings.padding, &settings.overlap,
+                                     &weighted, &threads)) return nullptr;
+    if (!(sample_rate > 0) || !(settings.window_size > 0) || settings.overlap < 1) {
+        PyErr_SetString(PyExc_ValueError, "sample_rate and window_size must be positive, overlap at least 1");
+        return nullptr;
+    }
+    settings.equal_loudness = weighted != 0;
+
+    buffer left_audio, right_audio;
+    factors k;
+    if (!get_buffer(left_object, "left", "df", 1, false, left_audio) ||
+        !get_buffer(right_object, "right", "df", 1, false, right_audio) ||
+        (k_object && !get_factors(k_object, k))) return nullptr;
+    std::vector<double> left = to_doubles(left_audio);
+    std::vector<double> right = to_doubles(right_audio);
+    settings.interpolation = [&k](size_t w, size_t num_windows) { return k.at(w, num_windows); };
+
+    std::vector<double> audio;
+    if (!without_gil([&] {
+        offline_renderer renderer(threads);
+        audio = renderer.transport(left, sample_rate, right, sample_rate, settings);
+    })) return nullptr;
+    return from_doubles(audio);
+}
+
+static PyMethodDef module_methods[] = {
+    { "analysis", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(analysis)),
+      METH_VARARGS | METH_KEYWORDS,
+      "analysis(audio, sample_rate, window_size=0.05, padding=0, overlap=1) -> Frames\n\n"
+      "spectral::analysis_frames of a 1-D float64 or float32 signal (window_size in seconds)" },
+    { "interpolate", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(interpolate)),
+      METH_VARARGS | METH_KEYWORDS,
+      "interpolate(left, right, k, window_size) -> Frames\n\n"
+      "Transport each window of left toward right, carrying phases from window to window.\n"
+      "k is a number or a curve of factors stretched over the windows" },
+    { "synthesis", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(synthesis)),
+      METH_VARARGS | METH_KEYWORDS,
+      "synthesis(frames, padding=0, overlap=1) -> float64 buffer" },
+    { "transport", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(transport)),
+      METH_VARARGS | METH_KEYWORDS,
+      "transport(left, right, sample_rate, k=0.5, window_size=0.05, padding=0, overlap=1,\n"
+      "          equal_loudness=True, threads=1) -> float64 buffer\n\n"
+      "analysis, interpolate and synthesis in one call on an offline_renderer of threads\n"
+      "threads (0 = one per core)" },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+static PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT,
+    "_audio_transport",
+    "Native audio transport engines and offline transport",
+    -1,
+    module_methods,
+    nullptr, nullptr, nullptr, nullptr
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit__audio_transport() {
+    PyObject* module = PyModule_Create(&module_def);
+    if (!module) return nullptr;
+
+    PyObject* cdf = PyType_FromSpec(&cdf_spec);
+    PyObject* reassignment = PyType_FromSpec(&reassignment_spec);
+    frames_type = PyType_FromSpec(&frames_spec);
+    if (!cdf || !reassignment || !frames_type ||
+        PyModule_AddObject(module, "RealtimeAudioTransport", cdf) != 0 ||
+        PyModule_AddObject(module, "RealtimeReassignmentTransport", reassignment) != 0) {
+        Py_XDECREF(cdf);
+        Py_XDECREF(reassignment);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    Py_INCREF(frames_type);
+    if (PyModule_AddObject(module, "Frames", frames_type) != 0) {
+        Py_DECREF(frames_type);
+        Py_DECREF(module);
+        return nullptr;
+    }
+
+#ifdef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    PyModule_AddIntConstant(module, "FLOAT_ENGINES", 0);
+#else
+    PyModule_AddIntConstant(module, "FLOAT_ENGINES", 1);
+#endif
+    return module;
+}
@@ -0,0 +1,327 @@
+#include "audio_transport/PipelinedEngine.hpp"
+#include "audio_transport/realtime_check.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace audio_transport {
+
+// Realtime scheduling where the system grants it; a refusal (no
+// privileges, say) leaves the thread as it was
+static void raisePriority(std::thread& thread) {
+#if defined(_WIN32)
+    SetThreadPriority(thread.native_handle(), THREAD_PRIORITY_TIME_CRITICAL);
+#elif defined(__unix__) || defined(__APPLE__)
+    sched_param param;
+    param.sched_priority = (sched_get_priority_min(SCHED_FIFO) + sched_get_priority_max(SCHED_FIFO)) / 2;
+    pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+#else
+    (void) thread;
+#endif
+}
+
+PipelinedEngine::PipelinedEngine(std::unique_ptr<RealtimeEngine> engine, int max_block_size)
+    : engine_(std::move(engine)),
+      num_channels_(engine_->getNumChannels()),
+      hop_size_(engine_->getHopSize()),
+      max_block_size_(std::max(max_block_size, 1)),
+      channel_mode_(engine_->getChannelMode()),
+      silence_threshold_(engine_->getSilenceThreshold()),
+      sidechain_frozen_(engine_->isSidechainFrozen()),
+      wait_for_worker_(false),
+      tail_(0),
+      done_(0),
+      read_(0),
+      position_(0),
+      filling_(false),
+      reading_(false),
+      dropped_(false),
+      late_hops_(0),
+      dropped_hops_(0),
+      running_(false)
+{
+    // A hop completes at the end of a callback at the latest and is
+    // first due one block before its output starts, a hop later
+    pipeline_latency_ = 2 * hop_size_ + max_block_size_ - 1;
+
+    // A quarter of the hop's budget at most goes to finding it
+    double hop_us = hop_size_ / engine_->getTargetAnalysis().sample_rate * 1e6;
+    poll_interval_ = std::chrono::microseconds(
+        std::max<long long>(50, std::min<long long>(1000, static_cast<long long>(hop_us / 4))));
+
+    allocateJobs();
+    clearJobs();
+    startWorker();
+}
+
+PipelinedEngine::~PipelinedEngine() {
+    stopWorker();
+}
+
+void PipelinedEngine::allocateJobs() {
+    // Every hop from the one due for output to the one being filled
+    // holds a job, plus one spare
+    size_t count = (pipeline_latency_ + hop_size_ - 1) / hop_size_ + 3;
+    jobs_.assign(count, job());
+    for (job& j : jobs_) {
+        for (auto* buffers : { &j.main, &j.sidechain, &j.output }) {
+            buffers->assign(num_channels_, std::vector<float>(hop_size_, 0.0f));
+        }
+        j.k.assign(hop_size_, 0.0f);
+        j.main_pointers.resize(num_channels_);
+        j.sidechain_pointers.resize(num_channels_);
+        j.output_pointers.resize(num_channels_);
+        for (int c = 0; c < num_channels_; c++) {
+            j.main_pointers[c] = j.main[c].data();
+            j.sidechain_pointers[c] = j.sidechain[c].data();
+            j.output_pointers[c] = j.output[c].data();
+        }
+    }
+}
+
+void PipelinedEngine::clearJobs() {
+    tail_.store(0);
+    done_.store(0);
+    read_ = 0;
+    position_ = 0;
+    filling_ = false;
+    reading_ = false;
+    dropped_ = false;
+    late_hops_.store(0);
+    dropped_hops_.store(0);
+}
+
+void PipelinedEngine::startWorker() {
+    running_.store(true);
+    worker_ = std::thread(&PipelinedEngine::workerLoop, this);
+    raisePriority(worker_);
+}
+
+void PipelinedEngine::stopWorker() {
+    if (!worker_.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_.store(false);
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+void PipelinedEngine::workerLoop() {
+    diagnostics::scope reports(diagnostics_);
+    const std::uint64_t count = jobs_.size();
+
+    while (running_.load(std::memory_order_acquire)) {
+        std::uint64_t done = done_.load(std::memory_order_relaxed);
+        if (done == tail_.load(std::memory_order_acquire)) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait_for(lock, poll_interval_, [&] {
+                return !running_.load(std::memory_order_acquire)
+                    || done != tail_.load(std::memory_order_acquire);
+            });
+            continue;
+        }
+
+        job& j = jobs_[done % count];
+        if (j.restart) engine_->reset();
+        engine_->setChannelMode(j.mode);
+        engine_->setSilenceThreshold(j.silence_threshold);
+        engine_->setSidechainFrozen(j.sidechain_frozen);
+        engine_->process(j.main_pointers.data(), j.sidechain_pointers.data(),
+                         j.output_pointers.data(), num_channels_, hop_size_, j.k.data());
+        done_.store(done + 1, std::memory_order_release);
+    }
+}
+
+void PipelinedEngine::setNumChannels(int num_channels) {
+    stopWorker();
+    engine_->setNumChannels(num_channels);
+    num_channels_ = num_channels;
+    allocateJobs();
+    clearJobs();
+    startWorker();
+}
+
+void PipelinedEngine::setInstrumentation(instrumentation::recorder* recorder) {
+    stopWorker();
+    engine_->setInstrumentation(recorder);
+    startWorker();
+}
+
+std::shared_ptr<const target_spectrum> PipelinedEngine::makeTarget(
+    const float* audio, size_t num_samples, target_spectrum::mode playback) {
+    stopWorker();
+    std::shared_ptr<const target_spectrum> target = engine_->makeTarget(audio, num_samples, playback);
+    startWorker();
+    return target;
+}
+
+bool PipelinedEngine::setTarget(std::shared_ptr<const target_spectrum> target) {
+    stopWorker();
+    bool accepted = engine_->setTarget(std::move(target));
+    startWorker();
+    return accepted;
+}
+
+void PipelinedEngine::reset() {
+    stopWorker();
+    engine_->reset();
+    clearJobs();
+    startWorker();
+}
+
+int PipelinedEngine::getLatencySamples() const {
+    return engine_->getLatencySamples() + pipeline_latency_;
+}
+
+void PipelinedEngine::process(
+    const float* input_main,
+    const float* input_sidechain,
+    float* output,
+    int buffer_size,
+    float k
+) {
+    processChannels(&input_main, &input_sidechain, &output, 1, buffer_size, k, nullptr);
+}
+
+void PipelinedEngine::process(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    float k
+) {
+    processChannels(input_main, input_sidechain, output, num_channels, buffer_size, k, nullptr);
+}
+
+void PipelinedEngine::process(
+    const float* input_main,
+    const float* input_sidechain,
+    float* output,
+    int buffer_size,
+    const float* k
+) {
+    processChannels(&input_main, &input_sidechain, &output, 1, buffer_size, 0.0f, k);
+}
+
+void PipelinedEngine::process(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    const float* k
+) {
+    processChannels(input_main, input_sidechain, output, num_channels, buffer_size, 0.0f, k);
+}
+
+void PipelinedEngine::processChannels(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    float k_value,
+    const float* k_samples
+) {
+    realtime_check::scope realtime;
+    assert(num_channels == num_channels_);
+
+    const std::uint64_t count = jobs_.size();
+    const std::uint64_t hop = hop_size_;
+    const std::uint64_t latency = pipeline_latency_;
+    int samples_processed = 0;
+
+    while (samples_processed < buffer_size) {
+        // A span ends where an input hop, an output hop or the buffer
+        // does, and output starts latency samples behind input
+        const std::uint64_t in_offset = position_ % hop;
+        std::uint64_t span = std::min<std::uint64_t>(hop - in_offset, buffer_size - samples_processed);
+        const bool sounding = position_ >= latency;
+        const std::uint64_t out_position = sounding ? position_ - latency : 0;
+        const std::uint64_t out_offset = out_position % hop;
+        span = std::min(span, sounding ? hop - out_offset : latency - position_);
+        const int n = static_cast<int>(span);
+
+        // Take the input into the job of its hop. Every channel's span
+        // is copied before output is written over it (in-place
+        // processing), and the job due for output is an earlier one.
+        std::uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (in_offset == 0) {
+            filling_ = tail - read_ < count;
+            if (filling_) {
+                jobs_[tail % count].hop = position_ / hop;
+                jobs_[tail % count].restart = dropped_;
+                dropped_ = false;
+            } else {
+                dropped_ = true;
+                dropped_hops_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        if (filling_) {
+            job& j = jobs_[tail % count];
+            for (int c = 0; c < num_channels; c++) {
+                std::memcpy(j.main[c].data() + in_offset, input_main[c] + samples_processed,
+                            n * sizeof(float));
+                std::memcpy(j.sidechain[c].data() + in_offset, input_sidechain[c] + samples_processed,
+                            n * sizeof(float));
+            }
+            if (k_samples) {
+                std::memcpy(j.k.data() + in_offset, k_samples + samples_processed, n * sizeof(float));
+            } else {
+                std::fill(j.k.begin() + in_offset, j.k.begin() + in_offset + n, k_value);
+            }
+
+            if (in_offset + span == hop) {
+                j.mode = channel_mode_;
+                j.silence_threshold = silence_threshold_;
+                j.sidechain_frozen = sidechain_frozen_;
+                tail_.store(tail + 1, std::memory_order_release);
+            }
+        }
+
+        // Hand out the output of the hop under out_position if the
+        // worker finished it in time, skipping jobs too late to use
+        if (sounding && out_offset == 0) {
+            const std::uint64_t out_hop = out_position / hop;
+            // Offline only (see setWaitForWorker)
+            std::uint64_t done = done_.load(std::memory_order_acquire);
+            while (wait_for_worker_ && done != tail_.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+                done = done_.load(std::memory_order_acquire);
+            }
+            while (read_ < done && jobs_[read_ % count].hop < out_hop) read_++;
+            reading_ = read_ < done && jobs_[read_ % count].hop == out_hop;
+            if (!reading_) late_hops_.fetch_add(1, std::memory_order_relaxed);
+        }
+        for (int c = 0; c < num_channels; c++) {
+            float* out = output[c] + samples_processed;
+            if (sounding && reading_) {
+                std::memcpy(out, jobs_[read_ % count].output[c].data() + out_offset, n * sizeof(float));
+            } else {
+                std::fill(out, out + n, 0.0f);
+            }
+        }
+        if (sounding && reading_ && out_offset + span == hop) {
+            read_++;
+            reading_ = false;
+        }
+
+        position_ += span;
+        samples_processed += n;
+    }
+}
+
+} // namespace audio_transport
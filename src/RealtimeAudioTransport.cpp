@@ -1,4 +1,11 @@
 #include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/denormals.hpp"
+#include "audio_transport/diagnostics.hpp"
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/realtime_check.hpp"
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/vector_math.hpp"
+#include <cassert>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -6,159 +13,333 @@
 
 namespace audio_transport {
 
-RealtimeAudioTransport::RealtimeAudioTransport(
+template <typename Real>
+BasicRealtimeAudioTransport<Real>::BasicRealtimeAudioTransport(
     double sample_rate,
     double window_ms,
     int hop_divisor,
-    int fft_mult)
+    int fft_mult,
+    double synthesis_ms)
     : sample_rate_(sample_rate)
+    , window_ms_(window_ms)
+    , synthesis_ms_(synthesis_ms)
+    , hop_divisor_(hop_divisor)
+    , fft_mult_(fft_mult)
+    , map_mode_(TransportMapMode::Nearest)
+    , num_channels_(1)
+    , channel_mode_(ChannelMode::Independent)
+    , silence_threshold_(0.0f)
+    , sidechain_frozen_(false)
+    , instrumentation_(nullptr)
     , buffer_write_pos_(0)
-    , buffer_read_pos_(0)
     , samples_in_buffer_(0)
     , ola_write_pos_(0)
+    , target_hop_(0)
+    , installed_target_(nullptr)
 {
-    // Calculate sizes
-    window_size_ = static_cast<int>(window_ms * sample_rate / 1000.0);
-    hop_size_ = window_size_ / hop_divisor;
-
-    // FFT size: next power of 2, multiplied by fft_mult
-    int next_pow2 = static_cast<int>(std::pow(2, std::ceil(std::log2(window_size_))));
-    fft_size_ = next_pow2 * fft_mult;
-    num_bins_ = fft_size_ / 2 + 1;
+    computeSizes();
 
     std::cout << "[RealtimeAudioTransport] Initialized:" << std::endl;
     std::cout << "  Sample rate: " << sample_rate_ << " Hz" << std::endl;
     std::cout << "  Window size: " << window_size_ << " samples (" << window_ms << " ms)" << std::endl;
+    if (synthesis_size_ < window_size_) {
+        std::cout << "  Synthesis size: " << synthesis_size_ << " samples (low latency)" << std::endl;
+    }
     std::cout << "  Hop size: " << hop_size_ << " samples" << std::endl;
     std::cout << "  FFT size: " << fft_size_ << " samples" << std::endl;
     std::cout << "  Frequency bins: " << num_bins_ << std::endl;
     std::cout << "  Latency: " << getLatencySamples() << " samples" << std::endl;
 
-    // Initialize buffers
-    main_buffer_.resize(window_size_, 0.0);
-    sidechain_buffer_.resize(window_size_, 0.0);
-    output_buffer_.resize(window_size_, 0.0);
+    allocateBuffers();
+
+    // Initialize FFTW
+    initializeFFTW();
+}
+
+template <typename Real>
+BasicRealtimeAudioTransport<Real>::~BasicRealtimeAudioTransport() {
+    destroyFFTW();
+}
 
-    spectrum_main_.resize(num_bins_);
-    spectrum_sidechain_.resize(num_bins_);
-    spectrum_output_.resize(num_bins_);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::computeSizes() {
+    // Calculate sizes
+    window_size_ = static_cast<int>(window_ms_ * sample_rate_ / 1000.0);
+
+    // The asymmetric window needs an even synthesis length
+    synthesis_size_ = window_size_;
+    if (synthesis_ms_ > 0.0) {
+        int synthesis_size = static_cast<int>(std::round(synthesis_ms_ * sample_rate_ / 1000.0));
+        synthesis_size += synthesis_size % 2;
+        synthesis_size = std::max(synthesis_size, 2);
+        if (synthesis_size < window_size_) synthesis_size_ = synthesis_size;
+    }
+    hop_size_ = synthesis_size_ / hop_divisor_;
 
-    phases_.resize(num_bins_, 0.0);
+    // FFT size: next power of 2, multiplied by fft_mult
+    int next_pow2 = static_cast<int>(std::pow(2, std::ceil(std::log2(window_size_))));
+    fft_size_ = next_pow2 * fft_mult_;
+    num_bins_ = fft_size_ / 2 + 1;
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::allocateBuffers() {
+    // Mirrored input rings
+    main_buffers_.assign(num_channels_, std::vector<Real>(window_size_ * 2, 0.0));
+    sidechain_buffers_.assign(num_channels_, std::vector<Real>(window_size_ * 2, 0.0));
+    main_gates_.assign(num_channels_, silence_gate());
+    sidechain_gates_.assign(num_channels_, silence_gate());
+    k_history_.resize(synthesis_size_);
+
+    spectrum_main_.assign(num_bins_, std::complex<Real>());
+    spectrum_sidechain_.assign(num_bins_, std::complex<Real>());
+    spectrum_output_.assign(num_bins_, std::complex<Real>());
+
+    // A synthesis this short no longer hides phases taken unchanged
+    // from the main input, so low-latency mode tracks them
+    int tracked = synthesis_size_ < window_size_ ? num_channels_ : 0;
+    for (auto* phases : { &last_phase_X_, &last_phase_Y_, &advance_X_, &advance_Y_, &phases_ }) {
+        phases->assign(tracked, std::vector<Real>(num_bins_, 0.0));
+    }
+    moved_phase_.assign(tracked ? num_bins_ : 0, 0.0);
 
     // Overlap-add buffer needs to store at least window_size samples
-    ola_buffer_.resize(window_size_ * 2, 0.0);
+    ola_buffers_.assign(num_channels_, std::vector<Real>(window_size_ * 2, 0.0));
 
     // Create Hann window
     window_.resize(window_size_);
     for (int i = 0; i < window_size_; ++i) {
         window_[i] = 0.5 * (1.0 - std::cos(2.0 * M_PI * i / (window_size_ - 1)));
     }
+    synthesis_window_ = window_;
+
+    // In low-latency mode the pair multiplies to the square of a Hann
+    // window of synthesis_size_, as the symmetric pair multiplies to
+    // the square of one of window_size_, so the gain is the same
+    if (synthesis_size_ < window_size_) {
+        const int L = synthesis_size_;
+        for (int i = 0; i < window_size_; ++i) {
+            window_[i] = spectral::asymmetric(i, window_size_, L);
+        }
+        synthesis_window_.resize(L);
+        for (int j = 0; j < L; ++j) {
+            double hann = 0.5 * (1.0 - std::cos(2.0 * M_PI * j / (L - 1)));
+            double analysis = spectral::asymmetric(window_size_ - L + j, window_size_, L);
+            synthesis_window_[j] = hann * hann / analysis;
+        }
+    }
 
-    // Initialize FFTW
-    initializeFFTW();
-}
-
-RealtimeAudioTransport::~RealtimeAudioTransport() {
-    destroyFFTW();
+    // Per-hop working storage
+    output_frame_.assign(synthesis_size_, 0.0);
+
+    mag_X_.assign(num_channels_, std::vector<Real>(num_bins_, 0.0));
+    mag_Y_.assign(num_channels_, std::vector<Real>(num_bins_, 0.0));
+    phase_X_.assign(num_channels_, std::vector<Real>(num_bins_, 0.0));
+    phase_Y_.assign(num_channels_, std::vector<Real>(num_bins_, 0.0));
+    mag_X_sum_.assign(num_bins_, 0.0);
+    mag_Y_sum_.assign(num_bins_, 0.0);
+    mag_out_.assign(num_bins_, 0.0);
+    phase_out_.assign(num_bins_, 0.0);
+
+    transport_map_.assign(num_bins_, 0);
+    transport_positions_.assign(num_bins_, 0.0);
+    interp_positions_.assign(num_bins_, 0.0);
+    weight_sum_.assign(num_bins_, 0.0);
+    phase_num_.assign(num_bins_, 0.0);
+    cdf_X_.assign(num_bins_, 0.0);
+    cdf_Y_.assign(num_bins_, 0.0);
+    installed_target_ = nullptr;
 }
 
-void RealtimeAudioTransport::initializeFFTW() {
-    // Allocate FFTW buffers
-    fft_input_ = fftw_alloc_real(fft_size_);
-    fft_output_ = fftw_alloc_complex(num_bins_);
-    ifft_input_ = fftw_alloc_complex(num_bins_);
-    ifft_output_ = fftw_alloc_real(fft_size_);
-
-    // Create FFTW plans
-    fft_plan_ = fftw_plan_dft_r2c_1d(fft_size_, fft_input_, fft_output_, FFTW_MEASURE);
-    ifft_plan_ = fftw_plan_dft_c2r_1d(fft_size_, ifft_input_, ifft_output_, FFTW_MEASURE);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::initializeFFTW() {
+    // Allocate FFTW buffers: the main and sidechain transforms lie one
+    // after the other, laid out for a batched plan. Only the windowed
+    // samples are written after this, so the zero padding stays.
+    real_distance_ = fft_plans::real_distance(fft_size_);
+    complex_distance_ = fft_plans::complex_distance(fft_size_);
+    fft_input_ = fft::alloc_real(2 * real_distance_);
+    std::memset(fft_input_, 0, 2 * real_distance_ * sizeof(Real));
+    fft_output_ = fft::alloc_complex(2 * complex_distance_);
+    ifft_input_ = fft::alloc_complex(num_bins_);
+    ifft_output_ = fft::alloc_real(fft_size_);
+
+    // Shared plans, measured once per size for the whole process: one
+    // input's transform, both inputs' as one batch, and the inverse
+    fft_plan_ = fft_plans::get<Real>(fft_size_, fft_plans::forward);
+    paired_fft_plan_ = fft_plans::get<Real>(fft_size_, fft_plans::forward, 2);
+    ifft_plan_ = fft_plans::get<Real>(fft_size_, fft_plans::inverse);
 }
 
-void RealtimeAudioTransport::destroyFFTW() {
-    if (fft_plan_) fftw_destroy_plan(fft_plan_);
-    if (ifft_plan_) fftw_destroy_plan(ifft_plan_);
-    if (fft_input_) fftw_free(fft_input_);
-    if (fft_output_) fftw_free(fft_output_);
-    if (ifft_input_) fftw_free(ifft_input_);
-    if (ifft_output_) fftw_free(ifft_output_);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::destroyFFTW() {
+    if (fft_input_) fft::free(fft_input_);
+    if (fft_output_) fft::free(fft_output_);
+    if (ifft_input_) fft::free(ifft_input_);
+    if (ifft_output_) fft::free(ifft_output_);
 }
 
-void RealtimeAudioTransport::reset() {
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::reset() {
     // Clear all buffers
-    std::fill(main_buffer_.begin(), main_buffer_.end(), 0.0);
-    std::fill(sidechain_buffer_.begin(), sidechain_buffer_.end(), 0.0);
-    std::fill(output_buffer_.begin(), output_buffer_.end(), 0.0);
-    std::fill(ola_buffer_.begin(), ola_buffer_.end(), 0.0);
-    std::fill(phases_.begin(), phases_.end(), 0.0);
+    k_history_.reset();
+    for (int c = 0; c < num_channels_; ++c) {
+        std::fill(main_buffers_[c].begin(), main_buffers_[c].end(), 0.0);
+        std::fill(sidechain_buffers_[c].begin(), sidechain_buffers_[c].end(), 0.0);
+        std::fill(ola_buffers_[c].begin(), ola_buffers_[c].end(), 0.0);
+        main_gates_[c].reset();
+        sidechain_gates_[c].reset();
+
+        // A sidechain frozen from here on holds silence
+        std::fill(mag_Y_[c].begin(), mag_Y_[c].end(), 0.0);
+        std::fill(phase_Y_[c].begin(), phase_Y_[c].end(), 0.0);
+    }
+    for (auto* phases : { &last_phase_X_, &last_phase_Y_, &advance_X_, &advance_Y_, &phases_ }) {
+        for (std::vector<Real>& channel : *phases) {
+            std::fill(channel.begin(), channel.end(), 0.0);
+        }
+    }
 
     buffer_write_pos_ = 0;
-    buffer_read_pos_ = 0;
     samples_in_buffer_ = 0;
     ola_write_pos_ = 0;
+    target_hop_ = 0;
+    installed_target_ = nullptr;
 }
 
-void RealtimeAudioTransport::setSampleRate(double sample_rate) {
-    if (sample_rate == sample_rate_) return;
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::setNumChannels(int num_channels) {
+    assert(num_channels >= 1);
+    if (num_channels == num_channels_) return;
 
-    sample_rate_ = sample_rate;
+    num_channels_ = num_channels;
+    allocateBuffers();
+    reset();
+}
 
-    // Recalculate window size to maintain same time duration
-    double window_ms = (window_size_ * 1000.0) / sample_rate_;
-    window_size_ = static_cast<int>(window_ms * sample_rate / 1000.0);
-    hop_size_ = window_size_ / 4; // Keep same overlap ratio
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::setSampleRate(double sample_rate) {
+    if (sample_rate == sample_rate_) return;
 
-    // Recalculate FFT size
-    int next_pow2 = static_cast<int>(std::pow(2, std::ceil(std::log2(window_size_))));
-    fft_size_ = next_pow2 * 2;
-    num_bins_ = fft_size_ / 2 + 1;
+    sample_rate_ = sample_rate;
 
-    // Resize buffers
-    main_buffer_.resize(window_size_, 0.0);
-    sidechain_buffer_.resize(window_size_, 0.0);
-    output_buffer_.resize(window_size_, 0.0);
-    spectrum_main_.resize(num_bins_);
-    spectrum_sidechain_.resize(num_bins_);
-    spectrum_output_.resize(num_bins_);
-    phases_.resize(num_bins_, 0.0);
-    ola_buffer_.resize(window_size_ * 2, 0.0);
-
-    // Recreate window
-    window_.resize(window_size_);
-    for (int i = 0; i < window_size_; ++i) {
-        window_[i] = 0.5 * (1.0 - std::cos(2.0 * M_PI * i / (window_size_ - 1)));
-    }
+    // Recalculate sizes to maintain the same window duration, overlap
+    // and zero-padding
+    computeSizes();
+    allocateBuffers();
 
     // Recreate FFTW plans
     destroyFFTW();
     initializeFFTW();
 
+    if (target_ && target_->settings() != getTargetAnalysis()) target_.reset();
     reset();
 }
 
-void RealtimeAudioTransport::computeSTFT(
-    const std::vector<double>& input_buffer,
-    std::vector<std::complex<double>>& spectrum)
+template <typename Real>
+target_spectrum::analysis BasicRealtimeAudioTransport<Real>::getTargetAnalysis() const {
+    target_spectrum::analysis settings;
+    settings.engine = target_spectrum::algorithm::cdf;
+    settings.sample_rate = sample_rate_;
+    settings.fft_size = fft_size_;
+    settings.window_size = window_size_;
+    settings.synthesis_size = synthesis_size_;
+    settings.hop_size = hop_size_;
+    return settings;
+}
+
+template <typename Real>
+std::shared_ptr<const target_spectrum> BasicRealtimeAudioTransport<Real>::makeTarget(
+    const float* audio,
+    size_t num_samples,
+    target_spectrum::mode playback)
 {
-    // Apply window and zero-padding
-    std::memset(fft_input_, 0, fft_size_ * sizeof(double));
+    if (num_samples < static_cast<size_t>(window_size_)) return nullptr;
+
+    // Every window within the recording, a hop apart, analysed as the
+    // sidechain would be
+    std::vector<target_spectrum::frame> frames;
+    std::vector<Real> input(window_size_), magnitudes(num_bins_), phases(num_bins_);
+    for (size_t start = 0; start + window_size_ <= num_samples; start += hop_size_) {
+        std::copy(audio + start, audio + start + window_size_, input.begin());
+        windowFrame(input.data(), 1);
+        transformFrames(false, true);
+        readSpectrum(1, spectrum_sidechain_);
+        vector_math::magnitude_phase(spectrum_sidechain_.data(),
+                                     magnitudes.data(), phases.data(), num_bins_);
+
+        target_spectrum::frame frame;
+        frame.magnitudes.assign(magnitudes.begin(), magnitudes.end());
+        frame.phases.assign(phases.begin(), phases.end());
+        frames.push_back(std::move(frame));
+    }
+    if (playback == target_spectrum::mode::averaged) {
+        target_spectrum::frame mean = target_spectrum::average(frames);
+        frames.clear();
+        frames.push_back(std::move(mean));
+    }
+
+    // Silent as processHop() would find it
+    for (target_spectrum::frame& frame : frames) {
+        double sum = 0.0;
+        for (float m : frame.magnitudes) sum += m;
+        frame.silent = sum < 1e-10;
+    }
+    return std::make_shared<const target_spectrum>(getTargetAnalysis(), playback, std::move(frames));
+}
+
+template <typename Real>
+bool BasicRealtimeAudioTransport<Real>::setTarget(std::shared_ptr<const target_spectrum> target) {
+    if (target && (target->empty() || target->settings() != getTargetAnalysis())) return false;
+    target_ = std::move(target);
+    target_hop_ = 0;
+    installed_target_ = nullptr;
+
+    // Either way the sidechain spectra start over from silence
+    for (int c = 0; c < num_channels_; ++c) {
+        std::fill(mag_Y_[c].begin(), mag_Y_[c].end(), 0.0);
+        std::fill(phase_Y_[c].begin(), phase_Y_[c].end(), 0.0);
+    }
+    return true;
+}
 
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::windowFrame(const Real* input_frame, int side)
+{
+    // Apply the window inside the zero padding
     int padding_offset = (fft_size_ - window_size_) / 2;
+    Real* fft_input = fft_input_ + side * real_distance_ + padding_offset;
     for (int i = 0; i < window_size_; ++i) {
-        fft_input_[padding_offset + i] = input_buffer[i] * window_[i];
+        fft_input[i] = input_frame[i] * window_[i];
     }
+}
 
-    // Execute FFT
-    fftw_execute(fft_plan_);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::transformFrames(bool main, bool sidechain)
+{
+    if (main && sidechain) {
+        fft::execute_r2c(paired_fft_plan_, fft_input_, fft_output_);
+    } else if (main || sidechain) {
+        int side = main ? 0 : 1;
+        fft::execute_r2c(fft_plan_, fft_input_ + side * real_distance_,
+                         fft_output_ + side * complex_distance_);
+    }
+}
 
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::readSpectrum(int side, std::vector<std::complex<Real>>& spectrum)
+{
     // Copy to complex spectrum
+    const typename fft::complex* bins = fft_output_ + side * complex_distance_;
     for (int i = 0; i < num_bins_; ++i) {
-        spectrum[i] = std::complex<double>(fft_output_[i][0], fft_output_[i][1]);
+        spectrum[i] = std::complex<Real>(bins[i][0], bins[i][1]);
     }
 }
 
-void RealtimeAudioTransport::computeISTFT(
-    const std::vector<std::complex<double>>& spectrum,
-    std::vector<double>& output_frame)
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::computeISTFT(
+    const std::vector<std::complex<Real>>& spectrum,
+    std::vector<Real>& output_frame)
 {
     // Copy spectrum to FFTW buffer
     for (int i = 0; i < num_bins_; ++i) {
@@ -167,39 +348,100 @@ void RealtimeAudioTransport::computeISTFT(
     }
 
     // Execute inverse FFT
-    fftw_execute(ifft_plan_);
+    fft::execute_c2r(ifft_plan_, ifft_input_, ifft_output_);
 
-    // Extract windowed samples and normalize
-    output_frame.resize(window_size_);
+    // Extract windowed samples and normalize: the whole frame, or in
+    // low-latency mode its last synthesis_size_ samples
     int padding_offset = (fft_size_ - window_size_) / 2;
-    double norm = 1.0 / fft_size_;
+    Real* frame = ifft_output_ + padding_offset + window_size_ - synthesis_size_;
+    Real norm = Real(1) / fft_size_;
 
-    for (int i = 0; i < window_size_; ++i) {
+    // NaN/Inf never reaches the overlap-add
+    size_t invalid = vector_math::sanitize(frame, synthesis_size_);
+    if (invalid) {
+        diagnostics::report(diagnostics::event::invalid_sample, -1, static_cast<double>(invalid));
+    }
+
+    for (int i = 0; i < synthesis_size_; ++i) {
         // Apply window again for overlap-add
-        output_frame[i] = ifft_output_[padding_offset + i] * window_[i] * norm;
+        output_frame[i] = frame[i] * synthesis_window_[i] * norm;
     }
 }
 
-void RealtimeAudioTransport::computeTransportMap(
-    const std::vector<double>& mag_X,
-    const std::vector<double>& mag_Y,
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::mergeTransportMap(
+    const std::vector<Real>& cdf_X,
+    const std::vector<Real>& cdf_Y,
     std::vector<int>& transport_map)
 {
-    const double eps = 1e-10;
-    transport_map.resize(num_bins_);
+    const Real eps = static_cast<Real>(1e-10);
+    const int num_bins = static_cast<int>(cdf_X.size());
+
+    // cdf_X is non-decreasing, so the matching target bin never moves left
+    int j = 0;
+    for (int i = 0; i < num_bins; ++i) {
+        while (j < num_bins - 1 && cdf_Y[j] < cdf_X[i] - eps) {
+            ++j;
+        }
+        transport_map[i] = j;
+    }
+}
 
-    // Normalize to probability distributions
-    double sum_X = 0.0, sum_Y = 0.0;
-    for (int i = 0; i < num_bins_; ++i) {
-        sum_X += mag_X[i];
-        sum_Y += mag_Y[i];
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::mergeFractionalTransportMap(
+    const std::vector<Real>& cdf_X,
+    const std::vector<Real>& cdf_Y,
+    std::vector<Real>& positions)
+{
+    const Real eps = static_cast<Real>(1e-10);
+    const int num_bins = static_cast<int>(cdf_X.size());
+
+    int j = 0;
+    for (int i = 0; i < num_bins; ++i) {
+        while (j < num_bins - 1 && cdf_Y[j] < cdf_X[i] - eps) {
+            ++j;
+        }
+
+        // Walk back along the segment from bin j - 1 to bin j
+        Real position = j;
+        if (j > 0) {
+            Real rise = cdf_Y[j] - cdf_Y[j - 1];
+            if (rise > eps) {
+                Real frac = (cdf_X[i] - cdf_Y[j - 1]) / rise;
+                frac = std::max(Real(0), std::min(frac, Real(1)));
+                position = (j - 1) + frac;
+            }
+        }
+        positions[i] = position;
     }
-    sum_X = std::max(sum_X, eps);
-    sum_Y = std::max(sum_Y, eps);
+}
 
-    // Compute CDFs
-    std::vector<double> cdf_X(num_bins_);
-    std::vector<double> cdf_Y(num_bins_);
+// Spectra whose magnitudes sum to less than this have nothing to
+// transport
+static const double silent_sum = 1e-10;
+
+// Sums are accumulated in double regardless of Real so the CDFs of
+// the float engine do not drift across thousands of bins
+template <typename Real>
+static double magnitudeSum(const std::vector<Real>& mag) {
+    double sum = 0.0;
+    for (Real m : mag) {
+        sum += m;
+    }
+    return sum;
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::computeTransportMap(
+    const std::vector<Real>& mag_X,
+    double sum_X,
+    const std::vector<Real>& mag_Y,
+    double sum_Y,
+    std::vector<Real>& positions)
+{
+    // Normalize to probability distributions and compute CDFs
+    std::vector<Real>& cdf_X = cdf_X_;
+    std::vector<Real>& cdf_Y = cdf_Y_;
 
     double cumsum_X = 0.0, cumsum_Y = 0.0;
     for (int i = 0; i < num_bins_; ++i) {
@@ -211,79 +453,213 @@ void RealtimeAudioTransport::computeTransportMap(
 
     // Compute transport map: for each bin in X, find where it maps to in Y
     // T(x) = F_Y^{-1}(F_X(x))
+    if (map_mode_ == TransportMapMode::Fractional) {
+        mergeFractionalTransportMap(cdf_X, cdf_Y, positions);
+    } else {
+        mergeTransportMap(cdf_X, cdf_Y, transport_map_);
+        for (int i = 0; i < num_bins_; ++i) {
+            positions[i] = transport_map_[i];
+        }
+    }
+}
+
+template <typename Real>
+bool BasicRealtimeAudioTransport<Real>::interpolateSpectrum(
+    int channel,
+    Real k,
+    std::vector<Real>& mag_out,
+    std::vector<Real>& phase_out)
+{
+    const std::vector<Real>& mag_X = mag_X_[channel];
+    const std::vector<Real>& phase_X = phase_X_[channel];
+    const std::vector<Real>& mag_Y = mag_Y_[channel];
+    const std::vector<Real>& phase_Y = phase_Y_[channel];
+
+    // A silent side would normalize to an all-zero CDF and send every
+    // bin to the top of the spectrum, so scale the other side instead
+    double sum_X = magnitudeSum(mag_X);
+    double sum_Y = magnitudeSum(mag_Y);
+    if (sum_X < silent_sum && sum_Y < silent_sum) return false;
+    if (sum_X < silent_sum) {
+        scaleSpectrum(mag_Y, phase_Y, k, mag_out, phase_out);
+        return true;
+    }
+    if (sum_Y < silent_sum) {
+        scaleSpectrum(mag_X, phase_X, 1 - k, mag_out, phase_out);
+        return true;
+    }
+
+    // Compute transport map
+    computeTransportMap(mag_X, sum_X, mag_Y, sum_Y, transport_positions_);
+    applyTransportMap(mag_X, phases_.empty() ? phase_X : movedPhases(channel, k),
+                      mag_Y, phase_Y, transport_positions_, k, mag_out, phase_out);
+    return true;
+}
+
+// Phase wrapped into [-pi, pi]
+template <typename Real>
+static Real wrapPhase(Real phase) {
+    return phase - Real(2 * M_PI) * std::round(phase / Real(2 * M_PI));
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::measureAdvance(
+    const std::vector<Real>& phase,
+    std::vector<Real>& last_phase,
+    std::vector<Real>& advance)
+{
+    // The bin's own turn per hop plus the wrapped deviation from it,
+    // which is unambiguous for partials within sample_rate / (2 hop)
+    // of the bin
     for (int i = 0; i < num_bins_; ++i) {
-        // Binary search for smallest j where cdf_Y[j] >= cdf_X[i]
-        int left = 0, right = num_bins_ - 1;
-        int result = num_bins_ - 1;
-
-        while (left <= right) {
-            int mid = (left + right) / 2;
-            if (cdf_Y[mid] >= cdf_X[i] - eps) {
-                result = mid;
-                right = mid - 1;
-            } else {
-                left = mid + 1;
-            }
+        Real expected = Real(2 * M_PI) * i * hop_size_ / fft_size_;
+        advance[i] = expected + wrapPhase(phase[i] - last_phase[i] - expected);
+        last_phase[i] = phase[i];
+    }
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::installTarget(const target_spectrum::frame& frame)
+{
+    // A frame played again (averaged, frozen) turns every bin by its
+    // own frequency over a hop, so a held spectrum sounds as partials
+    // rather than as one window repeating
+    std::vector<Real>& phase = phase_Y_[0];
+    if (&frame == installed_target_) {
+        for (int i = 0; i < num_bins_; ++i) {
+            Real expected = Real(2 * M_PI) * i * hop_size_ / fft_size_;
+            phase[i] = wrapPhase(phase[i] + expected);
         }
+    } else {
+        std::copy(frame.phases.begin(), frame.phases.end(), phase.begin());
+    }
+    std::copy(frame.magnitudes.begin(), frame.magnitudes.end(), mag_Y_[0].begin());
+    installed_target_ = &frame;
 
-        transport_map[i] = result;
+    for (int c = 0; c < num_channels_; ++c) {
+        if (c > 0) {
+            mag_Y_[c] = mag_Y_[0];
+            phase_Y_[c] = phase_Y_[0];
+        }
+        if (!phases_.empty()) measureAdvance(phase_Y_[c], last_phase_Y_[c], advance_Y_[c]);
     }
 }
 
-void RealtimeAudioTransport::interpolateSpectrum(
-    const std::vector<double>& mag_X,
-    const std::vector<double>& phase_X,
-    const std::vector<double>& mag_Y,
-    const std::vector<double>& phase_Y,
-    double k,
-    std::vector<double>& mag_out,
-    std::vector<double>& phase_out)
+template <typename Real>
+const std::vector<Real>& BasicRealtimeAudioTransport<Real>::movedPhases(int channel, Real k)
 {
-    const double eps = 1e-10;
+    const std::vector<Real>& mag_X = mag_X_[channel];
+    const std::vector<Real>& phase_X = phase_X_[channel];
+    const std::vector<Real>& advance_X = advance_X_[channel];
+    const std::vector<Real>& advance_Y = advance_Y_[channel];
+    std::vector<Real>& gained = phases_[channel];
+
+    // A partial's peak gains k times the difference between the
+    // advance at its target and its own, so the moved partial turns at
+    // the interpolated frequency. The bins around the peak down to the
+    // next minimum take the same gain (identity phase locking, Laroche
+    // & Dolson 1999), which keeps the main input's phase relations
+    // within the frame however the gain started out. A peak carries
+    // over the gain of whichever region held its bin on the last hop.
+    int start = 0;
+    while (start < num_bins_) {
+        int peak = start;
+        while (peak + 1 < num_bins_ && mag_X[peak + 1] >= mag_X[peak]) peak++;
+        int end = peak;
+        while (end + 1 < num_bins_ && mag_X[end + 1] < mag_X[end]) end++;
+
+        Real position = transport_positions_[peak];
+        int target = static_cast<int>(position);
+        Real frac = position - target;
+        Real advance_target = advance_Y[target];
+        if (frac > 0 && target + 1 < num_bins_) {
+            advance_target += frac * (advance_Y[target + 1] - advance_Y[target]);
+        }
+        Real gain = wrapPhase(gained[peak] + k * (advance_target - advance_X[peak]));
 
-    mag_out.resize(num_bins_, 0.0);
-    phase_out.resize(num_bins_, 0.0);
+        for (int i = start; i <= end; ++i) {
+            gained[i] = gain;
+            moved_phase_[i] = phase_X[i] + gain;
+        }
+        start = end + 1;
+    }
+    return moved_phase_;
+}
 
-    // Compute transport map
-    std::vector<int> transport_map;
-    computeTransportMap(mag_X, mag_Y, transport_map);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::scaleSpectrum(
+    const std::vector<Real>& mag,
+    const std::vector<Real>& phase,
+    Real scale,
+    std::vector<Real>& mag_out,
+    std::vector<Real>& phase_out)
+{
+    for (int i = 0; i < num_bins_; ++i) {
+        mag_out[i] = scale * mag[i];
+        phase_out[i] = phase[i];
+    }
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::applyTransportMap(
+    const std::vector<Real>& mag_X,
+    const std::vector<Real>& phase_X,
+    const std::vector<Real>& mag_Y,
+    const std::vector<Real>& phase_Y,
+    const std::vector<Real>& transport_map,
+    Real k,
+    std::vector<Real>& mag_out,
+    std::vector<Real>& phase_out)
+{
+    const Real eps = static_cast<Real>(1e-10);
+
+    std::fill(mag_out.begin(), mag_out.end(), 0.0);
+    std::fill(phase_out.begin(), phase_out.end(), 0.0);
 
     // Interpolated bin positions
-    std::vector<double> interp_positions(num_bins_);
+    std::vector<Real>& interp_positions = interp_positions_;
     for (int i = 0; i < num_bins_; ++i) {
-        interp_positions[i] = (1.0 - k) * i + k * transport_map[i];
+        interp_positions[i] = (1 - k) * i + k * transport_map[i];
     }
 
     // Accumulate energy at interpolated positions
-    std::vector<double> weight_sum(num_bins_, eps);
-    std::vector<double> phase_num(num_bins_, 0.0);
+    std::vector<Real>& weight_sum = weight_sum_;
+    std::vector<Real>& phase_num = phase_num_;
+    std::fill(weight_sum.begin(), weight_sum.end(), eps);
+    std::fill(phase_num.begin(), phase_num.end(), 0.0);
 
     for (int i = 0; i < num_bins_; ++i) {
-        double target_pos = interp_positions[i];
-        int target_idx = transport_map[i];
-
-        // Interpolate magnitude
-        double interp_mag = (1.0 - k) * mag_X[i] + k * mag_Y[target_idx];
+        Real target_pos = interp_positions[i];
+
+        // Interpolate magnitude, reading the target spectrum at the
+        // (possibly fractional) mapped position
+        Real source_pos = transport_map[i];
+        int target_idx = static_cast<int>(source_pos);
+        Real target_frac = source_pos - target_idx;
+        Real mag_target = mag_Y[target_idx];
+        if (target_frac > 0 && target_idx + 1 < num_bins_) {
+            mag_target += target_frac * (mag_Y[target_idx + 1] - mag_Y[target_idx]);
+        }
+        Real interp_mag = (1 - k) * mag_X[i] + k * mag_target;
 
-        // Distribute energy to neighboring bins (linear interpolation)
+        // Distribute energy to the two neighboring bins (linear interpolation)
         int low_bin = static_cast<int>(std::floor(target_pos));
-        int high_bin = static_cast<int>(std::ceil(target_pos));
-        double frac = target_pos - low_bin;
+        Real frac = target_pos - low_bin;
+        int high_bin = low_bin + 1;
 
         // Clamp to valid range
         low_bin = std::max(0, std::min(low_bin, num_bins_ - 1));
-        high_bin = std::max(0, std::min(high_bin, num_bins_ - 1));
 
         // Accumulate magnitude
         if (low_bin < num_bins_) {
-            double weight = (1.0 - frac) * interp_mag;
+            Real weight = (1 - frac) * interp_mag;
             mag_out[low_bin] += weight;
             weight_sum[low_bin] += weight;
             phase_num[low_bin] += weight * phase_X[i];
         }
 
-        if (high_bin < num_bins_ && high_bin != low_bin) {
-            double weight = frac * interp_mag;
+        if (high_bin < num_bins_ && frac > 0) {
+            Real weight = frac * interp_mag;
             mag_out[high_bin] += weight;
             weight_sum[high_bin] += weight;
             phase_num[high_bin] += weight * phase_X[i];
@@ -301,79 +677,283 @@ void RealtimeAudioTransport::interpolateSpectrum(
     }
 }
 
-void RealtimeAudioTransport::process(
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::processHop(float k_value, int ola_position) {
+    const Real k = static_cast<Real>(k_value);
+    instrumentation::hop_timer timer(instrumentation_);
+    size_t skipped = 0;
+
+    if (target_) {
+        installTarget(target_->at(target_hop_));
+        if (!sidechain_frozen_) target_hop_++;
+    }
+
+    for (int c = 0; c < num_channels_; ++c) {
+        // The last window_size_ input samples, oldest first
+        const Real* main_frame = main_buffers_[c].data() + buffer_write_pos_;
+        const Real* sidechain_frame = sidechain_buffers_[c].data() + buffer_write_pos_;
+
+        // Compute STFTs and extract magnitude and phase. A silent
+        // window is all zeros without the FFT, and a frozen sidechain
+        // keeps the last spectrum it had. When both inputs are
+        // analysed their transforms run as one batch, timed as main
+        // analysis. A target takes the sidechain's place without either.
+        bool analyze_sidechain = false;
+        if (target_ || sidechain_frozen_) {
+            skipped++;
+        } else if (sidechain_gates_[c].silent(window_size_)) {
+            std::fill(mag_Y_[c].begin(), mag_Y_[c].end(), 0.0);
+            std::fill(phase_Y_[c].begin(), phase_Y_[c].end(), 0.0);
+            skipped++;
+        } else {
+            windowFrame(sidechain_frame, 1);
+            analyze_sidechain = true;
+        }
+        timer.lap(instrumentation::stage::analyze_sidechain);
+
+        bool analyze_main = !main_gates_[c].silent(window_size_);
+        if (!analyze_main) {
+            std::fill(mag_X_[c].begin(), mag_X_[c].end(), 0.0);
+            std::fill(phase_X_[c].begin(), phase_X_[c].end(), 0.0);
+            skipped++;
+        } else {
+            windowFrame(main_frame, 0);
+        }
+        transformFrames(analyze_main, analyze_sidechain);
+        if (analyze_main) {
+            readSpectrum(0, spectrum_main_);
+            vector_math::magnitude_phase(spectrum_main_.data(),
+                                         mag_X_[c].data(), phase_X_[c].data(), num_bins_);
+            if (!phases_.empty()) measureAdvance(phase_X_[c], last_phase_X_[c], advance_X_[c]);
+        }
+        timer.lap(analyze_main ? instrumentation::stage::analyze_main
+                               : instrumentation::stage::analyze_sidechain);
+
+        if (analyze_sidechain) {
+            readSpectrum(1, spectrum_sidechain_);
+            vector_math::magnitude_phase(spectrum_sidechain_.data(),
+                                         mag_Y_[c].data(), phase_Y_[c].data(), num_bins_);
+            if (!phases_.empty()) measureAdvance(phase_Y_[c], last_phase_Y_[c], advance_Y_[c]);
+        }
+        timer.lap(instrumentation::stage::analyze_sidechain);
+    }
+    timer.skipped(skipped);
+
+    if (channel_mode_ == ChannelMode::Linked && num_channels_ > 1) {
+        // One map from the summed magnitudes moves every channel
+        for (int i = 0; i < num_bins_; ++i) {
+            Real sum_X = 0, sum_Y = 0;
+            for (int c = 0; c < num_channels_; ++c) {
+                sum_X += mag_X_[c][i];
+                sum_Y += mag_Y_[c][i];
+            }
+            mag_X_sum_[i] = sum_X;
+            mag_Y_sum_[i] = sum_Y;
+        }
+
+        // A side silent in the sum is silent on every channel
+        double total_X = magnitudeSum(mag_X_sum_);
+        double total_Y = magnitudeSum(mag_Y_sum_);
+        bool main_silent = total_X < silent_sum;
+        bool sidechain_silent = total_Y < silent_sum;
+        if (main_silent && sidechain_silent) {
+            timer.finish();
+            return;
+        }
+        if (!main_silent && !sidechain_silent) {
+            computeTransportMap(mag_X_sum_, total_X, mag_Y_sum_, total_Y, transport_positions_);
+        }
+
+        for (int c = 0; c < num_channels_; ++c) {
+            if (main_silent) {
+                scaleSpectrum(mag_Y_[c], phase_Y_[c], k, mag_out_, phase_out_);
+            } else if (sidechain_silent) {
+                scaleSpectrum(mag_X_[c], phase_X_[c], 1 - k, mag_out_, phase_out_);
+            } else {
+                const std::vector<Real>& phase_X = phases_.empty() ? phase_X_[c] : movedPhases(c, k);
+                applyTransportMap(mag_X_[c], phase_X, mag_Y_[c], phase_Y_[c],
+                                  transport_positions_, k, mag_out_, phase_out_);
+            }
+            timer.lap(instrumentation::stage::interpolate);
+            synthesizeChannel(c, ola_position, timer);
+        }
+    } else {
+        for (int c = 0; c < num_channels_; ++c) {
+            // Interpolate spectrum using optimal transport; a hop with
+            // both inputs silent adds nothing to the overlap-add
+            bool audible = interpolateSpectrum(c, k, mag_out_, phase_out_);
+            timer.lap(instrumentation::stage::interpolate);
+            if (audible) synthesizeChannel(c, ola_position, timer);
+        }
+    }
+    timer.finish();
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::synthesizeChannel(
+    int channel, int position, instrumentation::hop_timer& timer) {
+    // Reconstruct complex spectrum
+    vector_math::polar(mag_out_.data(), phase_out_.data(),
+                       spectrum_output_.data(), num_bins_);
+
+    // Inverse STFT
+    computeISTFT(spectrum_output_, output_frame_);
+    overlapAdd(channel, position);
+    timer.lap(instrumentation::stage::synthesize);
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::overlapAdd(int channel, int position) {
+    std::vector<Real>& ola_buffer = ola_buffers_[channel];
+    const int ola_size = static_cast<int>(ola_buffer.size());
+    const int first = std::min(synthesis_size_, ola_size - position);
+
+    Real* ola = ola_buffer.data();
+    const Real* frame = output_frame_.data();
+    for (int j = 0; j < first; ++j) {
+        ola[position + j] += frame[j];
+    }
+    for (int j = first; j < synthesis_size_; ++j) {
+        ola[j - first] += frame[j];
+    }
+}
+
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::process(
     const float* input_main,
     const float* input_sidechain,
     float* output,
     int buffer_size,
     float k_value)
 {
-    // Process sample by sample
-    for (int i = 0; i < buffer_size; ++i) {
-        // Write to input buffers (circular)
-        main_buffer_[buffer_write_pos_] = static_cast<double>(input_main[i]);
-        sidechain_buffer_[buffer_write_pos_] = static_cast<double>(input_sidechain[i]);
-
-        buffer_write_pos_ = (buffer_write_pos_ + 1) % window_size_;
-        samples_in_buffer_++;
-
-        // Process when we have enough samples for a hop
-        if (samples_in_buffer_ >= hop_size_) {
-            samples_in_buffer_ -= hop_size_;
-
-            // Extract linear buffers for processing
-            std::vector<double> main_frame(window_size_);
-            std::vector<double> sidechain_frame(window_size_);
-
-            for (int j = 0; j < window_size_; ++j) {
-                int idx = (buffer_read_pos_ + j) % window_size_;
-                main_frame[j] = main_buffer_[idx];
-                sidechain_frame[j] = sidechain_buffer_[idx];
-            }
+    processChannels(&input_main, &input_sidechain, &output, 1, buffer_size, k_value, nullptr);
+}
 
-            buffer_read_pos_ = (buffer_read_pos_ + hop_size_) % window_size_;
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::process(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    float k_value)
+{
+    processChannels(input_main, input_sidechain, output, num_channels, buffer_size, k_value, nullptr);
+}
 
-            // Compute STFTs
-            computeSTFT(main_frame, spectrum_main_);
-            computeSTFT(sidechain_frame, spectrum_sidechain_);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::process(
+    const float* input_main,
+    const float* input_sidechain,
+    float* output,
+    int buffer_size,
+    const float* k)
+{
+    processChannels(&input_main, &input_sidechain, &output, 1, buffer_size, 0.0f, k);
+}
 
-            // Extract magnitude and phase
-            std::vector<double> mag_X(num_bins_), mag_Y(num_bins_);
-            std::vector<double> phase_X(num_bins_), phase_Y(num_bins_);
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::process(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    const float* k)
+{
+    processChannels(input_main, input_sidechain, output, num_channels, buffer_size, 0.0f, k);
+}
 
-            for (int j = 0; j < num_bins_; ++j) {
-                mag_X[j] = std::abs(spectrum_main_[j]);
-                mag_Y[j] = std::abs(spectrum_sidechain_[j]);
-                phase_X[j] = std::arg(spectrum_main_[j]);
-                phase_Y[j] = std::arg(spectrum_sidechain_[j]);
-            }
+template <typename Real>
+void BasicRealtimeAudioTransport<Real>::processChannels(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    float k_value,
+    const float* k_samples)
+{
+    realtime_check::scope realtime;
+    denormals::scoped_flush_denormals flush;
+    instrumentation::block_timer block(instrumentation_);
+    assert(num_channels == num_channels_);
+
+    const int ola_size = window_size_ * 2;
+    int samples_processed = 0;
+
+    while (samples_processed < buffer_size) {
+        // Take samples up to the next hop or the end of the ring,
+        // whichever comes first
+        int chunk = std::min(hop_size_ - samples_in_buffer_,
+                             buffer_size - samples_processed);
+        chunk = std::min(chunk, window_size_ - buffer_write_pos_);
+
+        // Append to both halves of the mirrored input rings. Every
+        // channel's chunk is taken before any output is written over
+        // it, which is what makes in-place processing safe
+        for (int c = 0; c < num_channels; ++c) {
+            const float* main_in = input_main[c] + samples_processed;
+            const float* sidechain_in = input_sidechain[c] + samples_processed;
+            std::vector<Real>& main_buffer = main_buffers_[c];
+            std::vector<Real>& sidechain_buffer = sidechain_buffers_[c];
+            std::copy(main_in, main_in + chunk, main_buffer.begin() + buffer_write_pos_);
+            std::copy(main_in, main_in + chunk,
+                      main_buffer.begin() + buffer_write_pos_ + window_size_);
+            std::copy(sidechain_in, sidechain_in + chunk,
+                      sidechain_buffer.begin() + buffer_write_pos_);
+            std::copy(sidechain_in, sidechain_in + chunk,
+                      sidechain_buffer.begin() + buffer_write_pos_ + window_size_);
+            main_gates_[c].push(main_in, chunk, silence_threshold_);
+            sidechain_gates_[c].push(sidechain_in, chunk, silence_threshold_);
+        }
+        if (k_samples) {
+            k_history_.push(k_samples + samples_processed, chunk);
+        } else {
+            k_history_.fill(k_value, chunk);
+        }
 
-            // Interpolate spectrum using optimal transport
-            std::vector<double> mag_out, phase_out;
-            interpolateSpectrum(mag_X, phase_X, mag_Y, phase_Y,
-                              static_cast<double>(k_value), mag_out, phase_out);
+        buffer_write_pos_ += chunk;
+        if (buffer_write_pos_ == window_size_) buffer_write_pos_ = 0;
+        samples_in_buffer_ += chunk;
 
-            // Reconstruct complex spectrum
-            for (int j = 0; j < num_bins_; ++j) {
-                spectrum_output_[j] = std::polar(mag_out[j], phase_out[j]);
-            }
+        // A completed hop starts its output frame at the chunk's last
+        // sample, so that sample's output already includes it
+        if (samples_in_buffer_ == hop_size_) {
+            samples_in_buffer_ = 0;
 
-            // Inverse STFT
-            std::vector<double> output_frame;
-            computeISTFT(spectrum_output_, output_frame);
+            int position = ola_write_pos_ + chunk - 1;
+            if (position >= ola_size) position -= ola_size;
+            // A per-sample k is taken at the centre of the frame
+            // resynthesized, which ends at this sample
+            processHop(k_samples ? k_history_.at((synthesis_size_ - 1) / 2) : k_value, position);
+        }
 
-            // Add to overlap-add buffer
-            for (int j = 0; j < window_size_; ++j) {
-                int ola_idx = (ola_write_pos_ + j) % ola_buffer_.size();
-                ola_buffer_[ola_idx] += output_frame[j];
+        // Hand out and clear the chunk's output (at most two spans)
+        int first = std::min(chunk, ola_size - ola_write_pos_);
+        for (int c = 0; c < num_channels; ++c) {
+            float* out = output[c] + samples_processed;
+            Real* ola = ola_buffers_[c].data();
+            for (int j = 0; j < first; ++j) {
+                out[j] = static_cast<float>(ola[ola_write_pos_ + j]);
             }
+            std::fill(ola + ola_write_pos_, ola + ola_write_pos_ + first, Real(0));
+            for (int j = first; j < chunk; ++j) {
+                out[j] = static_cast<float>(ola[j - first]);
+            }
+            std::fill(ola, ola + (chunk - first), Real(0));
         }
 
-        // Read from overlap-add buffer
-        output[i] = static_cast<float>(ola_buffer_[ola_write_pos_]);
-        ola_buffer_[ola_write_pos_] = 0.0; // Clear after reading
-        ola_write_pos_ = (ola_write_pos_ + 1) % ola_buffer_.size();
+        ola_write_pos_ += chunk;
+        if (ola_write_pos_ >= ola_size) ola_write_pos_ -= ola_size;
+        samples_processed += chunk;
     }
+    block.finish(buffer_size);
 }
 
+template class BasicRealtimeAudioTransport<double>;
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+template class BasicRealtimeAudioTransport<float>;
+#endif
+
 } // namespace audio_transport
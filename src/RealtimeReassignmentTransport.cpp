@@ -1,23 +1,40 @@
 #include "audio_transport/RealtimeReassignmentTransport.hpp"
+#include "audio_transport/denormals.hpp"
+#include "audio_transport/diagnostics.hpp"
+#include "audio_transport/fft_plans.hpp"
 #include "audio_transport/spectral.hpp"
+#include "audio_transport/realtime_check.hpp"
+#include "audio_transport/vector_math.hpp"
+#include <cassert>
 #include <cmath>
 #include <cstring>
 #include <algorithm>
 #include <iostream>
 
-using namespace audio_transport;
+namespace audio_transport {
 
-RealtimeReassignmentTransport::RealtimeReassignmentTransport(
+template <typename Real>
+BasicRealtimeReassignmentTransport<Real>::BasicRealtimeReassignmentTransport(
     double sample_rate,
     double window_ms,
     int hop_divisor,
-    int fft_padding
+    int fft_padding,
+    double synthesis_ms,
+    fft_plans::sizing fft_sizing
 ) : sample_rate_(sample_rate),
     window_size_(window_ms / 1000.0),
     hop_divisor_(hop_divisor),
     fft_padding_(fft_padding),
+    num_channels_(1),
+    channel_mode_(ChannelMode::Independent),
+    silence_threshold_(0.0f),
+    sidechain_frozen_(false),
+    instrumentation_(nullptr),
     input_write_pos_(0),
-    output_read_pos_(0)
+    output_read_pos_(0),
+    linked_sidechain_grouped_(false),
+    target_hop_(0),
+    installed_target_(nullptr)
 {
     // Calculate window size in samples (must be even for symmetry)
     window_samples_ = static_cast<int>(std::round(window_size_ * sample_rate));
@@ -25,205 +42,618 @@ RealtimeReassignmentTransport::RealtimeReassignmentTransport(
         window_samples_++;
     }
 
-    window_padded_ = window_samples_ * (1 + fft_padding_);
-    hop_size_ = window_samples_ / (2 * hop_divisor_);
+    // A low-latency synthesis length is rounded the same way and
+    // falls back to the full window if it is not shorter
+    synthesis_samples_ = window_samples_;
+    if (synthesis_ms > 0.0) {
+        int synthesis_samples = static_cast<int>(std::round(synthesis_ms / 1000.0 * sample_rate));
+        synthesis_samples = std::max(synthesis_samples, 1);
+        while (synthesis_samples % (2 * hop_divisor_) != 0) {
+            synthesis_samples++;
+        }
+        synthesis_samples_ = std::min(synthesis_samples, window_samples_);
+    }
+
+    // The padded window is even, and the rounded transform with it,
+    // so the window is centred at exactly window_padded_ / 2 as the
+    // phases placed by the transport assume
+    window_padded_ = fft_plans::transform_size(window_samples_ * (1 + fft_padding_), fft_sizing);
+    hop_size_ = synthesis_samples_ / (2 * hop_divisor_);
+
+    // The transport advances phases by half its window_size argument
+    // per hop. In low-latency mode the hop is a fraction of the
+    // synthesis length, not of the window, so pass the window whose
+    // half is that hop.
+    phase_window_ = window_size_;
+    if (synthesis_samples_ < window_samples_) {
+        phase_window_ = 2.0 * hop_size_ / sample_rate_;
+    }
     fft_size_ = window_padded_ / 2 + 1;
 
-    // Calculate latency: we need (2 * hop_divisor - 1) hops before first output
-    int latency_hops = 2 * hop_divisor_ - 1;
-    int latency_samples = latency_hops * hop_size_;
+    // Allocate the analysis windows of both inputs in one block, in
+    // the layout of a batched plan. Only the windowed samples are ever
+    // written, so the zero padding stays.
+    real_distance_ = fft_plans::real_distance(window_padded_);
+    complex_distance_ = fft_plans::complex_distance(window_padded_);
+    windows_.resize(6 * real_distance_, Real(0));
+    synthesized_.resize(window_padded_, Real(0));
+
+    // Allocate FFT buffers
+    spectra_ = fft::alloc_complex(6 * complex_distance_);
+    ifft_ = fft::alloc_complex(fft_size_);
+
+    // Plans from the process-wide registry, so only the first engine of
+    // a given size measures: the three transforms of one input, or of
+    // both at once
+    analysis_plan_ = fft_plans::get<Real>(window_padded_, fft_plans::forward, 3);
+    paired_plan_ = fft_plans::get<Real>(window_padded_, fft_plans::forward, 6);
+    ifft_plan_ = fft_plans::get<Real>(window_padded_, fft_plans::inverse);
+
+    // Windows only depend on the sizes and sample rate
+    window_tables_ = spectral::get_window_tables(window_samples_, sample_rate_,
+                                                 synthesis_samples_);
+
+    // Preallocate the interpolation scratch
+    hop_output_.resize(hop_size_, 0.0f);
+    plan_.reserve(fft_size_);
+    target_phases_.resize(fft_size_, 0.0);
+
+    allocateChannels();
+}
 
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::allocateChannels() {
     // Allocate input buffers (need to accumulate samples for analysis)
     int input_buffer_size = window_samples_ + hop_size_;
-    main_buffer_.resize(input_buffer_size, 0.0f);
-    sidechain_buffer_.resize(input_buffer_size, 0.0f);
+    main_buffers_.assign(num_channels_, std::vector<float>(input_buffer_size, 0.0f));
+    sidechain_buffers_.assign(num_channels_, std::vector<float>(input_buffer_size, 0.0f));
+    main_gates_.assign(num_channels_, silence_gate());
+    sidechain_gates_.assign(num_channels_, silence_gate());
+    k_history_.resize(synthesis_samples_);
 
-    // Allocate output buffer (stores latency + some extra for processing)
-    output_buffer_.resize(latency_samples + hop_size_ * 4, 0.0f);
+    // A hop's output is handed out over the next hop of input, so two
+    // hops of ring suffice at any block size
+    output_buffers_.assign(num_channels_, std::vector<float>(2 * hop_size_, 0.0f));
 
-    // Allocate spectral analysis windows
-    window_.resize(window_padded_, 0.0);
-    window_t_.resize(window_padded_, 0.0);
-    window_d_.resize(window_padded_, 0.0);
+    // Initialize phase tracking
+    phases_.assign(num_channels_, std::vector<double>(fft_size_, 0.0));
 
-    // Allocate FFT buffers
-    fft_ = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * fft_size_);
-    fft_t_ = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * fft_size_);
-    fft_d_ = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * fft_size_);
-    ifft_ = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * fft_size_);
+    // Initialize overlap-add buffer
+    overlap_buffers_.assign(num_channels_, std::vector<Real>(synthesis_samples_ + hop_size_, Real(0)));
+
+    // Preallocate the per-hop spectra
+    main_spectra_.assign(num_channels_, spectral::frame());
+    sidechain_spectra_.assign(num_channels_, spectral::frame());
+    morphed_spectra_.assign(num_channels_, spectral::frame());
+    for (int c = 0; c < num_channels_; c++) {
+        main_spectra_[c].resize(fft_size_);
+        sidechain_spectra_[c].resize(fft_size_);
+        morphed_spectra_[c].reserve(fft_size_);
+        clearSpectrum(sidechain_spectra_[c]);
+    }
+    workspaces_.assign(num_channels_, interpolate_workspace());
+    for (interpolate_workspace& workspace : workspaces_) {
+        workspace.reserve(fft_size_);
+        workspace.plan.pruning = plan_.pruning;
+    }
 
-    // Create FFTW plans
-    fft_plan_ = fftw_plan_dft_r2c_1d(window_padded_, window_.data(), fft_, FFTW_MEASURE);
-    fft_plan_t_ = fftw_plan_dft_r2c_1d(window_padded_, window_t_.data(), fft_t_, FFTW_MEASURE);
-    fft_plan_d_ = fftw_plan_dft_r2c_1d(window_padded_, window_d_.data(), fft_d_, FFTW_MEASURE);
-    ifft_plan_ = fftw_plan_dft_c2r_1d(window_padded_, ifft_, window_.data(), FFTW_MEASURE);
+    // Nothing is grouped yet, and a sidechain frozen before any input
+    // holds silence
+    main_silent_.assign(num_channels_, false);
+    sidechain_silent_.assign(num_channels_, true);
+    sidechain_grouped_.assign(num_channels_, false);
+    linked_sidechain_grouped_ = false;
+    installed_target_ = nullptr;
+}
 
-    // Initialize phase tracking
-    phases_.resize(fft_size_, 0.0);
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::setNumChannels(int num_channels) {
+    assert(num_channels >= 1);
+    if (num_channels == num_channels_) return;
 
-    // Initialize overlap-add buffer
-    overlap_buffer_.resize(window_samples_ + hop_size_, 0.0);
+    num_channels_ = num_channels;
+    allocateChannels();
+    reset();
 }
 
-RealtimeReassignmentTransport::~RealtimeReassignmentTransport() {
-    fftw_destroy_plan(fft_plan_);
-    fftw_destroy_plan(fft_plan_t_);
-    fftw_destroy_plan(fft_plan_d_);
-    fftw_destroy_plan(ifft_plan_);
-    fftw_free(fft_);
-    fftw_free(fft_t_);
-    fftw_free(fft_d_);
-    fftw_free(ifft_);
+template <typename Real>
+BasicRealtimeReassignmentTransport<Real>::~BasicRealtimeReassignmentTransport() {
+    fft::free(spectra_);
+    fft::free(ifft_);
 }
 
-void RealtimeReassignmentTransport::reset() {
-    std::fill(main_buffer_.begin(), main_buffer_.end(), 0.0f);
-    std::fill(sidechain_buffer_.begin(), sidechain_buffer_.end(), 0.0f);
-    std::fill(output_buffer_.begin(), output_buffer_.end(), 0.0f);
-    std::fill(phases_.begin(), phases_.end(), 0.0);
-    std::fill(overlap_buffer_.begin(), overlap_buffer_.end(), 0.0);
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::setMassPruning(const mass_pruning& pruning) {
+    plan_.pruning = pruning;
+    for (interpolate_workspace& workspace : workspaces_) {
+        workspace.plan.pruning = pruning;
+    }
+
+    // Sidechain masses kept from earlier hops were pruned the old way
+    std::fill(sidechain_grouped_.begin(), sidechain_grouped_.end(), false);
+    linked_sidechain_grouped_ = false;
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::reset() {
+    k_history_.reset();
+    for (int c = 0; c < num_channels_; c++) {
+        std::fill(main_buffers_[c].begin(), main_buffers_[c].end(), 0.0f);
+        std::fill(sidechain_buffers_[c].begin(), sidechain_buffers_[c].end(), 0.0f);
+        std::fill(output_buffers_[c].begin(), output_buffers_[c].end(), 0.0f);
+        std::fill(phases_[c].begin(), phases_[c].end(), 0.0);
+        std::fill(overlap_buffers_[c].begin(), overlap_buffers_[c].end(), Real(0));
+        main_gates_[c].reset();
+        sidechain_gates_[c].reset();
+        clearSpectrum(sidechain_spectra_[c]);
+        sidechain_silent_[c] = true;
+        sidechain_grouped_[c] = false;
+    }
+    linked_sidechain_grouped_ = false;
+    target_hop_ = 0;
+    installed_target_ = nullptr;
     input_write_pos_ = 0;
     output_read_pos_ = 0;
 }
 
-int RealtimeReassignmentTransport::getLatencySamples() const {
-    // Latency is (2 * hop_divisor - 1) hops
-    return (2 * hop_divisor_ - 1) * hop_size_;
+template <typename Real>
+target_spectrum::analysis BasicRealtimeReassignmentTransport<Real>::getTargetAnalysis() const {
+    target_spectrum::analysis settings;
+    settings.engine = target_spectrum::algorithm::reassignment;
+    settings.sample_rate = sample_rate_;
+    settings.fft_size = window_padded_;
+    settings.window_size = window_samples_;
+    settings.synthesis_size = synthesis_samples_;
+    settings.hop_size = hop_size_;
+    return settings;
 }
 
-void RealtimeReassignmentTransport::analyzeWindow(
-    const float* input,
-    std::vector<spectral::point>& spectrum
+template <typename Real>
+std::shared_ptr<const target_spectrum> BasicRealtimeReassignmentTransport<Real>::makeTarget(
+    const float* audio,
+    size_t num_samples,
+    target_spectrum::mode playback
 ) {
-    int padding_samples = (window_padded_ - window_samples_) / 2;
+    if (num_samples < static_cast<size_t>(window_samples_)) return nullptr;
+
+    // Every window within the recording, a hop apart, analysed as the
+    // sidechain would be
+    std::vector<target_spectrum::frame> frames;
+    spectral::frame spectrum;
+    std::vector<double> magnitudes(fft_size_), phases(fft_size_);
+    for (size_t start = 0; start + window_samples_ <= num_samples; start += hop_size_) {
+        windowInput(audio + start, 1);
+        transformWindows(false, true);
+        buildSpectrum(1, spectrum);
+        vector_math::hypot(spectrum.re.data(), spectrum.im.data(), magnitudes.data(), fft_size_);
+        vector_math::atan2(spectrum.im.data(), spectrum.re.data(), phases.data(), fft_size_);
+
+        target_spectrum::frame frame;
+        frame.magnitudes.assign(magnitudes.begin(), magnitudes.end());
+        frame.phases.assign(phases.begin(), phases.end());
+        frame.freq_offsets.resize(fft_size_);
+        for (int i = 0; i < fft_size_; i++) {
+            frame.freq_offsets[i] = static_cast<float>(spectrum.freq_reassigned[i] - spectrum.freq[i]);
+        }
+        frames.push_back(std::move(frame));
+    }
+    if (playback == target_spectrum::mode::averaged) {
+        target_spectrum::frame mean = target_spectrum::average(frames);
+        frames.clear();
+        frames.push_back(std::move(mean));
+    }
 
-    // Clear padded windows
-    std::fill(window_.begin(), window_.end(), 0.0);
-    std::fill(window_t_.begin(), window_t_.end(), 0.0);
-    std::fill(window_d_.begin(), window_d_.end(), 0.0);
+    // Group what installTarget() hands the transport, rounded to the
+    // stored floats, and flag silence as the transport would
+    for (target_spectrum::frame& frame : frames) {
+        for (int i = 0; i < fft_size_; i++) {
+            magnitudes[i] = frame.magnitudes[i];
+            spectrum.freq_reassigned[i] = spectrum.freq[i] + frame.freq_offsets[i];
+        }
+        double mass_sum = group_spectrum(magnitudes.data(), spectrum.freq.data(),
+                                         spectrum.freq_reassigned.data(), fft_size_, frame.masses);
+        frame.silent = mass_sum < 1e-10;
+    }
+    return std::make_shared<const target_spectrum>(getTargetAnalysis(), playback, std::move(frames));
+}
 
-    // Apply windowing functions
-    for (int i = 0; i < window_samples_; i++) {
-        double n = i - (window_samples_ - 1) / 2.0;
-        double a = input[i];
+template <typename Real>
+bool BasicRealtimeReassignmentTransport<Real>::setTarget(std::shared_ptr<const target_spectrum> target) {
+    if (target && (target->empty() || target->settings() != getTargetAnalysis())) return false;
+    target_ = std::move(target);
+    target_hop_ = 0;
+    installed_target_ = nullptr;
+
+    // Either way the sidechain spectra start over from silence
+    for (int c = 0; c < num_channels_; c++) {
+        clearSpectrum(sidechain_spectra_[c]);
+        sidechain_silent_[c] = true;
+        sidechain_grouped_[c] = false;
+    }
+    linked_sidechain_grouped_ = false;
+    return true;
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::installTarget(const target_spectrum::frame& frame) {
+    interpolate_workspace& first = workspaces_[0];
+    spectral::frame& spectrum = sidechain_spectra_[0];
+
+    // A frame played again (averaged, frozen) moves on by a hop the
+    // way the transport advances phases, so a held spectrum sounds as
+    // partials rather than as one window repeating
+    if (&frame == installed_target_) {
+        for (int i = 0; i < fft_size_; i++) {
+            target_phases_[i] = std::remainder(
+                target_phases_[i] + spectrum.freq_reassigned[i] * phase_window_ / 2.0, 2.0 * M_PI);
+        }
+    } else {
+        target_phases_.assign(frame.phases.begin(), frame.phases.end());
+        for (int i = 0; i < fft_size_; i++) {
+            spectrum.freq_reassigned[i] = spectrum.freq[i] + frame.freq_offsets[i];
+            spectrum.time_reassigned[i] = 0.0;
+        }
+    }
+    installed_target_ = &frame;
+
+    // Channel 0's spectrum and polar form, then the same for the rest
+    first.right_magnitudes.assign(frame.magnitudes.begin(), frame.magnitudes.end());
+    first.right_phases.assign(target_phases_.begin(), target_phases_.end());
+    first.sines.resize(fft_size_);
+    first.cosines.resize(fft_size_);
+    vector_math::sincos(target_phases_.data(), first.sines.data(), first.cosines.data(), fft_size_);
+    for (int i = 0; i < fft_size_; i++) {
+        spectrum.re[i] = first.right_magnitudes[i] * first.cosines[i];
+        spectrum.im[i] = first.right_magnitudes[i] * first.sines[i];
+    }
 
-        window_[i + padding_samples] = a * spectral::hann(n, window_samples_);
-        window_t_[i + padding_samples] = a * spectral::hann_t(n, window_samples_, sample_rate_);
-        window_d_[i + padding_samples] = a * spectral::hann_d(n, window_samples_, sample_rate_);
+    for (int c = 0; c < num_channels_; c++) {
+        interpolate_workspace& workspace = workspaces_[c];
+        if (c > 0) {
+            sidechain_spectra_[c] = spectrum;
+            workspace.right_magnitudes = first.right_magnitudes;
+            workspace.right_phases = first.right_phases;
+        }
+        workspace.plan.right_masses = frame.masses;
+        workspace.plan.right_grouped = frame.masses.size();
+        workspace.plan.right_silent = frame.silent;
+        sidechain_silent_[c] = frame.silent;
+        sidechain_grouped_[c] = true;
     }
 
-    // Execute FFT plans
-    fftw_execute(fft_plan_);
-    fftw_execute(fft_plan_t_);
-    fftw_execute(fft_plan_d_);
+    // The linked plan's sum of identical channels groups like one
+    plan_.right = spectrum;
+    plan_.right_magnitudes = first.right_magnitudes;
+    plan_.right_phases = first.right_phases;
+    plan_.right_masses = frame.masses;
+    plan_.right_grouped = frame.masses.size();
+    plan_.right_silent = frame.silent;
+    linked_sidechain_grouped_ = true;
+}
+
+template <typename Real>
+int BasicRealtimeReassignmentTransport<Real>::getLatencySamples() const {
+    // The oldest sample resynthesized by a hop is output at the slot
+    // of its newest, and only the last synthesis_samples_ of each
+    // window are resynthesized
+    return synthesis_samples_ - 1;
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::windowInput(const float* input, int side) {
+    int padding_samples = (window_padded_ - window_samples_) / 2;
+    Real* window = windows_.data() + 3 * side * real_distance_ + padding_samples;
+
+    // Apply windowing functions in one pass
+    spectral::apply_windows(*window_tables_, input, window,
+                            window + real_distance_, window + 2 * real_distance_);
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::transformWindows(bool main, bool sidechain) {
+    if (main && sidechain) {
+        fft::execute_r2c(paired_plan_, windows_.data(), spectra_);
+    } else if (main || sidechain) {
+        int side = main ? 0 : 1;
+        fft::execute_r2c(analysis_plan_, windows_.data() + 3 * side * real_distance_,
+                         spectra_ + 3 * side * complex_distance_);
+    }
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::buildSpectrum(int side, spectral::frame& spectrum) {
+    const typename fft::complex* bins = spectra_ + 3 * side * complex_distance_;
+    const typename fft::complex* bins_t = bins + complex_distance_;
+    const typename fft::complex* bins_d = bins + 2 * complex_distance_;
 
     // Compute center time
     double center_time = 0.0; // Relative to window center
 
-    // Build spectral points
+    // Build spectral frame
     spectrum.resize(fft_size_);
+
+    // Compute time (not used much in current algorithm)
+    spectrum.time = center_time;
+
     for (int i = 0; i < fft_size_; i++) {
-        std::complex<double> X(fft_[i][0], fft_[i][1]);
-        std::complex<double> X_t(fft_t_[i][0], fft_t_[i][1]);
-        std::complex<double> X_d(fft_d_[i][0], fft_d_[i][1]);
+        std::complex<double> X(bins[i][0], bins[i][1]);
+        std::complex<double> X_t(bins_t[i][0], bins_t[i][1]);
+        std::complex<double> X_d(bins_d[i][0], bins_d[i][1]);
 
-        spectrum[i].value = X;
+        spectrum.re[i] = X.real();
+        spectrum.im[i] = X.imag();
 
         // Compute frequency
-        spectrum[i].freq = (2.0 * M_PI * i) / window_padded_ * sample_rate_;
-
-        // Compute time (not used much in current algorithm)
-        spectrum[i].time = center_time;
+        spectrum.freq[i] = (2.0 * M_PI * i) / window_padded_ * sample_rate_;
 
         // Compute reassigned frequency
         double mag = std::abs(X);
         if (mag > 1e-10) {
-            double freq_offset = -std::imag(X_d / X) / (2.0 * M_PI);
-            spectrum[i].freq_reassigned = spectrum[i].freq + freq_offset;
+            double freq_offset = -std::imag(X_d / X);
+            spectrum.freq_reassigned[i] = spectrum.freq[i] + freq_offset;
         } else {
-            spectrum[i].freq_reassigned = spectrum[i].freq;
+            spectrum.freq_reassigned[i] = spectrum.freq[i];
         }
 
         // Compute reassigned time
         if (mag > 1e-10) {
             double time_offset = std::real(X_t / X);
-            spectrum[i].time_reassigned = center_time + time_offset;
+            spectrum.time_reassigned[i] = center_time + time_offset;
         } else {
-            spectrum[i].time_reassigned = center_time;
+            spectrum.time_reassigned[i] = center_time;
         }
     }
 }
 
-void RealtimeReassignmentTransport::synthesizeWindow(
-    const std::vector<spectral::point>& spectrum,
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::clearSpectrum(spectral::frame& spectrum) const {
+    spectrum.resize(fft_size_);
+    spectrum.time = 0.0;
+    for (int i = 0; i < fft_size_; i++) {
+        spectrum.re[i] = 0.0;
+        spectrum.im[i] = 0.0;
+        spectrum.freq[i] = (2.0 * M_PI * i) / window_padded_ * sample_rate_;
+        spectrum.freq_reassigned[i] = spectrum.freq[i];
+        spectrum.time_reassigned[i] = 0.0;
+    }
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::synthesizeWindow(
+    const spectral::frame& spectrum,
+    std::vector<Real>& overlap_buffer,
     float* output
 ) {
     // Fill IFFT buffer
     for (size_t i = 0; i < spectrum.size(); i++) {
-        ifft_[i][0] = std::real(spectrum[i].value);
-        ifft_[i][1] = std::imag(spectrum[i].value);
+        ifft_[i][0] = spectrum.re[i];
+        ifft_[i][1] = spectrum.im[i];
     }
 
     // Execute IFFT
-    fftw_execute(ifft_plan_);
+    fft::execute_c2r(ifft_plan_, ifft_, synthesized_.data());
 
-    // Extract windowed samples (with overlap-add)
+    // Extract windowed samples (with overlap-add): the whole window,
+    // or in low-latency mode its tail through the synthesis window
     int padding_samples = (window_padded_ - window_samples_) / 2;
+    Real* frame = synthesized_.data() + padding_samples + window_samples_ - synthesis_samples_;
+    const double* synthesis = window_tables_->synthesis.empty()
+                            ? nullptr : window_tables_->synthesis.data();
+
+    // Zero any NaN/Inf before it reaches the overlap-add, in one pass
+    // so the loop below stays branch-free
+    size_t invalid = vector_math::sanitize(frame, synthesis_samples_);
+    if (invalid) {
+        diagnostics::report(diagnostics::event::invalid_sample, -1, static_cast<double>(invalid));
+    }
 
-    for (int i = 0; i < window_samples_; i++) {
-        // Scale down to correct for FFT and overlap
-        double value = window_[i + padding_samples] / (hop_divisor_ * window_padded_);
-
-        // Safety check: clamp NaN/Inf values
-        if (!std::isfinite(value)) {
-            value = 0.0;
+    // Scale down to correct for FFT and overlap
+    const Real divisor = static_cast<Real>(hop_divisor_ * window_padded_);
+    if (synthesis) {
+        for (int i = 0; i < synthesis_samples_; i++) {
+            overlap_buffer[i] += frame[i] / divisor * static_cast<Real>(synthesis[i]);
+        }
+    } else {
+        for (int i = 0; i < synthesis_samples_; i++) {
+            overlap_buffer[i] += frame[i] / divisor;
         }
-
-        // Add to overlap buffer
-        overlap_buffer_[i] += value;
     }
 
+    emitHop(overlap_buffer, output);
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::emitHop(
+    std::vector<Real>& overlap_buffer,
+    float* output
+) {
     // Copy out the ready samples (one hop's worth)
     for (int i = 0; i < hop_size_; i++) {
-        output[i] = static_cast<float>(overlap_buffer_[i]);
+        output[i] = static_cast<float>(overlap_buffer[i]);
     }
 
     // Shift overlap buffer
-    std::memmove(overlap_buffer_.data(), overlap_buffer_.data() + hop_size_,
-                 (overlap_buffer_.size() - hop_size_) * sizeof(double));
-    std::fill(overlap_buffer_.end() - hop_size_, overlap_buffer_.end(), 0.0);
+    std::memmove(overlap_buffer.data(), overlap_buffer.data() + hop_size_,
+                 (overlap_buffer.size() - hop_size_) * sizeof(Real));
+    std::fill(overlap_buffer.end() - hop_size_, overlap_buffer.end(), Real(0));
 }
 
-void RealtimeReassignmentTransport::processHop(float k) {
-    // Analyze main and sidechain inputs
-    std::vector<spectral::point> main_spectrum;
-    std::vector<spectral::point> sidechain_spectrum;
+// Count the masses and transport entries of a plan just used
+static void record_plan(instrumentation::recorder* recorder, const transport_plan& plan) {
+    bool silent = plan.left_silent || plan.right_silent;
+    size_t pruned = plan.left_grouped + plan.right_grouped
+                  - plan.left_masses.size() - plan.right_masses.size();
+    recorder->add_plan(plan.left_masses.size(), plan.right_masses.size(),
+                       silent ? 0 : plan.transport.size(), silent, pruned);
+}
 
-    analyzeWindow(main_buffer_.data(), main_spectrum);
-    analyzeWindow(sidechain_buffer_.data(), sidechain_spectrum);
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::processHop(float k, int output_position) {
+    instrumentation::hop_timer timer(instrumentation_);
+    size_t skipped = 0;
+
+    // Analyze main and sidechain inputs. A silent window gets the
+    // spectrum of zeros without its FFTs, and a frozen sidechain keeps
+    // the last spectrum it had. When both are analysed their six
+    // transforms run as one batch, timed as main analysis. A target
+    // takes the sidechain's place without either.
+    if (target_) {
+        installTarget(target_->at(target_hop_));
+        if (!sidechain_frozen_) target_hop_++;
+    }
+    for (int c = 0; c < num_channels_; c++) {
+        bool analyze_sidechain = false;
+        if (target_ || sidechain_frozen_) {
+            skipped++;
+        } else if (sidechain_gates_[c].silent(window_samples_)) {
+            // Still zeroed from an earlier hop means still grouped
+            if (!sidechain_silent_[c]) {
+                clearSpectrum(sidechain_spectra_[c]);
+                sidechain_silent_[c] = true;
+                sidechain_grouped_[c] = false;
+                linked_sidechain_grouped_ = false;
+            }
+            skipped++;
+        } else {
+            windowInput(sidechain_buffers_[c].data(), 1);
+            analyze_sidechain = true;
+        }
+        timer.lap(instrumentation::stage::analyze_sidechain);
+
+        main_silent_[c] = main_gates_[c].silent(window_samples_);
+        if (main_silent_[c]) {
+            clearSpectrum(main_spectra_[c]);
+            skipped++;
+        } else {
+            windowInput(main_buffers_[c].data(), 0);
+        }
+        transformWindows(!main_silent_[c], analyze_sidechain);
+        if (!main_silent_[c]) buildSpectrum(0, main_spectra_[c]);
+        timer.lap(main_silent_[c] ? instrumentation::stage::analyze_sidechain
+                                  : instrumentation::stage::analyze_main);
+
+        if (analyze_sidechain) {
+            buildSpectrum(1, sidechain_spectra_[c]);
+            sidechain_silent_[c] = false;
+            sidechain_grouped_[c] = false;
+            linked_sidechain_grouped_ = false;
+        }
+        timer.lap(instrumentation::stage::analyze_sidechain);
+    }
+    timer.skipped(skipped);
+
+    // Perform optimal transport interpolation. Where both inputs are
+    // silent the hop is silent and neither transported nor synthesized.
+    bool linked = channel_mode_ == ChannelMode::Linked && num_channels_ > 1;
+    bool all_silent = true;
+    for (int c = 0; c < num_channels_; c++) {
+        all_silent = all_silent && main_silent_[c] && sidechain_silent_[c];
+    }
 
-    // Perform optimal transport interpolation
-    std::vector<spectral::point> morphed_spectrum =
-        interpolate(main_spectrum, sidechain_spectrum, phases_, window_size_, k);
+    if (linked) {
+        if (!all_silent) {
+            plan_transport(main_spectra_, sidechain_spectra_, plan_, linked_sidechain_grouped_);
+            interpolate(plan_, main_spectra_, sidechain_spectra_, phases_[0], phase_window_, k,
+                        morphed_spectra_, workspaces_[0]);
+            linked_sidechain_grouped_ = true;
+            sidechain_grouped_[0] = false;
+            if (timer.active()) record_plan(instrumentation_, plan_);
+        }
+    } else {
+        for (int c = 0; c < num_channels_; c++) {
+            if (main_silent_[c] && sidechain_silent_[c]) continue;
+
+            interpolate_workspace& workspace = workspaces_[c];
+            workspace.reuse_right = sidechain_grouped_[c];
+            interpolate(main_spectra_[c], sidechain_spectra_[c], phases_[c], phase_window_, k,
+                        morphed_spectra_[c], workspace);
+            sidechain_grouped_[c] = true;
+            if (timer.active()) record_plan(instrumentation_, workspace.plan);
+        }
+    }
+    timer.lap(instrumentation::stage::interpolate);
 
-    // Synthesize output
-    std::vector<float> hop_output(hop_size_);
-    synthesizeWindow(morphed_spectrum, hop_output.data());
+    for (int c = 0; c < num_channels_; c++) {
+        // Synthesize output
+        bool silent = linked ? all_silent : main_silent_[c] && sidechain_silent_[c];
+        if (silent) {
+            emitHop(overlap_buffers_[c], hop_output_.data());
+        } else {
+            synthesizeWindow(morphed_spectra_[c], overlap_buffers_[c], hop_output_.data());
+        }
 
-    // Write to output buffer
-    for (int i = 0; i < hop_size_; i++) {
-        int write_idx = (output_read_pos_ + getLatencySamples() + i) % output_buffer_.size();
-        output_buffer_[write_idx] = hop_output[i];
+        // Write to output buffer
+        std::vector<float>& output_buffer = output_buffers_[c];
+        for (int i = 0; i < hop_size_; i++) {
+            int write_idx = (output_position + i) % output_buffer.size();
+            output_buffer[write_idx] = hop_output_[i];
+        }
     }
+    timer.lap(instrumentation::stage::synthesize);
+    timer.finish();
 }
 
-void RealtimeReassignmentTransport::process(
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::process(
     const float* input_main,
     const float* input_sidechain,
     float* output,
     int buffer_size,
     float k
 ) {
+    processChannels(&input_main, &input_sidechain, &output, 1, buffer_size, k, nullptr);
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::process(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    float k
+) {
+    processChannels(input_main, input_sidechain, output, num_channels, buffer_size, k, nullptr);
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::process(
+    const float* input_main,
+    const float* input_sidechain,
+    float* output,
+    int buffer_size,
+    const float* k
+) {
+    processChannels(&input_main, &input_sidechain, &output, 1, buffer_size, 0.0f, k);
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::process(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    const float* k
+) {
+    processChannels(input_main, input_sidechain, output, num_channels, buffer_size, 0.0f, k);
+}
+
+template <typename Real>
+void BasicRealtimeReassignmentTransport<Real>::processChannels(
+    const float* const* input_main,
+    const float* const* input_sidechain,
+    float* const* output,
+    int num_channels,
+    int buffer_size,
+    float k_value,
+    const float* k_samples
+) {
+    realtime_check::scope realtime;
+    denormals::scoped_flush_denormals flush;
+    instrumentation::block_timer block(instrumentation_);
+    assert(num_channels == num_channels_);
+
     int samples_processed = 0;
 
     while (samples_processed < buffer_size) {
@@ -231,37 +661,69 @@ void RealtimeReassignmentTransport::process(
         int samples_until_hop = hop_size_ - input_write_pos_;
         int samples_to_copy = std::min(samples_until_hop, buffer_size - samples_processed);
 
-        // Copy input samples to buffers
-        std::memcpy(main_buffer_.data() + window_samples_ - hop_size_ + input_write_pos_,
-                    input_main + samples_processed,
-                    samples_to_copy * sizeof(float));
-        std::memcpy(sidechain_buffer_.data() + window_samples_ - hop_size_ + input_write_pos_,
-                    input_sidechain + samples_processed,
-                    samples_to_copy * sizeof(float));
+        // Copy input samples to buffers, for every channel before any
+        // output is written over them (in-place processing)
+        for (int c = 0; c < num_channels; c++) {
+            std::memcpy(main_buffers_[c].data() + window_samples_ - hop_size_ + input_write_pos_,
+                        input_main[c] + samples_processed,
+                        samples_to_copy * sizeof(float));
+            std::memcpy(sidechain_buffers_[c].data() + window_samples_ - hop_size_ + input_write_pos_,
+                        input_sidechain[c] + samples_processed,
+                        samples_to_copy * sizeof(float));
+            main_gates_[c].push(input_main[c] + samples_processed, samples_to_copy,
+                                silence_threshold_);
+            sidechain_gates_[c].push(input_sidechain[c] + samples_processed, samples_to_copy,
+                                     silence_threshold_);
+        }
+        if (k_samples) {
+            k_history_.push(k_samples + samples_processed, samples_to_copy);
+        } else {
+            k_history_.fill(k_value, samples_to_copy);
+        }
 
         input_write_pos_ += samples_to_copy;
-        samples_processed += samples_to_copy;
 
-        // If we've filled a hop, process it
+        // If we've filled a hop, process it; its output starts at the
+        // slot of the chunk's last sample
+        int output_size = static_cast<int>(output_buffers_[0].size());
         if (input_write_pos_ >= hop_size_) {
-            processHop(k);
+            // A per-sample k is taken at the centre of the frame
+            // resynthesized, which ends at this sample
+            float k = k_samples ? k_history_.at((synthesis_samples_ - 1) / 2) : k_value;
+            processHop(k, (output_read_pos_ + samples_to_copy - 1) % output_size);
 
             // Shift input buffers
-            std::memmove(main_buffer_.data(), main_buffer_.data() + hop_size_,
-                        (main_buffer_.size() - hop_size_) * sizeof(float));
-            std::memmove(sidechain_buffer_.data(), sidechain_buffer_.data() + hop_size_,
-                        (sidechain_buffer_.size() - hop_size_) * sizeof(float));
-            std::fill(main_buffer_.end() - hop_size_, main_buffer_.end(), 0.0f);
-            std::fill(sidechain_buffer_.end() - hop_size_, sidechain_buffer_.end(), 0.0f);
+            for (int c = 0; c < num_channels; c++) {
+                for (std::vector<float>* buffer : { &main_buffers_[c], &sidechain_buffers_[c] }) {
+                    std::memmove(buffer->data(), buffer->data() + hop_size_,
+                                 (buffer->size() - hop_size_) * sizeof(float));
+                    std::fill(buffer->end() - hop_size_, buffer->end(), 0.0f);
+                }
+            }
 
             input_write_pos_ = 0;
         }
-    }
 
-    // Copy output samples
-    for (int i = 0; i < buffer_size; i++) {
-        output[i] = output_buffer_[output_read_pos_];
-        output_buffer_[output_read_pos_] = 0.0f;
-        output_read_pos_ = (output_read_pos_ + 1) % output_buffer_.size();
+        // Hand out and clear the chunk's output
+        for (int c = 0; c < num_channels; c++) {
+            std::vector<float>& output_buffer = output_buffers_[c];
+            float* out = output[c] + samples_processed;
+            int read_pos = output_read_pos_;
+            for (int i = 0; i < samples_to_copy; i++) {
+                out[i] = output_buffer[read_pos];
+                output_buffer[read_pos] = 0.0f;
+                read_pos = (read_pos + 1) % output_size;
+            }
+        }
+        output_read_pos_ = (output_read_pos_ + samples_to_copy) % output_size;
+        samples_processed += samples_to_copy;
     }
+    block.finish(buffer_size);
 }
+
+template class BasicRealtimeReassignmentTransport<double>;
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+template class BasicRealtimeReassignmentTransport<float>;
+#endif
+
+} // namespace audio_transport
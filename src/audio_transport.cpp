@@ -2,14 +2,118 @@
 #include <vector>
 #include <tuple>
 #include <map>
-#include <iostream>
+#include <algorithm>
+#include <functional>
 
 #include "audio_transport/spectral.hpp"
 #include "audio_transport/audio_transport.hpp"
+#include "audio_transport/vector_math.hpp"
+#include "audio_transport/diagnostics.hpp"
 
 // Minimum mass threshold to avoid division by zero/near-zero
 static const double MIN_MASS_THRESHOLD = 1e-10;
 
+void audio_transport::interpolate_workspace::reserve(size_t num_bins) {
+  // Every mass starts at a distinct bin and every transport
+  // step consumes a left or a right mass
+  plan.left_masses.reserve(num_bins);
+  plan.right_masses.reserve(num_bins);
+  plan.transport.reserve(2 * num_bins);
+  plan.ranked_masses.reserve(num_bins);
+  new_amplitudes.reserve(num_bins);
+  new_phases.reserve(num_bins);
+  left_magnitudes.reserve(num_bins);
+  left_phases.reserve(num_bins);
+  right_magnitudes.reserve(num_bins);
+  right_phases.reserve(num_bins);
+  rotated_phases.reserve(num_bins);
+  sines.reserve(num_bins);
+  cosines.reserve(num_bins);
+  left_frame.reserve(num_bins);
+  right_frame.reserve(num_bins);
+  output_frame.reserve(num_bins);
+}
+
+void audio_transport::transport_plan::reserve(size_t num_bins) {
+  left_masses.reserve(num_bins);
+  right_masses.reserve(num_bins);
+  transport.reserve(2 * num_bins);
+  ranked_masses.reserve(num_bins);
+  left.reserve(num_bins);
+  right.reserve(num_bins);
+  left_magnitudes.reserve(num_bins);
+  left_phases.reserve(num_bins);
+  right_magnitudes.reserve(num_bins);
+  right_phases.reserve(num_bins);
+}
+
+// Zero the NaN/Inf in values, reporting how many there were. Every
+// spectrum is sanitized once where it enters or leaves placement, so
+// the per-bin loops in between need no checks.
+static void sanitize(
+    std::vector<double> & values,
+    audio_transport::diagnostics::event type) {
+
+  size_t invalid = audio_transport::vector_math::sanitize(values.data(), values.size());
+  if (invalid) {
+    audio_transport::diagnostics::report(type, -1, static_cast<double>(invalid));
+  }
+}
+
+static void sanitize(
+    audio_transport::spectral::frame & frame,
+    audio_transport::diagnostics::event type) {
+
+  size_t invalid = audio_transport::vector_math::sanitize(frame.re.data(), frame.size())
+                 + audio_transport::vector_math::sanitize(frame.im.data(), frame.size());
+  if (invalid) {
+    audio_transport::diagnostics::report(type, -1, static_cast<double>(invalid));
+  }
+}
+
+// Convert a frame to polar form with the batched kernels
+static void to_polar(
+    const audio_transport::spectral::frame & spectrum,
+    std::vector<double> & magnitudes,
+    std::vector<double> & phases) {
+
+  size_t n = spectrum.size();
+  magnitudes.resize(n);
+  phases.resize(n);
+  audio_transport::vector_math::hypot(
+      spectrum.re.data(), spectrum.im.data(), magnitudes.data(), n);
+  audio_transport::vector_math::atan2(
+      spectrum.im.data(), spectrum.re.data(), phases.data(), n);
+  sanitize(magnitudes, audio_transport::diagnostics::event::invalid_magnitude);
+  sanitize(phases, audio_transport::diagnostics::event::invalid_bin_phase);
+}
+
+// Silence with the given bin frequencies
+static void clear_frame(
+    const audio_transport::aligned_vector<double> & freq,
+    audio_transport::spectral::frame & output) {
+
+  output.resize(freq.size());
+  output.time = 0;
+  std::fill(output.re.begin(), output.re.end(), 0.0);
+  std::fill(output.im.begin(), output.im.end(), 0.0);
+  std::fill(output.time_reassigned.begin(), output.time_reassigned.end(), 0.0);
+  std::fill(output.freq_reassigned.begin(), output.freq_reassigned.end(), 0.0);
+  std::copy(freq.begin(), freq.end(), output.freq.begin());
+}
+
+static void scale_frame(
+    const audio_transport::spectral::frame & input,
+    double scale,
+    audio_transport::spectral::frame & output) {
+
+  output = input;
+  for (size_t i = 0; i < output.size(); i++) {
+    output.re[i] *= scale;
+    output.im[i] *= scale;
+  }
+}
+
 std::vector<audio_transport::spectral::point> audio_transport::interpolate(
     const std::vector<audio_transport::spectral::point> & left,
     const std::vector<audio_transport::spectral::point> & right,
@@ -17,86 +121,167 @@ std::vector<audio_transport::spectral::point> audio_transport::interpolate(
     double window_size,
     double interpolation) {
 
-  // Check for silent inputs - if one side is silent, just scale the other
-  double left_mass_sum = 0, right_mass_sum = 0;
-  for (size_t i = 0; i < left.size(); i++) {
-    left_mass_sum += std::abs(left[i].value);
-  }
-  for (size_t i = 0; i < right.size(); i++) {
-    right_mass_sum += std::abs(right[i].value);
-  }
+  std::vector<audio_transport::spectral::point> output;
+  interpolate_workspace workspace;
+  interpolate(left, right, phases, window_size, interpolation, output, workspace);
+  return output;
+}
 
-  bool left_silent = (left_mass_sum < MIN_MASS_THRESHOLD);
-  bool right_silent = (right_mass_sum < MIN_MASS_THRESHOLD);
+void audio_transport::interpolate(
+    const std::vector<audio_transport::spectral::point> & left,
+    const std::vector<audio_transport::spectral::point> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    std::vector<audio_transport::spectral::point> & output,
+    interpolate_workspace & workspace) {
 
-  // Handle silent inputs by simple scaling instead of transport
-  if (left_silent && right_silent) {
-    // Both silent - return silence
-    std::vector<audio_transport::spectral::point> output(left.size());
-    for (size_t i = 0; i < left.size(); i++) {
-      output[i].freq = left[i].freq;
-      output[i].value = 0;
+  spectral::to_frame(left, workspace.left_frame);
+  spectral::to_frame(right, workspace.right_frame);
+  interpolate(workspace.left_frame, workspace.right_frame, phases,
+              window_size, interpolation, workspace.output_frame, workspace);
+  spectral::to_points(workspace.output_frame, output);
+}
+
+/**
+ * Keep the masses pruning asks for and merge each run of the others
+ * into one residual mass, in place. Masses of exactly the K-th
+ * largest value are kept in bin order until there are K.
+ */
+static void prune_masses(
+    const audio_transport::mass_pruning & pruning,
+    std::vector<audio_transport::spectral_mass> & masses,
+    std::vector<double> & ranked) {
+
+  // The lightest mass kept, and how many of exactly that may be
+  size_t max_masses = pruning.max_masses;
+  double lightest = pruning.min_mass;
+  size_t ties = masses.size();
+  if (max_masses > 0 && masses.size() > max_masses) {
+    ranked.clear();
+    for (const auto & m : masses) ranked.push_back(m.mass);
+    std::nth_element(ranked.begin(), ranked.begin() + (max_masses - 1), ranked.end(),
+                     std::greater<double>());
+    double kth = ranked[max_masses - 1];
+    if (kth >= lightest) {
+      lightest = kth;
+      ties = max_masses - std::count_if(ranked.begin(), ranked.begin() + (max_masses - 1),
+                                        [kth](double mass) { return mass > kth; });
     }
-    return output;
   }
 
-  if (left_silent) {
-    // Left is silent - just scale right by interpolation factor
-    std::vector<audio_transport::spectral::point> output(right.size());
-    for (size_t i = 0; i < right.size(); i++) {
-      output[i] = right[i];
-      output[i].value *= interpolation;
-    }
-    // Update phases from right side
-    for (size_t i = 0; i < phases.size() && i < right.size(); i++) {
-      double mag = std::abs(right[i].value);
-      if (mag > 0) {
-        phases[i] = std::arg(right[i].value) + right[i].freq_reassigned * window_size / 2.0;
+  size_t kept = 0;
+  bool residual = false;
+  double heaviest = 0;
+  for (size_t i = 0; i < masses.size(); i++) {
+    const audio_transport::spectral_mass m = masses[i];
+    bool keep = m.mass > lightest || (m.mass == lightest && ties > 0);
+    if (keep) {
+      if (m.mass == lightest) ties--;
+      masses[kept++] = m;
+      residual = false;
+    } else if (residual) {
+      audio_transport::spectral_mass & r = masses[kept - 1];
+      r.right_bin = m.right_bin;
+      r.mass += m.mass;
+      if (m.mass > heaviest) {
+        heaviest = m.mass;
+        r.center_bin = m.center_bin;
       }
+    } else {
+      masses[kept++] = m;
+      residual = true;
+      heaviest = m.mass;
     }
-    return output;
   }
+  masses.resize(kept);
+}
 
-  if (right_silent) {
-    // Right is silent - just scale left by (1 - interpolation factor)
-    std::vector<audio_transport::spectral::point> output(left.size());
-    for (size_t i = 0; i < left.size(); i++) {
-      output[i] = left[i];
-      output[i].value *= (1 - interpolation);
-    }
-    // Update phases from left side
-    for (size_t i = 0; i < phases.size() && i < left.size(); i++) {
-      double mag = std::abs(left[i].value);
-      if (mag > 0) {
-        phases[i] = std::arg(left[i].value) + left[i].freq_reassigned * window_size / 2.0;
-      }
-    }
-    return output;
+// Group both spectra, flag silent sides and, if neither is, compute
+// the transport matrix between them. Unless group_right is set the
+// right masses and silence are the plan's from last time.
+static void make_plan(
+    const audio_transport::spectral::frame & left,
+    const std::vector<double> & left_magnitudes,
+    const audio_transport::spectral::frame & right,
+    const std::vector<double> & right_magnitudes,
+    bool group_right,
+    audio_transport::transport_plan & plan) {
+
+  // Group the left and right spectra; the same pass gives their totals
+  double left_mass_sum = audio_transport::group_spectrum(
+      left_magnitudes.data(), left.freq.data(), left.freq_reassigned.data(),
+      left.size(), plan.left_masses);
+  plan.left_grouped = plan.left_masses.size();
+  if (plan.pruning.enabled()) prune_masses(plan.pruning, plan.left_masses, plan.ranked_masses);
+  if (group_right) {
+    double right_mass_sum = audio_transport::group_spectrum(
+        right_magnitudes.data(), right.freq.data(), right.freq_reassigned.data(),
+        right.size(), plan.right_masses);
+    plan.right_silent = (right_mass_sum < MIN_MASS_THRESHOLD);
+    plan.right_grouped = plan.right_masses.size();
+    if (plan.pruning.enabled()) prune_masses(plan.pruning, plan.right_masses, plan.ranked_masses);
   }
 
-  // Both sides have content - proceed with normal transport
-  // Group the left and right spectra
-  std::vector<spectral_mass> left_masses = group_spectrum(left);
-  std::vector<spectral_mass> right_masses = group_spectrum(right);
+  // Check for silent inputs - if one side is silent, just scale the other
+  plan.left_silent = (left_mass_sum < MIN_MASS_THRESHOLD);
+  if (plan.left_silent || plan.right_silent) return;
 
-  // Get the transport matrix
-  std::vector<std::tuple<size_t, size_t, double>> T =
-    transport_matrix(left_masses, right_masses);
+  // Both sides have content - get the transport matrix
+  audio_transport::transport_matrix(plan.left_masses, plan.right_masses, plan.transport);
+}
 
-  // Initialize the output spectral masses
-  std::vector<audio_transport::spectral::point> interpolated(left.size());
-  for (unsigned int i = 0; i < left.size(); i++) {
-    interpolated[i].freq = left[i].freq;
+// Phases of a silent transition follow the side that has content
+static void follow_phases(
+    const double * freq_reassigned,
+    const std::vector<double> & magnitudes,
+    const std::vector<double> & spectrum_phases,
+    double window_size,
+    std::vector<double> & phases) {
+
+  for (size_t i = 0; i < phases.size() && i < magnitudes.size(); i++) {
+    if (magnitudes[i] > 0) {
+      phases[i] = spectrum_phases[i] + freq_reassigned[i] * window_size / 2.0;
+    }
   }
+}
 
-  // Initialize new phases
-  std::vector<double> new_amplitudes(phases.size(), 0);
-  std::vector<double> new_phases(phases.size(), 0);
+/**
+ * Place one channel's masses along a plan into output, which must
+ * already be cleared. plan_left_freq and plan_right_freq are the
+ * reassigned frequencies of the spectra the plan was grouped on.
+ * When those are not the channel's own, their phases are passed in
+ * plan_*_phases so every channel gets the same rotation. The phases
+ * the next frame needs are collected in the workspace's new_phases
+ * and new_amplitudes.
+ */
+static void place_masses(
+    const audio_transport::transport_plan & plan,
+    const double * plan_left_freq,
+    const double * plan_right_freq,
+    const std::vector<double> * plan_left_phases,
+    const std::vector<double> * plan_right_phases,
+    const std::vector<double> & left_magnitudes,
+    const std::vector<double> & left_phases,
+    const std::vector<double> & right_magnitudes,
+    const std::vector<double> & right_phases,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    audio_transport::spectral::frame & interpolated,
+    audio_transport::interpolate_workspace & workspace) {
+
+  std::vector<double> & new_amplitudes = workspace.new_amplitudes;
+  std::vector<double> & new_phases = workspace.new_phases;
+
+  // Validate the phases carried from the previous window to prevent
+  // NaN propagation
+  sanitize(phases, audio_transport::diagnostics::event::invalid_phase);
 
   // Perform the interpolation
-  for (auto t : T) {
-    spectral_mass left_mass  =  left_masses[std::get<0>(t)];
-    spectral_mass right_mass = right_masses[std::get<1>(t)];
+  for (const auto & t : plan.transport) {
+    audio_transport::spectral_mass left_mass  =  plan.left_masses[std::get<0>(t)];
+    audio_transport::spectral_mass right_mass = plan.right_masses[std::get<1>(t)];
 
     // Calculate the new bin and frequency
     int interpolated_bin = std::round(
@@ -113,15 +298,8 @@ std::vector<audio_transport::spectral::point> audio_transport::interpolate(
     }
     // Interpolate the frequency appropriately
     double interpolated_freq = 
-      (1 - interpolation_rounded) * left[left_mass.center_bin].freq_reassigned +
-      interpolation_rounded * right[right_mass.center_bin].freq_reassigned;
-
-    // Validate phases input to prevent NaN propagation from previous windows
-    if (!std::isfinite(phases[interpolated_bin])) {
-      std::cerr << "[audio_transport] Warning: Invalid phase at bin " << interpolated_bin
-                << ", resetting to 0" << std::endl;
-      phases[interpolated_bin] = 0;
-    }
+      (1 - interpolation_rounded) * plan_left_freq[left_mass.center_bin] +
+      interpolation_rounded * plan_right_freq[right_mass.center_bin];
 
     double center_phase =
       phases[interpolated_bin] + (interpolated_freq * window_size/2.)/2. - (M_PI * interpolated_bin);
@@ -131,6 +309,19 @@ std::vector<audio_transport::spectral::point> audio_transport::interpolate(
     // Uncomment this for HORIZONTAL INCOHERENCE
     // center_phase = std::arg(left[interpolated_bin].value);
 
+    // place_mass puts the mass's center bin at center_phase; keep this
+    // channel's offset from the plan's spectrum instead
+    double left_center_phase = center_phase;
+    double right_center_phase = center_phase;
+    if (plan_left_phases) {
+      left_center_phase += left_phases[left_mass.center_bin]
+                         - (*plan_left_phases)[left_mass.center_bin];
+    }
+    if (plan_right_phases) {
+      right_center_phase += right_phases[right_mass.center_bin]
+                          - (*plan_right_phases)[right_mass.center_bin];
+    }
+
     // Place the left and right masses
     // Guard against division by zero/near-zero mass
     double left_scale = 0;
@@ -139,56 +330,305 @@ std::vector<audio_transport::spectral::point> audio_transport::interpolate(
     if (left_mass.mass > MIN_MASS_THRESHOLD) {
       left_scale = (1 - interpolation) * std::get<2>(t) / left_mass.mass;
     } else if (left_mass.mass > 0) {
-      // Very small mass - log warning and clamp scale
-      std::cerr << "[audio_transport] Warning: Very small left_mass.mass = "
-                << left_mass.mass << " at bin " << left_mass.center_bin
-                << ", clamping scale" << std::endl;
+      // Very small mass - report and clamp scale
+      audio_transport::diagnostics::report(
+          audio_transport::diagnostics::event::small_mass, left_mass.center_bin, left_mass.mass, 0);
       left_scale = (1 - interpolation);  // Use transport mass directly as scale
     }
 
     if (right_mass.mass > MIN_MASS_THRESHOLD) {
       right_scale = interpolation * std::get<2>(t) / right_mass.mass;
     } else if (right_mass.mass > 0) {
-      // Very small mass - log warning and clamp scale
-      std::cerr << "[audio_transport] Warning: Very small right_mass.mass = "
-                << right_mass.mass << " at bin " << right_mass.center_bin
-                << ", clamping scale" << std::endl;
+      // Very small mass - report and clamp scale
+      audio_transport::diagnostics::report(
+          audio_transport::diagnostics::event::small_mass, right_mass.center_bin, right_mass.mass, 1);
       right_scale = interpolation;  // Use transport mass directly as scale
     }
 
-    place_mass(
+    audio_transport::place_mass(
         left_mass,
         interpolated_bin,
         left_scale,
         interpolated_freq,
-        center_phase,
-        left,
+        left_center_phase,
+        left_magnitudes,
+        left_phases,
         interpolated,
         new_phase,
         new_phases,
-        new_amplitudes
+        new_amplitudes,
+        workspace
         );
-    place_mass(
+    audio_transport::place_mass(
         right_mass,
         interpolated_bin,
         right_scale,
         interpolated_freq,
-        center_phase,
-        right,
+        right_center_phase,
+        right_magnitudes,
+        right_phases,
         interpolated,
         new_phase,
         new_phases,
-        new_amplitudes
+        new_amplitudes,
+        workspace
         );
 
   }
 
+  // Overflowing bins of the placed spectrum never reach synthesis
+  sanitize(interpolated, audio_transport::diagnostics::event::invalid_magnitude);
+}
+
+void audio_transport::interpolate(
+    const audio_transport::spectral::frame & left,
+    const audio_transport::spectral::frame & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    audio_transport::spectral::frame & output,
+    interpolate_workspace & workspace) {
+
+  std::vector<double> & left_magnitudes = workspace.left_magnitudes;
+  std::vector<double> & left_phases = workspace.left_phases;
+  std::vector<double> & right_magnitudes = workspace.right_magnitudes;
+  std::vector<double> & right_phases = workspace.right_phases;
+  to_polar(left, left_magnitudes, left_phases);
+  if (!workspace.reuse_right) {
+    to_polar(right, right_magnitudes, right_phases);
+  }
+
+  transport_plan & plan = workspace.plan;
+  make_plan(left, left_magnitudes, right, right_magnitudes, !workspace.reuse_right, plan);
+
+  // Handle silent inputs by simple scaling instead of transport
+  if (plan.left_silent && plan.right_silent) {
+    // Both silent - return silence
+    clear_frame(left.freq, output);
+    return;
+  }
+
+  if (plan.left_silent) {
+    // Left is silent - just scale right by interpolation factor
+    scale_frame(right, interpolation, output);
+    follow_phases(right.freq_reassigned.data(), right_magnitudes, right_phases, window_size, phases);
+    return;
+  }
+
+  if (plan.right_silent) {
+    // Right is silent - just scale left by (1 - interpolation factor)
+    scale_frame(left, 1 - interpolation, output);
+    follow_phases(left.freq_reassigned.data(), left_magnitudes, left_phases, window_size, phases);
+    return;
+  }
+
+  // Initialize the output spectral masses
+  clear_frame(left.freq, output);
+
+  // Initialize new phases
+  workspace.new_amplitudes.assign(phases.size(), 0);
+  workspace.new_phases.assign(phases.size(), 0);
+
+  place_masses(plan, left.freq_reassigned.data(), right.freq_reassigned.data(), nullptr, nullptr,
+               left_magnitudes, left_phases, right_magnitudes, right_phases,
+               phases, window_size, interpolation, output, workspace);
+
   // Fill the phases with the new phases
   for (size_t i = 0; i < phases.size(); i++) {
-    phases[i] = new_phases[i];
+    phases[i] = workspace.new_phases[i];
+  }
+}
+
+// Sum the channels into the spectrum a linked plan is grouped on
+static void combine_channels(
+    const std::vector<audio_transport::spectral::frame> & channels,
+    audio_transport::spectral::frame & combined,
+    std::vector<double> & magnitudes,
+    std::vector<double> & phases) {
+
+  const audio_transport::spectral::frame & first = channels[0];
+  size_t n = first.size();
+  combined.resize(n);
+  combined.time = first.time;
+  std::copy(first.freq.begin(), first.freq.end(), combined.freq.begin());
+  std::fill(combined.re.begin(), combined.re.end(), 0.0);
+  std::fill(combined.im.begin(), combined.im.end(), 0.0);
+  std::fill(combined.time_reassigned.begin(), combined.time_reassigned.end(), 0.0);
+  std::fill(combined.freq_reassigned.begin(), combined.freq_reassigned.end(), 0.0);
+  magnitudes.assign(n, 0.0);
+
+  // Reassigned times and frequencies are weighted by magnitude so a
+  // loud channel decides where the mass boundaries fall. phases holds
+  // each channel's magnitudes until the end
+  std::vector<double> & channel_magnitudes = phases;
+  channel_magnitudes.resize(n);
+  for (const auto & channel : channels) {
+    audio_transport::vector_math::hypot(
+        channel.re.data(), channel.im.data(), channel_magnitudes.data(), n);
+    for (size_t i = 0; i < n; i++) {
+      double magnitude = channel_magnitudes[i];
+      combined.re[i] += channel.re[i];
+      combined.im[i] += channel.im[i];
+      combined.time_reassigned[i] += magnitude * channel.time_reassigned[i];
+      combined.freq_reassigned[i] += magnitude * channel.freq_reassigned[i];
+      magnitudes[i] += magnitude;
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    if (magnitudes[i] > 0) {
+      combined.time_reassigned[i] /= magnitudes[i];
+      combined.freq_reassigned[i] /= magnitudes[i];
+    } else {
+      combined.time_reassigned[i] = first.time;
+      combined.freq_reassigned[i] = first.freq[i];
+    }
   }
 
-  return interpolated;
+  phases.resize(n);
+  audio_transport::vector_math::atan2(
+      combined.im.data(), combined.re.data(), phases.data(), n);
+  sanitize(magnitudes, audio_transport::diagnostics::event::invalid_magnitude);
+  sanitize(phases, audio_transport::diagnostics::event::invalid_bin_phase);
+}
+
+void audio_transport::plan_transport(
+    const std::vector<audio_transport::spectral::frame> & left,
+    const std::vector<audio_transport::spectral::frame> & right,
+    transport_plan & plan,
+    bool reuse_right) {
+
+  combine_channels(left, plan.left, plan.left_magnitudes, plan.left_phases);
+  if (!reuse_right) {
+    combine_channels(right, plan.right, plan.right_magnitudes, plan.right_phases);
+  }
+  make_plan(plan.left, plan.left_magnitudes, plan.right, plan.right_magnitudes,
+            !reuse_right, plan);
+}
+
+void audio_transport::interpolate(
+    const transport_plan & plan,
+    const std::vector<audio_transport::spectral::frame> & left,
+    const std::vector<audio_transport::spectral::frame> & right,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    std::vector<audio_transport::spectral::frame> & output,
+    interpolate_workspace & workspace) {
+
+  size_t num_channels = left.size();
+
+  // A silent side is silent on every channel
+  if (plan.left_silent || plan.right_silent) {
+    for (size_t c = 0; c < num_channels; c++) {
+      if (plan.left_silent && plan.right_silent) {
+        clear_frame(left[c].freq, output[c]);
+      } else if (plan.left_silent) {
+        scale_frame(right[c], interpolation, output[c]);
+      } else {
+        scale_frame(left[c], 1 - interpolation, output[c]);
+      }
+    }
+    if (plan.left_silent && !plan.right_silent) {
+      follow_phases(plan.right.freq_reassigned.data(), plan.right_magnitudes, plan.right_phases, window_size, phases);
+    } else if (plan.right_silent && !plan.left_silent) {
+      follow_phases(plan.left.freq_reassigned.data(), plan.left_magnitudes, plan.left_phases, window_size, phases);
+    }
+    return;
+  }
+
+  // The channels share the phases, so each bin keeps the phase of
+  // whichever channel placed the most energy there
+  workspace.new_amplitudes.assign(phases.size(), 0);
+  workspace.new_phases.assign(phases.size(), 0);
+
+  for (size_t c = 0; c < num_channels; c++) {
+    to_polar(left[c], workspace.left_magnitudes, workspace.left_phases);
+    to_polar(right[c], workspace.right_magnitudes, workspace.right_phases);
+
+    clear_frame(left[c].freq, output[c]);
+    place_masses(plan, plan.left.freq_reassigned.data(), plan.right.freq_reassigned.data(),
+                 &plan.left_phases, &plan.right_phases,
+                 workspace.left_magnitudes, workspace.left_phases,
+                 workspace.right_magnitudes, workspace.right_phases,
+                 phases, window_size, interpolation, output[c], workspace);
+  }
+
+  for (size_t i = 0; i < phases.size(); i++) {
+    phases[i] = workspace.new_phases[i];
+  }
+}
+
+// scale times spectrum, rebuilt from its polar form
+static void scale_polar(
+    const audio_transport::polar_frame & spectrum,
+    const audio_transport::aligned_vector<double> & freq,
+    double scale,
+    audio_transport::spectral::frame & output) {
+
+  clear_frame(freq, output);
+  for (size_t i = 0; i < output.size(); i++) {
+    double magnitude = scale * spectrum.magnitudes[i];
+    output.re[i] = magnitude * std::cos(spectrum.phases[i]);
+    output.im[i] = magnitude * std::sin(spectrum.phases[i]);
+    output.freq_reassigned[i] = spectrum.freq_reassigned[i];
+  }
+}
+
+void audio_transport::plan_transport(
+    const audio_transport::spectral::frame & left,
+    const audio_transport::spectral::frame & right,
+    transport_plan & plan,
+    polar_frame & left_polar,
+    polar_frame & right_polar) {
+
+  to_polar(left, left_polar.magnitudes, left_polar.phases);
+  to_polar(right, right_polar.magnitudes, right_polar.phases);
+  left_polar.freq_reassigned.assign(left.freq_reassigned.begin(), left.freq_reassigned.end());
+  right_polar.freq_reassigned.assign(right.freq_reassigned.begin(), right.freq_reassigned.end());
+  make_plan(left, left_polar.magnitudes, right, right_polar.magnitudes, true, plan);
+}
+
+void audio_transport::interpolate(
+    const transport_plan & plan,
+    const polar_frame & left,
+    const aligned_vector<double> & left_freq,
+    const polar_frame & right,
+    const aligned_vector<double> & right_freq,
+    std::vector<double> & phases,
+    double window_size,
+    double interpolation,
+    audio_transport::spectral::frame & output,
+    interpolate_workspace & workspace) {
+
+  if (plan.left_silent && plan.right_silent) {
+    clear_frame(left_freq, output);
+    return;
+  }
+
+  if (plan.left_silent) {
+    scale_polar(right, right_freq, interpolation, output);
+    follow_phases(right.freq_reassigned.data(), right.magnitudes, right.phases, window_size, phases);
+    return;
+  }
+
+  if (plan.right_silent) {
+    scale_polar(left, left_freq, 1 - interpolation, output);
+    follow_phases(left.freq_reassigned.data(), left.magnitudes, left.phases, window_size, phases);
+    return;
+  }
+
+  clear_frame(left_freq, output);
+  workspace.new_amplitudes.assign(phases.size(), 0);
+  workspace.new_phases.assign(phases.size(), 0);
+
+  place_masses(plan, left.freq_reassigned.data(), right.freq_reassigned.data(), nullptr, nullptr,
+               left.magnitudes, left.phases, right.magnitudes, right.phases,
+               phases, window_size, interpolation, output, workspace);
+
+  for (size_t i = 0; i < phases.size(); i++) {
+    phases[i] = workspace.new_phases[i];
+  }
 }
 
 void audio_transport::place_mass(
@@ -203,17 +643,48 @@ void audio_transport::place_mass(
     std::vector<double> & phases,
     std::vector<double> & amplitudes) {
 
+  interpolate_workspace workspace;
+  spectral::frame input_frame, output_frame;
+  std::vector<double> input_magnitudes, input_phases;
+  spectral::to_frame(input, input_frame);
+  spectral::to_frame(output, output_frame);
+  to_polar(input_frame, input_magnitudes, input_phases);
+  place_mass(mass, center_bin, scale, interpolated_freq, center_phase,
+             input_magnitudes, input_phases, output_frame, next_phase,
+             phases, amplitudes, workspace);
+
+  // Write back only what place_mass changes so per-point times survive
+  for (size_t i = 0; i < output.size(); i++) {
+    output[i].value = output_frame.value(i);
+    output[i].freq_reassigned = output_frame.freq_reassigned[i];
+  }
+}
+
+void audio_transport::place_mass(
+    const spectral_mass & mass,
+    int center_bin,
+    double scale,
+    double interpolated_freq,
+    double center_phase,
+    const std::vector<double> & input_magnitudes,
+    const std::vector<double> & input_phases,
+    audio_transport::spectral::frame & output,
+    double next_phase,
+    std::vector<double> & phases,
+    std::vector<double> & amplitudes,
+    interpolate_workspace & workspace) {
+
   // Validate scale to prevent NaN/Inf propagation
   if (!std::isfinite(scale) || scale < 0) {
-    std::cerr << "[audio_transport] Warning: Invalid scale = " << scale
-              << " at center_bin = " << center_bin << ", skipping mass placement" << std::endl;
+    audio_transport::diagnostics::report(
+        audio_transport::diagnostics::event::invalid_scale, center_bin, scale);
     return;
   }
 
   // Validate interpolated_freq
   if (!std::isfinite(interpolated_freq)) {
-    std::cerr << "[audio_transport] Warning: Invalid interpolated_freq = " << interpolated_freq
-              << " at center_bin = " << center_bin << ", skipping mass placement" << std::endl;
+    audio_transport::diagnostics::report(
+        audio_transport::diagnostics::event::invalid_frequency, center_bin, interpolated_freq);
     return;
   }
 
@@ -226,60 +697,71 @@ void audio_transport::place_mass(
     attenuation = attenuation * attenuation;  // Squared for smoother rolloff
     scale *= attenuation;
 
-    // Only log if we're significantly attenuating (to reduce spam)
+    // Only report if we're significantly attenuating (to reduce spam)
     if (attenuation < 0.5 && scale > 0.001) {
-      std::cerr << "[audio_transport] Attenuating low freq: " << interpolated_freq
-                << " Hz, attenuation = " << attenuation << std::endl;
+      audio_transport::diagnostics::report(
+          audio_transport::diagnostics::event::low_frequency, center_bin, interpolated_freq, attenuation);
     }
   }
 
   // Compute how the phase changes in each bin
-  double phase_shift = center_phase - std::arg(input[mass.center_bin].value);
+  double phase_shift = center_phase - input_phases[mass.center_bin];
 
   // Validate phase_shift to prevent NaN propagation
   if (!std::isfinite(phase_shift)) {
-    std::cerr << "[audio_transport] Warning: Invalid phase_shift = " << phase_shift
-              << " at center_bin = " << center_bin << ", skipping mass placement" << std::endl;
+    audio_transport::diagnostics::report(
+        audio_transport::diagnostics::event::invalid_phase_shift, center_bin, phase_shift);
     return;
   }
 
-  for (size_t i = mass.left_bin; i < mass.right_bin; i++) {
-    // Compute the location in the new array
-    int new_i = i + center_bin - mass.center_bin;
-    if (new_i < 0) continue;
-    if (new_i >= (int) output.size()) continue;
-
-    // Rotate the output by the phase offset
-    // plus the frequency
-    double phase = phase_shift + std::arg(input[i].value);
-    double mag = scale * std::abs(input[i].value);
-
-    // Skip if magnitude is invalid
-    if (!std::isfinite(mag)) {
-      std::cerr << "[audio_transport] Warning: Invalid magnitude = " << mag
-                << " at bin " << new_i << ", skipping" << std::endl;
-      continue;
-    }
-
-    // Skip if phase is invalid
-    if (!std::isfinite(phase)) {
-      std::cerr << "[audio_transport] Warning: Invalid phase = " << phase
-                << " at bin " << new_i << ", skipping" << std::endl;
-      continue;
-    }
+  // next_phase is stored for every bin the mass is loudest in, so check
+  // it once here rather than in the loop
+  bool store_phase = std::isfinite(next_phase);
+  if (!store_phase) {
+    audio_transport::diagnostics::report(
+        audio_transport::diagnostics::event::invalid_next_phase, center_bin, next_phase);
+  }
 
-    output[new_i].value += std::polar(mag, phase);
+  // Clip the bin range to bins that land inside the output
+  long offset = (long) center_bin - (long) mass.center_bin;
+  long begin = std::max((long) mass.left_bin, -offset);
+  long end = std::min((long) mass.right_bin, (long) output.size() - offset);
+  if (begin >= end) return;
+  size_t count = end - begin;
+
+  // Rotate the output by the phase offset
+  // plus the frequency
+  std::vector<double> & rotated = workspace.rotated_phases;
+  rotated.resize(count);
+  for (size_t k = 0; k < count; k++) {
+    rotated[k] = phase_shift + input_phases[begin + k];
+  }
+  workspace.sines.resize(count);
+  workspace.cosines.resize(count);
+  audio_transport::vector_math::sincos(
+      rotated.data(), workspace.sines.data(), workspace.cosines.data(), count);
+
+  // Magnitudes and phases were sanitized in polar form and scale and
+  // phase_shift checked above, so every bin is finite here
+  const double * magnitudes = input_magnitudes.data() + begin;
+  double * re = output.re.data() + (begin + offset);
+  double * im = output.im.data() + (begin + offset);
+  for (size_t k = 0; k < count; k++) {
+    double mag = scale * magnitudes[k];
+    re[k] += mag * workspace.cosines[k];
+    im[k] += mag * workspace.sines[k];
+  }
 
+  // Each bin keeps the phase and frequency of the loudest mass in it
+  for (size_t k = 0; k < count; k++) {
+    size_t new_i = begin + offset + k;
+    double mag = scale * magnitudes[k];
     if (mag > amplitudes[new_i]) {
       amplitudes[new_i] = mag;
-      // Validate next_phase before storing to prevent NaN propagation
-      if (std::isfinite(next_phase)) {
+      if (store_phase) {
         phases[new_i] = next_phase;
-      } else {
-        std::cerr << "[audio_transport] Warning: Invalid next_phase = " << next_phase
-                  << " at bin " << new_i << ", keeping previous phase" << std::endl;
       }
-      output[new_i].freq_reassigned = interpolated_freq;
+      output.freq_reassigned[new_i] = interpolated_freq;
     }
   }
 }
@@ -288,8 +770,20 @@ std::vector<std::tuple<size_t, size_t, double>> audio_transport::transport_matri
     const std::vector<audio_transport::spectral_mass> & left,
     const std::vector<audio_transport::spectral_mass> & right) {
 
-  // Initialize the algorithm
   std::vector<std::tuple<size_t, size_t, double>> T;
+  transport_matrix(left, right, T);
+  return T;
+}
+
+void audio_transport::transport_matrix(
+    const std::vector<audio_transport::spectral_mass> & left,
+    const std::vector<audio_transport::spectral_mass> & right,
+    std::vector<std::tuple<size_t, size_t, double>> & T) {
+
+  // Initialize the algorithm
+  // Each step consumes a left or a right mass, and the last consumes both
+  T.clear();
+  T.reserve(left.size() + right.size() - 1);
   size_t left_index = 0, right_index = 0;
   double left_mass  = left[0].mass;
   double right_mass = right[0].mass;
@@ -319,106 +813,163 @@ std::vector<std::tuple<size_t, size_t, double>> audio_transport::transport_matri
       right_mass = right[right_index].mass;
     }
   }
-
-  return T;
 }
 
 std::vector<audio_transport::spectral_mass> audio_transport::group_spectrum(
    const std::vector<audio_transport::spectral::point> & spectrum
    ) {
 
-  // Keep track of the total mass
-  double mass_sum = 0;
-  for (size_t i = 0; i < spectrum.size(); i++) {
-    mass_sum += std::abs(spectrum[i].value);
-  }
+  std::vector<spectral_mass> masses;
+  group_spectrum(spectrum, masses);
+  return masses;
+}
 
-  // Guard against silent/near-silent spectrum
-  if (mass_sum < MIN_MASS_THRESHOLD) {
-    std::cerr << "[audio_transport] Warning: Near-silent spectrum detected (mass_sum = "
-              << mass_sum << "), returning single mass covering entire spectrum" << std::endl;
-    // Return a single mass covering the entire spectrum with uniform distribution
-    spectral_mass single_mass;
-    single_mass.left_bin = 0;
-    single_mass.center_bin = spectrum.size() / 2;
-    single_mass.right_bin = spectrum.size();
-    single_mass.mass = 1.0;  // Full normalized mass
-    return {single_mass};
-  }
+// Read-only views giving group_masses the fields it scans
+namespace {
+
+struct point_view {
+  const std::vector<audio_transport::spectral::point> & points;
+
+  size_t size() const { return points.size(); }
+  double magnitude(size_t i) const { return std::abs(points[i].value); }
+  double freq(size_t i) const { return points[i].freq; }
+  double freq_reassigned(size_t i) const { return points[i].freq_reassigned; }
+};
+
+struct frame_view {
+  const double * freqs;
+  const double * freqs_reassigned;
+  const double * magnitudes;
+  size_t num_bins;
+
+  size_t size() const { return num_bins; }
+  double magnitude(size_t i) const { return magnitudes[i]; }
+  double freq(size_t i) const { return freqs[i]; }
+  double freq_reassigned(size_t i) const { return freqs_reassigned[i]; }
+};
+
+}
+
+/**
+ * One pass over the bins: split at the sign changes of the frequency
+ * reassignment, summing each mass and the total as it goes, then
+ * normalise. Every sum runs in bin order from zero, so the masses are
+ * the same to the bit as summing each range separately.
+ */
+template <typename Spectrum>
+static double group_masses(
+   const Spectrum & spectrum,
+   std::vector<audio_transport::spectral_mass> & masses
+   ) {
+
+  masses.clear();
 
   // Initialize the first mass
-  std::vector<spectral_mass> masses;
   audio_transport::spectral_mass initial_mass;
   initial_mass.left_bin = 0;
   initial_mass.center_bin = 0;
   masses.push_back(initial_mass);
 
-  bool sign;
-  bool first = true;
+  // The total and the mass since the current left bin
+  double mass_sum = 0;
+  double mass = 0;
+
+  bool sign = false;
   for (size_t i = 0; i < spectrum.size(); i++) {
-    bool current_sign = (spectrum[i].freq_reassigned > spectrum[i].freq);
+    bool current_sign = (spectrum.freq_reassigned(i) > spectrum.freq(i));
 
     // Uncomment this for VERTICAL INCOHERENCE
-    //sign = false;
     //current_sign = not sign;
 
-    if (first) {
-      first = false;
-      sign = current_sign;
-      continue;
-    }
-
-    if (current_sign == sign) continue;
-
-    if (sign) {
-      // We are falling 
-      // This is the center bin
-      // Choose the one closest to the right
-
-      // These should both be positive
-      double left_dist = spectrum[i - 1].freq_reassigned - spectrum[i - 1].freq;
-      double right_dist = spectrum[i].freq - spectrum[i].freq_reassigned;
-
-      // Go to the closer side
-      if (left_dist < right_dist) {
-        masses[masses.size() - 1].center_bin = i - 1;
-      } else {
-        masses[masses.size() - 1].center_bin = i;
-      }
-    } else {
-      // We are rising
-      // This is the end
-
-      // Compute the actual mass
-      masses[masses.size() - 1].mass = 0;
-      for (size_t j = masses[masses.size() - 1].left_bin; j < i; j++) {
-        masses[masses.size() - 1].mass += std::abs(spectrum[j].value);
-      }
-
-      if (masses[masses.size() - 1].mass > 0) {
-        // Normalize
-        masses[masses.size() - 1].mass /= mass_sum;
-
-        // Set the end of the mass
-        masses[masses.size() - 1].right_bin = i;
+    if (i > 0 && current_sign != sign) {
+      audio_transport::spectral_mass & last = masses.back();
+      if (sign) {
+        // We are falling 
+        // This is the center bin
+        // Choose the one closest to the right
+
+        // These should both be positive
+        double left_dist = spectrum.freq_reassigned(i - 1) - spectrum.freq(i - 1);
+        double right_dist = spectrum.freq(i) - spectrum.freq_reassigned(i);
+
+        // Go to the closer side
+        if (left_dist < right_dist) {
+          last.center_bin = i - 1;
+        } else {
+          last.center_bin = i;
+        }
+      } else if (mass > 0) {
+        // We are rising
+        // This is the end of the mass
+        last.mass = mass;
+        last.right_bin = i;
 
         // Construct a new mass
-        spectral_mass mass;
-        mass.left_bin = i;
-        mass.center_bin = i;
-        masses.push_back(mass);
+        audio_transport::spectral_mass next;
+        next.left_bin = i;
+        next.center_bin = i;
+        masses.push_back(next);
+        mass = 0;
       }
     }
     sign = current_sign;
+
+    double magnitude = spectrum.magnitude(i);
+    mass += magnitude;
+    mass_sum += magnitude;
+  }
+
+  // Guard against silent/near-silent spectrum
+  if (mass_sum < MIN_MASS_THRESHOLD) {
+    // A single mass covering the entire spectrum with uniform distribution
+    masses.resize(1);
+    masses[0].left_bin = 0;
+    masses[0].center_bin = spectrum.size() / 2;
+    masses[0].right_bin = spectrum.size();
+    masses[0].mass = 1.0;  // Full normalized mass
+    return mass_sum;
   }
 
   // Finish the last mass
-  masses[masses.size() - 1].right_bin = spectrum.size();
-  masses[masses.size() - 1].mass = 0;
-  for (size_t j = masses[masses.size() - 1].left_bin; j < spectrum.size(); j++) {
-    masses[masses.size() - 1].mass += std::abs(spectrum[j].value);
+  masses.back().right_bin = spectrum.size();
+  masses.back().mass = mass;
+
+  // Normalize
+  for (size_t m = 0; m < masses.size(); m++) {
+    masses[m].mass /= mass_sum;
   }
-  masses[masses.size() - 1].mass /= mass_sum;
+  return mass_sum;
+}
 
-  return masses;
-} 
+static void warn_if_silent(double mass_sum) {
+  if (mass_sum < MIN_MASS_THRESHOLD) {
+    audio_transport::diagnostics::report(
+        audio_transport::diagnostics::event::near_silent_spectrum, -1, mass_sum);
+  }
+}
+
+void audio_transport::group_spectrum(
+   const std::vector<audio_transport::spectral::point> & spectrum,
+   std::vector<audio_transport::spectral_mass> & masses
+   ) {
+  warn_if_silent(group_masses(point_view{spectrum}, masses));
+}
+
+void audio_transport::group_spectrum(
+   const audio_transport::spectral::frame & spectrum,
+   const std::vector<double> & magnitudes,
+   std::vector<audio_transport::spectral_mass> & masses
+   ) {
+  warn_if_silent(group_masses(frame_view{spectrum.freq.data(), spectrum.freq_reassigned.data(),
+                                         magnitudes.data(), spectrum.size()}, masses));
+}
+
+double audio_transport::group_spectrum(
+   const double * magnitudes,
+   const double * freq,
+   const double * freq_reassigned,
+   size_t num_bins,
+   std::vector<audio_transport::spectral_mass> & masses
+   ) {
+  return group_masses(frame_view{freq, freq_reassigned, magnitudes, num_bins}, masses);
+}
@@ -0,0 +1,64 @@
+#include "audio_transport/denormals.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define AUDIO_TRANSPORT_DENORMALS_MXCSR
+#elif defined(__aarch64__)
+#define AUDIO_TRANSPORT_DENORMALS_FPCR
+#endif
+
+namespace audio_transport {
+namespace denormals {
+
+namespace {
+
+#if defined(AUDIO_TRANSPORT_DENORMALS_MXCSR)
+// Flush-to-zero (bit 15) and denormals-are-zero (bit 6)
+const unsigned int FLUSH_BITS = 0x8040;
+#elif defined(AUDIO_TRANSPORT_DENORMALS_FPCR)
+// Flush-to-zero (bit 24)
+const unsigned long long FLUSH_BITS = 1ull << 24;
+
+inline unsigned long long get_fpcr() {
+    unsigned long long fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    return fpcr;
+}
+
+inline void set_fpcr(unsigned long long fpcr) {
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+}
+#endif
+
+} // namespace
+
+scoped_flush_denormals::scoped_flush_denormals() : saved_(0) {
+#if defined(AUDIO_TRANSPORT_DENORMALS_MXCSR)
+    saved_ = _mm_getcsr();
+    _mm_setcsr(static_cast<unsigned int>(saved_) | FLUSH_BITS);
+#elif defined(AUDIO_TRANSPORT_DENORMALS_FPCR)
+    saved_ = get_fpcr();
+    set_fpcr(saved_ | FLUSH_BITS);
+#endif
+}
+
+scoped_flush_denormals::~scoped_flush_denormals() {
+    // Restore only the flush bits, so the rounding mode and exception
+    // flags set inside the scope are kept
+#if defined(AUDIO_TRANSPORT_DENORMALS_MXCSR)
+    _mm_setcsr((_mm_getcsr() & ~FLUSH_BITS) | (static_cast<unsigned int>(saved_) & FLUSH_BITS));
+#elif defined(AUDIO_TRANSPORT_DENORMALS_FPCR)
+    set_fpcr((get_fpcr() & ~FLUSH_BITS) | (saved_ & FLUSH_BITS));
+#endif
+}
+
+bool flush_supported() {
+#if defined(AUDIO_TRANSPORT_DENORMALS_MXCSR) || defined(AUDIO_TRANSPORT_DENORMALS_FPCR)
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace denormals
+} // namespace audio_transport
@@ -0,0 +1,145 @@
+#include "audio_transport/diagnostics.hpp"
+#include <ostream>
+#include <sstream>
+
+namespace audio_transport {
+namespace diagnostics {
+
+static thread_local channel* bound = nullptr;
+
+static std::atomic<std::uint64_t> totals[num_events];
+
+channel::channel() : dropped_(0) {
+    for (size_t e = 0; e < num_events; e++) {
+        counts_[e].store(0, std::memory_order_relaxed);
+    }
+}
+
+void channel::push(const record& r) {
+    // Single producer, so no read-modify-write is needed
+    std::atomic<std::uint64_t>& count = counts_[static_cast<size_t>(r.type)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (!ring_.push(r)) {
+        dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t channel::count(event type) const {
+    return counts_[static_cast<size_t>(type)].load(std::memory_order_relaxed);
+}
+
+scope::scope(channel& c) : previous_(bound) {
+    bound = &c;
+}
+
+scope::~scope() {
+    bound = previous_;
+}
+
+#ifndef AUDIO_TRANSPORT_NO_DIAGNOSTICS
+void report(event type, long bin, double value, double detail) {
+    totals[static_cast<size_t>(type)].fetch_add(1, std::memory_order_relaxed);
+
+    if (bound) {
+        record r = { type, bin, value, detail };
+        bound->push(r);
+    }
+}
+#endif
+
+std::uint64_t total(event type) {
+    return totals[static_cast<size_t>(type)].load(std::memory_order_relaxed);
+}
+
+void reset_totals() {
+    for (size_t e = 0; e < num_events; e++) {
+        totals[e].store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* name(event type) {
+    switch (type) {
+        case event::invalid_phase:        return "invalid_phase";
+        case event::small_mass:           return "small_mass";
+        case event::invalid_scale:        return "invalid_scale";
+        case event::invalid_frequency:    return "invalid_frequency";
+        case event::low_frequency:        return "low_frequency";
+        case event::invalid_phase_shift:  return "invalid_phase_shift";
+        case event::invalid_magnitude:    return "invalid_magnitude";
+        case event::invalid_bin_phase:    return "invalid_bin_phase";
+        case event::invalid_next_phase:   return "invalid_next_phase";
+        case event::near_silent_spectrum: return "near_silent_spectrum";
+        case event::invalid_sample:       return "invalid_sample";
+    }
+    return "unknown";
+}
+
+std::string describe(const record& r) {
+    std::ostringstream out;
+    out << "[audio_transport] ";
+    switch (r.type) {
+        case event::invalid_phase:
+            out << "Warning: " << r.value << " invalid phases, resetting to 0";
+            break;
+        case event::small_mass:
+            // detail is 0 for the left mass, 1 for the right
+            out << "Warning: Very small " << (r.detail == 0 ? "left" : "right")
+                << "_mass.mass = " << r.value << " at bin " << r.bin << ", clamping scale";
+            break;
+        case event::invalid_scale:
+            out << "Warning: Invalid scale = " << r.value
+                << " at center_bin = " << r.bin << ", skipping mass placement";
+            break;
+        case event::invalid_frequency:
+            out << "Warning: Invalid interpolated_freq = " << r.value
+                << " at center_bin = " << r.bin << ", skipping mass placement";
+            break;
+        case event::low_frequency:
+            out << "Attenuating low freq: " << r.value
+                << " Hz, attenuation = " << r.detail;
+            break;
+        case event::invalid_phase_shift:
+            out << "Warning: Invalid phase_shift = " << r.value
+                << " at center_bin = " << r.bin << ", skipping mass placement";
+            break;
+        case event::invalid_magnitude:
+            out << "Warning: " << r.value << " invalid bins, zeroing";
+            break;
+        case event::invalid_bin_phase:
+            out << "Warning: " << r.value << " invalid bin phases, zeroing";
+            break;
+        case event::invalid_next_phase:
+            out << "Warning: Invalid next_phase = " << r.value
+                << " at bin " << r.bin << ", keeping previous phase";
+            break;
+        case event::near_silent_spectrum:
+            out << "Warning: Near-silent spectrum detected (mass_sum = " << r.value
+                << "), returning single mass covering entire spectrum";
+            break;
+        case event::invalid_sample:
+            out << "Warning: " << r.value << " invalid synthesized samples, zeroing";
+            break;
+    }
+    return out.str();
+}
+
+size_t drain(channel& c, std::ostream& out) {
+    size_t written = 0;
+    record r;
+    while (c.pop(r)) {
+        out << describe(r) << '\n';
+        written++;
+    }
+
+    std::uint64_t dropped = c.dropped();
+    if (dropped != c.dropped_logged_) {
+        out << "[audio_transport] " << (dropped - c.dropped_logged_)
+            << " diagnostics dropped (queue full)" << '\n';
+        c.dropped_logged_ = dropped;
+    }
+    return written;
+}
+
+} // namespace diagnostics
+} // namespace audio_transport
@@ -40,3 +40,37 @@ void audio_transport::equal_loudness::remove(
     }
   }
 }
+
+void audio_transport::equal_loudness::apply(
+    spectral::frame & frame) {
+  for (size_t i = 0; i < frame.size(); i++) {
+    double weight = equal_loudness::a_weighting_amp(frame.freq[i]);
+    frame.re[i] *= weight;
+    frame.im[i] *= weight;
+  }
+}
+
+void audio_transport::equal_loudness::remove(
+    spectral::frame & frame) {
+  for (size_t i = 0; i < frame.size(); i++) {
+    double value = equal_loudness::a_weighting_amp(frame.freq[i]);
+    if (value > 0) {
+      frame.re[i] /= value;
+      frame.im[i] /= value;
+    }
+  }
+}
+
+void audio_transport::equal_loudness::apply(
+    std::vector<spectral::frame> & frames) {
+  for (size_t w = 0; w < frames.size(); w++) {
+    equal_loudness::apply(frames[w]);
+  }
+}
+
+void audio_transport::equal_loudness::remove(
+    std::vector<spectral::frame> & frames) {
+  for (size_t w = 0; w < frames.size(); w++) {
+    equal_loudness::remove(frames[w]);
+  }
+}
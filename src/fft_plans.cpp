@@ -0,0 +1,257 @@
+#include "audio_transport/fft_plans.hpp"
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <utility>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace audio_transport {
+namespace fft_plans {
+
+// Serialises every FFTW planner call and wisdom access made through here
+static std::mutex& registry_mutex() {
+    static std::mutex m;
+    return m;
+}
+
+static bool cache_directory_set = false;
+static std::string cache_directory_override;
+
+template <typename Real>
+struct registry {
+    typedef fftw_traits<Real> fft;
+
+    // Keyed by size, direction and batch size
+    std::map<std::tuple<int, direction, int>, typename fft::plan> plans;
+    bool wisdom_loaded = false;
+
+    static registry& instance() {
+        // Never destroyed: plans may still be executing during static
+        // destruction of a host
+        static registry* r = new registry();
+        return *r;
+    }
+};
+
+template <typename Real>
+static const char* wisdom_file();
+
+template <>
+const char* wisdom_file<double>() { return "fftw3.wisdom"; }
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+template <>
+const char* wisdom_file<float>() { return "fftw3f.wisdom"; }
+#endif
+
+static std::string env(const char* name) {
+    const char* value = std::getenv(name);
+    return value ? std::string(value) : std::string();
+}
+
+static std::string default_cache_directory() {
+    std::string dir = env("AUDIO_TRANSPORT_CACHE_DIR");
+    if (!dir.empty()) return dir;
+
+#if defined(_WIN32)
+    std::string base = env("LOCALAPPDATA");
+#elif defined(__APPLE__)
+    std::string base = env("HOME");
+    if (!base.empty()) base += "/Library/Caches";
+#else
+    std::string base = env("XDG_CACHE_HOME");
+    if (base.empty()) {
+        base = env("HOME");
+        if (!base.empty()) base += "/.cache";
+    }
+#endif
+    if (base.empty()) return std::string();
+    return base + "/audio_transport";
+}
+
+static std::string cache_directory_locked() {
+    return cache_directory_set ? cache_directory_override : default_cache_directory();
+}
+
+// mkdir -p; failures show up later as a failed export
+static void make_directories(const std::string& path) {
+    for (size_t i = 1; i <= path.size(); i++) {
+        if (i != path.size() && path[i] != '/' && path[i] != '\\') continue;
+        std::string prefix = path.substr(0, i);
+#ifdef _WIN32
+        _mkdir(prefix.c_str());
+#else
+        mkdir(prefix.c_str(), 0755);
+#endif
+    }
+}
+
+template <typename Real>
+static void load_wisdom(registry<Real>& r) {
+    if (r.wisdom_loaded) return;
+    r.wisdom_loaded = true;
+
+    std::string dir = cache_directory_locked();
+    if (dir.empty()) return;
+    // A missing or corrupt file just means planning from scratch
+    registry<Real>::fft::import_wisdom((dir + "/" + wisdom_file<Real>()).c_str());
+}
+
+template <typename Real>
+static void save_wisdom() {
+    std::string dir = cache_directory_locked();
+    if (dir.empty()) return;
+    make_directories(dir);
+
+    // Write to a private file and rename it over the old one so another
+    // process loading wisdom never sees a half-written file
+    std::string path = dir + "/" + wisdom_file<Real>();
+#ifdef _WIN32
+    std::string tmp = path + "." + std::to_string(_getpid());
+#else
+    std::string tmp = path + "." + std::to_string(getpid());
+#endif
+    if (!registry<Real>::fft::export_wisdom(tmp.c_str())) return;
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str());
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+        }
+    }
+}
+
+// Batched arrays start on a 64-byte boundary (or more) whenever the
+// first one does
+size_t real_distance(int n) {
+    return (static_cast<size_t>(n) + 15) / 16 * 16;
+}
+
+size_t complex_distance(int n) {
+    return (static_cast<size_t>(n) / 2 + 1 + 3) / 4 * 4;
+}
+
+int transform_size(int n, sizing policy) {
+    if (n <= 2 || policy == exact) return n;
+
+    if (policy == power_of_two) {
+        int size = 2;
+        while (size < n) size *= 2;
+        return size;
+    }
+
+    // Smooth sizes are dense, so counting up finds one quickly
+    for (int size = n + n % 2;; size += 2) {
+        int rest = size;
+        for (int factor : { 2, 3, 5 }) {
+            while (rest % factor == 0) rest /= factor;
+        }
+        if (rest == 1) return size;
+    }
+}
+
+template <typename Real>
+typename fftw_traits<Real>::plan get(int n, direction dir, int howmany) {
+    typedef fftw_traits<Real> fft;
+    assert(n > 0 && howmany > 0);
+
+    std::lock_guard<std::mutex> guard(registry_mutex());
+    registry<Real>& r = registry<Real>::instance();
+
+    std::tuple<int, direction, int> key(n, dir, howmany);
+    typename std::map<std::tuple<int, direction, int>, typename fft::plan>::iterator it =
+        r.plans.find(key);
+    if (it != r.plans.end()) return it->second;
+
+    load_wisdom(r);
+
+    // FFTW_MEASURE overwrites the arrays, so plan on scratch
+    typename fft::plan plan;
+    if (howmany == 1) {
+        Real* real = fft::alloc_real(n);
+        typename fft::complex* spectrum = fft::alloc_complex(n / 2 + 1);
+        plan = (dir == forward)
+            ? fft::plan_r2c(n, real, spectrum, FFTW_MEASURE)
+            : fft::plan_c2r(n, spectrum, real, FFTW_MEASURE);
+        fft::free(real);
+        fft::free(spectrum);
+    } else {
+        int real_step = static_cast<int>(real_distance(n));
+        int complex_step = static_cast<int>(complex_distance(n));
+        Real* real = fft::alloc_real(static_cast<size_t>(real_step) * howmany);
+        typename fft::complex* spectrum = fft::alloc_complex(static_cast<size_t>(complex_step) * howmany);
+        plan = (dir == forward)
+            ? fft::plan_many_r2c(n, howmany, real, real_step, spectrum, complex_step, FFTW_MEASURE)
+            : fft::plan_many_c2r(n, howmany, spectrum, complex_step, real, real_step, FFTW_MEASURE);
+        fft::free(real);
+        fft::free(spectrum);
+    }
+    assert(plan);
+
+    r.plans[key] = plan;
+    save_wisdom<Real>();
+    return plan;
+}
+
+template <typename Real>
+typename fftw_traits<Real>::plan get(int n, direction dir) {
+    return get<Real>(n, dir, 1);
+}
+
+void set_cache_directory(const std::string& path) {
+    std::lock_guard<std::mutex> guard(registry_mutex());
+    cache_directory_set = true;
+    cache_directory_override = path;
+}
+
+std::string cache_directory() {
+    std::lock_guard<std::mutex> guard(registry_mutex());
+    return cache_directory_locked();
+}
+
+template <typename Real>
+static void clear_registry() {
+    registry<Real>& r = registry<Real>::instance();
+    for (auto& entry : r.plans) {
+        fftw_traits<Real>::destroy(entry.second);
+    }
+    r.plans.clear();
+    r.wisdom_loaded = false;
+    fftw_traits<Real>::forget_wisdom();
+}
+
+size_t size() {
+    std::lock_guard<std::mutex> guard(registry_mutex());
+    size_t count = registry<double>::instance().plans.size();
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    count += registry<float>::instance().plans.size();
+#endif
+    return count;
+}
+
+void clear() {
+    std::lock_guard<std::mutex> guard(registry_mutex());
+    clear_registry<double>();
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    clear_registry<float>();
+#endif
+}
+
+template fftw_traits<double>::plan get<double>(int n, direction dir);
+template fftw_traits<double>::plan get<double>(int n, direction dir, int howmany);
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+template fftw_traits<float>::plan get<float>(int n, direction dir);
+template fftw_traits<float>::plan get<float>(int n, direction dir, int howmany);
+#endif
+
+} // namespace fft_plans
+} // namespace audio_transport
@@ -0,0 +1,216 @@
+#include "audio_transport/instrumentation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+
+namespace audio_transport {
+namespace instrumentation {
+
+static double measure_ticks_per_second() {
+    typedef std::chrono::steady_clock clock;
+    clock::time_point wall_start = clock::now();
+    ticks start = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ticks end = now();
+    double seconds = std::chrono::duration<double>(clock::now() - wall_start).count();
+    return (end - start) / seconds;
+}
+
+double ticks_per_second() {
+    static const double rate = measure_ticks_per_second();
+    return rate;
+}
+
+size_t bucket(ticks t) {
+    size_t b = 0;
+    while (t > 1 && b < histogram_buckets - 1) {
+        t >>= 1;
+        b++;
+    }
+    return b;
+}
+
+const char* name(stage s) {
+    switch (s) {
+        case stage::analyze_main:      return "analyze_main";
+        case stage::analyze_sidechain: return "analyze_sidechain";
+        case stage::interpolate:       return "interpolate";
+        case stage::synthesize:        return "synthesize";
+    }
+    return "unknown";
+}
+
+double snapshot::mean_hop_seconds() const {
+    return hops ? hop_ticks / (hops * ticks_per_second()) : 0;
+}
+
+double snapshot::mean_stage_seconds(stage s) const {
+    return hops ? stage_ticks[static_cast<size_t>(s)] / (hops * ticks_per_second()) : 0;
+}
+
+double snapshot::mean_masses() const {
+    return plans ? masses / (double) plans : 0;
+}
+
+double snapshot::mean_transport_entries() const {
+    std::uint64_t transported = plans - silent_shortcuts;
+    return transported ? transport_entries / (double) transported : 0;
+}
+
+double snapshot::pruned_fraction() const {
+    std::uint64_t grouped = masses + pruned_masses;
+    return grouped ? pruned_masses / (double) grouped : 0;
+}
+
+double snapshot::load(double sample_rate) const {
+    if (block_samples == 0) return 0;
+    double audio_seconds = block_samples / sample_rate;
+    return block_ticks / ticks_per_second() / audio_seconds;
+}
+
+snapshot operator-(const snapshot& later, const snapshot& earlier) {
+    snapshot d = later;
+    d.blocks -= earlier.blocks;
+    d.block_samples -= earlier.block_samples;
+    d.block_ticks -= earlier.block_ticks;
+    d.hops -= earlier.hops;
+    d.hop_ticks -= earlier.hop_ticks;
+    for (size_t b = 0; b < histogram_buckets; b++) {
+        d.hop_histogram[b] -= earlier.hop_histogram[b];
+    }
+    for (size_t s = 0; s < num_stages; s++) {
+        d.stage_ticks[s] -= earlier.stage_ticks[s];
+    }
+    d.plans -= earlier.plans;
+    d.masses -= earlier.masses;
+    d.transport_entries -= earlier.transport_entries;
+    d.silent_shortcuts -= earlier.silent_shortcuts;
+    d.pruned_masses -= earlier.pruned_masses;
+    d.skipped_analyses -= earlier.skipped_analyses;
+    return d;
+}
+
+void write(std::ostream& out, const snapshot& s, double sample_rate) {
+    double us = 1e6 / ticks_per_second();
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(2);
+
+    out << "blocks " << s.blocks << ", hops " << s.hops
+        << ", load " << 100 * s.load(sample_rate) << "% of realtime\n";
+    out << "  hop           mean " << std::setw(9) << s.mean_hop_seconds() * 1e6
+        << " us  max " << std::setw(9) << s.hop_max * us << " us\n";
+    for (size_t i = 0; i < num_stages; i++) {
+        stage st = static_cast<stage>(i);
+        out << "  " << std::left << std::setw(18) << name(st) << std::right
+            << "mean " << std::setw(9) << s.mean_stage_seconds(st) * 1e6
+            << " us  max " << std::setw(9) << s.stage_max[i] * us << " us\n";
+    }
+    if (s.plans) {
+        out << "  plans " << s.plans << ", masses/plan " << s.mean_masses()
+            << ", transport entries/plan " << s.mean_transport_entries()
+            << ", silent shortcuts " << s.silent_shortcuts << "\n";
+    }
+    if (s.pruned_masses) {
+        out << "  masses pruned " << s.pruned_masses
+            << " (" << 100 * s.pruned_fraction() << "% of those grouped)\n";
+    }
+    if (s.skipped_analyses) {
+        out << "  analyses skipped (silent or frozen input) " << s.skipped_analyses << "\n";
+    }
+
+    out << "  hop histogram (us: hops)\n";
+    for (size_t b = 0; b < histogram_buckets; b++) {
+        if (s.hop_histogram[b] == 0) continue;
+        out << "    " << std::setw(10) << (ticks(1) << b) * us
+            << " - " << std::setw(10) << (ticks(2) << b) * us
+            << ": " << s.hop_histogram[b] << "\n";
+    }
+    out.flags(flags);
+}
+
+recorder::recorder()
+    : enabled_(false), blocks_(0), block_samples_(0), block_ticks_(0), block_max_(0),
+      hops_(0), hop_ticks_(0), hop_max_(0),
+      plans_(0), masses_(0), transport_entries_(0), silent_shortcuts_(0), pruned_masses_(0),
+      skipped_analyses_(0) {
+    for (size_t b = 0; b < histogram_buckets; b++) {
+        hop_histogram_[b].store(0, std::memory_order_relaxed);
+    }
+    for (size_t s = 0; s < num_stages; s++) {
+        stage_ticks_[s].store(0, std::memory_order_relaxed);
+        stage_max_[s].store(0, std::memory_order_relaxed);
+    }
+}
+
+// Engines sharing a recorder may race here, so no plain store
+static void raise(std::atomic<ticks>& maximum, ticks value) {
+    ticks current = maximum.load(std::memory_order_relaxed);
+    while (value > current &&
+           !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void recorder::add_hop(ticks total, const ticks (&stages)[num_stages]) {
+    hops_.fetch_add(1, std::memory_order_relaxed);
+    hop_ticks_.fetch_add(total, std::memory_order_relaxed);
+    raise(hop_max_, total);
+    hop_histogram_[bucket(total)].fetch_add(1, std::memory_order_relaxed);
+    for (size_t s = 0; s < num_stages; s++) {
+        stage_ticks_[s].fetch_add(stages[s], std::memory_order_relaxed);
+        raise(stage_max_[s], stages[s]);
+    }
+}
+
+void recorder::add_plan(size_t left_masses, size_t right_masses,
+                        size_t transport_entries, bool silent,
+                        size_t pruned_masses) {
+    plans_.fetch_add(1, std::memory_order_relaxed);
+    masses_.fetch_add(left_masses + right_masses, std::memory_order_relaxed);
+    if (pruned_masses) pruned_masses_.fetch_add(pruned_masses, std::memory_order_relaxed);
+    if (silent) {
+        silent_shortcuts_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        transport_entries_.fetch_add(transport_entries, std::memory_order_relaxed);
+    }
+}
+
+void recorder::add_skipped(size_t analyses) {
+    skipped_analyses_.fetch_add(analyses, std::memory_order_relaxed);
+}
+
+void recorder::add_block(size_t samples, ticks total) {
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+    block_samples_.fetch_add(samples, std::memory_order_relaxed);
+    block_ticks_.fetch_add(total, std::memory_order_relaxed);
+    raise(block_max_, total);
+}
+
+snapshot recorder::read() const {
+    snapshot s;
+    s.blocks = blocks_.load(std::memory_order_relaxed);
+    s.block_samples = block_samples_.load(std::memory_order_relaxed);
+    s.block_ticks = block_ticks_.load(std::memory_order_relaxed);
+    s.block_max = block_max_.load(std::memory_order_relaxed);
+    s.hops = hops_.load(std::memory_order_relaxed);
+    s.hop_ticks = hop_ticks_.load(std::memory_order_relaxed);
+    s.hop_max = hop_max_.load(std::memory_order_relaxed);
+    for (size_t b = 0; b < histogram_buckets; b++) {
+        s.hop_histogram[b] = hop_histogram_[b].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < num_stages; i++) {
+        s.stage_ticks[i] = stage_ticks_[i].load(std::memory_order_relaxed);
+        s.stage_max[i] = stage_max_[i].load(std::memory_order_relaxed);
+    }
+    s.plans = plans_.load(std::memory_order_relaxed);
+    s.masses = masses_.load(std::memory_order_relaxed);
+    s.transport_entries = transport_entries_.load(std::memory_order_relaxed);
+    s.silent_shortcuts = silent_shortcuts_.load(std::memory_order_relaxed);
+    s.pruned_masses = pruned_masses_.load(std::memory_order_relaxed);
+    s.skipped_analyses = skipped_analyses_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace instrumentation
+} // namespace audio_transport
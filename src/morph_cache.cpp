@@ -0,0 +1,284 @@
+#include "audio_transport/morph_cache.hpp"
+#include "audio_transport/equal_loudness.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace audio_transport {
+
+// File signature; the last character is the format version
+static const char MAGIC[8] = { 'A', 'T', 'M', 'O', 'R', 'P', 'H', '1' };
+
+// Drop what render() does not read: with a silent side there is no
+// transport, and the silent side needs no spectrum
+static void trim(transport_plan& plan, polar_frame& left, polar_frame& right) {
+    if (plan.left_silent || plan.right_silent) {
+        plan.left_masses = std::vector<spectral_mass>();
+        plan.right_masses = std::vector<spectral_mass>();
+        plan.transport = std::vector<std::tuple<size_t, size_t, double>>();
+    } else {
+        plan.left_masses.shrink_to_fit();
+        plan.right_masses.shrink_to_fit();
+        plan.transport.shrink_to_fit();
+    }
+    if (plan.left_silent) left = polar_frame();
+    if (plan.right_silent) right = polar_frame();
+}
+
+morph_cache::morph_cache(const std::vector<double>& left, double left_sample_rate,
+                         const std::vector<double>& right, double right_sample_rate,
+                         const transport_settings& settings)
+    : left_length_(left.size()),
+      right_length_(right.size()),
+      left_sample_rate_(left_sample_rate),
+      right_sample_rate_(right_sample_rate),
+      window_size_(settings.window_size),
+      padding_(settings.padding),
+      overlap_(settings.overlap),
+      equal_loudness_(settings.equal_loudness) {
+
+    spectral::analysis_layout left_layout = spectral::get_analysis_layout(
+        left.size(), left_sample_rate,
+        settings.window_size, settings.padding, settings.overlap);
+    spectral::analysis_layout right_layout = spectral::get_analysis_layout(
+        right.size(), right_sample_rate,
+        settings.window_size, settings.padding, settings.overlap);
+
+    size_t num_windows = std::min(left_layout.num_windows, right_layout.num_windows);
+    if (num_windows == 0) return;
+
+    spectral::window_workspace left_workspace(left_layout.N_padded);
+    spectral::window_workspace right_workspace(right_layout.N_padded);
+    spectral::frame left_frame, right_frame;
+
+    windows_.resize(num_windows);
+    for (size_t w = 0; w < num_windows; w++) {
+        spectral::analyze_window(left.data() + w * left_layout.hop_size, left_layout, w,
+                                 left_frame, left_workspace);
+        spectral::analyze_window(right.data() + w * right_layout.hop_size, right_layout, w,
+                                 right_frame, right_workspace);
+        if (equal_loudness_) {
+            equal_loudness::apply(left_frame);
+            equal_loudness::apply(right_frame);
+        }
+        if (w == 0) {
+            left_freq_ = left_frame.freq;
+            right_freq_ = right_frame.freq;
+        }
+
+        window& kept = windows_[w];
+        plan_transport(left_frame, right_frame, kept.plan, kept.left, kept.right);
+        trim(kept.plan, kept.left, kept.right);
+    }
+}
+
+std::vector<double> morph_cache::render(
+    const std::function<double(size_t w, size_t num_windows)>& interpolation) const {
+
+    if (windows_.empty()) return std::vector<double>();
+
+    // Interpolated frames share the bins of left
+    size_t num_bins = left_freq_.size();
+    spectral::synthesis_layout layout = spectral::get_synthesis_layout(
+        num_bins, windows_.size(), padding_, overlap_);
+    spectral::window_workspace workspace(layout.N_padded);
+    interpolate_workspace interpolation_workspace(num_bins);
+    std::vector<double> phases(num_bins, 0);
+    spectral::frame output;
+
+    std::vector<double> audio(layout.num_samples, 0);
+    for (size_t w = 0; w < windows_.size(); w++) {
+        const window& kept = windows_[w];
+        double k = interpolation(w, windows_.size());
+        interpolate(kept.plan, kept.left, left_freq_, kept.right, right_freq_,
+                    phases, window_size_, k, output, interpolation_workspace);
+        if (equal_loudness_) {
+            equal_loudness::remove(output);
+        }
+        spectral::synthesize_window(output, layout, audio.data() + w * layout.hop_size, workspace);
+    }
+    return audio;
+}
+
+//==============================================================================
+// The file is the header fields in declaration order, then each
+// window's silence flags, masses, transport and non-empty spectra.
+// Every count is written as a uint64_t ahead of its array.
+
+template <typename T>
+static void write_value(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_value(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template <typename Vector>
+static void write_array(std::ostream& out, const Vector& values) {
+    write_value<uint64_t>(out, values.size());
+    out.write(reinterpret_cast<const char*>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(double)));
+}
+
+// Only sizes of 0 or expected are accepted
+template <typename Vector>
+static bool read_array(std::istream& in, Vector& values, size_t expected) {
+    uint64_t size;
+    if (!read_value(in, size) || (size != 0 && size != expected)) return false;
+    values.resize(static_cast<size_t>(size));
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()),
+                                     static_cast<std::streamsize>(size * sizeof(double))));
+}
+
+static void write_masses(std::ostream& out, const std::vector<spectral_mass>& masses) {
+    write_value<uint64_t>(out, masses.size());
+    for (const spectral_mass& mass : masses) {
+        write_value<uint64_t>(out, mass.left_bin);
+        write_value<uint64_t>(out, mass.right_bin);
+        write_value<uint64_t>(out, mass.center_bin);
+        write_value(out, mass.mass);
+    }
+}
+
+static bool read_masses(std::istream& in, std::vector<spectral_mass>& masses, size_t num_bins) {
+    uint64_t count;
+    if (!read_value(in, count) || count > num_bins) return false;
+    masses.resize(static_cast<size_t>(count));
+    for (spectral_mass& mass : masses) {
+        uint64_t left_bin, right_bin, center_bin;
+        if (!read_value(in, left_bin) || !read_value(in, right_bin) ||
+            !read_value(in, center_bin) || !read_value(in, mass.mass)) return false;
+        if (left_bin > right_bin || right_bin > num_bins || center_bin >= num_bins) return false;
+        mass.left_bin = static_cast<size_t>(left_bin);
+        mass.right_bin = static_cast<size_t>(right_bin);
+        mass.center_bin = static_cast<size_t>(center_bin);
+    }
+    return true;
+}
+
+bool morph_cache::save(const std::string& path) const {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out) return false;
+
+    out.write(MAGIC, sizeof(MAGIC));
+    write_value<uint64_t>(out, left_length_);
+    write_value<uint64_t>(out, right_length_);
+    write_value(out, left_sample_rate_);
+    write_value(out, right_sample_rate_);
+    write_value(out, window_size_);
+    write_value<uint32_t>(out, padding_);
+    write_value<uint32_t>(out, overlap_);
+    write_value<uint32_t>(out, equal_loudness_ ? 1 : 0);
+    write_array(out, left_freq_);
+    write_array(out, right_freq_);
+
+    write_value<uint64_t>(out, windows_.size());
+    for (const window& kept : windows_) {
+        write_value<uint8_t>(out, kept.plan.left_silent ? 1 : 0);
+        write_value<uint8_t>(out, kept.plan.right_silent ? 1 : 0);
+        write_masses(out, kept.plan.left_masses);
+        write_masses(out, kept.plan.right_masses);
+
+        write_value<uint64_t>(out, kept.plan.transport.size());
+        for (const auto& t : kept.plan.transport) {
+            write_value<uint64_t>(out, std::get<0>(t));
+            write_value<uint64_t>(out, std::get<1>(t));
+            write_value(out, std::get<2>(t));
+        }
+
+        for (const polar_frame* side : { &kept.left, &kept.right }) {
+            write_array(out, side->magnitudes);
+            write_array(out, side->phases);
+            write_array(out, side->freq_reassigned);
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool morph_cache::load(const std::string& path) {
+    *this = morph_cache();
+    morph_cache loaded;
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    uint64_t left_length, right_length;
+    uint32_t padding, overlap, equal_loudness;
+    if (!read_value(in, left_length) || !read_value(in, right_length) ||
+        !read_value(in, loaded.left_sample_rate_) || !read_value(in, loaded.right_sample_rate_) ||
+        !read_value(in, loaded.window_size_) || !read_value(in, padding) ||
+        !read_value(in, overlap) || !read_value(in, equal_loudness)) return false;
+    loaded.left_length_ = static_cast<size_t>(left_length);
+    loaded.right_length_ = static_cast<size_t>(right_length);
+    loaded.padding_ = padding;
+    loaded.overlap_ = overlap;
+    loaded.equal_loudness_ = equal_loudness != 0;
+
+    // Settings no cache could have been built with would only make
+    // the layouts below fail
+    const double max_window_samples = double(1 << 24);
+    for (double sample_rate : { loaded.left_sample_rate_, loaded.right_sample_rate_ }) {
+        double window_samples = loaded.window_size_ * sample_rate;
+        if (!(window_samples >= 1 && window_samples <= max_window_samples)) return false;
+    }
+    if (padding > 16 || overlap == 0 || overlap > 64) return false;
+
+    // The bin counts follow from the settings
+    size_t left_bins = spectral::get_analysis_layout(
+        0, loaded.left_sample_rate_, loaded.window_size_, padding, overlap).N_padded/2 + 1;
+    size_t right_bins = spectral::get_analysis_layout(
+        0, loaded.right_sample_rate_, loaded.window_size_, padding, overlap).N_padded/2 + 1;
+    if (!read_array(in, loaded.left_freq_, left_bins) ||
+        !read_array(in, loaded.right_freq_, right_bins)) return false;
+
+    uint64_t num_windows;
+    if (!read_value(in, num_windows)) return false;
+    for (uint64_t w = 0; w < num_windows; w++) {
+        window kept;
+        uint8_t left_silent, right_silent;
+        if (!read_value(in, left_silent) || !read_value(in, right_silent) ||
+            !read_masses(in, kept.plan.left_masses, left_bins) ||
+            !read_masses(in, kept.plan.right_masses, right_bins)) return false;
+        kept.plan.left_silent = left_silent != 0;
+        kept.plan.right_silent = right_silent != 0;
+
+        uint64_t transport_size;
+        if (!read_value(in, transport_size) || transport_size > left_bins + right_bins) return false;
+        kept.plan.transport.resize(static_cast<size_t>(transport_size));
+        for (auto& t : kept.plan.transport) {
+            uint64_t left_mass, right_mass;
+            double mass;
+            if (!read_value(in, left_mass) || !read_value(in, right_mass) ||
+                !read_value(in, mass)) return false;
+            if (left_mass >= kept.plan.left_masses.size() ||
+                right_mass >= kept.plan.right_masses.size()) return false;
+            t = std::make_tuple(static_cast<size_t>(left_mass), static_cast<size_t>(right_mass), mass);
+        }
+
+        size_t bins[] = { left_bins, right_bins };
+        polar_frame* sides[] = { &kept.left, &kept.right };
+        for (int s = 0; s < 2; s++) {
+            if (!read_array(in, sides[s]->magnitudes, bins[s]) ||
+                !read_array(in, sides[s]->phases, sides[s]->magnitudes.size()) ||
+                !read_array(in, sides[s]->freq_reassigned, sides[s]->magnitudes.size())) return false;
+            if (sides[s]->phases.size() != sides[s]->size() ||
+                sides[s]->freq_reassigned.size() != sides[s]->size()) return false;
+        }
+
+        // A side that sounds needs its spectrum
+        if ((!kept.plan.left_silent && kept.left.size() != left_bins) ||
+            (!kept.plan.right_silent && kept.right.size() != right_bins)) return false;
+        loaded.windows_.push_back(std::move(kept));
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+} // namespace audio_transport
@@ -0,0 +1,356 @@
+#include "audio_transport/offline_renderer.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/equal_loudness.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+namespace audio_transport {
+
+// Hops summed per claim when combining the synthesis lanes
+static const size_t COMBINE_HOPS = 64;
+
+/**
+ * Synthesized windows overlap their neighbours, so concurrent
+ * overlap-adds go to separate lanes: window w adds into lane
+ * w % lanes, and windows that share a lane never overlap. Summing
+ * the lanes in window order then repeats the serial additions exactly.
+ */
+struct synthesis_lanes {
+    synthesis_lanes(const spectral::synthesis_layout& layout)
+        : layout(layout),
+          count(layout.hop_size > 0
+                ? (layout.window_size + layout.hop_size - 1) / layout.hop_size
+                : 1),
+          audio(count, std::vector<double>(layout.num_samples, 0)) {}
+
+    // Where window w overlap-adds
+    double* window(size_t w) { return audio[w % count].data() + w * layout.hop_size; }
+
+    // output[i] for every sample of hops [first_hop, last_hop)
+    void combine(size_t first_hop, size_t last_hop, double* output) const {
+        for (size_t h = first_hop; h < last_hop; h++) {
+            // Windows that can reach hop h, in the order synthesis() adds them;
+            // lanes hold exact zeros wherever a window did not reach
+            size_t first_window = h + 1 > count ? h + 1 - count : 0;
+            size_t last_window = std::min(h + 1, layout.num_windows);
+            for (size_t i = h * layout.hop_size; i < (h + 1) * layout.hop_size; i++) {
+                double sum = 0;
+                for (size_t w = first_window; w < last_window; w++) {
+                    sum += audio[w % count][i];
+                }
+                output[i] = sum;
+            }
+        }
+    }
+
+    const spectral::synthesis_layout& layout;
+    size_t count;
+    std::vector<std::vector<double>> audio;
+};
+
+offline_renderer::offline_renderer(unsigned int num_threads) {
+    if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 1;
+
+    for (unsigned int t = 1; t < num_threads; t++) {
+        workers_.push_back(std::thread(&offline_renderer::worker_loop, this, t));
+    }
+}
+
+offline_renderer::~offline_renderer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_.notify_all();
+    for (size_t t = 0; t < workers_.size(); t++) {
+        workers_[t].join();
+    }
+}
+
+void offline_renderer::worker_loop(unsigned int thread) {
+    unsigned long seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        start_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+        if (stopping_) return;
+        seen = generation_;
+        const job* work = job_;
+
+        lock.unlock();
+        (*work)(thread);
+        lock.lock();
+
+        if (--running_ == 0) finished_.notify_one();
+    }
+}
+
+void offline_renderer::run(const job& work) {
+    if (workers_.empty()) {
+        work(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = &work;
+        running_ = static_cast<unsigned int>(workers_.size());
+        generation_++;
+    }
+    start_.notify_all();
+
+    // The workers reference work, so they must be done before we leave
+    struct wait_for_workers {
+        offline_renderer& self;
+        ~wait_for_workers() {
+            std::unique_lock<std::mutex> lock(self.mutex_);
+            self.finished_.wait(lock, [&] { return self.running_ == 0; });
+            self.job_ = nullptr;
+        }
+    } wait = { *this };
+
+    work(0);
+}
+
+void offline_renderer::combine_lanes(const synthesis_lanes& lanes, std::vector<double>& audio) {
+    size_t num_hops = audio.size() / std::max<size_t>(lanes.layout.hop_size, 1);
+    std::atomic<size_t> next(0);
+    run([&](unsigned int) {
+        for (size_t h = next.fetch_add(COMBINE_HOPS); h < num_hops;
+             h = next.fetch_add(COMBINE_HOPS)) {
+            lanes.combine(h, std::min(h + COMBINE_HOPS, num_hops), audio.data());
+        }
+    });
+}
+
+std::vector<spectral::frame> offline_renderer::analysis(
+    const std::vector<double>& audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+
+    // Plans and tables are made (and measured) here, not on the pool
+    spectral::analysis_layout layout = spectral::get_analysis_layout(
+        audio.size(), sample_rate, window_size, padding, overlap);
+    std::vector<spectral::frame> frames(layout.num_windows);
+
+    std::atomic<size_t> next(0);
+    run([&](unsigned int) {
+        spectral::window_workspace workspace(layout.N_padded);
+        for (size_t w = next++; w < layout.num_windows; w = next++) {
+            spectral::analyze_window(audio.data() + w * layout.hop_size, layout, w,
+                                     frames[w], workspace);
+        }
+    });
+
+    return frames;
+}
+
+std::vector<double> offline_renderer::synthesis(
+    const std::vector<spectral::frame>& frames,
+    unsigned int padding,
+    unsigned int overlap) {
+
+    spectral::synthesis_layout layout = spectral::get_synthesis_layout(
+        frames[0].size(), frames.size(), padding, overlap);
+    synthesis_lanes lanes(layout);
+
+    std::atomic<size_t> next(0);
+    run([&](unsigned int) {
+        spectral::window_workspace workspace(layout.N_padded);
+        for (size_t w = next++; w < layout.num_windows; w = next++) {
+            spectral::synthesize_window(frames[w], layout, lanes.window(w), workspace);
+        }
+    });
+
+    std::vector<double> audio(layout.num_samples);
+    combine_lanes(lanes, audio);
+    return audio;
+}
+
+std::vector<double> offline_renderer::transport(
+    const std::vector<double>& left,
+    double left_sample_rate,
+    const std::vector<double>& right,
+    double right_sample_rate,
+    const transport_settings& settings) {
+
+    assert(settings.interpolation);
+
+    spectral::analysis_layout left_layout = spectral::get_analysis_layout(
+        left.size(), left_sample_rate,
+        settings.window_size, settings.padding, settings.overlap);
+    spectral::analysis_layout right_layout = spectral::get_analysis_layout(
+        right.size(), right_sample_rate,
+        settings.window_size, settings.padding, settings.overlap);
+
+    size_t num_windows = std::min(left_layout.num_windows, right_layout.num_windows);
+    if (num_windows == 0) return std::vector<double>();
+
+    // Interpolated frames share the bins of left
+    size_t num_bins = left_layout.N_padded/2 + 1;
+    spectral::synthesis_layout output_layout = spectral::get_synthesis_layout(
+        num_bins, num_windows, settings.padding, settings.overlap);
+    std::vector<double> audio(output_layout.num_samples, 0);
+
+    std::vector<spectral::frame> left_frames(num_windows);
+    std::vector<spectral::frame> right_frames(num_windows);
+    std::vector<spectral::frame> output_frames(num_windows);
+
+    // Pipeline state, guarded by state_mutex. Windows are claimed in
+    // order at each stage; analysis may not run more than lookahead
+    // windows ahead of the interpolation, which bounds the spectra held.
+    // Each synthesized window waits in a slot until every window before
+    // it has been added to audio, then is added itself: the sums repeat
+    // the serial overlap-add exactly, and synthesis may not run more than
+    // the slots ahead of the additions, which bounds the samples held.
+    std::mutex state_mutex;
+    std::condition_variable changed;
+    std::vector<char> analyzed(num_windows, 0);
+    std::vector<char> synthesized(num_windows, 0);
+    size_t next_analysis = 0;
+    size_t interpolated = 0;
+    size_t next_synthesis = 0;
+    size_t added = 0;
+    bool adding = false;
+    const size_t lookahead = 4 * num_threads();
+    std::vector<std::vector<double>> slots(lookahead + num_threads(),
+                                           std::vector<double>(output_layout.window_size));
+
+    struct scratch {
+        scratch(size_t left_size, size_t right_size, size_t output_size)
+            : left(left_size), right(right_size), output(output_size) {}
+        spectral::window_workspace left, right, output;
+    };
+
+    auto analyze = [&](size_t w, scratch& s) {
+        spectral::analyze_window(left.data() + w * left_layout.hop_size, left_layout, w,
+                                 left_frames[w], s.left);
+        spectral::analyze_window(right.data() + w * right_layout.hop_size, right_layout, w,
+                                 right_frames[w], s.right);
+        if (settings.equal_loudness) {
+            equal_loudness::apply(left_frames[w]);
+            equal_loudness::apply(right_frames[w]);
+        }
+    };
+
+    auto synthesize = [&](size_t w, scratch& s) {
+        std::vector<double>& slot = slots[w % slots.size()];
+        std::fill(slot.begin(), slot.end(), 0.0);
+        spectral::synthesize_window(output_frames[w], output_layout, slot.data(), s.output);
+        output_frames[w] = spectral::frame();
+    };
+
+    auto can_synthesize = [&]() {
+        return next_synthesis < interpolated && next_synthesis < added + slots.size();
+    };
+
+    // Synthesize window w, claimed under lock, and add every window
+    // that is then next in order; one thread adds at a time
+    auto synthesize_and_add = [&](size_t w, std::unique_lock<std::mutex>& lock, scratch& s) {
+        lock.unlock();
+        synthesize(w, s);
+        lock.lock();
+        synthesized[w] = 1;
+        if (adding) return;
+
+        adding = true;
+        while (added < num_windows && synthesized[added]) {
+            size_t v = added;
+            lock.unlock();
+            const std::vector<double>& slot = slots[v % slots.size()];
+            double* output = audio.data() + v * output_layout.hop_size;
+            for (size_t i = 0; i < slot.size(); i++) {
+                output[i] += slot[i];
+            }
+            lock.lock();
+            added++;
+            changed.notify_all();
+        }
+        adding = false;
+    };
+
+    // Take one analysis or synthesis task, preferring synthesis so
+    // finished windows are released early. Returns false if none is ready.
+    auto help = [&](std::unique_lock<std::mutex>& lock, scratch& s) -> bool {
+        if (can_synthesize()) {
+            synthesize_and_add(next_synthesis++, lock, s);
+            return true;
+        }
+        if (next_analysis < num_windows && next_analysis < interpolated + lookahead) {
+            size_t w = next_analysis++;
+            lock.unlock();
+            analyze(w, s);
+            lock.lock();
+            analyzed[w] = 1;
+            changed.notify_all();
+            return true;
+        }
+        return false;
+    };
+
+    auto interpolate_windows = [&](scratch& s) {
+        std::vector<double> phases(num_bins, 0);
+        interpolate_workspace workspace(num_bins);
+
+        std::unique_lock<std::mutex> lock(state_mutex);
+        for (size_t w = 0; w < num_windows; w++) {
+            while (!analyzed[w]) {
+                if (next_analysis <= w) {
+                    // Nobody has started it: do it here, past the lookahead
+                    size_t a = next_analysis++;
+                    lock.unlock();
+                    analyze(a, s);
+                    lock.lock();
+                    analyzed[a] = 1;
+                    changed.notify_all();
+                } else {
+                    changed.wait(lock);
+                }
+            }
+            lock.unlock();
+
+            double k = settings.interpolation(w, num_windows);
+            interpolate(left_frames[w], right_frames[w], phases,
+                        settings.window_size, k, output_frames[w], workspace);
+            if (settings.on_window) {
+                settings.on_window(w, left_frames[w], right_frames[w], output_frames[w]);
+            }
+            if (settings.equal_loudness) {
+                equal_loudness::remove(output_frames[w]);
+            }
+            left_frames[w] = spectral::frame();
+            right_frames[w] = spectral::frame();
+
+            lock.lock();
+            interpolated++;
+            changed.notify_all();
+
+            // Keep the synthesis backlog bounded when the workers are
+            // busy (or there are none)
+            while (interpolated - next_synthesis > lookahead) {
+                if (can_synthesize()) {
+                    synthesize_and_add(next_synthesis++, lock, s);
+                } else {
+                    changed.wait(lock);
+                }
+            }
+        }
+    };
+
+    run([&](unsigned int thread) {
+        scratch s(left_layout.N_padded, right_layout.N_padded, output_layout.N_padded);
+        if (thread == 0) interpolate_windows(s);
+
+        std::unique_lock<std::mutex> lock(state_mutex);
+        while (next_synthesis < num_windows) {
+            if (!help(lock, s)) changed.wait(lock);
+        }
+    });
+
+    return audio;
+}
+
+} // namespace audio_transport
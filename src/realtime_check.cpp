@@ -0,0 +1,43 @@
+#include "audio_transport/realtime_check.hpp"
+#include <cstdio>
+#include <cstdlib>
+
+namespace audio_transport {
+namespace realtime_check {
+
+static thread_local int scope_depth = 0;
+static thread_local std::size_t allocations = 0;
+
+scope::scope() {
+    scope_depth++;
+}
+
+scope::~scope() {
+    scope_depth--;
+}
+
+bool active() {
+    return scope_depth > 0;
+}
+
+void allocation(std::size_t size) {
+    if (scope_depth == 0) return;
+
+    allocations++;
+
+#ifdef AUDIO_TRANSPORT_REALTIME_CHECKS
+    // No iostreams here: we are inside operator new
+    std::fprintf(stderr,
+        "[audio_transport] Heap allocation of %zu bytes inside a realtime scope\n", size);
+    std::abort();
+#else
+    (void)size;
+#endif
+}
+
+std::size_t allocation_count() {
+    return allocations;
+}
+
+} // namespace realtime_check
+} // namespace audio_transport
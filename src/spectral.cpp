@@ -3,74 +3,246 @@
 #include <complex>
 #include <ciso646>
 #include <cassert>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include <fftw3.h>
 
 #include "audio_transport/spectral.hpp"
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/vector_math.hpp"
+#include "audio_transport/diagnostics.hpp"
 
 using namespace audio_transport;
 
-std::vector<double> audio_transport::spectral::synthesis(
-    const std::vector<std::vector<spectral::point>> & points,
+void audio_transport::spectral::frame::resize(size_t n) {
+  re.resize(n);
+  im.resize(n);
+  freq.resize(n);
+  time_reassigned.resize(n);
+  freq_reassigned.resize(n);
+}
+
+void audio_transport::spectral::frame::reserve(size_t n) {
+  re.reserve(n);
+  im.reserve(n);
+  freq.reserve(n);
+  time_reassigned.reserve(n);
+  freq_reassigned.reserve(n);
+}
+
+audio_transport::spectral::point audio_transport::spectral::frame::get(size_t i) const {
+  point p;
+  p.value = value(i);
+  p.time = time;
+  p.freq = freq[i];
+  p.time_reassigned = time_reassigned[i];
+  p.freq_reassigned = freq_reassigned[i];
+  return p;
+}
+
+void audio_transport::spectral::frame::set(size_t i, const point & p) {
+  re[i] = p.value.real();
+  im[i] = p.value.imag();
+  freq[i] = p.freq;
+  time_reassigned[i] = p.time_reassigned;
+  freq_reassigned[i] = p.freq_reassigned;
+}
+
+void audio_transport::spectral::to_frame(
+    const std::vector<point> & points,
+    frame & output) {
+  output.resize(points.size());
+  output.time = points.empty() ? 0 : points[0].time;
+  for (size_t i = 0; i < points.size(); i++) {
+    output.set(i, points[i]);
+  }
+}
+
+void audio_transport::spectral::to_points(
+    const frame & input,
+    std::vector<point> & output) {
+  output.resize(input.size());
+  for (size_t i = 0; i < input.size(); i++) {
+    output[i] = input.get(i);
+  }
+}
+
+audio_transport::spectral::frame audio_transport::spectral::to_frame(
+    const std::vector<point> & points) {
+  frame output;
+  to_frame(points, output);
+  return output;
+}
+
+std::vector<audio_transport::spectral::point> audio_transport::spectral::to_points(
+    const frame & input) {
+  std::vector<point> output;
+  to_points(input, output);
+  return output;
+}
+
+std::vector<audio_transport::spectral::frame> audio_transport::spectral::to_frames(
+    const std::vector<std::vector<point>> & points) {
+  std::vector<frame> frames(points.size());
+  for (size_t w = 0; w < points.size(); w++) {
+    to_frame(points[w], frames[w]);
+  }
+  return frames;
+}
+
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::to_points(
+    const std::vector<frame> & frames) {
+  std::vector<std::vector<point>> points(frames.size());
+  for (size_t w = 0; w < frames.size(); w++) {
+    to_points(frames[w], points[w]);
+  }
+  return points;
+}
+
+// Accessors that let analysis and synthesis fill either layout
+static std::complex<double> bin_value(
+    const std::vector<spectral::point> & window, size_t i) {
+  return window[i].value;
+}
+
+static std::complex<double> bin_value(
+    const spectral::frame & window, size_t i) {
+  return window.value(i);
+}
+
+static void begin_window(
+    std::vector<spectral::point> & window, size_t fft_size, double) {
+  window.reserve(fft_size);
+}
+
+static void begin_window(
+    spectral::frame & window, size_t fft_size, double time) {
+  window.resize(fft_size);
+  window.time = time;
+}
+
+static void store_bin(
+    std::vector<spectral::point> & window, size_t, const spectral::point & p) {
+  window.push_back(p);
+}
+
+static void store_bin(
+    spectral::frame & window, size_t i, const spectral::point & p) {
+  window.set(i, p);
+}
+
+audio_transport::spectral::window_workspace::window_workspace(size_t N_padded)
+  : windows(3 * fft_plans::real_distance(N_padded), 0),
+    spectra(2 * 3 * fft_plans::complex_distance(N_padded)),
+    synthesized(N_padded) {
+}
+
+static fftw_complex * as_complex(aligned_vector<double> & interleaved) {
+  return reinterpret_cast<fftw_complex*>(interleaved.data());
+}
+
+audio_transport::spectral::synthesis_layout audio_transport::spectral::get_synthesis_layout(
+    size_t num_bins,
+    size_t num_windows,
+    unsigned int padding,
+    unsigned int overlap) {
+  synthesis_layout layout;
+  layout.N_padded = 2 * (num_bins - 1);
+  layout.window_size = layout.N_padded/(1 + padding);
+  layout.padding_samples = (layout.N_padded - layout.window_size)/2;
+  layout.overlap = overlap;
+
+  // Accounting for an overlap factor of 2 * overlap
+  layout.hop_size = layout.window_size/(2 * overlap);
+  layout.num_windows = num_windows;
+  layout.num_samples = (num_windows + 2 * overlap - 1) * layout.hop_size;
+
+  layout.plan = fft_plans::get<double>(layout.N_padded, fft_plans::inverse);
+  return layout;
+}
+
+template <typename Window>
+static void synthesize_window_impl(
+    const Window & window,
+    const spectral::synthesis_layout & layout,
+    double * output,
+    spectral::window_workspace & workspace) {
+
+  // Fill the FFT
+  fftw_complex * fft = as_complex(workspace.spectra);
+  for (size_t i = 0; i < window.size(); i++) {
+    std::complex<double> value = bin_value(window, i);
+    fft[i][0] = std::real(value);
+    fft[i][1] = std::imag(value);
+  }
+
+  // Execute the plans
+  double * window_padded = workspace.synthesized.data();
+  fftw_execute_dft_c2r(layout.plan, fft, window_padded);
+
+  // Clamp NaN/Inf values to prevent audio corruption, in one pass so
+  // the overlap-add below is branch-free
+  double * window_samples = window_padded + layout.padding_samples;
+  size_t invalid = audio_transport::vector_math::sanitize(window_samples, layout.window_size);
+  if (invalid) {
+    audio_transport::diagnostics::report(
+        audio_transport::diagnostics::event::invalid_sample, -1, static_cast<double>(invalid));
+  }
+
+  // Apply the weighted overlap add, scaled down to correct for FFT and
+  // overlap sizes
+  for (size_t i = 0; i < layout.window_size; i++) {
+    output[i] += window_samples[i]/(layout.overlap * layout.N_padded);
+  }
+}
+
+void audio_transport::spectral::synthesize_window(
+    const frame & window,
+    const synthesis_layout & layout,
+    double * output,
+    window_workspace & workspace) {
+  synthesize_window_impl(window, layout, output, workspace);
+}
+
+template <typename Window>
+static std::vector<double> synthesis_impl(
+    const std::vector<Window> & points,
     unsigned int padding,
     unsigned int overlap) {
 
-  // Initialize the window
-  std::vector<double> window_padded(2 * (points[0].size() - 1));
-  size_t window_size = window_padded.size()/(1 + padding);
-  size_t padding_samples = (window_padded.size() - window_size)/2;
+  spectral::synthesis_layout layout = spectral::get_synthesis_layout(
+      points[0].size(), points.size(), padding, overlap);
+  spectral::window_workspace workspace(layout.N_padded);
 
   // Initialize the audio
-  // Accounting for an overlap factor of 2 * overlap
-  size_t hop_size = window_size/(2 * overlap);
-  size_t num_hops = points.size() + 2 * overlap - 1;
-  std::vector<double> audio(num_hops * hop_size, 0);
-
-  // Initialize FFT
-  fftw_complex * fft;
-  fft = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * points[0].size());
-  fftw_plan fft_plan = fftw_plan_dft_c2r_1d(
-      window_padded.size(),
-      fft,
-      window_padded.data(),
-      FFTW_MEASURE);
+  std::vector<double> audio(layout.num_samples, 0);
 
   // Iterate over the windows
   for (size_t w = 0; w < points.size(); w++) {
-
-    // Fill the FFT
-    for (size_t i = 0; i < points[w].size(); i++) {
-      fft[i][0] = std::real(points[w][i].value);
-      fft[i][1] = std::imag(points[w][i].value);
-    }
-    
-    // Execute the plans
-    fftw_execute(fft_plan);
-
-    // Apply the weighted overlap add
-    for (size_t i = 0; i < window_size; i++) {
-      // Scale down to correct for FFT and overlap sizes
-      double value = window_padded[i + padding_samples]/(overlap * window_padded.size());
-
-      // Safety check: clamp NaN/Inf values to prevent audio corruption
-      if (!std::isfinite(value)) {
-        value = 0;
-      }
-
-      // Add it to the overlapped signal
-      audio[i + w * window_size/(2 * overlap)] += value;
-    }
+    synthesize_window_impl(points[w], layout, audio.data() + w * layout.hop_size, workspace);
   }
 
-  // Cleanup
-  fftw_destroy_plan(fft_plan);
-  fftw_free(fft);
-
   return audio;
 }
 
-std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::analysis(
-    const std::vector<double> & audio,
+std::vector<double> audio_transport::spectral::synthesis(
+    const std::vector<std::vector<spectral::point>> & points,
+    unsigned int padding,
+    unsigned int overlap) {
+  return synthesis_impl(points, padding, overlap);
+}
+
+std::vector<double> audio_transport::spectral::synthesis(
+    const std::vector<spectral::frame> & frames,
+    unsigned int padding,
+    unsigned int overlap) {
+  return synthesis_impl(frames, padding, overlap);
+}
+
+audio_transport::spectral::analysis_layout audio_transport::spectral::get_analysis_layout(
+    size_t num_samples,
     double sample_rate,
     double window_size,
     unsigned int padding,
@@ -80,119 +252,206 @@ std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spec
   assert(sample_rate > 0);
   assert(window_size > 0);
 
+  analysis_layout layout;
+  layout.sample_rate = sample_rate;
+
   // Convert the window size to samples
-  size_t N = std::round(window_size * sample_rate);
+  layout.N = std::round(window_size * sample_rate);
   // Make sure it is even for symmetry
-  while (N % (2 * overlap) != 0) N += 1;
-  size_t N_padded = N * (1 + padding);
-  // Initialize the windows
-  std::vector<double> window(N_padded, 0), window_t(N_padded, 0), window_d(N_padded, 0);
+  while (layout.N % (2 * overlap) != 0) layout.N += 1;
+  layout.N_padded = layout.N * (1 + padding);
 
   // Determine samples used for padding
-  size_t padding_samples = (N_padded - N)/2;
+  layout.padding_samples = (layout.N_padded - layout.N)/2;
 
   // Compute the number of windows
   // Accounting for an overlap factor of 2 * overlap
-  size_t num_hops = std::floor(audio.size()/(N/(2 * overlap)));
-  size_t num_windows = num_hops - (2 * overlap - 1);
-
-  // Initialize FFT
-  size_t fft_size = N_padded/2 + 1;
-  fftw_complex * fft, * fft_t, * fft_d;
-  fft   = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
-  fft_t = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
-  fft_d = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * fft_size);
-  fftw_plan fft_plan    = fftw_plan_dft_r2c_1d(
-      window.size(),
-      window.data(),
-      fft,
-      FFTW_MEASURE);
-  fftw_plan fft_plan_t  = fftw_plan_dft_r2c_1d(
-      window_t.size(),
-      window_t.data(),
-      fft_t,
-      FFTW_MEASURE);
-  fftw_plan fft_plan_d  = fftw_plan_dft_r2c_1d(
-      window_d.size(),
-      window_d.data(),
-      fft_d,
-      FFTW_MEASURE);
+  layout.hop_size = layout.N/(2 * overlap);
+  size_t num_hops = std::floor(num_samples/layout.hop_size);
+  layout.num_windows = num_hops >= 2 * overlap ? num_hops - (2 * overlap - 1) : 0;
+
+  layout.tables = get_window_tables(layout.N, sample_rate);
+  // One shared, batched plan transforms all three windows (it was
+  // measured on scratch, so the zero padding of the workspace
+  // survives planning)
+  layout.plan = fft_plans::get<double>(layout.N_padded, fft_plans::forward, 3);
+  return layout;
+}
+
+template <typename Window>
+static void analyze_window_impl(
+    const double * audio_window,
+    const spectral::analysis_layout & layout,
+    size_t w,
+    Window & output,
+    spectral::window_workspace & workspace) {
+
+  size_t fft_size = layout.N_padded/2 + 1;
+  double sample_rate = layout.sample_rate;
+
+  // Compute the center time
+  double t = ((layout.N - 1)/2. + w * layout.hop_size)/sample_rate;
+
+  // Reserve space for each spectral point in each channel
+  begin_window(output, fft_size, t);
+
+  // Apply the various windows to the audio
+  // accounting for overlap of 2 * overlap
+  size_t real_distance = fft_plans::real_distance(layout.N_padded);
+  size_t complex_distance = fft_plans::complex_distance(layout.N_padded);
+  double * window = workspace.windows.data();
+  spectral::apply_windows(
+      *layout.tables,
+      audio_window,
+      window                     + layout.padding_samples,
+      window +     real_distance + layout.padding_samples,
+      window + 2 * real_distance + layout.padding_samples);
+
+  // Transform all three in one batch
+  fftw_complex * fft   = as_complex(workspace.spectra);
+  fftw_complex * fft_t = fft +     complex_distance;
+  fftw_complex * fft_d = fft + 2 * complex_distance;
+  fftw_execute_dft_r2c(layout.plan, window, fft);
+
+  for (size_t i = 0; i < fft_size; i++) {
+    // Convert to C++ complex
+    std::complex<double> X   (fft   [i][0], fft   [i][1]);
+    std::complex<double> X_t (fft_t [i][0], fft_t [i][1]);
+    std::complex<double> X_d (fft_d [i][0], fft_d [i][1]);
+
+    // Begin to construct a spectral point
+    spectral::point p;
+    p.value = X;
+    p.time = t;
+    p.freq = (2 * M_PI * i * sample_rate)/(double) layout.N_padded;
+
+    // Compute how the frequency and time changed
+    // Guard against division by zero when X is very small (silent bins)
+    double norm_X = std::norm(X);
+    if (norm_X > 1e-20) {
+      std::complex<double> conj_over_norm = std::conj(X)/norm_X;
+      double dphase_domega =  std::real(X_t * conj_over_norm);
+      double dphase_dt     = -std::imag(X_d * conj_over_norm);
+
+      // Compute the reassigned time and frequency
+      p.time_reassigned = p.time + dphase_domega;
+      p.freq_reassigned = p.freq + dphase_dt;
+    } else {
+      // For silent/near-silent bins, don't reassign
+      p.time_reassigned = p.time;
+      p.freq_reassigned = p.freq;
+    }
+
+    // Add the point
+    store_bin(output, i, p);
+  }
+}
+
+void audio_transport::spectral::analyze_window(
+    const double * audio_window,
+    const analysis_layout & layout,
+    size_t w,
+    frame & output,
+    window_workspace & workspace) {
+  analyze_window_impl(audio_window, layout, w, output, workspace);
+}
+
+template <typename Window>
+static std::vector<Window> analysis_impl(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+
+  spectral::analysis_layout layout = spectral::get_analysis_layout(
+      audio.size(), sample_rate, window_size, padding, overlap);
+  spectral::window_workspace workspace(layout.N_padded);
 
   // Initialize the spectral points
-  std::vector<std::vector<spectral::point>> points(num_windows);
+  std::vector<Window> points(layout.num_windows);
 
   // Iterate over the windows
-  for (size_t w = 0; w < num_windows; w++) {
+  for (size_t w = 0; w < layout.num_windows; w++) {
+    analyze_window_impl(
+        audio.data() + w * layout.hop_size, layout, w, points[w], workspace);
+  }
 
-    // Reserve space for each spectral point in each channel
-    points[w].reserve(fft_size);
+  return points;
+}
 
-    // Apply the various windows
-    for (size_t i = 0; i < N; i++) {
-      // The sample index of with window
-      // if the center of the window has n = 0
-      double n = i - (N - 1)/2.;
+std::vector<std::vector<audio_transport::spectral::point>> audio_transport::spectral::analysis(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+  return analysis_impl<std::vector<spectral::point>>(
+      audio, sample_rate, window_size, padding, overlap);
+}
 
-      // The audio sample to window accounting for overlap of 2 * overlap
-      double a = audio[i + w * N/(2 * overlap)];
+std::vector<audio_transport::spectral::frame> audio_transport::spectral::analysis_frames(
+    const std::vector<double> & audio,
+    double sample_rate,
+    double window_size,
+    unsigned int padding,
+    unsigned int overlap) {
+  return analysis_impl<spectral::frame>(
+      audio, sample_rate, window_size, padding, overlap);
+}
 
-      // Apply the various windows
-      window  [i + padding_samples] = a * hann  (n, N);
-      window_t[i + padding_samples] = a * hann_t(n, N, sample_rate);
-      window_d[i + padding_samples] = a * hann_d(n, N, sample_rate);
+std::shared_ptr<const audio_transport::spectral::window_tables>
+audio_transport::spectral::get_window_tables(
+    size_t N,
+    double sample_rate,
+    size_t L) {
+
+  if (L == 0 || L > N) L = N;
+  assert(L == N || (L >= 2 && L % 2 == 0));
+
+  typedef std::tuple<size_t, double, size_t> key;
+  static std::mutex mutex;
+  static std::map<key, std::weak_ptr<const window_tables>> cache;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  std::weak_ptr<const window_tables> & entry = cache[key(N, sample_rate, L)];
+  std::shared_ptr<const window_tables> tables = entry.lock();
+  if (tables) return tables;
+
+  std::shared_ptr<window_tables> built = std::make_shared<window_tables>();
+  built->N = N;
+  built->L = L;
+  built->sample_rate = sample_rate;
+  built->hann.resize(N);
+  built->hann_t.resize(N);
+  built->hann_d.resize(N);
+  for (size_t i = 0; i < N; i++) {
+    if (L < N) {
+      built->hann  [i] = asymmetric  (i, N, L);
+      built->hann_t[i] = asymmetric_t(i, N, L, sample_rate);
+      built->hann_d[i] = asymmetric_d(i, N, L, sample_rate);
+      continue;
     }
 
-    // Execute the plans
-    fftw_execute(fft_plan);
-    fftw_execute(fft_plan_t);
-    fftw_execute(fft_plan_d);
-
-    // Compute the center time
-    double t = ((N - 1)/2. + w * N/(2 * overlap))/sample_rate;
-
-    for (size_t i = 0; i < fft_size; i++) {
-      // Convert to C++ complex
-      std::complex<double> X   (fft   [i][0], fft   [i][1]);
-      std::complex<double> X_t (fft_t [i][0], fft_t [i][1]);
-      std::complex<double> X_d (fft_d [i][0], fft_d [i][1]);
-
-      // Begin to construct a spectral point
-      spectral::point p;
-      p.value = X;
-      p.time = t;
-      p.freq = (2 * M_PI * i * sample_rate)/(double) N_padded;
-
-      // Compute how the frequency and time changed
-      // Guard against division by zero when X is very small (silent bins)
-      double norm_X = std::norm(X);
-      if (norm_X > 1e-20) {
-        std::complex<double> conj_over_norm = std::conj(X)/norm_X;
-        double dphase_domega =  std::real(X_t * conj_over_norm);
-        double dphase_dt     = -std::imag(X_d * conj_over_norm);
-
-        // Compute the reassigned time and frequency
-        p.time_reassigned = p.time + dphase_domega;
-        p.freq_reassigned = p.freq + dphase_dt;
-      } else {
-        // For silent/near-silent bins, don't reassign
-        p.time_reassigned = p.time;
-        p.freq_reassigned = p.freq;
-      }
-
-      // Add the point
-      points[w].push_back(p);
-    }
+    // The sample index of with window
+    // if the center of the window has n = 0
+    double n = i - (N - 1)/2.;
+    built->hann  [i] = hann  (n, N);
+    built->hann_t[i] = hann_t(n, N, sample_rate);
+    built->hann_d[i] = hann_d(n, N, sample_rate);
   }
 
-  // Cleanup
-  fftw_destroy_plan(fft_plan);
-  fftw_destroy_plan(fft_plan_t);
-  fftw_destroy_plan(fft_plan_d);
-  fftw_free(fft);
-  fftw_free(fft_t);
-  fftw_free(fft_d);
+  if (L < N) {
+    // The analysis window is positive throughout, so this is finite
+    built->synthesis.resize(L);
+    for (size_t j = 0; j < L; j++) {
+      built->synthesis[j] = hann(j - (L - 1)/2., L)/built->hann[N - L + j];
+    }
+  }
 
-  return points;
+  entry = built;
+  return built;
 }
 
 double audio_transport::spectral::hann(
@@ -214,3 +473,37 @@ double audio_transport::spectral::hann_d(
     double sample_rate) {
   return - (M_PI * sample_rate)/(N - 1) * std::sin(2 * M_PI * n/(N - 1));
 }
+
+double audio_transport::spectral::asymmetric(
+    double i,
+    double N,
+    double L) {
+  // Half-sample offsets keep both ends nonzero, so the synthesis
+  // window never divides by zero
+  double rise = N - L/2;
+  if (i < rise) {
+    return std::sin(M_PI/2 * (i + 0.5)/rise);
+  }
+  return std::cos(M_PI/2 * (i - rise + 0.5)/(L/2));
+}
+
+double audio_transport::spectral::asymmetric_t(
+    double i,
+    double N,
+    double L,
+    double sample_rate) {
+  double n = i - (N - 1)/2.;
+  return (n/sample_rate) * asymmetric(i, N, L);
+}
+
+double audio_transport::spectral::asymmetric_d(
+    double i,
+    double N,
+    double L,
+    double sample_rate) {
+  double rise = N - L/2;
+  if (i < rise) {
+    return (M_PI * sample_rate)/(2 * rise) * std::cos(M_PI/2 * (i + 0.5)/rise);
+  }
+  return - (M_PI * sample_rate)/L * std::sin(M_PI/2 * (i - rise + 0.5)/(L/2));
+}
@@ -0,0 +1,180 @@
+#include "audio_transport/target_spectrum.hpp"
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace audio_transport {
+
+// File signature; the last character is the format version
+static const char MAGIC[8] = { 'A', 'T', 'T', 'A', 'R', 'G', 'T', '1' };
+
+bool target_spectrum::analysis::operator==(const analysis& other) const {
+    return engine == other.engine && sample_rate == other.sample_rate
+        && fft_size == other.fft_size && window_size == other.window_size
+        && synthesis_size == other.synthesis_size && hop_size == other.hop_size;
+}
+
+target_spectrum::target_spectrum(const analysis& settings, mode playback, std::vector<frame> frames)
+    : settings_(settings), playback_(playback), frames_(std::move(frames)) {}
+
+target_spectrum::frame target_spectrum::average(const std::vector<frame>& frames) {
+    const frame& first = frames.front();
+    size_t num_bins = first.magnitudes.size();
+    bool offsets = !first.freq_offsets.empty();
+
+    frame mean;
+    mean.magnitudes.assign(num_bins, 0.0f);
+    mean.phases.assign(num_bins, 0.0f);
+    if (offsets) mean.freq_offsets.assign(num_bins, 0.0f);
+
+    // Sums in double; the phases come from the loudest frame so that
+    // the partials of one hop stay aligned with each other
+    std::vector<double> magnitude_sums(num_bins, 0.0), offset_sums(num_bins, 0.0);
+    double loudest = -1;
+    for (const frame& f : frames) {
+        double total = 0;
+        for (size_t i = 0; i < num_bins; i++) {
+            magnitude_sums[i] += f.magnitudes[i];
+            if (offsets) offset_sums[i] += double(f.magnitudes[i]) * f.freq_offsets[i];
+            total += f.magnitudes[i];
+        }
+        if (total > loudest) {
+            loudest = total;
+            mean.phases = f.phases;
+        }
+        mean.silent = mean.silent && f.silent;
+    }
+
+    for (size_t i = 0; i < num_bins; i++) {
+        mean.magnitudes[i] = static_cast<float>(magnitude_sums[i] / frames.size());
+        if (offsets && magnitude_sums[i] > 0) {
+            mean.freq_offsets[i] = static_cast<float>(offset_sums[i] / magnitude_sums[i]);
+        }
+    }
+    return mean;
+}
+
+//==============================================================================
+// The file is the analysis fields in declaration order and the mode,
+// then each frame's silence flag, arrays and masses. Every count is
+// written as a uint64_t ahead of its array; bins are uint32_t.
+
+template <typename T>
+static void write_value(std::ostream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read_value(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static void write_array(std::ostream& out, const std::vector<float>& values) {
+    write_value<uint64_t>(out, values.size());
+    out.write(reinterpret_cast<const char*>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(float)));
+}
+
+// Only arrays of the expected size are accepted
+static bool read_array(std::istream& in, std::vector<float>& values, size_t expected) {
+    uint64_t size;
+    if (!read_value(in, size) || size != expected) return false;
+    values.resize(static_cast<size_t>(size));
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()),
+                                     static_cast<std::streamsize>(size * sizeof(float))));
+}
+
+bool target_spectrum::save(const std::string& path) const {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    if (!out) return false;
+
+    out.write(MAGIC, sizeof(MAGIC));
+    write_value<uint32_t>(out, static_cast<uint32_t>(settings_.engine));
+    write_value(out, settings_.sample_rate);
+    write_value(out, settings_.fft_size);
+    write_value(out, settings_.window_size);
+    write_value(out, settings_.synthesis_size);
+    write_value(out, settings_.hop_size);
+    write_value<uint32_t>(out, static_cast<uint32_t>(playback_));
+
+    write_value<uint64_t>(out, frames_.size());
+    for (const frame& f : frames_) {
+        write_value<uint8_t>(out, f.silent ? 1 : 0);
+        write_array(out, f.magnitudes);
+        write_array(out, f.phases);
+        write_array(out, f.freq_offsets);
+
+        write_value<uint64_t>(out, f.masses.size());
+        for (const spectral_mass& mass : f.masses) {
+            write_value<uint32_t>(out, static_cast<uint32_t>(mass.left_bin));
+            write_value<uint32_t>(out, static_cast<uint32_t>(mass.right_bin));
+            write_value<uint32_t>(out, static_cast<uint32_t>(mass.center_bin));
+            write_value(out, mass.mass);
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool target_spectrum::load(const std::string& path) {
+    *this = target_spectrum();
+    target_spectrum loaded;
+
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return false;
+    }
+
+    analysis& settings = loaded.settings_;
+    uint32_t engine, playback;
+    if (!read_value(in, engine) || !read_value(in, settings.sample_rate) ||
+        !read_value(in, settings.fft_size) || !read_value(in, settings.window_size) ||
+        !read_value(in, settings.synthesis_size) || !read_value(in, settings.hop_size) ||
+        !read_value(in, playback)) return false;
+    if (engine != static_cast<uint32_t>(algorithm::cdf) &&
+        engine != static_cast<uint32_t>(algorithm::reassignment)) return false;
+    if (playback > static_cast<uint32_t>(mode::time_indexed)) return false;
+    settings.engine = static_cast<algorithm>(engine);
+    loaded.playback_ = static_cast<mode>(playback);
+
+    // Settings no engine could have been built with would only make
+    // the arrays below fail
+    if (!(settings.sample_rate > 0) || settings.fft_size < 2 || settings.fft_size > (1u << 24) ||
+        settings.window_size == 0 || settings.window_size > settings.fft_size ||
+        settings.hop_size == 0 || settings.synthesis_size > settings.window_size) return false;
+    const size_t num_bins = settings.num_bins();
+    const bool reassignment = settings.engine == algorithm::reassignment;
+
+    uint64_t num_frames;
+    if (!read_value(in, num_frames) || num_frames == 0) return false;
+    if (playback == static_cast<uint32_t>(mode::averaged) && num_frames != 1) return false;
+    for (uint64_t n = 0; n < num_frames; n++) {
+        frame f;
+        uint8_t silent;
+        if (!read_value(in, silent) ||
+            !read_array(in, f.magnitudes, num_bins) ||
+            !read_array(in, f.phases, num_bins) ||
+            !read_array(in, f.freq_offsets, reassignment ? num_bins : 0)) return false;
+        f.silent = silent != 0;
+
+        uint64_t count;
+        if (!read_value(in, count) || count > num_bins) return false;
+        if (reassignment ? count == 0 && !f.silent : count != 0) return false;
+        f.masses.resize(static_cast<size_t>(count));
+        for (spectral_mass& mass : f.masses) {
+            uint32_t left_bin, right_bin, center_bin;
+            if (!read_value(in, left_bin) || !read_value(in, right_bin) ||
+                !read_value(in, center_bin) || !read_value(in, mass.mass)) return false;
+            if (left_bin > right_bin || right_bin > num_bins || center_bin >= num_bins) return false;
+            mass.left_bin = left_bin;
+            mass.right_bin = right_bin;
+            mass.center_bin = center_bin;
+        }
+        loaded.frames_.push_back(std::move(f));
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
+
+} // namespace audio_transport
@@ -0,0 +1,130 @@
+#include "audio_transport/transport_stream.hpp"
+#include "audio_transport/equal_loudness.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace audio_transport {
+
+transport_stream::input::input(source pull, double sample_rate,
+                               const transport_settings& settings)
+    : pull(pull),
+      layout(spectral::get_analysis_layout(0, sample_rate, settings.window_size,
+                                           settings.padding, settings.overlap)),
+      workspace(layout.N_padded),
+      buffer(layout.N, 0) {}
+
+bool transport_stream::input::advance(size_t w) {
+    // The first window reads N samples, each later one a hop more
+    size_t keep = 0;
+    if (w > 0) {
+        keep = layout.N - layout.hop_size;
+        std::copy(buffer.begin() + layout.hop_size, buffer.end(), buffer.begin());
+    }
+
+    while (keep < layout.N) {
+        size_t count = pull(buffer.data() + keep, layout.N - keep);
+        if (count == 0) return false;
+        assert(count <= layout.N - keep);
+        keep += count;
+    }
+    return true;
+}
+
+transport_stream::transport_stream(source left, double left_sample_rate,
+                                   source right, double right_sample_rate,
+                                   const transport_settings& settings,
+                                   size_t num_windows)
+    : settings_(settings),
+      num_windows_(num_windows),
+      left_(left, left_sample_rate, settings),
+      right_(right, right_sample_rate, settings),
+      // Interpolated frames share the bins of left
+      output_layout_(spectral::get_synthesis_layout(
+          left_.layout.N_padded/2 + 1, 0, settings.padding, settings.overlap)),
+      output_workspace_(output_layout_.N_padded),
+      interpolate_workspace_(left_.layout.N_padded/2 + 1),
+      phases_(left_.layout.N_padded/2 + 1, 0),
+      overlap_(output_layout_.window_size, 0) {
+
+    assert(settings_.interpolation);
+    assert((2 * settings_.overlap - 1) * output_layout_.hop_size <= overlap_.size());
+    pending_.reserve(overlap_.size());
+}
+
+size_t transport_stream::num_windows(size_t left_length, double left_sample_rate,
+                                     size_t right_length, double right_sample_rate,
+                                     const transport_settings& settings) {
+    spectral::analysis_layout left = spectral::get_analysis_layout(
+        left_length, left_sample_rate,
+        settings.window_size, settings.padding, settings.overlap);
+    spectral::analysis_layout right = spectral::get_analysis_layout(
+        right_length, right_sample_rate,
+        settings.window_size, settings.padding, settings.overlap);
+    return std::min(left.num_windows, right.num_windows);
+}
+
+void transport_stream::step() {
+    size_t hop = output_layout_.hop_size;
+    pending_.clear();
+    pending_position_ = 0;
+
+    if (!left_.advance(window_) || !right_.advance(window_)) {
+        // Every window that reaches the tail has been added
+        if (window_ > 0) {
+            size_t tail = (2 * settings_.overlap - 1) * hop;
+            pending_.assign(overlap_.begin(), overlap_.begin() + tail);
+        }
+        finished_ = true;
+        return;
+    }
+
+    spectral::analyze_window(left_.buffer.data(), left_.layout, window_,
+                             left_.frame, left_.workspace);
+    spectral::analyze_window(right_.buffer.data(), right_.layout, window_,
+                             right_.frame, right_.workspace);
+    if (settings_.equal_loudness) {
+        equal_loudness::apply(left_.frame);
+        equal_loudness::apply(right_.frame);
+    }
+
+    double k = settings_.interpolation(window_, num_windows_);
+    interpolate(left_.frame, right_.frame, phases_, settings_.window_size, k,
+                output_frame_, interpolate_workspace_);
+    if (settings_.on_window) {
+        settings_.on_window(window_, left_.frame, right_.frame, output_frame_);
+    }
+    if (settings_.equal_loudness) {
+        equal_loudness::remove(output_frame_);
+    }
+
+    spectral::synthesize_window(output_frame_, output_layout_, overlap_.data(),
+                                output_workspace_);
+
+    // Later windows start past the first hop, so it is finished
+    pending_.assign(overlap_.begin(), overlap_.begin() + hop);
+    std::copy(overlap_.begin() + hop, overlap_.end(), overlap_.begin());
+    std::fill(overlap_.end() - hop, overlap_.end(), 0.0);
+
+    window_++;
+}
+
+size_t transport_stream::read(double* output, size_t count) {
+    size_t written = 0;
+    while (written < count) {
+        if (pending_position_ == pending_.size()) {
+            if (finished_) break;
+            step();
+            continue;
+        }
+
+        size_t n = std::min(count - written, pending_.size() - pending_position_);
+        std::copy(pending_.begin() + pending_position_,
+                  pending_.begin() + pending_position_ + n,
+                  output + written);
+        pending_position_ += n;
+        written += n;
+    }
+    return written;
+}
+
+} // namespace audio_transport
@@ -0,0 +1,743 @@
+#include "audio_transport/vector_math.hpp"
+#include <cmath>
+#include <limits>
+
+#ifndef AUDIO_TRANSPORT_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AUDIO_TRANSPORT_SIMD_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AUDIO_TRANSPORT_SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define AUDIO_TRANSPORT_SIMD_NEON
+#endif
+#endif
+
+namespace audio_transport {
+namespace vector_math {
+
+namespace {
+
+//==============================================================================
+// Packs
+//
+// Each pack wraps one register of the target instruction set and
+// provides the handful of operations the kernels below need. The
+// scalar pack is used for loop tails and when no SIMD is available,
+// so every element goes through the same arithmetic.
+//==============================================================================
+
+template <typename T>
+struct scalar_mask {
+    bool v;
+};
+
+template <typename T>
+struct scalar_pack {
+    typedef T scalar;
+    typedef scalar_mask<T> mask;
+    static const size_t width = 1;
+
+    T v;
+
+    static scalar_pack splat(T x) { return {x}; }
+    static scalar_pack load(const T* p) { return {*p}; }
+    void store(T* p) const { *p = v; }
+
+    static void load2(const T* p, scalar_pack& re, scalar_pack& im) {
+        re.v = p[0];
+        im.v = p[1];
+    }
+    static void store2(T* p, scalar_pack re, scalar_pack im) {
+        p[0] = re.v;
+        p[1] = im.v;
+    }
+};
+
+template <typename T> inline scalar_pack<T> operator+(scalar_pack<T> a, scalar_pack<T> b) { return {a.v + b.v}; }
+template <typename T> inline scalar_pack<T> operator-(scalar_pack<T> a, scalar_pack<T> b) { return {a.v - b.v}; }
+template <typename T> inline scalar_pack<T> operator*(scalar_pack<T> a, scalar_pack<T> b) { return {a.v * b.v}; }
+template <typename T> inline scalar_pack<T> operator/(scalar_pack<T> a, scalar_pack<T> b) { return {a.v / b.v}; }
+template <typename T> inline scalar_pack<T> operator-(scalar_pack<T> a) { return {-a.v}; }
+template <typename T> inline scalar_mask<T> operator>(scalar_pack<T> a, scalar_pack<T> b) { return {a.v > b.v}; }
+template <typename T> inline scalar_mask<T> operator<=(scalar_pack<T> a, scalar_pack<T> b) { return {a.v <= b.v}; }
+template <typename T> inline scalar_mask<T> operator==(scalar_pack<T> a, scalar_pack<T> b) { return {a.v == b.v}; }
+template <typename T> inline scalar_mask<T> operator|(scalar_mask<T> a, scalar_mask<T> b) { return {a.v || b.v}; }
+template <typename T> inline bool all(scalar_mask<T> m) { return m.v; }
+template <typename T> inline scalar_pack<T> select(scalar_mask<T> m, scalar_pack<T> a, scalar_pack<T> b) { return {m.v ? a.v : b.v}; }
+template <typename T> inline scalar_pack<T> vabs(scalar_pack<T> a) { return {std::fabs(a.v)}; }
+template <typename T> inline scalar_pack<T> vsqrt(scalar_pack<T> a) { return {std::sqrt(a.v)}; }
+template <typename T> inline scalar_pack<T> vtrunc(scalar_pack<T> a) { return {std::trunc(a.v)}; }
+template <typename T> inline scalar_mask<T> negative(scalar_pack<T> a) { return {std::signbit(a.v)}; }
+template <typename T> inline scalar_pack<T> xor_sign(scalar_pack<T> a, scalar_pack<T> s) { return {std::signbit(s.v) ? -a.v : a.v}; }
+
+#if defined(AUDIO_TRANSPORT_SIMD_SSE2)
+
+struct mask_f64 { __m128d v; };
+struct mask_f32 { __m128 v; };
+
+struct pack_f64 {
+    typedef double scalar;
+    typedef mask_f64 mask;
+    static const size_t width = 2;
+
+    __m128d v;
+
+    static pack_f64 splat(double x) { return {_mm_set1_pd(x)}; }
+    static pack_f64 load(const double* p) { return {_mm_loadu_pd(p)}; }
+    void store(double* p) const { _mm_storeu_pd(p, v); }
+
+    static void load2(const double* p, pack_f64& re, pack_f64& im) {
+        __m128d a = _mm_loadu_pd(p);
+        __m128d b = _mm_loadu_pd(p + 2);
+        re.v = _mm_unpacklo_pd(a, b);
+        im.v = _mm_unpackhi_pd(a, b);
+    }
+    static void store2(double* p, pack_f64 re, pack_f64 im) {
+        _mm_storeu_pd(p, _mm_unpacklo_pd(re.v, im.v));
+        _mm_storeu_pd(p + 2, _mm_unpackhi_pd(re.v, im.v));
+    }
+};
+
+struct pack_f32 {
+    typedef float scalar;
+    typedef mask_f32 mask;
+    static const size_t width = 4;
+
+    __m128 v;
+
+    static pack_f32 splat(float x) { return {_mm_set1_ps(x)}; }
+    static pack_f32 load(const float* p) { return {_mm_loadu_ps(p)}; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    static void load2(const float* p, pack_f32& re, pack_f32& im) {
+        __m128 a = _mm_loadu_ps(p);
+        __m128 b = _mm_loadu_ps(p + 4);
+        re.v = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        im.v = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+    static void store2(float* p, pack_f32 re, pack_f32 im) {
+        _mm_storeu_ps(p, _mm_unpacklo_ps(re.v, im.v));
+        _mm_storeu_ps(p + 4, _mm_unpackhi_ps(re.v, im.v));
+    }
+};
+
+inline pack_f64 operator+(pack_f64 a, pack_f64 b) { return {_mm_add_pd(a.v, b.v)}; }
+inline pack_f64 operator-(pack_f64 a, pack_f64 b) { return {_mm_sub_pd(a.v, b.v)}; }
+inline pack_f64 operator*(pack_f64 a, pack_f64 b) { return {_mm_mul_pd(a.v, b.v)}; }
+inline pack_f64 operator/(pack_f64 a, pack_f64 b) { return {_mm_div_pd(a.v, b.v)}; }
+inline pack_f64 operator-(pack_f64 a) { return {_mm_xor_pd(a.v, _mm_set1_pd(-0.0))}; }
+inline mask_f64 operator>(pack_f64 a, pack_f64 b) { return {_mm_cmpgt_pd(a.v, b.v)}; }
+inline mask_f64 operator<=(pack_f64 a, pack_f64 b) { return {_mm_cmple_pd(a.v, b.v)}; }
+inline mask_f64 operator==(pack_f64 a, pack_f64 b) { return {_mm_cmpeq_pd(a.v, b.v)}; }
+inline mask_f64 operator|(mask_f64 a, mask_f64 b) { return {_mm_or_pd(a.v, b.v)}; }
+inline bool all(mask_f64 m) { return _mm_movemask_pd(m.v) == 0x3; }
+inline pack_f64 select(mask_f64 m, pack_f64 a, pack_f64 b) {
+    return {_mm_or_pd(_mm_and_pd(m.v, a.v), _mm_andnot_pd(m.v, b.v))};
+}
+inline pack_f64 vabs(pack_f64 a) { return {_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)}; }
+inline pack_f64 vsqrt(pack_f64 a) { return {_mm_sqrt_pd(a.v)}; }
+// Only used on non-negative values below 2^31
+inline pack_f64 vtrunc(pack_f64 a) { return {_mm_cvtepi32_pd(_mm_cvttpd_epi32(a.v))}; }
+inline mask_f64 negative(pack_f64 a) {
+    // Broadcast each sign bit across its 64-bit lane
+    __m128i hi = _mm_srai_epi32(_mm_castpd_si128(a.v), 31);
+    return {_mm_castsi128_pd(_mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 1, 1)))};
+}
+inline pack_f64 xor_sign(pack_f64 a, pack_f64 s) {
+    return {_mm_xor_pd(a.v, _mm_and_pd(s.v, _mm_set1_pd(-0.0)))};
+}
+
+inline pack_f32 operator+(pack_f32 a, pack_f32 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline pack_f32 operator-(pack_f32 a, pack_f32 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline pack_f32 operator*(pack_f32 a, pack_f32 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline pack_f32 operator/(pack_f32 a, pack_f32 b) { return {_mm_div_ps(a.v, b.v)}; }
+inline pack_f32 operator-(pack_f32 a) { return {_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))}; }
+inline mask_f32 operator>(pack_f32 a, pack_f32 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+inline mask_f32 operator<=(pack_f32 a, pack_f32 b) { return {_mm_cmple_ps(a.v, b.v)}; }
+inline mask_f32 operator==(pack_f32 a, pack_f32 b) { return {_mm_cmpeq_ps(a.v, b.v)}; }
+inline mask_f32 operator|(mask_f32 a, mask_f32 b) { return {_mm_or_ps(a.v, b.v)}; }
+inline bool all(mask_f32 m) { return _mm_movemask_ps(m.v) == 0xF; }
+inline pack_f32 select(mask_f32 m, pack_f32 a, pack_f32 b) {
+    return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+}
+inline pack_f32 vabs(pack_f32 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+inline pack_f32 vsqrt(pack_f32 a) { return {_mm_sqrt_ps(a.v)}; }
+// Only used on non-negative values below 2^31
+inline pack_f32 vtrunc(pack_f32 a) { return {_mm_cvtepi32_ps(_mm_cvttps_epi32(a.v))}; }
+inline mask_f32 negative(pack_f32 a) {
+    return {_mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(a.v), 31))};
+}
+inline pack_f32 xor_sign(pack_f32 a, pack_f32 s) {
+    return {_mm_xor_ps(a.v, _mm_and_ps(s.v, _mm_set1_ps(-0.0f)))};
+}
+
+#elif defined(AUDIO_TRANSPORT_SIMD_AVX2)
+
+struct mask_f64 { __m256d v; };
+struct mask_f32 { __m256 v; };
+
+struct pack_f64 {
+    typedef double scalar;
+    typedef mask_f64 mask;
+    static const size_t width = 4;
+
+    __m256d v;
+
+    static pack_f64 splat(double x) { return {_mm256_set1_pd(x)}; }
+    static pack_f64 load(const double* p) { return {_mm256_loadu_pd(p)}; }
+    void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+    static void load2(const double* p, pack_f64& re, pack_f64& im) {
+        __m256d a = _mm256_loadu_pd(p);
+        __m256d b = _mm256_loadu_pd(p + 4);
+        // Unpacking works per 128-bit lane; restore element order after
+        re.v = _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), 0xD8);
+        im.v = _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), 0xD8);
+    }
+    static void store2(double* p, pack_f64 re, pack_f64 im) {
+        __m256d r = _mm256_permute4x64_pd(re.v, 0xD8);
+        __m256d i = _mm256_permute4x64_pd(im.v, 0xD8);
+        _mm256_storeu_pd(p, _mm256_unpacklo_pd(r, i));
+        _mm256_storeu_pd(p + 4, _mm256_unpackhi_pd(r, i));
+    }
+};
+
+struct pack_f32 {
+    typedef float scalar;
+    typedef mask_f32 mask;
+    static const size_t width = 8;
+
+    __m256 v;
+
+    static pack_f32 splat(float x) { return {_mm256_set1_ps(x)}; }
+    static pack_f32 load(const float* p) { return {_mm256_loadu_ps(p)}; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    static void load2(const float* p, pack_f32& re, pack_f32& im) {
+        __m256 a = _mm256_loadu_ps(p);
+        __m256 b = _mm256_loadu_ps(p + 8);
+        __m256 r = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 i = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        re.v = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), 0xD8));
+        im.v = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(i), 0xD8));
+    }
+    static void store2(float* p, pack_f32 re, pack_f32 im) {
+        __m256 r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(re.v), 0xD8));
+        __m256 i = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(im.v), 0xD8));
+        _mm256_storeu_ps(p, _mm256_unpacklo_ps(r, i));
+        _mm256_storeu_ps(p + 8, _mm256_unpackhi_ps(r, i));
+    }
+};
+
+inline pack_f64 operator+(pack_f64 a, pack_f64 b) { return {_mm256_add_pd(a.v, b.v)}; }
+inline pack_f64 operator-(pack_f64 a, pack_f64 b) { return {_mm256_sub_pd(a.v, b.v)}; }
+inline pack_f64 operator*(pack_f64 a, pack_f64 b) { return {_mm256_mul_pd(a.v, b.v)}; }
+inline pack_f64 operator/(pack_f64 a, pack_f64 b) { return {_mm256_div_pd(a.v, b.v)}; }
+inline pack_f64 operator-(pack_f64 a) { return {_mm256_xor_pd(a.v, _mm256_set1_pd(-0.0))}; }
+inline mask_f64 operator>(pack_f64 a, pack_f64 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+inline mask_f64 operator<=(pack_f64 a, pack_f64 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)}; }
+inline mask_f64 operator==(pack_f64 a, pack_f64 b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)}; }
+inline mask_f64 operator|(mask_f64 a, mask_f64 b) { return {_mm256_or_pd(a.v, b.v)}; }
+inline bool all(mask_f64 m) { return _mm256_movemask_pd(m.v) == 0xF; }
+inline pack_f64 select(mask_f64 m, pack_f64 a, pack_f64 b) { return {_mm256_blendv_pd(b.v, a.v, m.v)}; }
+inline pack_f64 vabs(pack_f64 a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)}; }
+inline pack_f64 vsqrt(pack_f64 a) { return {_mm256_sqrt_pd(a.v)}; }
+inline pack_f64 vtrunc(pack_f64 a) { return {_mm256_round_pd(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)}; }
+inline mask_f64 negative(pack_f64 a) {
+    __m256i hi = _mm256_srai_epi32(_mm256_castpd_si256(a.v), 31);
+    return {_mm256_castsi256_pd(_mm256_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 1, 1)))};
+}
+inline pack_f64 xor_sign(pack_f64 a, pack_f64 s) {
+    return {_mm256_xor_pd(a.v, _mm256_and_pd(s.v, _mm256_set1_pd(-0.0)))};
+}
+
+inline pack_f32 operator+(pack_f32 a, pack_f32 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline pack_f32 operator-(pack_f32 a, pack_f32 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline pack_f32 operator*(pack_f32 a, pack_f32 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline pack_f32 operator/(pack_f32 a, pack_f32 b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline pack_f32 operator-(pack_f32 a) { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))}; }
+inline mask_f32 operator>(pack_f32 a, pack_f32 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline mask_f32 operator<=(pack_f32 a, pack_f32 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+inline mask_f32 operator==(pack_f32 a, pack_f32 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+inline mask_f32 operator|(mask_f32 a, mask_f32 b) { return {_mm256_or_ps(a.v, b.v)}; }
+inline bool all(mask_f32 m) { return _mm256_movemask_ps(m.v) == 0xFF; }
+inline pack_f32 select(mask_f32 m, pack_f32 a, pack_f32 b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+inline pack_f32 vabs(pack_f32 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline pack_f32 vsqrt(pack_f32 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline pack_f32 vtrunc(pack_f32 a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)}; }
+inline mask_f32 negative(pack_f32 a) {
+    return {_mm256_castsi256_ps(_mm256_srai_epi32(_mm256_castps_si256(a.v), 31))};
+}
+inline pack_f32 xor_sign(pack_f32 a, pack_f32 s) {
+    return {_mm256_xor_ps(a.v, _mm256_and_ps(s.v, _mm256_set1_ps(-0.0f)))};
+}
+
+#elif defined(AUDIO_TRANSPORT_SIMD_NEON)
+
+struct mask_f64 { uint64x2_t v; };
+struct mask_f32 { uint32x4_t v; };
+
+struct pack_f64 {
+    typedef double scalar;
+    typedef mask_f64 mask;
+    static const size_t width = 2;
+
+    float64x2_t v;
+
+    static pack_f64 splat(double x) { return {vdupq_n_f64(x)}; }
+    static pack_f64 load(const double* p) { return {vld1q_f64(p)}; }
+    void store(double* p) const { vst1q_f64(p, v); }
+
+    static void load2(const double* p, pack_f64& re, pack_f64& im) {
+        float64x2x2_t d = vld2q_f64(p);
+        re.v = d.val[0];
+        im.v = d.val[1];
+    }
+    static void store2(double* p, pack_f64 re, pack_f64 im) {
+        float64x2x2_t d;
+        d.val[0] = re.v;
+        d.val[1] = im.v;
+        vst2q_f64(p, d);
+    }
+};
+
+struct pack_f32 {
+    typedef float scalar;
+    typedef mask_f32 mask;
+    static const size_t width = 4;
+
+    float32x4_t v;
+
+    static pack_f32 splat(float x) { return {vdupq_n_f32(x)}; }
+    static pack_f32 load(const float* p) { return {vld1q_f32(p)}; }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    static void load2(const float* p, pack_f32& re, pack_f32& im) {
+        float32x4x2_t d = vld2q_f32(p);
+        re.v = d.val[0];
+        im.v = d.val[1];
+    }
+    static void store2(float* p, pack_f32 re, pack_f32 im) {
+        float32x4x2_t d;
+        d.val[0] = re.v;
+        d.val[1] = im.v;
+        vst2q_f32(p, d);
+    }
+};
+
+inline pack_f64 operator+(pack_f64 a, pack_f64 b) { return {vaddq_f64(a.v, b.v)}; }
+inline pack_f64 operator-(pack_f64 a, pack_f64 b) { return {vsubq_f64(a.v, b.v)}; }
+inline pack_f64 operator*(pack_f64 a, pack_f64 b) { return {vmulq_f64(a.v, b.v)}; }
+inline pack_f64 operator/(pack_f64 a, pack_f64 b) { return {vdivq_f64(a.v, b.v)}; }
+inline pack_f64 operator-(pack_f64 a) { return {vnegq_f64(a.v)}; }
+inline mask_f64 operator>(pack_f64 a, pack_f64 b) { return {vcgtq_f64(a.v, b.v)}; }
+inline mask_f64 operator<=(pack_f64 a, pack_f64 b) { return {vcleq_f64(a.v, b.v)}; }
+inline mask_f64 operator==(pack_f64 a, pack_f64 b) { return {vceqq_f64(a.v, b.v)}; }
+inline mask_f64 operator|(mask_f64 a, mask_f64 b) { return {vorrq_u64(a.v, b.v)}; }
+inline bool all(mask_f64 m) { return vminvq_u32(vreinterpretq_u32_u64(m.v)) == 0xFFFFFFFFu; }
+inline pack_f64 select(mask_f64 m, pack_f64 a, pack_f64 b) { return {vbslq_f64(m.v, a.v, b.v)}; }
+inline pack_f64 vabs(pack_f64 a) { return {vabsq_f64(a.v)}; }
+inline pack_f64 vsqrt(pack_f64 a) { return {vsqrtq_f64(a.v)}; }
+inline pack_f64 vtrunc(pack_f64 a) { return {vrndq_f64(a.v)}; }
+inline mask_f64 negative(pack_f64 a) {
+    return {vreinterpretq_u64_s64(vshrq_n_s64(vreinterpretq_s64_f64(a.v), 63))};
+}
+inline pack_f64 xor_sign(pack_f64 a, pack_f64 s) {
+    uint64x2_t sign = vandq_u64(vreinterpretq_u64_f64(s.v), vdupq_n_u64(0x8000000000000000ull));
+    return {vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(a.v), sign))};
+}
+
+inline pack_f32 operator+(pack_f32 a, pack_f32 b) { return {vaddq_f32(a.v, b.v)}; }
+inline pack_f32 operator-(pack_f32 a, pack_f32 b) { return {vsubq_f32(a.v, b.v)}; }
+inline pack_f32 operator*(pack_f32 a, pack_f32 b) { return {vmulq_f32(a.v, b.v)}; }
+inline pack_f32 operator/(pack_f32 a, pack_f32 b) { return {vdivq_f32(a.v, b.v)}; }
+inline pack_f32 operator-(pack_f32 a) { return {vnegq_f32(a.v)}; }
+inline mask_f32 operator>(pack_f32 a, pack_f32 b) { return {vcgtq_f32(a.v, b.v)}; }
+inline mask_f32 operator<=(pack_f32 a, pack_f32 b) { return {vcleq_f32(a.v, b.v)}; }
+inline mask_f32 operator==(pack_f32 a, pack_f32 b) { return {vceqq_f32(a.v, b.v)}; }
+inline mask_f32 operator|(mask_f32 a, mask_f32 b) { return {vorrq_u32(a.v, b.v)}; }
+inline bool all(mask_f32 m) { return vminvq_u32(m.v) == 0xFFFFFFFFu; }
+inline pack_f32 select(mask_f32 m, pack_f32 a, pack_f32 b) { return {vbslq_f32(m.v, a.v, b.v)}; }
+inline pack_f32 vabs(pack_f32 a) { return {vabsq_f32(a.v)}; }
+inline pack_f32 vsqrt(pack_f32 a) { return {vsqrtq_f32(a.v)}; }
+inline pack_f32 vtrunc(pack_f32 a) { return {vrndq_f32(a.v)}; }
+inline mask_f32 negative(pack_f32 a) {
+    return {vreinterpretq_u32_s32(vshrq_n_s32(vreinterpretq_s32_f32(a.v), 31))};
+}
+inline pack_f32 xor_sign(pack_f32 a, pack_f32 s) {
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(s.v), vdupq_n_u32(0x80000000u));
+    return {vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a.v), sign))};
+}
+
+#else
+
+typedef scalar_pack<double> pack_f64;
+typedef scalar_pack<float> pack_f32;
+
+#endif
+
+//==============================================================================
+// Kernels (Cephes-style range reduction and polynomials)
+//==============================================================================
+
+template <typename T> struct kernels;
+
+template <>
+struct kernels<double> {
+    // Beyond this the three-part pi/4 reduction loses precision
+    static constexpr double sincos_limit = 1e8;
+
+    // atan(t) for t in [0, 1]
+    template <typename V>
+    static V atan_unit(V t) {
+        const V one = V::splat(1.0);
+        typename V::mask big = t > V::splat(0.66);
+        V z = select(big, (t - one) / (t + one), t);
+        V zz = z * z;
+        V p = (((V::splat(-8.750608600031904122785E-1) * zz
+               + V::splat(-1.615753718733365076637E1)) * zz
+               + V::splat(-7.500855792314704667340E1)) * zz
+               + V::splat(-1.228866684490136173410E2)) * zz
+               + V::splat(-6.485021904942025371773E1);
+        V q = ((((zz + V::splat(2.485846490142306297962E1)) * zz
+               + V::splat(1.650270098316988542046E2)) * zz
+               + V::splat(4.328810604912902668951E2)) * zz
+               + V::splat(4.853903996359136964868E2)) * zz
+               + V::splat(1.945506571482613964425E2);
+        V r = z + z * zz * p / q;
+        // pi/4 plus half of its rounding error
+        V base = select(big, V::splat(M_PI_4) + V::splat(0.5 * 6.123233995736765886130E-17),
+                        V::splat(0.0));
+        return base + r;
+    }
+
+    template <typename V>
+    static V half_pi_minus(V r) {
+        return (V::splat(M_PI_2) - r) + V::splat(6.123233995736765886130E-17);
+    }
+
+    template <typename V>
+    static V pi_minus(V r) {
+        return (V::splat(M_PI) - r) + V::splat(1.224646799147353177226E-16);
+    }
+
+    // sin/cos of z in [-pi/4, pi/4]
+    template <typename V>
+    static void sincos_reduced(V z, V& s, V& c) {
+        V zz = z * z;
+        V ps = (((((V::splat(1.58962301576546568060E-10) * zz
+                + V::splat(-2.50507477628578072866E-8)) * zz
+                + V::splat(2.75573136213857245213E-6)) * zz
+                + V::splat(-1.98412698295895385996E-4)) * zz
+                + V::splat(8.33333333332211858878E-3)) * zz
+                + V::splat(-1.66666666666666307295E-1));
+        V pc = (((((V::splat(-1.13585365213876817300E-11) * zz
+                + V::splat(2.08757008419747316778E-9)) * zz
+                + V::splat(-2.75573141792967388112E-7)) * zz
+                + V::splat(2.48015872888517045348E-5)) * zz
+                + V::splat(-1.38888888888730564116E-3)) * zz
+                + V::splat(4.16666666666665929218E-2));
+        s = z + z * zz * ps;
+        c = V::splat(1.0) - V::splat(0.5) * zz + zz * zz * pc;
+    }
+
+    // z = x - y * pi/4 in three parts
+    template <typename V>
+    static V reduce(V x, V y) {
+        return ((x - y * V::splat(7.85398125648498535156E-1))
+                   - y * V::splat(3.77489470793079817668E-8))
+                   - y * V::splat(2.69515142907905952645E-15);
+    }
+};
+
+template <>
+struct kernels<float> {
+    static constexpr float sincos_limit = 8192.0f;
+
+    template <typename V>
+    static V atan_unit(V t) {
+        const V one = V::splat(1.0f);
+        typename V::mask big = t > V::splat(0.4142135623730950f);
+        V z = select(big, (t - one) / (t + one), t);
+        V zz = z * z;
+        V r = (((V::splat(8.05374449538e-2f) * zz
+               - V::splat(1.38776856032E-1f)) * zz
+               + V::splat(1.99777106478E-1f)) * zz
+               - V::splat(3.33329491539E-1f)) * zz * z + z;
+        return select(big, V::splat(static_cast<float>(M_PI_4)), V::splat(0.0f)) + r;
+    }
+
+    template <typename V>
+    static V half_pi_minus(V r) {
+        return V::splat(static_cast<float>(M_PI_2)) - r;
+    }
+
+    template <typename V>
+    static V pi_minus(V r) {
+        return V::splat(static_cast<float>(M_PI)) - r;
+    }
+
+    template <typename V>
+    static void sincos_reduced(V z, V& s, V& c) {
+        V zz = z * z;
+        s = ((V::splat(-1.9515295891E-4f) * zz
+             + V::splat(8.3321608736E-3f)) * zz
+             - V::splat(1.6666654611E-1f)) * zz * z + z;
+        c = ((V::splat(2.443315711809948E-5f) * zz
+             - V::splat(1.388731625493765E-3f)) * zz
+             + V::splat(4.166664568298827E-2f)) * zz * zz
+             - V::splat(0.5f) * zz + V::splat(1.0f);
+    }
+
+    template <typename V>
+    static V reduce(V x, V y) {
+        return ((x - y * V::splat(0.78515625f))
+                   - y * V::splat(2.4187564849853515625e-4f))
+                   - y * V::splat(3.77489497744594108e-8f);
+    }
+};
+
+constexpr double kernels<double>::sincos_limit;
+constexpr float kernels<float>::sincos_limit;
+
+template <typename V>
+inline V hypot_kernel(V x, V y) {
+    return vsqrt(x * x + y * y);
+}
+
+template <typename V>
+inline V atan2_kernel(V y, V x) {
+    typedef kernels<typename V::scalar> K;
+    const V zero = V::splat(0);
+
+    // Reduce to atan of a ratio in [0, 1], then unfold the octant
+    V ax = vabs(x);
+    V ay = vabs(y);
+    typename V::mask swap = ay > ax;
+    V num = select(swap, ax, ay);
+    V den = select(swap, ay, ax);
+    // den is zero only when both inputs are; atan2(0, 0) = 0
+    V t = select(den > zero, num / den, zero);
+
+    V r = K::atan_unit(t);
+    r = select(swap, K::half_pi_minus(r), r);
+    r = select(negative(x), K::pi_minus(r), r);
+    return xor_sign(r, y);
+}
+
+template <typename V>
+inline void sincos_kernel(V x, V& s, V& c) {
+    typedef typename V::scalar T;
+    typedef kernels<T> K;
+    const V half = V::splat(T(0.5));
+    const V one = V::splat(T(1));
+    const V two = V::splat(T(2));
+
+    // Octant of |x|, rounded up to even so z lands in [-pi/4, pi/4]
+    V ax = vabs(x);
+    V j = vtrunc(ax * V::splat(T(4 / M_PI)));
+    j = j + (j - two * vtrunc(j * half));
+    V quadrant = j * half - V::splat(T(4)) * vtrunc(j * V::splat(T(0.125)));
+
+    V ps, pc;
+    K::sincos_reduced(K::reduce(ax, j), ps, pc);
+
+    typename V::mask odd = (quadrant == one) | (quadrant == V::splat(T(3)));
+    s = select(odd, pc, ps);
+    c = select(odd, ps, pc);
+
+    s = select(quadrant > one, -s, s);
+    c = select((quadrant == one) | (quadrant == two), -c, c);
+    s = xor_sign(s, x);
+}
+
+//==============================================================================
+// Loops: full packs, then the scalar tail
+//==============================================================================
+
+template <typename V, typename T>
+void hypot_loop(const T* x, const T* y, T* out, size_t n) {
+    typedef scalar_pack<T> S;
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        hypot_kernel(V::load(x + i), V::load(y + i)).store(out + i);
+    for (; i < n; i++)
+        hypot_kernel(S::load(x + i), S::load(y + i)).store(out + i);
+}
+
+template <typename V, typename T>
+void atan2_loop(const T* y, const T* x, T* out, size_t n) {
+    typedef scalar_pack<T> S;
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        atan2_kernel(V::load(y + i), V::load(x + i)).store(out + i);
+    for (; i < n; i++)
+        atan2_kernel(S::load(y + i), S::load(x + i)).store(out + i);
+}
+
+template <typename V, typename T>
+inline void sincos_block(const T* x, T* s, T* c, size_t count) {
+    V xv = V::load(x);
+    if (all(vabs(xv) <= V::splat(kernels<T>::sincos_limit))) {
+        V sv, cv;
+        sincos_kernel(xv, sv, cv);
+        sv.store(s);
+        cv.store(c);
+    } else {
+        // Out of range (or not finite): let libm do the reduction
+        for (size_t k = 0; k < count; k++) {
+            s[k] = std::sin(x[k]);
+            c[k] = std::cos(x[k]);
+        }
+    }
+}
+
+template <typename V, typename T>
+void sincos_loop(const T* x, T* s, T* c, size_t n) {
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        sincos_block<V>(x + i, s + i, c + i, V::width);
+    for (; i < n; i++)
+        sincos_block<scalar_pack<T> >(x + i, s + i, c + i, 1);
+}
+
+template <typename V, typename T>
+inline void magnitude_phase_block(const T* in, T* mag, T* phase) {
+    V re, im;
+    V::load2(in, re, im);
+    hypot_kernel(re, im).store(mag);
+    atan2_kernel(im, re).store(phase);
+}
+
+template <typename V, typename T>
+void magnitude_phase_loop(const std::complex<T>* in, T* mag, T* phase, size_t n) {
+    // std::complex<T> is layout-compatible with T[2]
+    const T* p = reinterpret_cast<const T*>(in);
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        magnitude_phase_block<V>(p + 2 * i, mag + i, phase + i);
+    for (; i < n; i++)
+        magnitude_phase_block<scalar_pack<T> >(p + 2 * i, mag + i, phase + i);
+}
+
+template <typename V, typename T>
+inline void polar_block(const T* mag, const T* phase, T* out) {
+    V xv = V::load(phase);
+    V s, c;
+    if (all(vabs(xv) <= V::splat(kernels<T>::sincos_limit))) {
+        sincos_kernel(xv, s, c);
+    } else {
+        T sb[V::width], cb[V::width];
+        for (size_t k = 0; k < V::width; k++) {
+            sb[k] = std::sin(phase[k]);
+            cb[k] = std::cos(phase[k]);
+        }
+        s = V::load(sb);
+        c = V::load(cb);
+    }
+    V m = V::load(mag);
+    V::store2(out, m * c, m * s);
+}
+
+template <typename V, typename T>
+void polar_loop(const T* mag, const T* phase, std::complex<T>* out, size_t n) {
+    T* p = reinterpret_cast<T*>(out);
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        polar_block<V>(mag + i, phase + i, p + 2 * i);
+    for (; i < n; i++)
+        polar_block<scalar_pack<T> >(mag + i, phase + i, p + 2 * i);
+}
+
+template <typename V, typename T>
+inline size_t sanitize_block(T* x, size_t count) {
+    // NaN compares false, so this is "finite" in one compare
+    if (all(vabs(V::load(x)) <= V::splat(std::numeric_limits<T>::max()))) return 0;
+    size_t replaced = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (!(std::fabs(x[k]) <= std::numeric_limits<T>::max())) {
+            x[k] = 0;
+            replaced++;
+        }
+    }
+    return replaced;
+}
+
+template <typename V, typename T>
+size_t sanitize_loop(T* x, size_t n) {
+    size_t replaced = 0;
+    size_t i = 0;
+    for (; i + V::width <= n; i += V::width)
+        replaced += sanitize_block<V>(x + i, V::width);
+    for (; i < n; i++)
+        replaced += sanitize_block<scalar_pack<T> >(x + i, 1);
+    return replaced;
+}
+
+} // namespace
+
+void hypot(const double* x, const double* y, double* out, size_t n) {
+    hypot_loop<pack_f64>(x, y, out, n);
+}
+
+void hypot(const float* x, const float* y, float* out, size_t n) {
+    hypot_loop<pack_f32>(x, y, out, n);
+}
+
+void atan2(const double* y, const double* x, double* out, size_t n) {
+    atan2_loop<pack_f64>(y, x, out, n);
+}
+
+void atan2(const float* y, const float* x, float* out, size_t n) {
+    atan2_loop<pack_f32>(y, x, out, n);
+}
+
+void sincos(const double* x, double* s, double* c, size_t n) {
+    sincos_loop<pack_f64>(x, s, c, n);
+}
+
+void sincos(const float* x, float* s, float* c, size_t n) {
+    sincos_loop<pack_f32>(x, s, c, n);
+}
+
+void magnitude_phase(const std::complex<double>* in, double* mag, double* phase, size_t n) {
+    magnitude_phase_loop<pack_f64>(in, mag, phase, n);
+}
+
+void magnitude_phase(const std::complex<float>* in, float* mag, float* phase, size_t n) {
+    magnitude_phase_loop<pack_f32>(in, mag, phase, n);
+}
+
+void polar(const double* mag, const double* phase, std::complex<double>* out, size_t n) {
+    polar_loop<pack_f64>(mag, phase, out, n);
+}
+
+void polar(const float* mag, const float* phase, std::complex<float>* out, size_t n) {
+    polar_loop<pack_f32>(mag, phase, out, n);
+}
+
+size_t sanitize(double* x, size_t n) {
+    return sanitize_loop<pack_f64>(x, n);
+}
+
+size_t sanitize(float* x, size_t n) {
+    return sanitize_loop<pack_f32>(x, n);
+}
+
+const char* isa() {
+#if defined(AUDIO_TRANSPORT_SIMD_AVX2)
+    return "avx2";
+#elif defined(AUDIO_TRANSPORT_SIMD_SSE2)
+    return "sse2";
+#elif defined(AUDIO_TRANSPORT_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace vector_math
+} // namespace audio_transport
@@ -0,0 +1,303 @@
+/**
+ * Unit test for the diagnostics channel
+ *
+ * Tests the SPSC ring, event counting and formatting, and that the
+ * transport reports its warnings there instead of printing them
+ */
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <thread>
+
+#include "audio_transport/diagnostics.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/realtime_check.hpp"
+
+using namespace audio_transport;
+
+// Route every allocation through the library's realtime check. In
+// Debug builds an allocation inside a realtime scope aborts the test.
+void* operator new(std::size_t size) {
+    realtime_check::allocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void test_ring() {
+    std::cout << "Test 1: Ring wraps and refuses pushes when full... ";
+
+    diagnostics::spsc_ring<int, 4> ring;
+    int value = 0;
+    assert(!ring.pop(value));
+
+    // Go round several times so the indices wrap
+    int next = 0, expected = 0;
+    for (int round = 0; round < 5; round++) {
+        while (ring.push(next)) next++;
+        assert(ring.size() == 4);
+        for (int i = 0; i < 3; i++) {
+            assert(ring.pop(value));
+            assert(value == expected++);
+        }
+    }
+    while (ring.pop(value)) assert(value == expected++);
+    assert(expected == next);
+    assert(ring.size() == 0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_threads() {
+    std::cout << "Test 2: Producer and consumer on separate threads... ";
+
+    const int count = 200000;
+    diagnostics::spsc_ring<int, 64> ring;
+
+    std::thread producer([&ring]() {
+        for (int i = 0; i < count;) {
+            if (ring.push(i)) i++;
+            else std::this_thread::yield();
+        }
+    });
+
+    int expected = 0, value;
+    while (expected < count) {
+        if (ring.pop(value)) assert(value == expected++);
+        else std::this_thread::yield();
+    }
+    producer.join();
+    assert(!ring.pop(value));
+
+    std::cout << "PASS" << std::endl;
+}
+
+#ifndef AUDIO_TRANSPORT_NO_DIAGNOSTICS
+
+void test_channel() {
+    std::cout << "Test 3: Scoped reports, counts and drops... ";
+
+    diagnostics::reset_totals();
+    diagnostics::channel channel;
+    diagnostics::record r;
+
+    // No channel bound: only the totals see it
+    diagnostics::report(diagnostics::event::invalid_scale, 3, -1.0);
+    assert(diagnostics::total(diagnostics::event::invalid_scale) == 1);
+    assert(!channel.pop(r));
+
+    {
+        diagnostics::scope scope(channel);
+        {
+            // Nested scopes restore the outer channel
+            diagnostics::channel inner;
+            diagnostics::scope inner_scope(inner);
+            diagnostics::report(diagnostics::event::invalid_phase, 1, 0);
+            assert(inner.count(diagnostics::event::invalid_phase) == 1);
+        }
+        for (size_t i = 0; i < diagnostics::channel::capacity + 10; i++) {
+            diagnostics::report(diagnostics::event::low_frequency, i, 12.5, 0.25);
+        }
+    }
+    diagnostics::report(diagnostics::event::low_frequency, 0, 0);
+
+    assert(channel.count(diagnostics::event::invalid_phase) == 0);
+    assert(channel.count(diagnostics::event::low_frequency) == diagnostics::channel::capacity + 10);
+    assert(channel.dropped() == 10);
+    assert(diagnostics::total(diagnostics::event::low_frequency) == diagnostics::channel::capacity + 11);
+
+    // The oldest records are kept
+    assert(channel.pop(r));
+    assert(r.type == diagnostics::event::low_frequency && r.bin == 0);
+    assert(r.value == 12.5 && r.detail == 0.25);
+
+    std::ostringstream out;
+    assert(diagnostics::drain(channel, out) == diagnostics::channel::capacity - 1);
+    assert(out.str().find("10 diagnostics dropped") != std::string::npos);
+
+    // The drop is only noted once
+    std::ostringstream again;
+    assert(diagnostics::drain(channel, again) == 0);
+    assert(again.str().empty());
+
+    diagnostics::reset_totals();
+    assert(diagnostics::total(diagnostics::event::low_frequency) == 0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_describe() {
+    std::cout << "Test 4: Records read like the old warnings... ";
+
+    diagnostics::record small = { diagnostics::event::small_mass, 7, 1e-12, 1 };
+    assert(diagnostics::describe(small) ==
+           "[audio_transport] Warning: Very small right_mass.mass = 1e-12 at bin 7, clamping scale");
+
+    diagnostics::record low = { diagnostics::event::low_frequency, 1, 10, 0.25 };
+    assert(diagnostics::describe(low) ==
+           "[audio_transport] Attenuating low freq: 10 Hz, attenuation = 0.25");
+
+    for (size_t e = 0; e < diagnostics::num_events; e++) {
+        diagnostics::record r = { (diagnostics::event) e, 0, 0, 0 };
+        assert(diagnostics::describe(r).find("[audio_transport] ") == 0);
+        assert(std::string(diagnostics::name(r.type)) != "unknown");
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_no_allocation() {
+    std::cout << "Test 5: Reporting does not allocate... ";
+
+    diagnostics::channel channel;
+    diagnostics::scope scope(channel);
+
+    size_t allocations_before = realtime_check::allocation_count();
+    {
+        realtime_check::scope realtime;
+        for (size_t i = 0; i < 2 * diagnostics::channel::capacity; i++) {
+            diagnostics::report(diagnostics::event::invalid_magnitude, i, std::numeric_limits<double>::infinity());
+        }
+    }
+    assert(realtime_check::allocation_count() == allocations_before);
+    assert(channel.dropped() == diagnostics::channel::capacity);
+
+    std::cout << "PASS" << std::endl;
+}
+
+spectral::frame tone_frame(size_t num_bins, double amplitude) {
+    const double sample_rate = 44100;
+    spectral::frame frame;
+    frame.resize(num_bins);
+    for (size_t i = 0; i < num_bins; i++) {
+        frame.freq[i] = i * sample_rate / (2 * (num_bins - 1));
+        frame.freq_reassigned[i] = frame.freq[i];
+        frame.time_reassigned[i] = 0;
+        frame.re[i] = amplitude / (1 + std::abs((double) i - 20.0));
+        frame.im[i] = 0;
+    }
+    return frame;
+}
+
+void test_transport_reports() {
+    std::cout << "Test 6: The transport reports instead of printing... ";
+
+    const size_t num_bins = 257;
+    spectral::frame left = tone_frame(num_bins, 1.0);
+    spectral::frame right = tone_frame(num_bins, 0.5);
+    spectral::frame silent = tone_frame(num_bins, 0.0);
+    spectral::frame output;
+    interpolate_workspace workspace(num_bins);
+
+    std::vector<double> phases(num_bins, std::numeric_limits<double>::quiet_NaN());
+
+    std::ostringstream captured;
+    std::streambuf* cerr_buffer = std::cerr.rdbuf(captured.rdbuf());
+
+    diagnostics::channel channel;
+    {
+        diagnostics::scope scope(channel);
+        interpolate(left, right, phases, 0.01, 0.5, output, workspace);
+        std::vector<spectral_mass> masses;
+        group_spectrum(silent, std::vector<double>(num_bins, 0.0), masses);
+    }
+
+    std::cerr.rdbuf(cerr_buffer);
+    assert(captured.str().empty());
+
+    // One report for the pass that reset them all
+    assert(channel.count(diagnostics::event::invalid_phase) == 1);
+    assert(channel.count(diagnostics::event::near_silent_spectrum) == 1);
+    for (size_t i = 0; i < num_bins; i++) assert(std::isfinite(phases[i]));
+
+    std::ostringstream out;
+    assert(diagnostics::drain(channel, out) > 0);
+    assert(out.str().find("257 invalid phases") != std::string::npos);
+    assert(out.str().find("Near-silent spectrum") != std::string::npos);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_sanitation_passes() {
+    std::cout << "Test 7: Non-finite spectra are zeroed between stages... ";
+
+    const size_t num_bins = 257;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    spectral::frame left = tone_frame(num_bins, 1.0);
+    spectral::frame right = tone_frame(num_bins, 0.5);
+
+    // Reassigned onto the peak, so each side groups to one audible mass
+    for (size_t i = 0; i < num_bins; i++) {
+        left.freq_reassigned[i] = right.freq_reassigned[i] = left.freq[20];
+    }
+    left.re[20] = nan;
+    left.im[21] = std::numeric_limits<double>::infinity();
+    right.re[30] = nan;
+    spectral::frame output;
+    interpolate_workspace workspace(num_bins);
+    std::vector<double> phases(num_bins, 0.0);
+
+    diagnostics::channel channel;
+    std::vector<double> audio;
+    {
+        diagnostics::scope scope(channel);
+        interpolate(left, right, phases, 0.01, 0.5, output, workspace);
+
+        // A spectrum of NaN synthesizes to silence
+        spectral::frame broken = tone_frame(num_bins, 1.0);
+        broken.re[5] = nan;
+        audio = spectral::synthesis(std::vector<spectral::frame>(2, broken));
+    }
+
+    // Left and right each had their magnitudes sanitized once
+    assert(channel.count(diagnostics::event::invalid_magnitude) == 2);
+    assert(channel.count(diagnostics::event::invalid_sample) == 2);
+    for (size_t i = 0; i < num_bins; i++) {
+        assert(std::isfinite(output.re[i]) && std::isfinite(output.im[i]));
+        assert(std::isfinite(phases[i]));
+    }
+    double energy = 0;
+    for (size_t i = 0; i < num_bins; i++) energy += output.re[i] * output.re[i] + output.im[i] * output.im[i];
+    assert(energy > 0);
+    for (double x : audio) assert(x == 0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+#endif
+
+int main() {
+    std::cout << "\n=== diagnostics Unit Tests ===\n" << std::endl;
+
+    try {
+        test_ring();
+        test_threads();
+#ifndef AUDIO_TRANSPORT_NO_DIAGNOSTICS
+        test_channel();
+        test_describe();
+        test_no_allocation();
+        test_transport_reports();
+        test_sanitation_passes();
+#endif
+
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
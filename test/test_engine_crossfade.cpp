@@ -0,0 +1,233 @@
+/**
+ * Unit test for engine_crossfade
+ *
+ * Tests that a handover between engines of equal latency keeps the
+ * old output until the new engine is primed and then fades linearly,
+ * and that one across a latency change never blends the two but
+ * switches at a block boundary once the fade would have ended
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+
+#include "audio_transport/engine_crossfade.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+const double SAMPLE_RATE = 44100.0;
+const int BLOCK = 64;
+
+// The engines log their configuration on construction
+struct silence_cout {
+    std::ostringstream sink;
+    std::streambuf* saved;
+    silence_cout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~silence_cout() { std::cout.rdbuf(saved); }
+};
+
+// Stereo blocks of constant old and new output through c until it
+// finishes; returns the output and the blocks it took
+std::vector<float> run_constant(engine_crossfade& c, float old_value, float new_value,
+                                int max_blocks, int& blocks) {
+    std::vector<float> result;
+    std::vector<float> left(BLOCK), right(BLOCK), incoming(BLOCK, new_value);
+    float* output[] = { left.data(), right.data() };
+    const float* in[] = { incoming.data(), incoming.data() };
+    for (blocks = 1; blocks <= max_blocks; blocks++) {
+        std::fill(left.begin(), left.end(), old_value);
+        std::fill(right.begin(), right.end(), old_value);
+        bool done = c.mix(output, in, 2, BLOCK);
+        assert(left == right);
+        result.insert(result.end(), left.begin(), left.end());
+        if (done) return result;
+    }
+    assert(false);
+    return result;
+}
+
+void test_fade() {
+    std::cout << "Test 1: Equal latencies fade after priming... ";
+
+    // Primed after 100 samples, then a fade of four 25-sample hops
+    engine_crossfade c;
+    assert(!c.active());
+    c.start(100, 100, 25);
+    assert(c.active() && c.fades());
+
+    int blocks;
+    std::vector<float> out = run_constant(c, 1.0f, 0.0f, 100, blocks);
+    assert(!c.active());
+    assert(blocks == 4); // the fade ends at 200, in the fourth block
+    for (int i = 0; i < 100; i++) assert(out[i] == 1.0f);
+    for (int i = 100; i < 200; i++) assert(std::fabs(out[i] - (1.0f - (i - 100) / 100.0f)) < 1e-6f);
+    for (int i = 200; i < blocks * BLOCK; i++) assert(out[i] == 0.0f);
+
+    // Not active: output is left alone
+    std::vector<float> left(BLOCK, 0.5f), incoming(BLOCK, 0.0f);
+    float* output[] = { left.data() };
+    const float* in[] = { incoming.data() };
+    assert(!c.mix(output, in, 1, BLOCK));
+    assert(left == std::vector<float>(BLOCK, 0.5f));
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_switch() {
+    std::cout << "Test 2: Different latencies switch at a block boundary... ";
+
+    // Latency and four 16-sample hops end exactly with block 5, and
+    // part-way through block 6
+    for (int latency : { 4 * BLOCK, 4 * BLOCK + 1 }) {
+        engine_crossfade c;
+        c.start(100, latency, 16);
+        assert(!c.fades());
+
+        int blocks;
+        std::vector<float> out = run_constant(c, 1.0f, 0.0f, 100, blocks);
+        assert(blocks == (latency + 4 * 16 + BLOCK - 1) / BLOCK);
+        for (float x : out) assert(x == 1.0f); // never blended
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+std::vector<float> sine(double freq, int samples) {
+    std::vector<float> audio(samples);
+    for (int i = 0; i < samples; i++) {
+        audio[i] = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * freq * i / SAMPLE_RATE));
+    }
+    return audio;
+}
+
+// A handover from old_engine to new_engine, started after start
+// samples, as a host runs it. Returns the output and the sample the
+// new engine takes over from.
+std::vector<float> hand_over(RealtimeEngine& old_engine, RealtimeEngine& new_engine,
+                             engine_crossfade& c, const std::vector<float>& main,
+                             const std::vector<float>& side, int start, int& switched) {
+    std::vector<float> output(main.size()), incoming(BLOCK);
+    RealtimeEngine* current = &old_engine;
+    bool handing_over = false;
+    switched = -1;
+    for (int pos = 0; pos + BLOCK <= static_cast<int>(main.size()); pos += BLOCK) {
+        if (pos == start) {
+            c.start(old_engine.getLatencySamples(), new_engine.getLatencySamples(),
+                    new_engine.getHopSize());
+            handing_over = true;
+        }
+        float* out = output.data() + pos;
+        if (handing_over) {
+            new_engine.process(main.data() + pos, side.data() + pos, incoming.data(), BLOCK, 0.5f);
+        }
+        current->process(main.data() + pos, side.data() + pos, out, BLOCK, 0.5f);
+        const float* in = incoming.data();
+        if (handing_over && c.mix(&out, &in, 1, BLOCK)) {
+            current = &new_engine;
+            handing_over = false;
+            switched = pos + BLOCK;
+        }
+    }
+    return output;
+}
+
+// Both engines' own outputs for the whole input, the new one fed from
+// start as in hand_over
+void reference(RealtimeEngine& old_engine, RealtimeEngine& new_engine,
+               const std::vector<float>& main, const std::vector<float>& side, int start,
+               std::vector<float>& old_output, std::vector<float>& new_output) {
+    int total = static_cast<int>(main.size());
+    old_output.assign(total, 0.0f);
+    new_output.assign(total, 0.0f);
+    for (int pos = 0; pos + BLOCK <= total; pos += BLOCK) {
+        old_engine.process(main.data() + pos, side.data() + pos, old_output.data() + pos, BLOCK, 0.5f);
+        if (pos >= start) {
+            new_engine.process(main.data() + pos, side.data() + pos, new_output.data() + pos, BLOCK, 0.5f);
+        }
+    }
+}
+
+void test_engines() {
+    std::cout << "Test 3: Engine handovers across a window change and a rebuild... ";
+
+    {
+        silence_cout quiet;
+        const int total = 20000;
+        const int start = 40 * BLOCK;
+        std::vector<float> main = sine(440.0, total), side = sine(660.0, total);
+
+        // 30 ms to 50 ms: the old output up to a block boundary, then the
+        // new engine's, never a blend of the two
+        {
+            RealtimeAudioTransport a(SAMPLE_RATE, 30.0, 4, 2), b(SAMPLE_RATE, 50.0, 4, 2);
+            RealtimeAudioTransport ra(SAMPLE_RATE, 30.0, 4, 2), rb(SAMPLE_RATE, 50.0, 4, 2);
+            assert(a.getLatencySamples() != b.getLatencySamples());
+            engine_crossfade c;
+            int switched;
+            std::vector<float> out = hand_over(a, b, c, main, side, start, switched), old_out, new_out;
+            reference(ra, rb, main, side, start, old_out, new_out);
+
+            int settled = start + b.getLatencySamples() + 4 * b.getHopSize();
+            assert(switched % BLOCK == 0);
+            assert(switched >= settled && switched < settled + BLOCK);
+            for (int i = 0; i < switched; i++) assert(out[i] == old_out[i]);
+            for (int i = switched; i + BLOCK <= total; i++) assert(out[i] == new_out[i]);
+
+            // The new engine is settled when it takes over
+            float peak = 0;
+            for (int i = switched; i < switched + BLOCK; i++) peak = std::max(peak, std::fabs(out[i]));
+            assert(peak > 0.05f);
+        }
+
+        // A rebuild at the same settings, as a target change makes: the
+        // same latency, so the old output, a linear fade into the new and
+        // then the new, all at the same delay
+        {
+            RealtimeReassignmentTransport a(SAMPLE_RATE, 30.0, 4, 2), b(SAMPLE_RATE, 30.0, 4, 2);
+            RealtimeReassignmentTransport ra(SAMPLE_RATE, 30.0, 4, 2), rb(SAMPLE_RATE, 30.0, 4, 2);
+            engine_crossfade c;
+            int switched;
+            std::vector<float> out = hand_over(a, b, c, main, side, start, switched), old_out, new_out;
+            reference(ra, rb, main, side, start, old_out, new_out);
+
+            int hop = b.getHopSize();
+            int fade_start = start + b.getLatencySamples();
+            int fade_end = fade_start + 4 * hop;
+            assert(switched >= fade_end && switched < fade_end + BLOCK);
+            for (int i = 0; i + BLOCK <= total; i++) {
+                float expected = old_out[i];
+                if (i >= fade_end) {
+                    expected = new_out[i];
+                } else if (i >= fade_start) {
+                    float fade = static_cast<float>(i - fade_start) / static_cast<float>(4 * hop);
+                    expected += (new_out[i] - expected) * fade;
+                }
+                assert(out[i] == expected);
+            }
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Engine Crossfade Unit Tests ===" << std::endl << std::endl;
+
+    try {
+        test_fade();
+        test_switch();
+        test_engines();
+
+        std::cout << std::endl << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,346 @@
+/**
+ * Unit test for the realtime engines' silence gate and frozen sidechain
+ *
+ * Tests that gating digital silence changes no output, that silent
+ * inputs skip their analysis (and a silent hop its synthesis), that the
+ * CDF engine scales the side with content when the other is silent,
+ * and that a frozen sidechain ignores its input and reuses its grouping
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#include "audio_transport/silence_gate.hpp"
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/instrumentation.hpp"
+#include "audio_transport/realtime_check.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+// Route every allocation through the library's realtime check. In
+// Debug builds an allocation inside process() aborts the test.
+void* operator new(std::size_t size) {
+    realtime_check::allocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+const double SAMPLE_RATE = 44100.0;
+const int BLOCK_SIZE = 256;
+const int NUM_BLOCKS = 40;
+
+std::vector<float> sine(double freq, size_t samples) {
+    std::vector<float> audio(samples);
+    for (size_t i = 0; i < samples; i++) {
+        audio[i] = 0.5f * std::sin(2.0 * M_PI * freq * i / SAMPLE_RATE);
+    }
+    return audio;
+}
+
+// Zero [begin, end) of audio
+void mute(std::vector<float>& audio, size_t begin, size_t end) {
+    for (size_t i = begin; i < end && i < audio.size(); i++) {
+        audio[i] = 0.0f;
+    }
+}
+
+// Run engine over main/sidechain in blocks, returning the output
+std::vector<float> run(RealtimeEngine& engine, const std::vector<float>& main,
+                       const std::vector<float>& sidechain, float k) {
+    std::vector<float> output(main.size(), 0.0f);
+    for (size_t i = 0; i + BLOCK_SIZE <= main.size(); i += BLOCK_SIZE) {
+        engine.process(main.data() + i, sidechain.data() + i, output.data() + i, BLOCK_SIZE, k);
+    }
+    return output;
+}
+
+void test_gate() {
+    std::cout << "Test 1: Silence gate counts the latest quiet samples... ";
+
+    silence_gate gate;
+    assert(!gate.silent(1));
+
+    float loud[] = { 0.5f, 0.0f, 0.0f };
+    gate.push(loud, 3, 0.0f);
+    assert(gate.silent(2) && !gate.silent(3));
+
+    float quiet[] = { 0.0f, -0.0f, 0.0f, 0.0f };
+    gate.push(quiet, 4, 0.0f);
+    assert(gate.silent(6) && !gate.silent(7));
+
+    // Below the threshold counts as quiet, a negative threshold never does
+    float noise[] = { 1e-5f, -2e-5f };
+    gate.push(noise, 2, 1e-4f);
+    assert(gate.silent(8));
+    gate.push(quiet, 4, -1.0f);
+    assert(!gate.silent(1));
+
+    gate.push(quiet, 4, 0.0f);
+    gate.reset();
+    assert(!gate.silent(1));
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_reuse_right() {
+    std::cout << "Test 2: interpolate() reuses a held right spectrum exactly... ";
+
+    const size_t bins = 257;
+    const double window_size = 0.05;
+    std::vector<spectral::frame> lefts(3);
+    spectral::frame right;
+    for (spectral::frame* f : { &lefts[0], &lefts[1], &lefts[2], &right }) {
+        f->resize(bins);
+        for (size_t i = 0; i < bins; i++) {
+            f->freq[i] = 2 * M_PI * i * SAMPLE_RATE / (2 * (bins - 1));
+            f->freq_reassigned[i] = f->freq[i];
+            f->re[i] = f->im[i] = 0;
+        }
+    }
+    for (size_t w = 0; w < lefts.size(); w++) {
+        lefts[w].re[20 + 10 * w] = 1.0;
+        lefts[w].im[21 + 10 * w] = 0.5;
+    }
+    right.re[60] = 0.8;
+    right.im[90] = -0.3;
+
+    interpolate_workspace fresh(bins), held(bins);
+    std::vector<double> fresh_phases(bins, 0.0), held_phases(bins, 0.0);
+    spectral::frame fresh_out, held_out;
+    for (size_t w = 0; w < lefts.size(); w++) {
+        interpolate(lefts[w], right, fresh_phases, window_size, 0.4, fresh_out, fresh);
+        held.reuse_right = w > 0;
+        interpolate(lefts[w], right, held_phases, window_size, 0.4, held_out, held);
+        assert(held_out.re == fresh_out.re && held_out.im == fresh_out.im);
+        assert(held_phases == fresh_phases);
+    }
+
+    // The same for a linked plan
+    std::vector<spectral::frame> rights(2, right);
+    std::vector<spectral::frame> left_pair(2);
+    transport_plan fresh_plan, held_plan;
+    for (size_t w = 0; w < lefts.size(); w++) {
+        left_pair[0] = lefts[w];
+        left_pair[1] = lefts[(w + 1) % lefts.size()];
+        plan_transport(left_pair, rights, fresh_plan);
+        plan_transport(left_pair, rights, held_plan, w > 0);
+        assert(held_plan.transport == fresh_plan.transport);
+        assert(held_plan.right_silent == fresh_plan.right_silent);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+// Gating digital silence gives exactly the output of analysing it, and
+// skips the analyses (and the whole hop when both inputs are silent)
+void check_gated_silence(RealtimeEngine& gated, RealtimeEngine& ungated) {
+    const size_t samples = NUM_BLOCKS * BLOCK_SIZE;
+    std::vector<float> main = sine(440.0, samples);
+    std::vector<float> sidechain = sine(660.0, samples);
+    mute(sidechain, samples / 4, samples);
+    mute(main, samples / 2, 3 * samples / 4);
+
+    instrumentation::recorder recorder;
+    recorder.set_enabled(true);
+    gated.setInstrumentation(&recorder);
+    ungated.setSilenceThreshold(-1.0f);
+    assert(gated.getSilenceThreshold() == 0.0f);
+
+    size_t allocations_before = realtime_check::allocation_count();
+    std::vector<float> expected = run(ungated, main, sidechain, 0.3f);
+    std::vector<float> output = run(gated, main, sidechain, 0.3f);
+    assert(realtime_check::allocation_count() == allocations_before);
+    assert(output == expected);
+
+#ifndef AUDIO_TRANSPORT_NO_INSTRUMENTATION
+    instrumentation::snapshot s = recorder.read();
+    assert(s.skipped_analyses > 0);
+    assert(s.skipped_analyses < 2 * s.hops);
+
+    // All silence: nothing is analysed and the output stays silent
+    gated.reset();
+    std::vector<float> silence(samples, 0.0f);
+    instrumentation::snapshot before = recorder.read();
+    output = run(gated, silence, silence, 0.5f);
+    instrumentation::snapshot recent = recorder.read() - before;
+    for (float x : output) assert(x == 0.0f);
+    // All but the first hops, before a whole window of silence is in
+    assert(recent.skipped_analyses >= 2 * (recent.hops - 8));
+    assert(recent.plans == recent.silent_shortcuts && recent.plans <= 8);
+#endif
+
+    gated.setInstrumentation(nullptr);
+}
+
+void test_gated_engines() {
+    std::cout << "Test 3: Gating digital silence leaves the output unchanged... ";
+
+    RealtimeAudioTransport cdf(SAMPLE_RATE, 25.0, 4, 1), cdf_ungated(SAMPLE_RATE, 25.0, 4, 1);
+    check_gated_silence(cdf, cdf_ungated);
+
+    RealtimeReassignmentTransport reassignment(SAMPLE_RATE, 25.0, 4, 1);
+    RealtimeReassignmentTransport reassignment_ungated(SAMPLE_RATE, 25.0, 4, 1);
+    check_gated_silence(reassignment, reassignment_ungated);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_cdf_silent_side() {
+    std::cout << "Test 4: CDF engine scales the main input under a silent sidechain... ";
+
+    const size_t samples = NUM_BLOCKS * BLOCK_SIZE;
+    std::vector<float> main = sine(440.0, samples);
+    std::vector<float> silence(samples, 0.0f);
+
+    // With nothing to transport to, every k is a scaled copy of k = 0
+    // (which used to push the spectrum towards Nyquist)
+    RealtimeAudioTransport reference(SAMPLE_RATE, 25.0, 4, 1), morphed(SAMPLE_RATE, 25.0, 4, 1);
+    std::vector<float> unscaled = run(reference, main, silence, 0.0f);
+    std::vector<float> scaled = run(morphed, main, silence, 0.3f);
+
+    double energy = 0;
+    for (size_t i = 0; i < samples; i++) {
+        assert(std::abs(scaled[i] - 0.7f * unscaled[i]) < 1e-5f);
+        energy += unscaled[i] * unscaled[i];
+    }
+    assert(energy > 1.0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+// A frozen sidechain ignores its input: whatever follows the freeze,
+// the output is the same, and only the main input is analysed
+void check_frozen(RealtimeEngine& a, RealtimeEngine& b) {
+    const size_t samples = NUM_BLOCKS * BLOCK_SIZE;
+    const size_t freeze_at = samples / 2;
+    std::vector<float> main = sine(330.0, samples);
+    std::vector<float> held = sine(550.0, freeze_at), first(samples), second(samples);
+    std::vector<float> noise = sine(1234.5, samples);
+    for (size_t i = 0; i < samples; i++) {
+        first[i] = i < freeze_at ? held[i] : noise[i];
+        second[i] = i < freeze_at ? held[i] : 0.0f;
+    }
+
+    instrumentation::recorder recorder;
+    recorder.set_enabled(true);
+    a.setInstrumentation(&recorder);
+
+    std::vector<float> out_a(samples), out_b(samples);
+    size_t allocations_before = realtime_check::allocation_count();
+    instrumentation::snapshot before;
+    for (size_t i = 0; i < samples; i += BLOCK_SIZE) {
+        if (i == freeze_at) {
+            a.setSidechainFrozen(true);
+            b.setSidechainFrozen(true);
+            before = recorder.read();
+        }
+        a.process(main.data() + i, first.data() + i, out_a.data() + i, BLOCK_SIZE, 0.5f);
+        b.process(main.data() + i, second.data() + i, out_b.data() + i, BLOCK_SIZE, 0.5f);
+    }
+    assert(realtime_check::allocation_count() == allocations_before);
+    assert(a.isSidechainFrozen());
+    assert(out_a == out_b);
+
+    // The held spectrum still morphs: the output is not silent
+    double energy = 0;
+    for (size_t i = freeze_at; i < samples; i++) energy += out_a[i] * out_a[i];
+    assert(energy > 0.01);
+
+#ifndef AUDIO_TRANSPORT_NO_INSTRUMENTATION
+    instrumentation::snapshot recent = recorder.read() - before;
+    assert(recent.skipped_analyses == recent.hops * a.getNumChannels());
+#endif
+
+    // Unfreezing follows the live sidechain again
+    a.setSidechainFrozen(false);
+    a.setInstrumentation(nullptr);
+}
+
+void test_frozen_sidechain() {
+    std::cout << "Test 5: A frozen sidechain ignores its input... ";
+
+    RealtimeAudioTransport cdf_a(SAMPLE_RATE, 25.0, 4, 1), cdf_b(SAMPLE_RATE, 25.0, 4, 1);
+    check_frozen(cdf_a, cdf_b);
+
+    RealtimeReassignmentTransport reassignment_a(SAMPLE_RATE, 25.0, 4, 1);
+    RealtimeReassignmentTransport reassignment_b(SAMPLE_RATE, 25.0, 4, 1);
+    check_frozen(reassignment_a, reassignment_b);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_linked() {
+    std::cout << "Test 6: Linked stereo gates and freezes like mono... ";
+
+    const size_t samples = NUM_BLOCKS * BLOCK_SIZE;
+    std::vector<float> main = sine(330.0, samples), sidechain = sine(550.0, samples);
+    std::vector<float> silence(samples, 0.0f);
+
+    for (int engine = 0; engine < 2; engine++) {
+        RealtimeAudioTransport cdf(SAMPLE_RATE, 25.0, 4, 1), cdf_ungated(SAMPLE_RATE, 25.0, 4, 1);
+        RealtimeReassignmentTransport ra(SAMPLE_RATE, 25.0, 4, 1), ra_ungated(SAMPLE_RATE, 25.0, 4, 1);
+        RealtimeEngine& gated = engine == 0 ? static_cast<RealtimeEngine&>(cdf) : ra;
+        RealtimeEngine& ungated = engine == 0 ? static_cast<RealtimeEngine&>(cdf_ungated) : ra_ungated;
+        ungated.setSilenceThreshold(-1.0f);
+
+        std::vector<float> left(samples), right(samples), left_ref(samples), right_ref(samples);
+        for (RealtimeEngine* e : { &gated, &ungated }) {
+            e->setNumChannels(2);
+            e->setChannelMode(RealtimeEngine::ChannelMode::Linked);
+        }
+
+        // Left sidechain silent throughout, both sides silent in the
+        // middle; the freeze comes in for the last quarter
+        for (size_t i = 0; i < samples; i += BLOCK_SIZE) {
+            bool gap = i >= samples / 4 && i < samples / 2;
+            if (i == 3 * samples / 4) {
+                gated.setSidechainFrozen(true);
+                ungated.setSidechainFrozen(true);
+            }
+            const float* source = gap ? silence.data() : main.data();
+            const float* mains[] = { source + i, source + i };
+            const float* sidechains[] = { silence.data() + i, (gap ? silence : sidechain).data() + i };
+            float* outputs[] = { left.data() + i, right.data() + i };
+            float* reference[] = { left_ref.data() + i, right_ref.data() + i };
+            gated.process(mains, sidechains, outputs, 2, BLOCK_SIZE, 0.5f);
+            ungated.process(mains, sidechains, reference, 2, BLOCK_SIZE, 0.5f);
+        }
+        assert(left == left_ref && right == right_ref);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "\n=== Realtime fast path Unit Tests ===\n" << std::endl;
+
+    try {
+        test_gate();
+        test_reuse_right();
+        test_gated_engines();
+        test_cdf_silent_side();
+        test_frozen_sidechain();
+        test_linked();
+
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
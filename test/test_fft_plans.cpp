@@ -0,0 +1,198 @@
+/**
+ * Unit test for the shared FFT plan registry
+ *
+ * Checks plan sharing across engines, that shared plans compute the
+ * same transform as dedicated ones, batched or not, and that wisdom
+ * reaches the cache
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "audio_transport/fft_plans.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+#include "audio_transport/aligned_allocator.hpp"
+
+using namespace audio_transport;
+
+static std::string cache_dir;
+
+bool file_exists(const std::string& path) {
+    std::FILE* f = std::fopen(path.c_str(), "r");
+    if (f) std::fclose(f);
+    return f != nullptr;
+}
+
+void test_sharing() {
+    std::cout << "Test 1: Plans are shared per size and direction... ";
+
+    fft_plans::clear();
+    assert(fft_plans::size() == 0);
+
+    fftw_plan a = fft_plans::get<double>(1024, fft_plans::forward);
+    fftw_plan b = fft_plans::get<double>(1024, fft_plans::forward);
+    fftw_plan c = fft_plans::get<double>(1024, fft_plans::inverse);
+    fftw_plan d = fft_plans::get<double>(2048, fft_plans::forward);
+    assert(a == b);
+    assert(a != c && a != d);
+    assert(fft_plans::size() == 3);
+
+    // A batch of one is the plain plan; other batch sizes are their own
+    assert(fft_plans::get<double>(1024, fft_plans::forward, 1) == a);
+    fftw_plan e = fft_plans::get<double>(1024, fft_plans::forward, 3);
+    assert(e != a && e == fft_plans::get<double>(1024, fft_plans::forward, 3));
+    assert(fft_plans::size() == 4);
+
+    // A second engine of the same size needs no new plans. Each uses
+    // a forward plan for one input, a batched one for both and an
+    // inverse plan.
+    {
+        RealtimeReassignmentTransport first(44100.0, 50.0, 4, 2);
+        size_t plans = fft_plans::size();
+        RealtimeReassignmentTransport second(44100.0, 50.0, 4, 2);
+        RealtimeAudioTransport cdf_first(44100.0, 50.0, 4, 2);
+        size_t with_cdf = fft_plans::size();
+        RealtimeAudioTransport cdf_second(44100.0, 50.0, 4, 2);
+        assert(plans == 7);
+        assert(with_cdf == plans + 3);
+        assert(fft_plans::size() == with_cdf);
+    }
+
+    std::cout << "PASS (" << fft_plans::size() << " plans)" << std::endl;
+}
+
+void test_shared_matches_dedicated() {
+    std::cout << "Test 2: Shared plan matches a dedicated plan... ";
+
+    const int n = 1764;
+    const int bins = n / 2 + 1;
+    aligned_vector<double> in(n), scratch(n);
+    for (int i = 0; i < n; i++) {
+        in[i] = std::sin(0.05 * i) + 0.25 * std::cos(0.31 * i);
+    }
+
+    fftw_complex* shared_out = fftw_alloc_complex(bins);
+    fftw_complex* dedicated_out = fftw_alloc_complex(bins);
+
+    fftw_plan shared = fft_plans::get<double>(n, fft_plans::forward);
+    fftw_execute_dft_r2c(shared, in.data(), shared_out);
+
+    // Dedicated plans clobber their arrays while planning
+    fftw_plan dedicated = fftw_plan_dft_r2c_1d(n, scratch.data(), dedicated_out, FFTW_ESTIMATE);
+    scratch = in;
+    fftw_execute(dedicated);
+
+    double max_error = 0.0;
+    for (int i = 0; i < bins; i++) {
+        max_error = std::max(max_error, std::abs(shared_out[i][0] - dedicated_out[i][0]));
+        max_error = std::max(max_error, std::abs(shared_out[i][1] - dedicated_out[i][1]));
+    }
+    assert(max_error < 1e-9);
+
+    fftw_destroy_plan(dedicated);
+    fftw_free(shared_out);
+    fftw_free(dedicated_out);
+
+    std::cout << "PASS (max error " << max_error << ")" << std::endl;
+}
+
+void test_batched_matches_single() {
+    std::cout << "Test 3: Batched plans match one transform at a time... ";
+
+    const int n = 1764;
+    const int howmany = 3;
+    const size_t real_step = fft_plans::real_distance(n);
+    const size_t complex_step = fft_plans::complex_distance(n);
+    assert(real_step >= (size_t) n && real_step % 16 == 0);
+    assert(complex_step >= (size_t) n / 2 + 1 && complex_step % 4 == 0);
+
+    aligned_vector<double> in(howmany * real_step, 0.0);
+    for (int t = 0; t < howmany; t++) {
+        for (int i = 0; i < n; i++) {
+            in[t * real_step + i] = std::sin(0.05 * (t + 1) * i) + 0.25 * std::cos(0.31 * i + t);
+        }
+    }
+
+    fftw_complex* batched = fftw_alloc_complex(howmany * complex_step);
+    fftw_complex* single = fftw_alloc_complex(n / 2 + 1);
+    fftw_execute_dft_r2c(fft_plans::get<double>(n, fft_plans::forward, howmany), in.data(), batched);
+
+    double max_error = 0.0;
+    fftw_plan plan = fft_plans::get<double>(n, fft_plans::forward);
+    for (int t = 0; t < howmany; t++) {
+        fftw_execute_dft_r2c(plan, in.data() + t * real_step, single);
+        for (int i = 0; i < n / 2 + 1; i++) {
+            max_error = std::max(max_error, std::abs(batched[t * complex_step + i][0] - single[i][0]));
+            max_error = std::max(max_error, std::abs(batched[t * complex_step + i][1] - single[i][1]));
+        }
+    }
+    assert(max_error < 1e-9);
+
+    fftw_free(batched);
+    fftw_free(single);
+
+    std::cout << "PASS (max error " << max_error << ")" << std::endl;
+}
+
+void test_wisdom_cache() {
+    std::cout << "Test 4: Wisdom is written to the cache directory... ";
+
+    std::string wisdom = cache_dir + "/nested/fftw3.wisdom";
+    fft_plans::set_cache_directory(cache_dir + "/nested");
+    assert(fft_plans::cache_directory() == cache_dir + "/nested");
+
+    fft_plans::clear();
+    fft_plans::get<double>(512, fft_plans::forward);
+    assert(file_exists(wisdom));
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    fft_plans::get<float>(512, fft_plans::forward);
+    assert(file_exists(cache_dir + "/nested/fftw3f.wisdom"));
+#endif
+
+    // An empty directory disables persistence
+    std::remove(wisdom.c_str());
+    fft_plans::set_cache_directory("");
+    fft_plans::clear();
+    fft_plans::get<double>(512, fft_plans::forward);
+    assert(!file_exists(wisdom));
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "\n=== fft_plans Unit Tests ===\n" << std::endl;
+
+    char dir_template[] = "/tmp/audio_transport_fft_plans_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::cerr << "Could not create a cache directory" << std::endl;
+        return 1;
+    }
+    cache_dir = dir_template;
+    fft_plans::set_cache_directory(cache_dir);
+
+    try {
+        test_sharing();
+        test_shared_matches_dedicated();
+        test_batched_matches_single();
+        test_wisdom_cache();
+
+        std::system(("rm -rf '" + cache_dir + "'").c_str());
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,225 @@
+/**
+ * Unit test for the realtime engines' instrumentation
+ *
+ * Tests the recorder and its snapshots, that both engines record every
+ * hop and block when enabled and nothing otherwise, without touching
+ * the heap, and prints the tables the recorder dumps
+ */
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+#include "audio_transport/instrumentation.hpp"
+#include "audio_transport/realtime_check.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+// Route every allocation through the library's realtime check. In
+// Debug builds an allocation inside process() aborts the test.
+void* operator new(std::size_t size) {
+    realtime_check::allocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+const double SAMPLE_RATE = 44100.0;
+
+void test_recorder() {
+    std::cout << "Test 1: Buckets, recorder and snapshot differences... ";
+
+    assert(instrumentation::bucket(0) == 0);
+    assert(instrumentation::bucket(1) == 0);
+    assert(instrumentation::bucket(2) == 1);
+    assert(instrumentation::bucket(3) == 1);
+    assert(instrumentation::bucket(1024) == 10);
+    assert(instrumentation::bucket(~instrumentation::ticks(0)) == instrumentation::histogram_buckets - 1);
+
+    instrumentation::recorder recorder;
+    assert(!recorder.enabled());
+
+    instrumentation::ticks stages[instrumentation::num_stages] = { 10, 20, 30, 40 };
+    recorder.add_hop(100, stages);
+    recorder.add_plan(3, 4, 6, false);
+    recorder.add_block(64, 500);
+    instrumentation::snapshot first = recorder.read();
+
+    recorder.add_hop(300, stages);
+    recorder.add_plan(1, 1, 0, true, 3);
+    recorder.add_block(64, 700);
+    instrumentation::snapshot second = recorder.read();
+
+    assert(second.hops == 2 && second.hop_ticks == 400 && second.hop_max == 300);
+    assert(second.hop_histogram[instrumentation::bucket(100)] == 1);
+    assert(second.hop_histogram[instrumentation::bucket(300)] == 1);
+    assert(second.stage_ticks[2] == 60 && second.stage_max[2] == 30);
+    assert(second.plans == 2 && second.masses == 9 && second.silent_shortcuts == 1);
+    assert(second.mean_masses() == 4.5);
+    assert(second.pruned_masses == 3 && second.pruned_fraction() == 0.25);
+    assert(second.mean_transport_entries() == 6);
+    assert(second.blocks == 2 && second.block_samples == 128 && second.block_max == 700);
+
+    instrumentation::snapshot recent = second - first;
+    assert(recent.hops == 1 && recent.hop_ticks == 300);
+    assert(recent.hop_histogram[instrumentation::bucket(100)] == 0);
+    assert(recent.plans == 1 && recent.silent_shortcuts == 1 && recent.transport_entries == 0);
+    assert(recent.pruned_masses == 3);
+    assert(recent.blocks == 1 && recent.block_ticks == 700);
+
+    assert(instrumentation::ticks_per_second() > 0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+std::vector<float> sine(double freq, size_t samples) {
+    std::vector<float> audio(samples);
+    for (size_t i = 0; i < samples; i++) {
+        audio[i] = 0.5f * std::sin(2.0 * M_PI * freq * i / SAMPLE_RATE);
+    }
+    return audio;
+}
+
+// Run engine over main/sidechain in blocks of block_size
+void run(RealtimeEngine& engine, const std::vector<float>& main,
+         const std::vector<float>& sidechain, int block_size) {
+    std::vector<float> output(block_size);
+    for (size_t i = 0; i + block_size <= main.size(); i += block_size) {
+        engine.process(main.data() + i, sidechain.data() + i, output.data(), block_size, 0.5f);
+    }
+}
+
+void check_engine(RealtimeEngine& engine, const char* name, bool has_plans) {
+    const int block_size = 256;
+    const int blocks = 40;
+    std::vector<float> main = sine(440.0, blocks * block_size);
+    std::vector<float> sidechain = sine(660.0, blocks * block_size);
+    std::vector<float> silence(blocks * block_size, 0.0f);
+
+    instrumentation::recorder recorder;
+    engine.setInstrumentation(&recorder);
+    assert(engine.getInstrumentation() == &recorder);
+
+    // Nothing is recorded until the recorder is enabled
+    run(engine, main, sidechain, block_size);
+    assert(recorder.read().blocks == 0);
+    assert(recorder.read().hops == 0);
+
+    recorder.set_enabled(true);
+    size_t allocations_before = realtime_check::allocation_count();
+    run(engine, main, sidechain, block_size);
+    assert(realtime_check::allocation_count() == allocations_before);
+
+    instrumentation::snapshot s = recorder.read();
+#ifdef AUDIO_TRANSPORT_NO_INSTRUMENTATION
+    assert(s.blocks == 0 && s.hops == 0);
+    (void) name;
+    (void) has_plans;
+#else
+    size_t expected_hops = blocks * block_size / engine.getHopSize();
+    assert(s.blocks == (size_t) blocks);
+    assert(s.block_samples == (size_t) blocks * block_size);
+    assert(s.hops >= expected_hops - 1 && s.hops <= expected_hops + 1);
+
+    // The stages account for the whole hop, apart from timer overhead
+    instrumentation::ticks stage_sum = 0, histogram_sum = 0;
+    for (size_t i = 0; i < instrumentation::num_stages; i++) {
+        assert(s.stage_ticks[i] > 0);
+        stage_sum += s.stage_ticks[i];
+    }
+    assert(stage_sum <= s.hop_ticks);
+    for (size_t b = 0; b < instrumentation::histogram_buckets; b++) {
+        histogram_sum += s.hop_histogram[b];
+    }
+    assert(histogram_sum == s.hops);
+    assert(s.load(SAMPLE_RATE) > 0);
+
+    if (has_plans) {
+        assert(s.plans == s.hops);
+        assert(s.mean_masses() >= 2);
+        assert(s.silent_shortcuts == 0);
+    } else {
+        assert(s.plans == 0);
+    }
+
+    std::cout << "\n  " << name << ", " << engine.getHopSize() << "-sample hops:\n";
+    instrumentation::write(std::cout, s, SAMPLE_RATE);
+
+    // A silent sidechain takes the shortcut on every hop it fills
+    if (has_plans) {
+        engine.reset();
+        instrumentation::snapshot before = recorder.read();
+        run(engine, main, silence, block_size);
+        instrumentation::snapshot recent = recorder.read() - before;
+        assert(recent.silent_shortcuts == recent.plans);
+        assert(recent.plans > 0);
+    }
+#endif
+
+    engine.setInstrumentation(nullptr);
+}
+
+void test_engines() {
+    std::cout << "Test 2: Engines record stages, plans and blocks... ";
+
+    RealtimeAudioTransport cdf(SAMPLE_RATE, 25.0, 4, 1);
+    check_engine(cdf, "CDF", false);
+
+    RealtimeReassignmentTransport reassignment(SAMPLE_RATE, 25.0, 4, 1);
+    check_engine(reassignment, "Reassignment", true);
+
+    RealtimeReassignmentTransport linked(SAMPLE_RATE, 25.0, 4, 1);
+    linked.setNumChannels(2);
+    linked.setChannelMode(RealtimeEngine::ChannelMode::Linked);
+    {
+        instrumentation::recorder recorder;
+        recorder.set_enabled(true);
+        linked.setInstrumentation(&recorder);
+
+        const int block_size = 512;
+        std::vector<float> main = sine(330.0, block_size), sidechain = sine(550.0, block_size);
+        std::vector<float> left(block_size), right(block_size);
+        const float* mains[] = { main.data(), main.data() };
+        const float* sidechains[] = { sidechain.data(), sidechain.data() };
+        float* outputs[] = { left.data(), right.data() };
+        for (int i = 0; i < 20; i++) {
+            linked.process(mains, sidechains, outputs, 2, block_size, 0.5f);
+        }
+
+        // One plan per hop for both channels
+        instrumentation::snapshot s = recorder.read();
+        assert(s.plans == s.hops);
+        linked.setInstrumentation(nullptr);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "\n=== instrumentation Unit Tests ===\n" << std::endl;
+
+    try {
+        test_recorder();
+        test_engines();
+
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,267 @@
+/**
+ * Unit test for the realtime engines' low-latency mode
+ *
+ * Tests the asymmetric window pair, that both engines' output is
+ * delayed by exactly the latency they report at any block size, and
+ * that a short synthesis length cuts that latency to a few
+ * milliseconds while reconstruction and morphing stay as they are
+ * with the full window
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "audio_transport/spectral.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+const double SAMPLE_RATE = 44100.0;
+const double WINDOW_MS = 50.0;
+const double SYNTHESIS_MS = 6.0;
+
+std::vector<float> sine(double freq, size_t samples) {
+    std::vector<float> audio(samples);
+    for (size_t i = 0; i < samples; i++) {
+        audio[i] = 0.5f * std::sin(2.0 * M_PI * freq * i / SAMPLE_RATE);
+    }
+    return audio;
+}
+
+// Run engine over main/sidechain in blocks of cycling, irregular sizes
+std::vector<float> run(RealtimeEngine& engine, const std::vector<float>& main,
+                       const std::vector<float>& sidechain, float k) {
+    const int sizes[] = {1, 37, 64, 219, 512, 1000, 2048};
+    int total = static_cast<int>(main.size());
+    std::vector<float> output(total);
+    int pos = 0, s = 0;
+    while (pos < total) {
+        int n = std::min(sizes[s++ % 7], total - pos);
+        engine.process(main.data() + pos, sidechain.data() + pos,
+                       output.data() + pos, n, k);
+        pos += n;
+    }
+    return output;
+}
+
+// Sample of the largest magnitude
+int peak(const std::vector<float>& audio) {
+    int best = 0;
+    for (int i = 0; i < static_cast<int>(audio.size()); i++) {
+        if (std::abs(audio[i]) > std::abs(audio[best])) best = i;
+    }
+    return best;
+}
+
+double rms(const std::vector<float>& audio, size_t begin) {
+    double sum = 0.0;
+    for (size_t i = begin; i < audio.size(); i++) {
+        sum += audio[i] * audio[i];
+    }
+    return std::sqrt(sum / (audio.size() - begin));
+}
+
+// Frequency from the upward zero crossings of audio[begin, end)
+double frequency(const std::vector<float>& audio, size_t begin, size_t end) {
+    size_t first = 0, last = 0;
+    int crossings = 0;
+    for (size_t i = begin + 1; i < end; i++) {
+        if (audio[i - 1] < 0.0f && audio[i] >= 0.0f) {
+            if (crossings == 0) first = i;
+            last = i;
+            crossings++;
+        }
+    }
+    assert(crossings > 1);
+    return (crossings - 1) * SAMPLE_RATE / (last - first);
+}
+
+void test_window_tables() {
+    std::cout << "Test 1: Asymmetric window pair... ";
+
+    const size_t N = 4416, L = 264;
+    auto symmetric = spectral::get_window_tables(N, SAMPLE_RATE);
+    auto asymmetric = spectral::get_window_tables(N, SAMPLE_RATE, L);
+    assert(symmetric->L == N);
+    assert(symmetric->synthesis.empty());
+    assert(asymmetric != symmetric);
+    assert(asymmetric == spectral::get_window_tables(N, SAMPLE_RATE, L));
+    assert(asymmetric->L == L);
+    assert(asymmetric->synthesis.size() == L);
+
+    // Analysis peaks L/2 from the end and is positive throughout
+    size_t top = std::max_element(asymmetric->hann.begin(), asymmetric->hann.end())
+               - asymmetric->hann.begin();
+    assert(top + 1 >= N - L/2 && top <= N - L/2);
+    for (double w : asymmetric->hann) {
+        assert(w > 0.0 && w <= 1.0);
+    }
+
+    // The pair multiplies to a Hann window of L
+    for (size_t j = 0; j < L; j++) {
+        double product = asymmetric->hann[N - L + j] * asymmetric->synthesis[j];
+        assert(std::abs(product - spectral::hann(j - (L - 1)/2., L)) < 1e-12);
+    }
+
+    // The derivative table matches the window's differences
+    for (size_t i = 1; i + 1 < N; i++) {
+        if (i + 1 == N - L/2 || i == N - L/2) continue; // the joint
+        double difference = (asymmetric->hann[i + 1] - asymmetric->hann[i - 1]) / 2.0 * SAMPLE_RATE;
+        assert(std::abs(difference - asymmetric->hann_d[i]) < 1e-3 * SAMPLE_RATE / L);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+// With a silent sidechain the main input passes through, delayed by
+// the latency
+void check_latency(RealtimeEngine& engine) {
+    const int total = 8192;
+    const int impulse = 3000;
+    std::vector<float> in(total, 0.0f), silence(total, 0.0f);
+    in[impulse] = 1.0f;
+
+    std::vector<float> out = run(engine, in, silence, 0.0f);
+    assert(peak(out) == impulse + engine.getLatencySamples());
+}
+
+void test_reported_latency() {
+    std::cout << "Test 2: Impulse delayed by reported latency... ";
+
+    RealtimeAudioTransport cdf(SAMPLE_RATE, WINDOW_MS, 4, 2);
+    RealtimeReassignmentTransport reassignment(SAMPLE_RATE, WINDOW_MS, 4, 2);
+    RealtimeAudioTransport cdf_low(SAMPLE_RATE, WINDOW_MS, 4, 2, SYNTHESIS_MS);
+    RealtimeReassignmentTransport reassignment_low(SAMPLE_RATE, WINDOW_MS, 1, 2, SYNTHESIS_MS);
+    for (RealtimeEngine* engine : std::vector<RealtimeEngine*>{
+             &cdf, &reassignment, &cdf_low, &reassignment_low}) {
+        check_latency(*engine);
+    }
+
+    // A few milliseconds instead of a window
+    int few_ms = static_cast<int>(SAMPLE_RATE * 0.007);
+    assert(cdf_low.getLatencySamples() < few_ms);
+    assert(reassignment_low.getLatencySamples() < few_ms);
+    assert(reassignment.getLatencySamples() > 5 * reassignment_low.getLatencySamples());
+    assert(reassignment_low.getHopSize() <= reassignment_low.getLatencySamples());
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    RealtimeAudioTransportFloat cdf_float(SAMPLE_RATE, WINDOW_MS, 4, 2, SYNTHESIS_MS);
+    RealtimeReassignmentTransportFloat reassignment_float(SAMPLE_RATE, WINDOW_MS, 1, 2, SYNTHESIS_MS);
+    check_latency(cdf_float);
+    check_latency(reassignment_float);
+#endif
+
+    std::cout << "PASS (" << reassignment.getLatencySamples() << " -> "
+              << reassignment_low.getLatencySamples() << " samples)" << std::endl;
+}
+
+void test_full_synthesis() {
+    std::cout << "Test 3: Synthesis as long as the window is the normal mode... ";
+
+    std::vector<float> main = sine(440.0, 20000);
+    std::vector<float> sidechain = sine(660.0, 20000);
+
+    RealtimeReassignmentTransport normal(SAMPLE_RATE, 20.0, 4, 2);
+    RealtimeReassignmentTransport full(SAMPLE_RATE, 20.0, 4, 2, 50.0);
+    assert(full.getLatencySamples() == normal.getLatencySamples());
+    assert(run(full, main, sidechain, 0.4f) == run(normal, main, sidechain, 0.4f));
+
+    RealtimeAudioTransport cdf_normal(SAMPLE_RATE, 20.0, 4, 2);
+    RealtimeAudioTransport cdf_full(SAMPLE_RATE, 20.0, 4, 2, 20.0);
+    assert(cdf_full.getLatencySamples() == cdf_normal.getLatencySamples());
+    assert(run(cdf_full, main, sidechain, 0.4f) == run(cdf_normal, main, sidechain, 0.4f));
+
+    std::cout << "PASS" << std::endl;
+}
+
+// A steady sine passed through and morphed towards a second one by an
+// engine in low-latency mode. normal is the same engine with the full
+// window, whose level it must keep.
+void check_quality(RealtimeEngine& normal, RealtimeEngine& low) {
+    const size_t total = 12288;
+    const size_t settled = 6144;
+    std::vector<float> a = sine(440.0, total);
+    std::vector<float> b = sine(880.0, total);
+    std::vector<float> silence(total, 0.0f);
+
+    // Against silence the window pair alone reconstructs the waveform
+    double gain = rms(run(normal, a, silence, 0.0f), settled) / rms(a, settled);
+    std::vector<float> out = run(low, a, silence, 0.0f);
+    int latency = low.getLatencySamples();
+    double error = 0.0, signal = 0.0;
+    for (size_t i = settled; i < total; i++) {
+        double expected = gain * a[i - latency];
+        error += (out[i] - expected) * (out[i] - expected);
+        signal += expected * expected;
+    }
+    assert(10.0 * std::log10(signal / error) > 40.0);
+
+    // Through the transport the main input keeps its level, and moved
+    // partials sound at the interpolated frequency
+    low.reset();
+    out = run(low, a, b, 0.0f);
+    assert(std::abs(rms(out, settled) / (gain * rms(a, settled)) - 1.0) < 0.02);
+    assert(std::abs(frequency(out, settled, total) - 440.0) < 5.0);
+    low.reset();
+    assert(std::abs(frequency(run(low, a, b, 0.5f), settled, total) - 660.0) < 5.0);
+    low.reset();
+    assert(std::abs(frequency(run(low, a, b, 1.0f), settled, total) - 880.0) < 5.0);
+}
+
+void test_quality() {
+    std::cout << "Test 4: Low-latency reconstruction and morphing... ";
+
+    RealtimeAudioTransport cdf(SAMPLE_RATE, WINDOW_MS, 4, 2);
+    RealtimeAudioTransport cdf_low(SAMPLE_RATE, WINDOW_MS, 4, 2, SYNTHESIS_MS);
+    check_quality(cdf, cdf_low);
+
+    RealtimeReassignmentTransport reassignment(SAMPLE_RATE, WINDOW_MS, 4, 2);
+    RealtimeReassignmentTransport reassignment_low(SAMPLE_RATE, WINDOW_MS, 1, 2, SYNTHESIS_MS);
+    check_quality(reassignment, reassignment_low);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_block_invariance() {
+    std::cout << "Test 5: Output independent of the block size... ";
+
+    std::vector<float> main = sine(440.0, 12000);
+    std::vector<float> sidechain = sine(550.0, 12000);
+
+    RealtimeReassignmentTransport blocks(SAMPLE_RATE, WINDOW_MS, 1, 2, SYNTHESIS_MS);
+    RealtimeReassignmentTransport whole(SAMPLE_RATE, WINDOW_MS, 1, 2, SYNTHESIS_MS);
+    std::vector<float> expected(main.size());
+    whole.process(main.data(), sidechain.data(), expected.data(),
+                  static_cast<int>(main.size()), 0.3f);
+    assert(run(blocks, main, sidechain, 0.3f) == expected);
+
+    RealtimeReassignmentTransport normal_blocks(SAMPLE_RATE, 20.0, 4, 2);
+    RealtimeReassignmentTransport normal_whole(SAMPLE_RATE, 20.0, 4, 2);
+    normal_whole.process(main.data(), sidechain.data(), expected.data(),
+                         static_cast<int>(main.size()), 0.3f);
+    assert(run(normal_blocks, main, sidechain, 0.3f) == expected);
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Low-Latency Mode Unit Tests ===" << std::endl << std::endl;
+
+    try {
+        test_window_tables();
+        test_reported_latency();
+        test_full_synthesis();
+        test_quality();
+        test_block_invariance();
+
+        std::cout << std::endl << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
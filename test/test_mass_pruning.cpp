@@ -0,0 +1,244 @@
+/**
+ * Unit test for sparse transport (mass_pruning)
+ *
+ * Tests that pruned plans keep the heaviest masses as grouped and merge
+ * the rest into residuals that still cover the spectrum, that the end
+ * points of an interpolation are unchanged, and that the reassignment
+ * engine counts the masses it prunes
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+
+#include "audio_transport/audio_transport.hpp"
+#include "audio_transport/instrumentation.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+const double SAMPLE_RATE = 44100.0;
+const double WINDOW_SIZE = 0.05;
+
+// Two partials over a deterministic noise floor, which groups into
+// far more masses than there are partials
+std::vector<double> partials(double f0, double f1, size_t samples) {
+    std::vector<double> audio(samples);
+    unsigned int seed = 4242;
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double noise = (seed >> 8) / double(1 << 24) - 0.5;
+        audio[i] = 0.5 * std::sin(2.0 * M_PI * f0 * i / SAMPLE_RATE)
+                 + 0.3 * std::sin(2.0 * M_PI * f1 * i / SAMPLE_RATE)
+                 + 0.02 * noise;
+    }
+    return audio;
+}
+
+// A window from the middle of each signal
+spectral::frame middle_frame(const std::vector<double>& audio) {
+    std::vector<spectral::frame> frames = spectral::analysis_frames(audio, SAMPLE_RATE, WINDOW_SIZE, 1);
+    return frames[frames.size() / 2];
+}
+
+bool same(const spectral_mass& a, const spectral_mass& b) {
+    return a.left_bin == b.left_bin && a.right_bin == b.right_bin
+        && a.center_bin == b.center_bin && a.mass == b.mass;
+}
+
+bool contains(const std::vector<spectral_mass>& masses, const spectral_mass& m) {
+    for (const spectral_mass& x : masses) {
+        if (same(x, m)) return true;
+    }
+    return false;
+}
+
+// Masses tile [0, num_bins) in order and sum to one
+void check_cover(const std::vector<spectral_mass>& masses, size_t num_bins) {
+    assert(!masses.empty());
+    assert(masses.front().left_bin == 0 && masses.back().right_bin == num_bins);
+    double total = 0;
+    for (size_t m = 0; m < masses.size(); m++) {
+        if (m > 0) assert(masses[m].left_bin == masses[m - 1].right_bin);
+        assert(masses[m].center_bin >= masses[m].left_bin && masses[m].center_bin < masses[m].right_bin);
+        total += masses[m].mass;
+    }
+    assert(std::abs(total - 1) < 1e-12);
+}
+
+void test_top_k() {
+    std::cout << "Test 1: Top-K keeps the heaviest masses and covers the rest... ";
+
+    spectral::frame left = middle_frame(partials(440, 1320, 8192));
+    spectral::frame right = middle_frame(partials(660, 990, 8192));
+
+    transport_plan full, pruned;
+    polar_frame left_polar, right_polar;
+    plan_transport(left, right, full, left_polar, right_polar);
+
+    const size_t K = 8;
+    pruned.pruning = mass_pruning(K, 0);
+    plan_transport(left, right, pruned, left_polar, right_polar);
+
+    assert(full.left_masses.size() > 4 * K && full.right_masses.size() > 4 * K);
+    assert(full.left_grouped == full.left_masses.size());
+    assert(pruned.left_grouped == full.left_masses.size());
+    assert(pruned.right_grouped == full.right_masses.size());
+
+    const std::vector<spectral_mass>* sides[][2] = {
+        { &full.left_masses, &pruned.left_masses },
+        { &full.right_masses, &pruned.right_masses }
+    };
+    for (auto& side : sides) {
+        const std::vector<spectral_mass>& grouped = *side[0];
+        const std::vector<spectral_mass>& kept = *side[1];
+        assert(kept.size() <= 2 * K + 1);
+        check_cover(kept, left.size());
+
+        // The K heaviest survive exactly as grouped
+        std::vector<spectral_mass> heaviest = grouped;
+        std::sort(heaviest.begin(), heaviest.end(),
+                  [](const spectral_mass& a, const spectral_mass& b) { return a.mass > b.mass; });
+        for (size_t i = 0; i < K; i++) assert(contains(kept, heaviest[i]));
+    }
+    assert(pruned.transport.size() < full.transport.size());
+    assert(pruned.transport.size() <= pruned.left_masses.size() + pruned.right_masses.size() - 1);
+
+    std::cout << "PASS (" << full.left_masses.size() << " -> " << pruned.left_masses.size()
+              << " masses)" << std::endl;
+}
+
+void test_threshold() {
+    std::cout << "Test 2: A mass threshold keeps every mass above it... ";
+
+    spectral::frame left = middle_frame(partials(440, 1320, 8192));
+    spectral::frame right = middle_frame(partials(660, 990, 8192));
+
+    transport_plan full, pruned;
+    polar_frame left_polar, right_polar;
+    plan_transport(left, right, full, left_polar, right_polar);
+
+    const double MIN_MASS = 0.01;
+    pruned.pruning = mass_pruning(0, MIN_MASS);
+    plan_transport(left, right, pruned, left_polar, right_polar);
+
+    size_t heavy = 0;
+    for (const spectral_mass& m : full.left_masses) {
+        if (m.mass >= MIN_MASS) {
+            assert(contains(pruned.left_masses, m));
+            heavy++;
+        }
+    }
+    assert(heavy > 0 && heavy < full.left_masses.size());
+
+    // Everything else is a residual, at most one between kept masses
+    check_cover(pruned.left_masses, left.size());
+    assert(pruned.left_masses.size() <= 2 * heavy + 1);
+
+    std::cout << "PASS" << std::endl;
+}
+
+// Largest difference between output magnitudes and expected
+double magnitude_error(const spectral::frame& output, const spectral::frame& expected) {
+    double error = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+        error = std::max(error, std::abs(std::hypot(output.re[i], output.im[i])
+                                       - std::hypot(expected.re[i], expected.im[i])));
+    }
+    return error;
+}
+
+void test_end_points() {
+    std::cout << "Test 3: Pruned interpolation keeps its end points... ";
+
+    spectral::frame left = middle_frame(partials(440, 1320, 8192));
+    spectral::frame right = middle_frame(partials(660, 990, 8192));
+
+    // Each side is placed unshifted at its own end, residuals included
+    for (int end = 0; end < 2; end++) {
+        interpolate_workspace workspace(left.size());
+        workspace.plan.pruning = mass_pruning(6, 0.001);
+        std::vector<double> phases(left.size(), 0);
+        spectral::frame output;
+        interpolate(left, right, phases, WINDOW_SIZE, end, output, workspace);
+        assert(workspace.plan.left_masses.size() < workspace.plan.left_grouped);
+        assert(magnitude_error(output, end ? right : left) < 1e-9);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void run(RealtimeReassignmentTransport& engine, const std::vector<float>& main,
+         const std::vector<float>& sidechain, std::vector<float>& output) {
+    for (size_t pos = 0; pos < main.size(); pos += 512) {
+        int n = static_cast<int>(std::min<size_t>(512, main.size() - pos));
+        engine.process(main.data() + pos, sidechain.data() + pos, output.data() + pos, n, 0.5f);
+    }
+}
+
+void test_engine_counts() {
+    std::cout << "Test 4: The engine counts the masses it prunes... ";
+
+    std::vector<double> main_audio = partials(440, 1320, 16384);
+    std::vector<double> side_audio = partials(660, 990, 16384);
+    std::vector<float> main(main_audio.begin(), main_audio.end());
+    std::vector<float> sidechain(side_audio.begin(), side_audio.end());
+    std::vector<float> full_output(main.size()), pruned_output(main.size());
+
+    RealtimeReassignmentTransport full(SAMPLE_RATE, 40.0, 4, 2);
+    RealtimeReassignmentTransport pruned(SAMPLE_RATE, 40.0, 4, 2);
+    assert(!pruned.getMassPruning().enabled());
+    pruned.setMassPruning(mass_pruning(12, 0));
+    assert(pruned.getMassPruning().max_masses == 12);
+
+    instrumentation::recorder full_recorder, pruned_recorder;
+    full_recorder.set_enabled(true);
+    pruned_recorder.set_enabled(true);
+    full.setInstrumentation(&full_recorder);
+    pruned.setInstrumentation(&pruned_recorder);
+
+    run(full, main, sidechain, full_output);
+    run(pruned, main, sidechain, pruned_output);
+
+    double energy = 0;
+    for (float x : pruned_output) {
+        assert(std::isfinite(x));
+        energy += x * x;
+    }
+    assert(energy > 0);
+
+#ifndef AUDIO_TRANSPORT_NO_INSTRUMENTATION
+    // Grouping saw the same spectra, so together the kept and pruned
+    // masses are the unpruned engine's masses
+    instrumentation::snapshot f = full_recorder.read();
+    instrumentation::snapshot p = pruned_recorder.read();
+    assert(f.plans == p.plans && f.plans > 0);
+    assert(f.pruned_masses == 0);
+    assert(p.pruned_masses > 0);
+    assert(p.masses + p.pruned_masses == f.masses);
+    assert(p.mean_masses() <= 2 * (2 * 12 + 1));
+    assert(p.mean_transport_entries() < f.mean_transport_entries());
+    assert(p.pruned_fraction() > 0 && p.pruned_fraction() < 1);
+#endif
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Mass Pruning Unit Tests ===" << std::endl << std::endl;
+
+    try {
+        test_top_k();
+        test_threshold();
+        test_end_points();
+        test_engine_counts();
+
+        std::cout << std::endl << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,188 @@
+/**
+ * Unit test for morph_cache
+ *
+ * Checks that rendering from the cache matches the offline renderer
+ * for several interpolation curves, that silent stretches agree to
+ * rounding, and that save() and load() round-trip the cache
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+
+#include "audio_transport/morph_cache.hpp"
+#include "audio_transport/offline_renderer.hpp"
+
+using namespace audio_transport;
+
+const double SAMPLE_RATE = 44100.0;
+const double WINDOW_SIZE = 1024 / 44100.0; // seconds, a power of two of samples
+const unsigned int PADDING = 1;
+
+// A swept tone over a deterministic noise floor, so every bin has mass
+std::vector<double> chirp(double f0, double f1, double amp, size_t samples) {
+    std::vector<double> audio(samples);
+    double phase = 0;
+    unsigned int seed = 777;
+    for (size_t i = 0; i < samples; i++) {
+        double f = f0 + (f1 - f0) * i / samples;
+        phase += 2.0 * M_PI * f / SAMPLE_RATE;
+        seed = seed * 1664525u + 1013904223u;
+        double noise = (seed >> 8) / double(1 << 24) - 0.5;
+        audio[i] = amp * std::sin(phase) + 0.01 * noise;
+    }
+    return audio;
+}
+
+transport_settings make_settings() {
+    transport_settings settings;
+    settings.window_size = WINDOW_SIZE;
+    settings.padding = PADDING;
+    return settings;
+}
+
+double constant_half(size_t, size_t) { return 0.5; }
+double ramp(size_t w, size_t num_windows) { return w / (double) num_windows; }
+
+// A start/end percent envelope as in the transport example
+double envelope(size_t w, size_t num_windows) {
+    double k = (w / (double) num_windows - 0.2) / (0.7 - 0.2);
+    return std::min(1., std::max(0., k));
+}
+
+double max_difference(const std::vector<double>& a, const std::vector<double>& b) {
+    assert(a.size() == b.size());
+    double difference = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+void test_matches_renderer() {
+    std::cout << "Test 1: Renders match the offline renderer... ";
+
+    std::vector<double> left = chirp(300, 900, 0.5, 20000);
+    std::vector<double> right = chirp(1500, 600, 0.4, 22000);
+
+    offline_renderer renderer(2);
+    for (int loudness = 0; loudness < 2; loudness++) {
+        transport_settings settings = make_settings();
+        settings.equal_loudness = loudness == 1;
+        morph_cache cache(left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+        assert(cache.num_windows() > 0);
+
+        // Every window has mass on both sides, so the match is exact
+        double (*curves[])(size_t, size_t) = { constant_half, ramp, envelope };
+        for (auto curve : curves) {
+            settings.interpolation = curve;
+            std::vector<double> expected = renderer.transport(
+                left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+            assert(cache.render(curve) == expected);
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_silent_windows() {
+    std::cout << "Test 2: Silent stretches agree to rounding... ";
+
+    // Left falls silent in the middle, right at the end
+    std::vector<double> left = chirp(300, 900, 0.5, 20000);
+    std::vector<double> right = chirp(1500, 600, 0.4, 20000);
+    std::fill(left.begin() + 6000, left.begin() + 12000, 0.0);
+    std::fill(right.begin() + 15000, right.end(), 0.0);
+
+    transport_settings settings = make_settings();
+    settings.interpolation = ramp;
+    morph_cache cache(left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+
+    offline_renderer renderer(1);
+    std::vector<double> expected = renderer.transport(left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+    std::vector<double> rendered = cache.render(ramp);
+    double peak = 0;
+    for (double sample : expected) peak = std::max(peak, std::abs(sample));
+    assert(peak > 0.1);
+    assert(max_difference(rendered, expected) < 1e-12 * peak);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_save_load() {
+    std::cout << "Test 3: Save and load round-trip... ";
+
+    std::vector<double> left = chirp(300, 900, 0.5, 12000);
+    std::vector<double> right = chirp(1500, 600, 0.4, 12000);
+    std::fill(right.begin() + 8000, right.end(), 0.0);
+
+    transport_settings settings = make_settings();
+    settings.overlap = 2;
+    morph_cache cache(left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+
+    const char* path = "test_morph_cache.bin";
+    assert(cache.save(path));
+
+    morph_cache loaded;
+    assert(loaded.empty());
+    assert(loaded.load(path));
+    assert(loaded.num_windows() == cache.num_windows());
+    assert(loaded.left_length() == left.size() && loaded.right_length() == right.size());
+    assert(loaded.left_sample_rate() == SAMPLE_RATE && loaded.right_sample_rate() == SAMPLE_RATE);
+    assert(loaded.window_size() == WINDOW_SIZE);
+    assert(loaded.padding() == PADDING && loaded.overlap() == 2 && loaded.equal_loudness());
+    assert(loaded.render(envelope) == cache.render(envelope));
+
+    // A truncated file or another file is rejected and leaves it empty
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(bytes.data(), bytes.size() / 2);
+    }
+    assert(!loaded.load(path));
+    assert(loaded.empty() && loaded.left_length() == 0);
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "not a cache";
+    }
+    assert(!loaded.load(path));
+    assert(!loaded.load("no/such/file.bin"));
+    std::remove(path);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_short_inputs() {
+    std::cout << "Test 4: Inputs shorter than a window... ";
+
+    std::vector<double> left = chirp(300, 900, 0.5, 500);
+    std::vector<double> right = chirp(1500, 600, 0.4, 20000);
+    morph_cache cache(left, SAMPLE_RATE, right, SAMPLE_RATE, make_settings());
+    assert(cache.empty());
+    assert(cache.render(ramp).empty());
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Morph Cache Unit Tests ===" << std::endl << std::endl;
+
+    try {
+        test_matches_renderer();
+        test_silent_windows();
+        test_save_load();
+        test_short_inputs();
+
+        std::cout << std::endl << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,364 @@
+/**
+ * Unit test for PipelinedEngine
+ *
+ * Tests that the worker's output is the engine's own, delayed by the
+ * pipeline latency, that hops the worker finishes too late are heard
+ * as silence without shifting the rest, that the engine restarts
+ * cleanly after hops are dropped, that the worker's warnings reach
+ * getDiagnostics(), and that at the smallest hop the plugin uses a
+ * worker under nominal load keeps up with callbacks paced in realtime
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "audio_transport/PipelinedEngine.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+
+using namespace audio_transport;
+
+const double SAMPLE_RATE = 44100.0;
+const int TOTAL = 20000;
+const int MAX_BLOCK = 256;
+
+std::vector<float> sine(double freq, size_t samples) {
+    std::vector<float> audio(samples);
+    for (size_t i = 0; i < samples; i++) {
+        audio[i] = 0.5f * std::sin(2.0 * M_PI * freq * i / SAMPLE_RATE);
+    }
+    return audio;
+}
+
+std::unique_ptr<RealtimeEngine> make_engine(int type) {
+    if (type == 0) {
+        return std::unique_ptr<RealtimeEngine>(new RealtimeAudioTransport(SAMPLE_RATE, 30.0, 4, 2));
+    }
+    return std::unique_ptr<RealtimeEngine>(new RealtimeReassignmentTransport(SAMPLE_RATE, 30.0, 4, 2));
+}
+
+// Stereo through engine in blocks of cycling sizes up to MAX_BLOCK, in
+// place, with a per-sample k sweep
+std::vector<std::vector<float>> run(RealtimeEngine& engine, int total) {
+    std::vector<std::vector<float>> audio = { sine(440.0, total), sine(550.0, total) };
+    std::vector<float> side_l = sine(660.0, total), side_r = sine(770.0, total);
+    std::vector<float> k(total);
+    for (int i = 0; i < total; i++) k[i] = std::min(1.0f, static_cast<float>(i) / TOTAL);
+
+    const int sizes[] = {1, 37, 64, 219, 256, 100};
+    int pos = 0, s = 0;
+    while (pos < total) {
+        int n = std::min(sizes[s++ % 6], total - pos);
+        const float* main[] = { audio[0].data() + pos, audio[1].data() + pos };
+        const float* side[] = { side_l.data() + pos, side_r.data() + pos };
+        float* out[] = { audio[0].data() + pos, audio[1].data() + pos };
+        engine.process(main, side, out, 2, n, k.data() + pos);
+        pos += n;
+    }
+    return audio;
+}
+
+void test_delayed_output() {
+    std::cout << "Test 1: Output is the engine's, delayed... ";
+
+    for (int type = 0; type < 2; type++) {
+        std::unique_ptr<RealtimeEngine> reference = make_engine(type);
+        reference->setNumChannels(2);
+        reference->setChannelMode(RealtimeEngine::ChannelMode::Linked);
+
+        PipelinedEngine pipeline(make_engine(type), MAX_BLOCK);
+        pipeline.setNumChannels(2);
+        pipeline.setChannelMode(RealtimeEngine::ChannelMode::Linked);
+        pipeline.setWaitForWorker(true);
+
+        int delay = pipeline.getPipelineLatency();
+        assert(delay == 2 * reference->getHopSize() + MAX_BLOCK - 1);
+        assert(pipeline.getLatencySamples() == reference->getLatencySamples() + delay);
+        assert(pipeline.getHopSize() == reference->getHopSize());
+
+        // Twice, to check a reset starts over cleanly
+        std::vector<std::vector<float>> expected = run(*reference, TOTAL);
+        for (int pass = 0; pass < 2; pass++) {
+            std::vector<std::vector<float>> output = run(pipeline, TOTAL + delay);
+            for (int c = 0; c < 2; c++) {
+                for (int i = 0; i < delay; i++) assert(output[c][i] == 0.0f);
+                assert(std::equal(expected[c].begin(), expected[c].end(), output[c].begin() + delay));
+            }
+            assert(pipeline.getLateHops() == 0);
+            pipeline.reset();
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_late_hops() {
+    std::cout << "Test 2: Late hops are silent and the rest aligned... ";
+
+    // Without waiting, callbacks faster than realtime outrun the worker
+    std::unique_ptr<RealtimeEngine> reference = make_engine(1);
+    reference->setNumChannels(2);
+    PipelinedEngine pipeline(make_engine(1), MAX_BLOCK);
+    pipeline.setNumChannels(2);
+
+    int delay = pipeline.getPipelineLatency();
+    int hop = pipeline.getHopSize();
+    std::vector<std::vector<float>> expected = run(*reference, TOTAL);
+    std::vector<std::vector<float>> output = run(pipeline, TOTAL + delay);
+
+    // Each hop of output is the engine's or silence, never shifted
+    std::uint64_t silent = 0;
+    int settled = reference->getLatencySamples() + hop;
+    for (int start = settled - settled % hop; start + hop <= TOTAL; start += hop) {
+        bool matches = true, zero = true;
+        for (int c = 0; c < 2; c++) {
+            for (int i = start; i < start + hop; i++) {
+                matches = matches && output[c][i + delay] == expected[c][i];
+                zero = zero && output[c][i + delay] == 0.0f;
+            }
+        }
+        assert(matches || zero);
+        if (zero) silent++;
+    }
+    assert(silent <= pipeline.getLateHops());
+
+    std::cout << "PASS (" << pipeline.getLateHops() << " late)" << std::endl;
+}
+
+// Hands everything to engine, but holds the worker in process() while
+// closed, and records the input of the first hop after each reset
+struct gated_engine : RealtimeEngine {
+    std::unique_ptr<RealtimeEngine> engine;
+    std::atomic<bool> open;
+    int resets;
+    bool record;
+    std::vector<float> restart_input;
+
+    explicit gated_engine(std::unique_ptr<RealtimeEngine> wrapped)
+        : engine(std::move(wrapped)), open(true), resets(0), record(false) {}
+
+    void wait() {
+        while (!open.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    void process(const float* main, const float* side, float* out, int n, float k) override {
+        wait();
+        engine->process(main, side, out, n, k);
+    }
+    void process(const float* const* main, const float* const* side, float* const* out,
+                 int channels, int n, float k) override {
+        wait();
+        engine->process(main, side, out, channels, n, k);
+    }
+    void process(const float* main, const float* side, float* out, int n, const float* k) override {
+        process(&main, &side, &out, 1, n, k);
+    }
+    void process(const float* const* main, const float* const* side, float* const* out,
+                 int channels, int n, const float* k) override {
+        wait();
+        if (record) restart_input.assign(main[0], main[0] + n);
+        record = false;
+        engine->process(main, side, out, channels, n, k);
+    }
+
+    void setNumChannels(int channels) override { engine->setNumChannels(channels); }
+    int getNumChannels() const override { return engine->getNumChannels(); }
+    void setChannelMode(ChannelMode mode) override { engine->setChannelMode(mode); }
+    ChannelMode getChannelMode() const override { return engine->getChannelMode(); }
+    void reset() override {
+        engine->reset();
+        resets++;
+        record = true;
+    }
+    int getLatencySamples() const override { return engine->getLatencySamples(); }
+    int getHopSize() const override { return engine->getHopSize(); }
+    void setSilenceThreshold(float threshold) override { engine->setSilenceThreshold(threshold); }
+    float getSilenceThreshold() const override { return engine->getSilenceThreshold(); }
+    void setSidechainFrozen(bool frozen) override { engine->setSidechainFrozen(frozen); }
+    bool isSidechainFrozen() const override { return engine->isSidechainFrozen(); }
+    std::shared_ptr<const target_spectrum> makeTarget(
+        const float* audio, size_t num_samples, target_spectrum::mode playback) override {
+        return engine->makeTarget(audio, num_samples, playback);
+    }
+    bool setTarget(std::shared_ptr<const target_spectrum> target) override {
+        return engine->setTarget(std::move(target));
+    }
+    const target_spectrum* getTarget() const override { return engine->getTarget(); }
+    target_spectrum::analysis getTargetAnalysis() const override { return engine->getTargetAnalysis(); }
+    void setInstrumentation(instrumentation::recorder* recorder) override { engine->setInstrumentation(recorder); }
+    instrumentation::recorder* getInstrumentation() const override { return engine->getInstrumentation(); }
+};
+
+// Mono through engine in blocks of MAX_BLOCK at k = 0.5
+void feed(RealtimeEngine& engine, const float* main, const float* side, float* out, int total) {
+    for (int pos = 0; pos < total; pos += MAX_BLOCK) {
+        engine.process(main + pos, side + pos, out + pos, std::min(MAX_BLOCK, total - pos), 0.5f);
+    }
+}
+
+void test_dropped_hops() {
+    std::cout << "Test 3: The engine restarts cleanly after dropped hops... ";
+
+    std::vector<float> main(TOTAL), side = sine(660.0, TOTAL);
+    unsigned int seed = 1;
+    for (float& x : main) {
+        seed = seed * 1664525u + 1013904223u;
+        x = static_cast<float>((seed >> 8) / double(1 << 24) - 0.5);
+    }
+
+    gated_engine* gate = new gated_engine(make_engine(0));
+    PipelinedEngine pipeline{std::unique_ptr<RealtimeEngine>(gate), MAX_BLOCK};
+    int delay = pipeline.getPipelineLatency();
+    int hop = pipeline.getHopSize();
+
+    // A stuck worker fills every job, and later hops are dropped
+    std::vector<float> output(TOTAL + delay);
+    std::vector<float> padded_main(main), padded_side(side);
+    padded_main.resize(TOTAL + delay);
+    padded_side.resize(TOTAL + delay);
+    int stuck = 4000;
+    gate->open = false;
+    feed(pipeline, padded_main.data(), padded_side.data(), output.data(), stuck);
+    assert(pipeline.getDroppedHops() > 0);
+    assert(gate->resets == 0);
+
+    gate->open = true;
+    pipeline.setWaitForWorker(true);
+    feed(pipeline, padded_main.data() + stuck, padded_side.data() + stuck, output.data() + stuck,
+         TOTAL + delay - stuck);
+    assert(gate->resets == 1);
+    assert(static_cast<int>(gate->restart_input.size()) == hop);
+
+    // The restart hop, found by its input
+    int restart = -1;
+    for (int start = 0; start + hop <= TOTAL && restart < 0; start += hop) {
+        if (std::equal(gate->restart_input.begin(), gate->restart_input.end(), main.begin() + start)) {
+            restart = start;
+        }
+    }
+    assert(restart >= stuck - MAX_BLOCK - hop && restart <= stuck + hop);
+
+    // From there on, the output of a fresh engine given the same input
+    std::unique_ptr<RealtimeEngine> reference = make_engine(0);
+    int length = TOTAL - restart;
+    std::vector<float> expected(length);
+    feed(*reference, main.data() + restart, side.data() + restart, expected.data(), length);
+    float peak = 0;
+    for (int i = 0; i < length; i++) {
+        assert(output[restart + delay + i] == expected[i]);
+        peak = std::max(peak, std::fabs(expected[i]));
+    }
+    assert(peak > 0.01f);
+
+    std::cout << "PASS (" << pipeline.getDroppedHops() << " dropped)" << std::endl;
+}
+
+void test_worker_diagnostics() {
+    std::cout << "Test 4: The worker's warnings are drained from getDiagnostics()... ";
+
+    for (int type = 0; type < 2; type++) {
+        PipelinedEngine pipeline(make_engine(type), MAX_BLOCK);
+        pipeline.setWaitForWorker(true);
+
+        // A NaN in the main input poisons the frames it falls in
+        std::vector<float> main = sine(440.0, TOTAL), side = sine(660.0, TOTAL), output(TOTAL);
+        main[TOTAL / 2] = std::numeric_limits<float>::quiet_NaN();
+        diagnostics::channel own;
+        {
+            diagnostics::scope callback(own);
+            feed(pipeline, main.data(), side.data(), output.data(), TOTAL);
+        }
+
+        // Reported on the worker's channel, not the callback's
+        std::ostringstream log;
+        assert(diagnostics::drain(pipeline.getDiagnostics(), log) > 0);
+        assert(log.str().find("invalid") != std::string::npos);
+        assert(diagnostics::drain(own, log) == 0);
+        for (float x : output) assert(std::isfinite(x));
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+// Takes engine's settings but stands in for its process(): spends
+// cost on each call, as a hop of known load, and passes main through
+struct fixed_cost_engine : gated_engine {
+    std::chrono::microseconds cost;
+
+    fixed_cost_engine(std::unique_ptr<RealtimeEngine> wrapped, std::chrono::microseconds c)
+        : gated_engine(std::move(wrapped)), cost(c) {}
+
+    void process(const float* const* main, const float* const*, float* const* out,
+                 int channels, int n, const float*) override {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + cost;
+        while (std::chrono::steady_clock::now() < end) {}
+        for (int c = 0; c < channels; c++) std::copy(main[c], main[c] + n, out[c]);
+    }
+};
+
+void test_realtime_small_hop() {
+    std::cout << "Test 5: A realtime worker keeps up at the smallest hop... ";
+
+    // The plugin's shortest window, 20 ms, at hop divisor 4: a hop of
+    // an eighth of it, about 2.5 ms, and half of that spent per hop
+    std::unique_ptr<RealtimeEngine> engine(
+        new RealtimeReassignmentTransport(SAMPLE_RATE, 20.0, 4, 2, 0.0, fft_plans::smooth));
+    int hop = engine->getHopSize();
+    assert(hop > 100 && hop < 120);
+    long long hop_us = static_cast<long long>(hop / SAMPLE_RATE * 1e6);
+    const int block = 64;
+    PipelinedEngine pipeline(std::unique_ptr<RealtimeEngine>(
+        new fixed_cost_engine(std::move(engine), std::chrono::microseconds(hop_us / 2))), block);
+
+    // A quarter of the hop
+    assert(std::abs(pipeline.getPollInterval().count() - hop_us / 4) <= 1);
+
+    // Callbacks at the block rate, as a host's, without waiting
+    int total = static_cast<int>(SAMPLE_RATE);
+    std::vector<float> main = sine(440.0, total), side = sine(660.0, total), output(total);
+    const std::chrono::duration<double> period(block / SAMPLE_RATE);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int pos = 0, n = 0; pos + block <= total; pos += block, n++) {
+        std::this_thread::sleep_until(
+            start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * n));
+        pipeline.process(main.data() + pos, side.data() + pos, output.data() + pos, block, 0.5f);
+    }
+    assert(pipeline.getDroppedHops() == 0);
+    assert(pipeline.getLateHops() == 0);
+
+    // Every hop on time: the input, delayed by the pipeline
+    int delay = pipeline.getPipelineLatency();
+    int end = total - total % block;
+    for (int i = 0; i < end; i++) {
+        assert(output[i] == (i >= delay ? main[i - delay] : 0.0f));
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Pipelined Engine Unit Tests ===" << std::endl << std::endl;
+
+    try {
+        test_delayed_output();
+        test_late_hops();
+        test_dropped_hops();
+        test_worker_diagnostics();
+        test_realtime_small_hop();
+
+        std::cout << std::endl << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,264 @@
+"""
+Unit test for the _audio_transport Python bindings
+
+Tests that the engines match themselves across call sizes and layouts,
+that outputs are written in place, that threads sharing or not sharing
+an engine give the sequential results, and the offline API. Uses the
+standard library only; NumPy arrays are checked too when it is present.
+"""
+
+import array
+import math
+import sys
+import threading
+
+import _audio_transport as at
+
+SAMPLE_RATE = 44100.0
+WINDOW_MS = 50.0
+
+
+def tone(frequency, samples, amplitude=0.4, typecode='f'):
+    return array.array(typecode, (amplitude * math.sin(2.0 * math.pi * frequency * i / SAMPLE_RATE)
+                                  for i in range(samples)))
+
+
+def engines():
+    yield at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS)
+    yield at.RealtimeReassignmentTransport(SAMPLE_RATE, WINDOW_MS, fft_sizing='smooth')
+    if at.FLOAT_ENGINES:
+        yield at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS, precision='float')
+
+
+def run(engine, main, sidechain, k=0.5, block=512):
+    """main through engine in blocks, as a list of floats"""
+    output = []
+    for pos in range(0, len(main), block):
+        end = min(pos + block, len(main))
+        output.extend(engine.process(main[pos:end], sidechain[pos:end], k))
+    return output
+
+
+def test_process():
+    print("Test 1: process() is independent of the block size... ", end='')
+
+    main, sidechain = tone(220.0, 22050), tone(330.0, 22050)
+    for engine in engines():
+        assert engine.latency > 0 and engine.hop_size > 0
+        whole = list(engine.process(main, sidechain, 0.5))
+        engine.reset()
+        assert run(engine, main, sidechain, 0.5, 333) == whole
+        assert max(abs(x) for x in whole) > 0.05
+
+        # A per-sample k of one value is the scalar k
+        engine.reset()
+        assert list(engine.process(main, sidechain, array.array('f', [0.5]) * len(main))) == whole
+
+    print("PASS")
+
+
+def test_in_place():
+    print("Test 2: Outputs are written in place, and checked... ", end='')
+
+    main, sidechain = tone(220.0, 8192), tone(330.0, 8192)
+    engine = at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS)
+    expected = list(engine.process(main, sidechain, 0.3))
+
+    engine.reset()
+    out = array.array('f', [0.0]) * len(main)
+    assert engine.process(main, sidechain, 0.3, out) is out
+    assert list(out) == expected
+
+    # Over the main input
+    engine.reset()
+    work = array.array('f', main)
+    engine.process(work, sidechain, 0.3, work)
+    assert list(work) == expected
+
+    for bad in (lambda: engine.process(main, sidechain[:100]),
+                lambda: engine.process(array.array('d', main), sidechain),
+                lambda: engine.process(main, sidechain, 0.5, array.array('f', [0.0]) * 10),
+                lambda: engine.process(main, sidechain, array.array('f', [0.5]) * 10),
+                lambda: engine.process(main, sidechain, 0.5, bytes(4 * len(main)))):
+        try:
+            bad()
+            assert False
+        except (TypeError, ValueError):
+            pass
+
+    for bad in (lambda: at.RealtimeAudioTransport(SAMPLE_RATE, 0.0),
+                lambda: at.RealtimeReassignmentTransport(SAMPLE_RATE, WINDOW_MS, fft_sizing='odd'),
+                lambda: at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS, precision='half')):
+        try:
+            bad()
+            assert False
+        except ValueError:
+            pass
+
+    print("PASS")
+
+
+def test_planar():
+    print("Test 3: Planar buffers run every channel... ", end='')
+
+    n = 8192
+    left, right = tone(220.0, n), tone(440.0, n, 0.2)
+    side = tone(330.0, n)
+    main = memoryview(bytearray(left.tobytes() + right.tobytes())).cast('B').cast('f', (2, n))
+    sidechain = memoryview(bytearray(side.tobytes() * 2)).cast('B').cast('f', (2, n))
+
+    engine = at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS)
+    stereo = engine.process(main, sidechain, 0.5)
+    assert stereo.shape == (2, n) and engine.num_channels == 2
+
+    # Independent channels are the mono results
+    for c, channel in enumerate((left, right)):
+        mono = at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS)
+        assert stereo.tolist()[c] == list(mono.process(channel, side, 0.5))
+
+    engine.linked = True
+    assert engine.linked
+    engine.silence_threshold = 1e-4
+    assert abs(engine.silence_threshold - 1e-4) < 1e-9
+    engine.sidechain_frozen = True
+    assert engine.sidechain_frozen
+
+    print("PASS")
+
+
+def test_threads():
+    print("Test 4: Threads give the sequential results... ", end='')
+
+    main, sidechain = tone(220.0, 22050), tone(330.0, 22050)
+    ks = (0.1, 0.4, 0.7, 0.9)
+    expected = []
+    for k in ks:
+        engine = at.RealtimeReassignmentTransport(SAMPLE_RATE, WINDOW_MS)
+        expected.append(run(engine, main, sidechain, k))
+
+    # An engine per thread
+    results = [None] * len(ks)
+
+    def own(i):
+        engine = at.RealtimeReassignmentTransport(SAMPLE_RATE, WINDOW_MS)
+        results[i] = run(engine, main, sidechain, ks[i])
+
+    threads = [threading.Thread(target=own, args=(i,)) for i in range(len(ks))]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert results == expected
+
+    # One engine shared: each call is whole, whatever the interleaving
+    shared = at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS)
+    errors = []
+
+    def hammer():
+        try:
+            for _ in range(20):
+                out = shared.process(main[:1024], sidechain[:1024], 0.5)
+                assert len(out) == 1024
+                _ = shared.latency
+        except Exception as e:
+            errors.append(e)
+
+    threads = [threading.Thread(target=hammer) for _ in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert not errors
+
+    # The offline renderer too
+    left, right = tone(220.0, 22050, typecode='d'), tone(330.0, 22050, typecode='d')
+    sequential = [list(at.transport(left, right, SAMPLE_RATE, k)) for k in ks]
+    results = [None] * len(ks)
+
+    def offline(i):
+        results[i] = list(at.transport(left, right, SAMPLE_RATE, ks[i]))
+
+    threads = [threading.Thread(target=offline, args=(i,)) for i in range(len(ks))]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    assert results == sequential
+
+    print("PASS")
+
+
+def test_offline():
+    print("Test 5: analysis, interpolate and synthesis match transport()... ", end='')
+
+    left, right = tone(220.0, 22050, typecode='d'), tone(330.0, 22050, typecode='d')
+    a = at.analysis(left, SAMPLE_RATE, 0.05, 2)
+    b = at.analysis(right, SAMPLE_RATE, 0.05, 2)
+    assert len(a) == len(b) > 0 and a.num_bins == b.num_bins > 0
+
+    # At k = 0 the input's level comes back (its phases are resynthesized)
+    same = at.synthesis(at.interpolate(a, b, 0.0, 0.05), 2)
+    assert same.format == 'd' and len(same) > 17640
+    level = math.sqrt(sum(x * x for x in same[4410:17640]) / 13230)
+    assert abs(level - 0.4 / math.sqrt(2.0)) < 0.05
+
+    # Against the renderer, without weighting, over a curve of factors
+    curve = array.array('d', [0.0, 1.0])
+    frames = at.interpolate(a, b, curve, 0.05)
+    direct = list(at.synthesis(frames, 2))
+    rendered = list(at.transport(left, right, SAMPLE_RATE, curve, 0.05, 2, 1,
+                                 equal_loudness=False, threads=2))
+    assert direct == rendered
+
+    # float32 input is accepted
+    assert len(at.analysis(array.array('f', left), SAMPLE_RATE)) == len(at.analysis(left, SAMPLE_RATE))
+
+    try:
+        at.synthesis(left)
+        assert False
+    except TypeError:
+        pass
+
+    print("PASS")
+
+
+def test_numpy():
+    try:
+        import numpy as np
+    except ImportError:
+        print("Test 6: NumPy arrays (skipped, no NumPy)")
+        return
+    print("Test 6: NumPy arrays are used without copies... ", end='')
+
+    t = np.arange(22050) / SAMPLE_RATE
+    main = (0.4 * np.sin(2 * np.pi * 220 * t)).astype(np.float32)
+    sidechain = (0.4 * np.sin(2 * np.pi * 330 * t)).astype(np.float32)
+    engine = at.RealtimeAudioTransport(SAMPLE_RATE, WINDOW_MS)
+    out = np.empty_like(main)
+    engine.process(main, sidechain, np.full(main.shape, 0.5, np.float32), out)
+    engine.reset()
+    assert np.array_equal(np.asarray(engine.process(main, sidechain, 0.5)), out)
+
+    stereo = np.stack([main, main])
+    assert np.asarray(engine.process(stereo, np.stack([sidechain, sidechain]))).shape == (2, len(main))
+
+    audio = np.asarray(at.transport(t, t[::-1].copy(), SAMPLE_RATE))
+    assert audio.dtype == np.float64 and np.isfinite(audio).all()
+
+    print("PASS")
+
+
+def main():
+    print("=== Python Bindings Unit Tests ===\n")
+    test_process()
+    test_in_place()
+    test_planar()
+    test_threads()
+    test_offline()
+    test_numpy()
+    print("\nAll tests passed!")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,406 @@
+/**
+ * Unit test for RealtimeReassignmentTransport
+ *
+ * Tests basic functionality, that the hop path stays off the heap and
+ * that the FFT sizing policies analyse and resynthesize alike
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <algorithm>
+
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+#include "audio_transport/realtime_check.hpp"
+#include "audio_transport/fft_plans.hpp"
+
+// Route every allocation through the library's realtime check. In
+// Debug builds an allocation inside process() aborts the test.
+void* operator new(std::size_t size) {
+    audio_transport::realtime_check::allocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void test_initialization() {
+    std::cout << "Test 1: Initialization... ";
+
+    audio_transport::RealtimeReassignmentTransport processor(44100.0, 100.0, 4, 2);
+
+    int latency = processor.getLatencySamples();
+    assert(latency > 0);
+    assert(latency < 44100); // Less than 1 second
+    assert(processor.getHopSize() > 0);
+    assert(processor.getHopSize() <= latency);
+
+    std::cout << "PASS (latency = " << latency << " samples)" << std::endl;
+}
+
+void test_process_sine_waves() {
+    std::cout << "Test 2: Process sine waves... ";
+
+    const double sample_rate = 44100.0;
+    const int buffer_size = 512;
+    const int num_buffers = 40;
+
+    audio_transport::RealtimeReassignmentTransport processor(sample_rate, 50.0, 4, 2);
+
+    std::vector<float> main_in(buffer_size);
+    std::vector<float> sc_in(buffer_size);
+    std::vector<float> output(buffer_size);
+
+    double t = 0.0;
+    bool has_non_zero_output = false;
+
+    for (int buf = 0; buf < num_buffers; ++buf) {
+        for (int i = 0; i < buffer_size; ++i) {
+            main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+            sc_in[i] = 0.5f * std::sin(2.0 * M_PI * 660.0 * t);
+            t += 1.0 / sample_rate;
+        }
+
+        processor.process(main_in.data(), sc_in.data(), output.data(), buffer_size, 0.5f);
+
+        for (int i = 0; i < buffer_size; ++i) {
+            assert(std::isfinite(output[i]));
+            if (std::abs(output[i]) > 0.01f) {
+                has_non_zero_output = true;
+            }
+        }
+    }
+
+    assert(has_non_zero_output);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_different_buffer_sizes() {
+    std::cout << "Test 3: Different buffer sizes... ";
+
+    audio_transport::RealtimeReassignmentTransport processor(44100.0, 50.0, 4, 2);
+
+    std::vector<int> buffer_sizes = {32, 64, 128, 256, 512, 1024, 2048};
+
+    for (int size : buffer_sizes) {
+        std::vector<float> main_in(size, 0.1f);
+        std::vector<float> sc_in(size, 0.2f);
+        std::vector<float> output(size);
+
+        processor.process(main_in.data(), sc_in.data(), output.data(), size, 0.5f);
+
+        for (int i = 0; i < size; ++i) {
+            assert(std::isfinite(output[i]));
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_no_allocations_in_process() {
+    std::cout << "Test 4: No allocations in process()... ";
+
+    const double sample_rate = 44100.0;
+    const int buffer_size = 256;
+
+    audio_transport::RealtimeReassignmentTransport processor(sample_rate, 50.0, 4, 2);
+
+    std::vector<float> main_in(buffer_size);
+    std::vector<float> sc_in(buffer_size);
+    std::vector<float> output(buffer_size);
+
+    size_t allocations_before = audio_transport::realtime_check::allocation_count();
+
+    // Cover silence, one-sided silence and full transport hops
+    double t = 0.0;
+    for (int buf = 0; buf < 60; ++buf) {
+        bool main_on = buf >= 10;
+        bool sc_on = buf >= 25 && buf < 50;
+        for (int i = 0; i < buffer_size; ++i) {
+            main_in[i] = main_on ? 0.5f * std::sin(2.0 * M_PI * 440.0 * t) : 0.0f;
+            sc_in[i] = sc_on ? 0.5f * std::sin(2.0 * M_PI * 880.0 * t) : 0.0f;
+            t += 1.0 / sample_rate;
+        }
+        processor.process(main_in.data(), sc_in.data(), output.data(), buffer_size, 0.5f);
+    }
+
+    assert(audio_transport::realtime_check::allocation_count() == allocations_before);
+
+    std::cout << "PASS" << std::endl;
+}
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+void test_float_matches_double() {
+    std::cout << "Test 5: Float engine matches double engine... ";
+
+    const double sample_rate = 44100.0;
+    const int buffer_size = 512;
+    const int settle = 10; // buffers, past the first full window
+
+    // A hop of half the window, as in Test 8, so that the output is at
+    // the level of the input (at a quarter hop it mostly cancels and
+    // the comparison would be between near silences)
+    audio_transport::RealtimeReassignmentTransport proc_d(sample_rate, 50.0, 1, 2);
+    audio_transport::RealtimeReassignmentTransportFloat proc_f(sample_rate, 50.0, 1, 2);
+
+    std::vector<float> main_in(buffer_size);
+    std::vector<float> sc_in(buffer_size);
+    std::vector<float> out_d(buffer_size);
+    std::vector<float> out_f(buffer_size);
+
+    double t = 0.0;
+    double input = 0.0, signal = 0.0, error = 0.0, worst = 0.0;
+    for (int buf = 0; buf < 40; ++buf) {
+        for (int i = 0; i < buffer_size; ++i) {
+            main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+            sc_in[i] = 0.5f * std::sin(2.0 * M_PI * 660.0 * t);
+            t += 1.0 / sample_rate;
+        }
+        proc_d.process(main_in.data(), sc_in.data(), out_d.data(), buffer_size, 0.5f);
+        proc_f.process(main_in.data(), sc_in.data(), out_f.data(), buffer_size, 0.5f);
+
+        for (int i = 0; i < buffer_size; ++i) {
+            assert(std::isfinite(out_f[i]));
+        }
+        if (buf < settle) continue;
+        for (int i = 0; i < buffer_size; ++i) {
+            double d = out_f[i] - out_d[i];
+            input += main_in[i] * main_in[i];
+            signal += out_d[i] * out_d[i];
+            error += d * d;
+            worst = std::max(worst, std::abs(d));
+        }
+    }
+    assert(std::abs(10.0 * std::log10(signal / input)) < 0.1);
+
+    double error_db = 10.0 * std::log10((error + 1e-30) / signal);
+    // Both synthesize the reassigned partials from the same analysis,
+    // so once settled float differs from double by about the rounding
+    // of the output samples themselves (around -145 dB), sample by
+    // sample as well as on average
+    assert(error_db < -120.0);
+    assert(worst < 1e-6);
+
+    std::cout << "PASS (error " << error_db << " dB, worst " << worst << ")" << std::endl;
+}
+#endif
+
+void test_multichannel() {
+    std::cout << "Test 6: Multichannel independent and linked modes... ";
+
+    const double sample_rate = 44100.0;
+    const int total = 16384;
+    const int block = 512;
+
+    // The right side is the left at half level
+    std::vector<float> main_l(total), main_r(total), sc_l(total), sc_r(total);
+    for (int i = 0; i < total; ++i) {
+        double t = i / sample_rate;
+        main_l[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+        sc_l[i] = 0.3f * std::sin(2.0 * M_PI * 660.0 * t);
+        main_r[i] = 0.5f * main_l[i];
+        sc_r[i] = 0.5f * sc_l[i];
+    }
+
+    // Mono reference per channel, in the same blocks (output is only
+    // read out at the end of a call)
+    std::vector<float> mono_l(total), mono_r(total);
+    {
+        audio_transport::RealtimeReassignmentTransport mono(sample_rate, 50.0, 4, 2);
+        for (int pos = 0; pos < total; pos += block) {
+            mono.process(main_l.data() + pos, sc_l.data() + pos, mono_l.data() + pos, block, 0.3f);
+        }
+        mono.reset();
+        for (int pos = 0; pos < total; pos += block) {
+            mono.process(main_r.data() + pos, sc_r.data() + pos, mono_r.data() + pos, block, 0.3f);
+        }
+    }
+
+    for (int mode = 0; mode < 2; ++mode) {
+        audio_transport::RealtimeReassignmentTransport processor(sample_rate, 50.0, 4, 2);
+        processor.setNumChannels(2);
+        processor.setChannelMode(mode == 0
+            ? audio_transport::RealtimeEngine::ChannelMode::Independent
+            : audio_transport::RealtimeEngine::ChannelMode::Linked);
+
+        std::vector<float> out_l(total), out_r(total);
+        size_t allocations_before = audio_transport::realtime_check::allocation_count();
+        for (int pos = 0; pos < total; pos += block) {
+            const float* main_in[2] = { main_l.data() + pos, main_r.data() + pos };
+            const float* sc_in[2] = { sc_l.data() + pos, sc_r.data() + pos };
+            float* out[2] = { out_l.data() + pos, out_r.data() + pos };
+            processor.process(main_in, sc_in, out, 2, block, 0.3f);
+        }
+        assert(audio_transport::realtime_check::allocation_count() == allocations_before);
+
+        if (mode == 0) {
+            // Independent channels are exactly the mono engine
+            assert(out_l == mono_l);
+            assert(out_r == mono_r);
+        } else {
+            // One plan for both: the right channel stays the left at half
+            // level, and the left matches mono up to rounding
+            double energy = 0.0, pan_error = 0.0, mono_error = 0.0;
+            for (int i = 0; i < total; ++i) {
+                double d = out_r[i] - 0.5 * out_l[i];
+                double m = out_l[i] - mono_l[i];
+                energy += out_l[i] * out_l[i];
+                pan_error += d * d;
+                mono_error += m * m;
+            }
+            assert(energy > 0.0);
+            assert(pan_error < 1e-10 * energy);
+            assert(mono_error < 1e-8 * energy);
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_in_place() {
+    std::cout << "Test 7: Processing in place... ";
+
+    const double sample_rate = 44100.0;
+    const int block = 300;
+    const int total = 27 * block;
+
+    // Stereo main, and a mono sidechain shared by both channels
+    std::vector<float> main_l(total), main_r(total), sc(total);
+    for (int i = 0; i < total; ++i) {
+        double t = i / sample_rate;
+        main_l[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+        main_r[i] = 0.4f * std::sin(2.0 * M_PI * 330.0 * t);
+        sc[i] = 0.3f * std::sin(2.0 * M_PI * 660.0 * t);
+    }
+
+    // Output over the main input, then over the sidechain input with the
+    // two swapped (as the plugin does past the flip point)
+    for (int flip = 0; flip < 2; ++flip) {
+        audio_transport::RealtimeReassignmentTransport reference(sample_rate, 50.0, 4, 2);
+        audio_transport::RealtimeReassignmentTransport processor(sample_rate, 50.0, 4, 2);
+        reference.setNumChannels(2);
+        processor.setNumChannels(2);
+
+        std::vector<float> expected_l(total), expected_r(total);
+        std::vector<float> buffer_l = main_l, buffer_r = main_r;
+        for (int pos = 0; pos < total; pos += block) {
+            const float* own[2] = { main_l.data() + pos, main_r.data() + pos };
+            const float* shared[2] = { sc.data() + pos, sc.data() + pos };
+            float* expected[2] = { expected_l.data() + pos, expected_r.data() + pos };
+            reference.process(flip ? shared : own, flip ? own : shared, expected, 2, block, 0.3f);
+
+            float* buffer[2] = { buffer_l.data() + pos, buffer_r.data() + pos };
+            const float* buffer_in[2] = { buffer[0], buffer[1] };
+            processor.process(flip ? shared : buffer_in, flip ? buffer_in : shared,
+                              buffer, 2, block, 0.3f);
+        }
+        assert(buffer_l == expected_l);
+        assert(buffer_r == expected_r);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+double rms(const std::vector<float>& audio, size_t from) {
+    double sum = 0;
+    for (size_t i = from; i < audio.size(); ++i) sum += double(audio[i]) * audio[i];
+    return std::sqrt(sum / (audio.size() - from));
+}
+
+void test_fft_sizing() {
+    std::cout << "Test 8: FFT sizing policies... ";
+
+    using namespace audio_transport;
+
+    // 100 ms at 44.1 kHz with 2x padding is 13230 = 2 * 3^3 * 5 * 7^2
+    assert(fft_plans::transform_size(13230, fft_plans::exact) == 13230);
+    assert(fft_plans::transform_size(13230, fft_plans::power_of_two) == 16384);
+    assert(fft_plans::transform_size(13230, fft_plans::smooth) == 13500);
+    assert(fft_plans::transform_size(14400, fft_plans::smooth) == 14400);
+    assert(fft_plans::transform_size(16384, fft_plans::power_of_two) == 16384);
+    assert(fft_plans::transform_size(243, fft_plans::smooth) == 250); // even
+
+    // A hop of half the window, where the transport's phase advance is
+    // exact, so that each side resynthesizes at its own level
+    const double sample_rate = 44100.0;
+    const int total = 44100;
+    std::vector<float> main_in(total), sc_in(total);
+    for (int i = 0; i < total; ++i) {
+        double t = i / sample_rate;
+        main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t) + 0.2f * std::sin(2.0 * M_PI * 1250.0 * t);
+        sc_in[i] = 0.4f * std::sin(2.0 * M_PI * 660.0 * t);
+    }
+
+    const fft_plans::sizing policies[] = {
+        fft_plans::exact, fft_plans::power_of_two, fft_plans::smooth
+    };
+    for (fft_plans::sizing policy : policies) {
+        RealtimeReassignmentTransport processor(sample_rate, 100.0, 1, 2, 0.0, policy);
+        int size = processor.getFFTSize();
+        assert(size == fft_plans::transform_size(13230, policy));
+        assert(processor.getTargetAnalysis().fft_size == static_cast<uint32_t>(size));
+
+        // Bins are spaced for the transform, and the reassigned
+        // frequency of a partial does not depend on them
+        std::shared_ptr<const target_spectrum> target =
+            processor.makeTarget(main_in.data(), 8192, target_spectrum::mode::averaged);
+        const target_spectrum::frame& frame = target->at(0);
+        size_t peak = 0;
+        for (size_t i = 0; i < frame.magnitudes.size(); ++i) {
+            if (frame.magnitudes[i] > frame.magnitudes[peak]) peak = i;
+        }
+        double bin_hz = sample_rate / size;
+        assert(std::abs(peak * bin_hz - 440.0) <= bin_hz);
+        double reassigned_hz = peak * bin_hz + frame.freq_offsets[peak] / (2.0 * M_PI);
+        assert(std::abs(reassigned_hz - 440.0) < 0.05);
+
+        // The overlap-add scales for the transform size
+        for (float k : { 0.0f, 1.0f }) {
+            processor.reset();
+            std::vector<float> output(total);
+            for (int pos = 0; pos < total; pos += 512) {
+                int n = std::min(512, total - pos);
+                processor.process(main_in.data() + pos, sc_in.data() + pos, output.data() + pos, n, k);
+            }
+            const std::vector<float>& input = k == 0.0f ? main_in : sc_in;
+            assert(std::abs(rms(output, total / 2) / rms(input, total / 2) - 1.0) < 0.01);
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "\n=== RealtimeReassignmentTransport Unit Tests ===\n" << std::endl;
+
+    try {
+        test_initialization();
+        test_process_sine_waves();
+        test_different_buffer_sizes();
+        test_no_allocations_in_process();
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+        test_float_matches_double();
+#endif
+        test_multichannel();
+        test_in_place();
+        test_fft_sizing();
+
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
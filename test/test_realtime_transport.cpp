@@ -6,11 +6,28 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cmath>
 #include <cassert>
 #include <cstring>
+#include <cstdlib>
+#include <new>
 
 #include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/realtime_check.hpp"
+
+// Route every allocation through the library's realtime check. In
+// Debug builds an allocation inside process() aborts the test.
+void* operator new(std::size_t size) {
+    audio_transport::realtime_check::allocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
 
 void test_initialization() {
     std::cout << "Test 1: Initialization... ";
@@ -21,6 +38,8 @@ void test_initialization() {
     int latency = processor.getLatencySamples();
     assert(latency > 0);
     assert(latency < 44100); // Less than 1 second
+    assert(processor.getHopSize() > 0);
+    assert(processor.getHopSize() <= latency);
 
     std::cout << "PASS (latency = " << latency << " samples)" << std::endl;
 }
@@ -219,6 +238,377 @@ void test_sample_rate_change() {
     std::cout << "PASS" << std::endl;
 }
 
+void test_no_allocations_in_process() {
+    std::cout << "Test 8: No allocations in process()... ";
+
+    const double sample_rate = 44100.0;
+    const int buffer_size = 256;
+
+    audio_transport::RealtimeAudioTransport processor(sample_rate, 50.0, 4, 2);
+
+    std::vector<float> main_in(buffer_size);
+    std::vector<float> sc_in(buffer_size);
+    std::vector<float> output(buffer_size);
+
+    size_t allocations_before = audio_transport::realtime_check::allocation_count();
+
+    double t = 0.0;
+    for (int buf = 0; buf < 40; ++buf) {
+        // Change sample rate halfway; buffers are resized there, not in process()
+        if (buf == 20) processor.setSampleRate(48000.0);
+
+        for (int i = 0; i < buffer_size; ++i) {
+            main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+            sc_in[i] = 0.5f * std::sin(2.0 * M_PI * 880.0 * t);
+            t += 1.0 / sample_rate;
+        }
+        processor.process(main_in.data(), sc_in.data(), output.data(), buffer_size, 0.5f);
+    }
+
+    assert(audio_transport::realtime_check::allocation_count() == allocations_before);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_merge_transport_map() {
+    std::cout << "Test 9: Merge transport map matches binary search... ";
+
+    typedef audio_transport::RealtimeAudioTransport RT;
+
+    const int num_bins = 1025;
+    const double eps = 1e-10;
+    std::srand(1234);
+
+    for (int trial = 0; trial < 20; ++trial) {
+        // Random spectra with silent stretches so the CDFs have flat regions
+        std::vector<double> mag_X(num_bins), mag_Y(num_bins);
+        for (int i = 0; i < num_bins; ++i) {
+            mag_X[i] = (std::rand() % 4 == 0) ? 0.0 : std::rand() / (double)RAND_MAX;
+            mag_Y[i] = (i % 200 < 50) ? 0.0 : std::rand() / (double)RAND_MAX;
+        }
+
+        double sum_X = 0.0, sum_Y = 0.0;
+        for (int i = 0; i < num_bins; ++i) {
+            sum_X += mag_X[i];
+            sum_Y += mag_Y[i];
+        }
+        std::vector<double> cdf_X(num_bins), cdf_Y(num_bins);
+        double cumsum_X = 0.0, cumsum_Y = 0.0;
+        for (int i = 0; i < num_bins; ++i) {
+            cumsum_X += mag_X[i] / sum_X;
+            cumsum_Y += mag_Y[i] / sum_Y;
+            cdf_X[i] = cumsum_X;
+            cdf_Y[i] = cumsum_Y;
+        }
+
+        std::vector<int> merged(num_bins);
+        std::vector<double> fractional(num_bins);
+        RT::mergeTransportMap(cdf_X, cdf_Y, merged);
+        RT::mergeFractionalTransportMap(cdf_X, cdf_Y, fractional);
+
+        for (int i = 0; i < num_bins; ++i) {
+            // Reference: binary search for smallest j where cdf_Y[j] >= cdf_X[i]
+            int left = 0, right = num_bins - 1, result = num_bins - 1;
+            while (left <= right) {
+                int mid = (left + right) / 2;
+                if (cdf_Y[mid] >= cdf_X[i] - eps) {
+                    result = mid;
+                    right = mid - 1;
+                } else {
+                    left = mid + 1;
+                }
+            }
+            assert(merged[i] == result);
+
+            // The fractional position lies on the segment ending at that bin
+            assert(fractional[i] <= merged[i]);
+            assert(fractional[i] >= merged[i] - 1);
+            if (i > 0) assert(fractional[i] >= fractional[i - 1]);
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_fractional_transport_map() {
+    std::cout << "Test 10: Fractional transport map processing... ";
+
+    const double sample_rate = 44100.0;
+    const int buffer_size = 512;
+
+    audio_transport::RealtimeAudioTransport processor(sample_rate, 50.0, 4, 2);
+    processor.setTransportMapMode(
+        audio_transport::RealtimeAudioTransport::TransportMapMode::Fractional);
+
+    std::vector<float> main_in(buffer_size);
+    std::vector<float> sc_in(buffer_size);
+    std::vector<float> output(buffer_size);
+
+    double t = 0.0;
+    bool has_non_zero_output = false;
+    for (int buf = 0; buf < 40; ++buf) {
+        for (int i = 0; i < buffer_size; ++i) {
+            main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+            sc_in[i] = 0.5f * std::sin(2.0 * M_PI * 554.37 * t);
+            t += 1.0 / sample_rate;
+        }
+        processor.process(main_in.data(), sc_in.data(), output.data(), buffer_size, 0.5f);
+
+        for (int i = 0; i < buffer_size; ++i) {
+            assert(std::isfinite(output[i]));
+            assert(std::abs(output[i]) <= 1.0f);
+            if (std::abs(output[i]) > 0.01f) has_non_zero_output = true;
+        }
+    }
+    assert(has_non_zero_output);
+
+    std::cout << "PASS" << std::endl;
+}
+
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+void test_float_matches_double() {
+    std::cout << "Test 11: Float engine matches double engine... ";
+
+    const double sample_rate = 44100.0;
+    const int buffer_size = 512;
+    const int settle = 10; // buffers, past the first full window
+    const int buffers = 40;
+
+    // The fractional map is continuous in the CDFs, so float rounding
+    // can only move mass slightly instead of jumping a whole bin
+    audio_transport::RealtimeAudioTransport proc_d(sample_rate, 50.0, 4, 2);
+    audio_transport::RealtimeAudioTransportFloat proc_f(sample_rate, 50.0, 4, 2);
+    proc_d.setTransportMapMode(
+        audio_transport::RealtimeAudioTransport::TransportMapMode::Fractional);
+    proc_f.setTransportMapMode(
+        audio_transport::RealtimeAudioTransportFloat::TransportMapMode::Fractional);
+
+    std::vector<float> main_in(buffer_size);
+    std::vector<float> sc_in(buffer_size);
+    std::vector<float> out_d(buffer_size);
+    std::vector<float> out_f(buffer_size);
+
+    // Settled error over the first and second half of the run
+    double t = 0.0;
+    double signal[2] = { 0.0, 0.0 }, error[2] = { 0.0, 0.0 }, energy_f = 0.0;
+    for (int buf = 0; buf < buffers; ++buf) {
+        for (int i = 0; i < buffer_size; ++i) {
+            main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+            sc_in[i] = 0.5f * std::sin(2.0 * M_PI * 554.37 * t);
+            t += 1.0 / sample_rate;
+        }
+        proc_d.process(main_in.data(), sc_in.data(), out_d.data(), buffer_size, 0.5f);
+        proc_f.process(main_in.data(), sc_in.data(), out_f.data(), buffer_size, 0.5f);
+
+        for (int i = 0; i < buffer_size; ++i) {
+            assert(std::isfinite(out_f[i]));
+        }
+        if (buf < settle) continue;
+        int half = buf < (settle + buffers) / 2 ? 0 : 1;
+        for (int i = 0; i < buffer_size; ++i) {
+            double d = out_f[i] - out_d[i];
+            signal[half] += out_d[i] * out_d[i];
+            energy_f += out_f[i] * out_f[i];
+            error[half] += d * d;
+        }
+    }
+    assert(signal[0] > 0.0 && signal[1] > 0.0);
+
+    double level_db = 10.0 * std::log10(energy_f / (signal[0] + signal[1]));
+    double early_db = 10.0 * std::log10((error[0] + 1e-30) / signal[0]);
+    double late_db = 10.0 * std::log10((error[1] + 1e-30) / signal[1]);
+    // The CDFs, not phases, carry the state from hop to hop, so once
+    // settled float follows double to the precision of the map (around
+    // -100 dB) and the error does not grow over the run
+    assert(std::abs(level_db) < 0.001);
+    assert(early_db < -85.0);
+    assert(late_db < -85.0);
+
+    std::cout << "PASS (level " << level_db << " dB, error " << early_db << " / "
+              << late_db << " dB)" << std::endl;
+}
+#endif
+
+void test_block_size_invariance() {
+    std::cout << "Test 12: Output independent of host block size... ";
+
+    const double sample_rate = 44100.0;
+    const int total = 16384;
+
+    std::vector<float> main_in(total), sc_in(total);
+    for (int i = 0; i < total; ++i) {
+        double t = i / sample_rate;
+        main_in[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+        sc_in[i] = 0.3f * std::sin(2.0 * M_PI * 660.0 * t);
+    }
+
+    // Reference: one call for everything
+    audio_transport::RealtimeAudioTransport reference(sample_rate, 20.0, 4, 2);
+    std::vector<float> expected(total);
+    reference.process(main_in.data(), sc_in.data(), expected.data(), total, 0.3f);
+
+    // Irregular block sizes, including ones that straddle hops
+    const int sizes[] = {1, 7, 32, 64, 219, 220, 221, 512, 1000};
+    audio_transport::RealtimeAudioTransport processor(sample_rate, 20.0, 4, 2);
+    std::vector<float> actual(total);
+    int pos = 0, s = 0;
+    while (pos < total) {
+        int n = std::min(sizes[s++ % 9], total - pos);
+        processor.process(main_in.data() + pos, sc_in.data() + pos,
+                          actual.data() + pos, n, 0.3f);
+        pos += n;
+    }
+
+    assert(actual == expected);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_impulse_latency() {
+    std::cout << "Test 13: Impulse delayed by reported latency... ";
+
+    // k = 0 passes the main input through, delayed by the latency
+    audio_transport::RealtimeAudioTransport processor(44100.0, 20.0, 4, 2);
+    const int total = 8192;
+    const int impulse = 1000;
+
+    std::vector<float> in(total, 0.0f), out(total);
+    in[impulse] = 1.0f;
+    processor.process(in.data(), in.data(), out.data(), total, 0.0f);
+
+    int peak = 0;
+    for (int i = 0; i < total; ++i) {
+        if (std::abs(out[i]) > std::abs(out[peak])) peak = i;
+    }
+    assert(peak == impulse + processor.getLatencySamples());
+
+    std::cout << "PASS (latency = " << processor.getLatencySamples() << " samples)" << std::endl;
+}
+
+void test_multichannel() {
+    std::cout << "Test 14: Multichannel independent and linked modes... ";
+
+    const double sample_rate = 44100.0;
+    const int total = 8192;
+    const int block = 256;
+
+    // Left and right differ; the right side is the left at half level
+    std::vector<float> main_l(total), main_r(total), sc_l(total), sc_r(total);
+    for (int i = 0; i < total; ++i) {
+        double t = i / sample_rate;
+        main_l[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+        sc_l[i] = 0.3f * std::sin(2.0 * M_PI * 660.0 * t);
+        main_r[i] = 0.5f * main_l[i];
+        sc_r[i] = 0.5f * sc_l[i];
+    }
+
+    // Mono reference per channel
+    std::vector<float> mono_l(total), mono_r(total);
+    {
+        audio_transport::RealtimeAudioTransport mono(sample_rate, 20.0, 4, 2);
+        mono.process(main_l.data(), sc_l.data(), mono_l.data(), total, 0.3f);
+        mono.reset();
+        mono.process(main_r.data(), sc_r.data(), mono_r.data(), total, 0.3f);
+    }
+
+    for (int mode = 0; mode < 2; ++mode) {
+        audio_transport::RealtimeAudioTransport processor(sample_rate, 20.0, 4, 2);
+        processor.setNumChannels(2);
+        processor.setChannelMode(mode == 0
+            ? audio_transport::RealtimeEngine::ChannelMode::Independent
+            : audio_transport::RealtimeEngine::ChannelMode::Linked);
+        assert(processor.getNumChannels() == 2);
+
+        std::vector<float> out_l(total), out_r(total);
+        size_t allocations_before = audio_transport::realtime_check::allocation_count();
+        for (int pos = 0; pos < total; pos += block) {
+            const float* main_in[2] = { main_l.data() + pos, main_r.data() + pos };
+            const float* sc_in[2] = { sc_l.data() + pos, sc_r.data() + pos };
+            float* out[2] = { out_l.data() + pos, out_r.data() + pos };
+            processor.process(main_in, sc_in, out, 2, block, 0.3f);
+        }
+        assert(audio_transport::realtime_check::allocation_count() == allocations_before);
+
+        if (mode == 0) {
+            // Independent channels are exactly the mono engine
+            assert(out_l == mono_l);
+            assert(out_r == mono_r);
+        } else {
+            // Scaling a channel leaves the summed map unchanged, so the
+            // linked output keeps the level difference
+            double energy = 0.0, error = 0.0;
+            for (int i = 0; i < total; ++i) {
+                double d = out_r[i] - 0.5 * out_l[i];
+                energy += out_l[i] * out_l[i];
+                error += d * d;
+            }
+            assert(energy > 0.0);
+            assert(error < 1e-10 * energy);
+        }
+    }
+
+    // Identical channels give the mono output on each
+    {
+        audio_transport::RealtimeAudioTransport processor(sample_rate, 20.0, 4, 2);
+        processor.setNumChannels(2);
+        processor.setChannelMode(audio_transport::RealtimeEngine::ChannelMode::Linked);
+
+        std::vector<float> out_a(total), out_b(total);
+        const float* main_in[2] = { main_l.data(), main_l.data() };
+        const float* sc_in[2] = { sc_l.data(), sc_l.data() };
+        float* out[2] = { out_a.data(), out_b.data() };
+        processor.process(main_in, sc_in, out, 2, total, 0.3f);
+        assert(out_a == mono_l);
+        assert(out_b == mono_l);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_in_place() {
+    std::cout << "Test 15: Processing in place... ";
+
+    const double sample_rate = 44100.0;
+    const int block = 300;
+    const int total = 27 * block;
+
+    // Stereo main, and a mono sidechain shared by both channels
+    std::vector<float> main_l(total), main_r(total), sc(total);
+    for (int i = 0; i < total; ++i) {
+        double t = i / sample_rate;
+        main_l[i] = 0.5f * std::sin(2.0 * M_PI * 440.0 * t);
+        main_r[i] = 0.4f * std::sin(2.0 * M_PI * 330.0 * t);
+        sc[i] = 0.3f * std::sin(2.0 * M_PI * 660.0 * t);
+    }
+
+    // Output over the main input, then over the sidechain input with the
+    // two swapped (as the plugin does past the flip point)
+    for (int flip = 0; flip < 2; ++flip) {
+        audio_transport::RealtimeAudioTransport reference(sample_rate, 20.0, 4, 2);
+        audio_transport::RealtimeAudioTransport processor(sample_rate, 20.0, 4, 2);
+        reference.setNumChannels(2);
+        processor.setNumChannels(2);
+
+        std::vector<float> expected_l(total), expected_r(total);
+        std::vector<float> buffer_l = main_l, buffer_r = main_r;
+        for (int pos = 0; pos < total; pos += block) {
+            const float* own[2] = { main_l.data() + pos, main_r.data() + pos };
+            const float* shared[2] = { sc.data() + pos, sc.data() + pos };
+            float* expected[2] = { expected_l.data() + pos, expected_r.data() + pos };
+            reference.process(flip ? shared : own, flip ? own : shared, expected, 2, block, 0.3f);
+
+            float* buffer[2] = { buffer_l.data() + pos, buffer_r.data() + pos };
+            const float* buffer_in[2] = { buffer[0], buffer[1] };
+            processor.process(flip ? shared : buffer_in, flip ? buffer_in : shared,
+                              buffer, 2, block, 0.3f);
+        }
+        assert(buffer_l == expected_l);
+        assert(buffer_r == expected_r);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
 int main() {
     std::cout << "\n=== RealtimeAudioTransport Unit Tests ===\n" << std::endl;
 
@@ -230,6 +620,16 @@ int main() {
         test_interpolation_extremes();
         test_different_buffer_sizes();
         test_sample_rate_change();
+        test_no_allocations_in_process();
+        test_merge_transport_map();
+        test_fractional_transport_map();
+#ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+        test_float_matches_double();
+#endif
+        test_block_size_invariance();
+        test_impulse_latency();
+        test_multichannel();
+        test_in_place();
 
         std::cout << "\n=== All tests PASSED ===\n" << std::endl;
         return 0;
@@ -0,0 +1,288 @@
+/**
+ * Unit test for target_spectrum
+ *
+ * Tests averaging, that save() and load() round-trip a target, that a
+ * time-indexed target plays as its recording would as the sidechain,
+ * that the sidechain input is ignored while one plays, and that
+ * engines refuse targets of other settings
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+
+#include "audio_transport/target_spectrum.hpp"
+#include "audio_transport/RealtimeAudioTransport.hpp"
+#include "audio_transport/RealtimeReassignmentTransport.hpp"
+#include "audio_transport/PipelinedEngine.hpp"
+
+using namespace audio_transport;
+
+// 40 ms windows at this rate are a whole number of hops for both
+// engines, so hops of the target and of a live sidechain line up
+const double SAMPLE_RATE = 48000.0;
+const double WINDOW_MS = 40.0;
+
+// Two partials, the upper one swelling, over a deterministic noise floor
+std::vector<float> recording(size_t samples) {
+    std::vector<float> audio(samples);
+    unsigned int seed = 99;
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double noise = (seed >> 8) / double(1 << 24) - 0.5;
+        double swell = double(i) / samples;
+        audio[i] = static_cast<float>(0.4 * std::sin(2.0 * M_PI * 330.0 * i / SAMPLE_RATE)
+                                    + 0.3 * swell * std::sin(2.0 * M_PI * 1210.0 * i / SAMPLE_RATE)
+                                    + 0.01 * noise);
+    }
+    return audio;
+}
+
+std::unique_ptr<RealtimeEngine> make_engine(int type, double window_ms = WINDOW_MS) {
+    if (type == 0) {
+        return std::unique_ptr<RealtimeEngine>(new RealtimeAudioTransport(SAMPLE_RATE, window_ms, 4, 2));
+    }
+    return std::unique_ptr<RealtimeEngine>(new RealtimeReassignmentTransport(SAMPLE_RATE, window_ms, 4, 2));
+}
+
+// Mono through engine in blocks of 256
+std::vector<float> run(RealtimeEngine& engine, const std::vector<float>& main,
+                       const std::vector<float>& sidechain, float k) {
+    std::vector<float> output(main.size());
+    for (size_t pos = 0; pos < main.size(); pos += 256) {
+        int n = static_cast<int>(std::min<size_t>(256, main.size() - pos));
+        engine.process(main.data() + pos, sidechain.data() + pos, output.data() + pos, n, k);
+    }
+    return output;
+}
+
+float peak(const std::vector<float>& audio) {
+    float p = 0;
+    for (float x : audio) p = std::max(p, std::abs(x));
+    return p;
+}
+
+void test_average() {
+    std::cout << "Test 1: Averaging frames... ";
+
+    std::vector<target_spectrum::frame> frames(2);
+    frames[0].magnitudes = { 1.0f, 0.0f, 2.0f };
+    frames[0].phases = { 0.1f, 0.2f, 0.3f };
+    frames[0].freq_offsets = { 1.0f, 5.0f, 2.0f };
+    frames[1].magnitudes = { 3.0f, 0.0f, 2.0f };
+    frames[1].phases = { 1.1f, 1.2f, 1.3f };
+    frames[1].freq_offsets = { 3.0f, 7.0f, 4.0f };
+    frames[1].silent = false;
+
+    target_spectrum::frame mean = target_spectrum::average(frames);
+    assert(mean.magnitudes == std::vector<float>({ 2.0f, 0.0f, 2.0f }));
+    assert(mean.freq_offsets == std::vector<float>({ 2.5f, 0.0f, 3.0f }));
+    assert(mean.phases == frames[1].phases); // the louder frame's
+    assert(mean.masses.empty() && !mean.silent);
+
+    frames[1].silent = true;
+    assert(target_spectrum::average(frames).silent);
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_save_load() {
+    std::cout << "Test 2: save() and load() round-trip a target... ";
+
+    std::vector<float> audio = recording(24000);
+    for (int type = 0; type < 2; type++) {
+        std::unique_ptr<RealtimeEngine> engine = make_engine(type);
+        std::shared_ptr<const target_spectrum> target =
+            engine->makeTarget(audio.data(), audio.size(), target_spectrum::mode::time_indexed);
+        assert(target && target->settings() == engine->getTargetAnalysis());
+        assert(target->playback() == target_spectrum::mode::time_indexed);
+
+        // Every window within the recording, a hop apart
+        size_t window = target->settings().window_size;
+        size_t hop = target->settings().hop_size;
+        assert(target->num_frames() == (audio.size() - window) / hop + 1);
+        assert(&target->at(target->num_frames()) == &target->at(0));
+        for (size_t f = 0; f < target->num_frames(); f++) {
+            const target_spectrum::frame& frame = target->at(f);
+            assert(frame.magnitudes.size() == target->settings().num_bins());
+            assert(frame.freq_offsets.size() == (type == 1 ? frame.magnitudes.size() : 0));
+            assert(!frame.silent && frame.masses.empty() == (type == 0));
+        }
+
+        const char* path = "test_target_spectrum.bin";
+        assert(target->save(path));
+        target_spectrum loaded;
+        assert(loaded.empty());
+        assert(loaded.load(path));
+        assert(loaded.settings() == target->settings());
+        assert(loaded.num_frames() == target->num_frames());
+        for (size_t f = 0; f < loaded.num_frames(); f++) {
+            const target_spectrum::frame& a = loaded.at(f);
+            const target_spectrum::frame& b = target->at(f);
+            assert(a.magnitudes == b.magnitudes && a.phases == b.phases);
+            assert(a.freq_offsets == b.freq_offsets && a.silent == b.silent);
+            assert(a.masses.size() == b.masses.size());
+            for (size_t m = 0; m < a.masses.size(); m++) {
+                assert(a.masses[m].left_bin == b.masses[m].left_bin);
+                assert(a.masses[m].right_bin == b.masses[m].right_bin);
+                assert(a.masses[m].center_bin == b.masses[m].center_bin);
+                assert(a.masses[m].mass == b.masses[m].mass);
+            }
+        }
+
+        // A truncated file or another file is rejected and leaves it empty
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        {
+            std::ofstream out(path, std::ios::binary);
+            out.write(bytes.data(), bytes.size() / 2);
+        }
+        assert(!loaded.load(path));
+        assert(loaded.empty());
+        {
+            std::ofstream out(path, std::ios::binary);
+            out << "not a target";
+        }
+        assert(!loaded.load(path));
+        assert(!loaded.load("no/such/file.bin"));
+        std::remove(path);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_plays_recording() {
+    std::cout << "Test 3: A time-indexed target plays like its recording as sidechain... ";
+
+    // With a silent main input and k = 1 the output is the sidechain
+    // resynthesized, so the target's float spectra must give it to
+    // rounding. The live engine's hop h analyses the window ending at
+    // (h + 1) hops, which is frame h + 1 - window / hop of the target.
+    const size_t N = 24000;
+    std::vector<float> audio = recording(N);
+    std::vector<float> silence(N, 0.0f);
+
+    for (int type = 0; type < 2; type++) {
+        std::unique_ptr<RealtimeEngine> live = make_engine(type);
+        std::unique_ptr<RealtimeEngine> played = make_engine(type);
+        std::shared_ptr<const target_spectrum> target =
+            played->makeTarget(audio.data(), N, target_spectrum::mode::time_indexed);
+        assert(played->setTarget(target));
+        assert(played->getTarget() == target.get());
+
+        size_t window = target->settings().window_size;
+        size_t hop = target->settings().hop_size;
+        assert(window % hop == 0);
+        size_t shift = window - hop;
+
+        std::vector<float> expected = run(*live, silence, audio, 1.0f);
+        std::vector<float> output = run(*played, silence, silence, 1.0f);
+
+        // Once the target engine's overlap-add is full of frames
+        double error = 0;
+        size_t from = 2 * window;
+        size_t to = (target->num_frames() - 1) * hop;
+        assert(from < to);
+        for (size_t t = from; t < to; t++) {
+            error = std::max(error, double(std::abs(output[t] - expected[t + shift])));
+        }
+        assert(peak(expected) > 0.1f);
+        assert(error < 1e-4 * peak(expected));
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_sidechain_ignored() {
+    std::cout << "Test 4: The sidechain is ignored while a target plays... ";
+
+    const size_t N = 24000;
+    std::vector<float> audio = recording(N);
+    std::vector<float> main(N), noise(N), silence(N, 0.0f);
+    unsigned int seed = 5;
+    for (size_t i = 0; i < N; i++) {
+        main[i] = 0.5f * static_cast<float>(std::sin(2.0 * M_PI * 523.0 * i / SAMPLE_RATE));
+        seed = seed * 1664525u + 1013904223u;
+        noise[i] = (seed >> 8) / float(1 << 24) - 0.5f;
+    }
+
+    for (int type = 0; type < 2; type++) {
+        for (int mode = 0; mode < 2; mode++) {
+            target_spectrum::mode playback = mode ? target_spectrum::mode::time_indexed
+                                                  : target_spectrum::mode::averaged;
+            std::unique_ptr<RealtimeEngine> a = make_engine(type);
+            std::unique_ptr<RealtimeEngine> b = make_engine(type);
+            std::shared_ptr<const target_spectrum> target = a->makeTarget(audio.data(), N, playback);
+            assert(mode || target->num_frames() == 1);
+            assert(a->setTarget(target) && b->setTarget(target));
+
+            std::vector<float> with_noise = run(*a, main, noise, 0.5f);
+            std::vector<float> with_silence = run(*b, main, silence, 0.5f);
+            assert(with_noise == with_silence);
+            assert(peak(with_noise) > 0.05f);
+            for (float x : with_noise) assert(std::isfinite(x));
+
+            // A reset plays the target from its start again
+            a->reset();
+            assert(run(*a, main, silence, 0.5f) == with_silence);
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_settings_checked() {
+    std::cout << "Test 5: Engines refuse targets of other settings... ";
+
+    std::vector<float> audio = recording(24000);
+    std::unique_ptr<RealtimeEngine> cdf = make_engine(0);
+    std::unique_ptr<RealtimeEngine> reassignment = make_engine(1);
+    std::unique_ptr<RealtimeEngine> wider = make_engine(1, 50.0);
+
+    std::shared_ptr<const target_spectrum> target =
+        reassignment->makeTarget(audio.data(), audio.size(), target_spectrum::mode::averaged);
+    assert(!cdf->setTarget(target) && cdf->getTarget() == nullptr);
+    assert(!wider->setTarget(target) && wider->getTarget() == nullptr);
+
+    // An empty target is refused too, and nullptr goes back to the sidechain
+    assert(!reassignment->setTarget(std::make_shared<const target_spectrum>()));
+    assert(reassignment->setTarget(target) && reassignment->getTarget() == target.get());
+    assert(reassignment->setTarget(nullptr) && reassignment->getTarget() == nullptr);
+
+    // Shorter than one window there is nothing to analyse
+    assert(!cdf->makeTarget(audio.data(), 100, target_spectrum::mode::averaged));
+
+    // A pipelined engine hands targets to its engine
+    PipelinedEngine pipeline(make_engine(1), 256);
+    assert(pipeline.getTargetAnalysis() == target->settings());
+    assert(pipeline.setTarget(target) && pipeline.getTarget() == target.get());
+    assert(!pipeline.setTarget(cdf->makeTarget(audio.data(), audio.size(),
+                                               target_spectrum::mode::averaged)));
+    assert(pipeline.getTarget() == target.get());
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Target Spectrum Unit Tests ===" << std::endl << std::endl;
+
+    try {
+        test_average();
+        test_save_load();
+        test_plays_recording();
+        test_sidechain_ignored();
+        test_settings_checked();
+
+        std::cout << std::endl << "All tests passed!" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Test failed with exception: " << e.what() << std::endl;
+        return 1;
+    }
+}
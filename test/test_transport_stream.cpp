@@ -0,0 +1,134 @@
+/**
+ * Unit test for transport_stream
+ *
+ * Checks that the streamed output matches the whole-file render
+ * exactly for any source and read sizes, and the end-of-input cases
+ */
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <memory>
+
+#include "audio_transport/transport_stream.hpp"
+#include "audio_transport/offline_renderer.hpp"
+
+using namespace audio_transport;
+
+const double SAMPLE_RATE = 44100.0;
+const double WINDOW_SIZE = 1024 / 44100.0; // seconds, a power of two of samples
+const unsigned int PADDING = 1;
+
+// A swept tone over a deterministic noise floor, so every bin has mass
+std::vector<double> chirp(double f0, double f1, double amp, size_t samples) {
+    std::vector<double> audio(samples);
+    double phase = 0;
+    unsigned int seed = 777;
+    for (size_t i = 0; i < samples; i++) {
+        double f = f0 + (f1 - f0) * i / samples;
+        phase += 2.0 * M_PI * f / SAMPLE_RATE;
+        seed = seed * 1664525u + 1013904223u;
+        double noise = (seed >> 8) / double(1 << 24) - 0.5;
+        audio[i] = amp * std::sin(phase) + 0.01 * noise;
+    }
+    return audio;
+}
+
+// Serves audio at most chunk samples per call
+transport_stream::source from(const std::vector<double>& audio, size_t chunk) {
+    std::shared_ptr<size_t> position = std::make_shared<size_t>(0);
+    return [&audio, chunk, position](double* buffer, size_t count) {
+        size_t n = std::min(std::min(count, chunk), audio.size() - *position);
+        std::copy(audio.begin() + *position, audio.begin() + *position + n, buffer);
+        *position += n;
+        return n;
+    };
+}
+
+std::vector<double> stream_all(transport_stream& stream, size_t block) {
+    std::vector<double> output, buffer(block);
+    for (;;) {
+        size_t n = stream.read(buffer.data(), block);
+        output.insert(output.end(), buffer.begin(), buffer.begin() + n);
+        if (n < block) break;
+    }
+    assert(stream.finished());
+    assert(stream.read(buffer.data(), block) == 0);
+    return output;
+}
+
+transport_settings make_settings(unsigned int overlap) {
+    transport_settings settings;
+    settings.window_size = WINDOW_SIZE;
+    settings.padding = PADDING;
+    settings.overlap = overlap;
+    settings.interpolation = [](size_t w, size_t num_windows) {
+        return std::min(1.0, w / (double) num_windows);
+    };
+    return settings;
+}
+
+void test_matches_render() {
+    std::cout << "Test 1: Streamed output matches the whole-file render... ";
+
+    std::vector<double> left = chirp(220.0, 440.0, 0.5, 30000);
+    std::vector<double> right = chirp(880.0, 660.0, 0.3, 27000);
+    offline_renderer renderer(1);
+
+    const size_t chunks[] = { 1 << 20, 1000, 7 };
+    const size_t blocks[] = { 1 << 20, 512, 1 };
+
+    for (unsigned int overlap = 1; overlap <= 2; overlap++) {
+        transport_settings settings = make_settings(overlap);
+        std::vector<double> expected =
+            renderer.transport(left, SAMPLE_RATE, right, SAMPLE_RATE, settings);
+        size_t num_windows = transport_stream::num_windows(
+            left.size(), SAMPLE_RATE, right.size(), SAMPLE_RATE, settings);
+
+        for (size_t c = 0; c < 3; c++) {
+            transport_stream stream(from(left, chunks[c]), SAMPLE_RATE,
+                                    from(right, chunks[2 - c]), SAMPLE_RATE,
+                                    settings, num_windows);
+            assert(stream_all(stream, blocks[c]) == expected);
+            assert(stream.windows() == num_windows);
+        }
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+void test_short_input() {
+    std::cout << "Test 2: Inputs shorter than a window... ";
+
+    std::vector<double> tiny(500, 0.1);
+    std::vector<double> audio = chirp(220.0, 440.0, 0.5, 20000);
+    transport_settings settings = make_settings(1);
+
+    transport_stream stream(from(audio, 4096), SAMPLE_RATE,
+                            from(tiny, 4096), SAMPLE_RATE, settings);
+    assert(stream_all(stream, 256).empty());
+    assert(stream.windows() == 0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "\n=== transport_stream Unit Tests ===\n" << std::endl;
+
+    try {
+        test_matches_render();
+        test_short_input();
+
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,179 @@
+/**
+ * Unit test for the vector_math kernels
+ *
+ * Compares the batched kernels against <cmath> / std::complex for
+ * lengths that exercise both the SIMD body and the scalar tail, and
+ * checks sanitize() and the denormal guard
+ */
+
+#include <iostream>
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cassert>
+#include <random>
+#include <limits>
+
+#include "audio_transport/vector_math.hpp"
+#include "audio_transport/denormals.hpp"
+
+using namespace audio_transport;
+
+template <typename T>
+void check_kernels(T tolerance) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<double> dist(-10.0, 10.0);
+
+    for (size_t n = 0; n < 40; n++) {
+        std::vector<T> x(n), y(n), out(n), s(n), c(n);
+        for (size_t i = 0; i < n; i++) {
+            x[i] = static_cast<T>(dist(rng));
+            y[i] = static_cast<T>(dist(rng));
+        }
+
+        vector_math::hypot(x.data(), y.data(), out.data(), n);
+        for (size_t i = 0; i < n; i++)
+            assert(std::abs(out[i] - std::hypot(x[i], y[i])) <= tolerance * 20);
+
+        vector_math::atan2(y.data(), x.data(), out.data(), n);
+        for (size_t i = 0; i < n; i++)
+            assert(std::abs(out[i] - std::atan2(y[i], x[i])) <= tolerance * 4);
+
+        // Include arguments well outside [-pi, pi]
+        for (size_t i = 0; i < n; i++) x[i] *= 100;
+        vector_math::sincos(x.data(), s.data(), c.data(), n);
+        for (size_t i = 0; i < n; i++) {
+            assert(std::abs(s[i] - std::sin(x[i])) <= tolerance);
+            assert(std::abs(c[i] - std::cos(x[i])) <= tolerance);
+        }
+
+        std::vector<std::complex<T>> z(n), rebuilt(n);
+        for (size_t i = 0; i < n; i++)
+            z[i] = std::complex<T>(static_cast<T>(dist(rng)), static_cast<T>(dist(rng)));
+
+        vector_math::magnitude_phase(z.data(), s.data(), c.data(), n);
+        for (size_t i = 0; i < n; i++) {
+            assert(std::abs(s[i] - std::abs(z[i])) <= tolerance * 20);
+            assert(std::abs(c[i] - std::arg(z[i])) <= tolerance * 4);
+        }
+
+        vector_math::polar(s.data(), c.data(), rebuilt.data(), n);
+        for (size_t i = 0; i < n; i++)
+            assert(std::abs(rebuilt[i] - z[i]) <= tolerance * 40);
+    }
+}
+
+void test_double() {
+    std::cout << "Test 1: Double kernels match <cmath>... ";
+    check_kernels<double>(1e-15);
+    std::cout << "PASS" << std::endl;
+}
+
+void test_float() {
+    std::cout << "Test 2: Float kernels match <cmath>... ";
+    check_kernels<float>(1e-6f);
+    std::cout << "PASS" << std::endl;
+}
+
+void test_special_values() {
+    std::cout << "Test 3: Signed zeros, axes and large arguments... ";
+
+    // std::arg conventions on the axes, including signed zeros
+    const double ys[] = { 0.0, 0.0, -0.0, 0.0, -2.0, 2.0 };
+    const double xs[] = { 0.0, -0.0, -1.0, -3.0, 0.0, 0.0 };
+    double out[6];
+    vector_math::atan2(ys, xs, out, 6);
+    for (int i = 0; i < 6; i++)
+        assert(out[i] == std::atan2(ys[i], xs[i]));
+
+    // Arguments past the reduction limit fall back to <cmath>
+    const double big[] = { 1e9, -3e12, 0.5, 1e9 + 1 };
+    double s[4], c[4];
+    vector_math::sincos(big, s, c, 4);
+    for (int i = 0; i < 4; i++) {
+        assert(std::abs(s[i] - std::sin(big[i])) <= 1e-15);
+        assert(std::abs(c[i] - std::cos(big[i])) <= 1e-15);
+    }
+
+    std::cout << "PASS" << std::endl;
+}
+
+template <typename T>
+void check_sanitize() {
+    const T values[] = {
+        T(1), std::numeric_limits<T>::quiet_NaN(), T(-2),
+        std::numeric_limits<T>::infinity(), -std::numeric_limits<T>::infinity(),
+        std::numeric_limits<T>::max(), std::numeric_limits<T>::denorm_min(), T(-0.0)
+    };
+    const size_t num_values = sizeof(values) / sizeof(values[0]);
+
+    // Every value at every position, so each lands in a pack and a tail
+    for (size_t n = 0; n < 20; n++) {
+        for (size_t v = 0; v < num_values; v++) {
+            for (size_t at = 0; at < n; at++) {
+                std::vector<T> x(n, T(0.25));
+                x[at] = values[v];
+                size_t replaced = vector_math::sanitize(x.data(), n);
+                bool finite = std::isfinite(values[v]);
+                assert(replaced == (finite ? 0u : 1u));
+                for (size_t i = 0; i < n; i++) {
+                    T expected = i != at ? T(0.25) : (finite ? values[v] : T(0));
+                    assert(x[i] == expected && std::signbit(x[i]) == std::signbit(expected));
+                }
+            }
+        }
+    }
+}
+
+void test_sanitize() {
+    std::cout << "Test 4: sanitize() zeroes NaN and infinities only... ";
+    check_sanitize<double>();
+    check_sanitize<float>();
+    std::cout << "PASS" << std::endl;
+}
+
+void test_denormals() {
+    std::cout << "Test 5: Denormals flush inside scoped_flush_denormals... ";
+
+    // volatile keeps the arithmetic at run time, under the guard
+    volatile double tiny = std::numeric_limits<double>::min();
+    volatile double half = 0.5;
+    assert(tiny * half != 0);
+    {
+        denormals::scoped_flush_denormals guard;
+        if (denormals::flush_supported()) {
+            assert(tiny * half == 0);
+        }
+        {
+            denormals::scoped_flush_denormals nested;
+        }
+        if (denormals::flush_supported()) {
+            assert(tiny * half == 0);
+        }
+    }
+    assert(tiny * half != 0);
+
+    std::cout << "PASS" << std::endl;
+}
+
+int main() {
+    std::cout << "\n=== vector_math Unit Tests (" << vector_math::isa() << ") ===\n" << std::endl;
+
+    try {
+        test_double();
+        test_float();
+        test_special_values();
+        test_sanitize();
+        test_denormals();
+
+        std::cout << "\n=== All tests PASSED ===\n" << std::endl;
+        return 0;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\nTest FAILED with exception: " << e.what() << std::endl;
+        return 1;
+    } catch (...) {
+        std::cerr << "\nTest FAILED with unknown exception" << std::endl;
+        return 1;
+    }
+}
@@ -7,7 +7,7 @@ AudioTransportEditor::AudioTransportEditor (AudioTransportProcessor& p)
       audioProcessor (p)
 {
     // Set window size (taller to accommodate new controls)
-    setSize (500, 490);
+    setSize (500, 630);
 
     // Title
     titleLabel.setText("Audio Transport", juce::dontSendNotification);
@@ -73,6 +73,24 @@ AudioTransportEditor::AudioTransportEditor (AudioTransportProcessor& p)
     };
     addAndMakeVisible(bypassButton);
 
+    // Stereo link button
+    stereoLinkButton.setButtonText("Stereo Link");
+    stereoLinkButton.setClickingTogglesState(true);
+    stereoLinkButton.setToggleState(p.getStereoLinkParameter()->get(), juce::dontSendNotification);
+    stereoLinkButton.onClick = [this] {
+        audioProcessor.getStereoLinkParameter()->setValueNotifyingHost(stereoLinkButton.getToggleState() ? 1.0f : 0.0f);
+    };
+    addAndMakeVisible(stereoLinkButton);
+
+    // Freeze sidechain button
+    freezeSidechainButton.setButtonText("Freeze Sidechain");
+    freezeSidechainButton.setClickingTogglesState(true);
+    freezeSidechainButton.setToggleState(p.getFreezeSidechainParameter()->get(), juce::dontSendNotification);
+    freezeSidechainButton.onClick = [this] {
+        audioProcessor.getFreezeSidechainParameter()->setValueNotifyingHost(freezeSidechainButton.getToggleState() ? 1.0f : 0.0f);
+    };
+    addAndMakeVisible(freezeSidechainButton);
+
     // Morph Mode combo box
     morphModeCombo.addItem("Full Morph", 1);
     morphModeCombo.addItem("Dry at Extremes", 2);
@@ -123,18 +141,88 @@ AudioTransportEditor::AudioTransportEditor (AudioTransportProcessor& p)
     algorithmLabel.setJustificationType(juce::Justification::centredLeft);
     addAndMakeVisible(algorithmLabel);
 
+    // Precision combo box
+    precisionCombo.addItem("Double", 1);
+    precisionCombo.addItem("Float", 2);
+    precisionCombo.setSelectedItemIndex(p.getPrecisionParameter()->getIndex(), juce::dontSendNotification);
+    precisionCombo.onChange = [this] {
+        int index = precisionCombo.getSelectedItemIndex();
+        float normalizedValue = static_cast<float>(index) / static_cast<float>(precisionCombo.getNumItems() - 1);
+        audioProcessor.getPrecisionParameter()->setValueNotifyingHost(normalizedValue);
+    };
+   #ifdef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    precisionCombo.setEnabled(false);
+   #endif
+    addAndMakeVisible(precisionCombo);
+
+    precisionLabel.setText("Precision", juce::dontSendNotification);
+    precisionLabel.setFont(juce::Font(14.0f));
+    precisionLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(precisionLabel);
+
+    // Latency mode combo box
+    latencyModeCombo.addItem("Normal", 1);
+    latencyModeCombo.addItem("Low", 2);
+    latencyModeCombo.addItem("Pipelined", 3);
+    latencyModeCombo.setSelectedItemIndex(p.getLatencyModeParameter()->getIndex(), juce::dontSendNotification);
+    latencyModeCombo.onChange = [this] {
+        int index = latencyModeCombo.getSelectedItemIndex();
+        float normalizedValue = static_cast<float>(index) / static_cast<float>(latencyModeCombo.getNumItems() - 1);
+        audioProcessor.getLatencyModeParameter()->setValueNotifyingHost(normalizedValue);
+    };
+    addAndMakeVisible(latencyModeCombo);
+
+    latencyModeLabel.setText("Latency", juce::dontSendNotification);
+    latencyModeLabel.setFont(juce::Font(14.0f));
+    latencyModeLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(latencyModeLabel);
+
+    // Target file: the button shows the file and opens a chooser
+    targetButton.setButtonText("Load Target...");
+    targetButton.onClick = [this] { chooseTargetFile(); };
+    addAndMakeVisible(targetButton);
+
+    clearTargetButton.setButtonText("Clear");
+    clearTargetButton.onClick = [this] { audioProcessor.setTargetFile(juce::File()); };
+    addAndMakeVisible(clearTargetButton);
+
+    targetModeCombo.addItem("Averaged", 1);
+    targetModeCombo.addItem("Time-indexed", 2);
+    targetModeCombo.setSelectedItemIndex(p.getTargetModeParameter()->getIndex(), juce::dontSendNotification);
+    targetModeCombo.onChange = [this] {
+        int index = targetModeCombo.getSelectedItemIndex();
+        float normalizedValue = static_cast<float>(index) / static_cast<float>(targetModeCombo.getNumItems() - 1);
+        audioProcessor.getTargetModeParameter()->setValueNotifyingHost(normalizedValue);
+    };
+    addAndMakeVisible(targetModeCombo);
+
+    targetLabel.setText("Target", juce::dontSendNotification);
+    targetLabel.setFont(juce::Font(14.0f));
+    targetLabel.setJustificationType(juce::Justification::centredLeft);
+    addAndMakeVisible(targetLabel);
+
     // Latency label
     latencyLabel.setFont(juce::Font(12.0f));
     latencyLabel.setJustificationType(juce::Justification::centred);
     latencyLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
     addAndMakeVisible(latencyLabel);
 
+    // CPU label, fed by the engines' instrumentation while we are open
+    cpuLabel.setFont(juce::Font(12.0f));
+    cpuLabel.setJustificationType(juce::Justification::centred);
+    cpuLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
+    addAndMakeVisible(cpuLabel);
+
+    audioProcessor.getInstrumentation().set_enabled(true);
+    lastStats = audioProcessor.getInstrumentation().read();
+
     // Start timer for updating latency display
     startTimerHz(10);
 }
 
 AudioTransportEditor::~AudioTransportEditor()
 {
+    audioProcessor.getInstrumentation().set_enabled(false);
 }
 
 //==============================================================================
@@ -201,6 +289,20 @@ void AudioTransportEditor::resized()
 
     bounds.removeFromTop(10); // Spacing
 
+    // Precision combo box
+    auto precisionArea = bounds.removeFromTop(30);
+    precisionLabel.setBounds(precisionArea.removeFromLeft(120));
+    precisionCombo.setBounds(precisionArea);
+
+    bounds.removeFromTop(10); // Spacing
+
+    // Latency mode combo box
+    auto latencyModeArea = bounds.removeFromTop(30);
+    latencyModeLabel.setBounds(latencyModeArea.removeFromLeft(120));
+    latencyModeCombo.setBounds(latencyModeArea);
+
+    bounds.removeFromTop(10); // Spacing
+
     // Morph Mode combo box
     auto morphModeArea = bounds.removeFromTop(30);
     morphModeLabel.setBounds(morphModeArea.removeFromLeft(120));
@@ -222,13 +324,29 @@ void AudioTransportEditor::resized()
 
     bounds.removeFromTop(10); // Spacing
 
-    // Bypass button
-    bypassButton.setBounds(bounds.removeFromTop(30).withSizeKeepingCentre(120, 30));
+    // Target file, clear and mode
+    auto targetArea = bounds.removeFromTop(30);
+    targetLabel.setBounds(targetArea.removeFromLeft(120));
+    targetModeCombo.setBounds(targetArea.removeFromRight(110));
+    targetArea.removeFromRight(5);
+    clearTargetButton.setBounds(targetArea.removeFromRight(50));
+    targetArea.removeFromRight(5);
+    targetButton.setBounds(targetArea);
+
+    bounds.removeFromTop(10); // Spacing
+
+    // Bypass, stereo link and freeze buttons
+    auto buttonArea = bounds.removeFromTop(30);
+    int buttonWidth = buttonArea.getWidth() / 3;
+    bypassButton.setBounds(buttonArea.removeFromLeft(buttonWidth).withSizeKeepingCentre(120, 30));
+    stereoLinkButton.setBounds(buttonArea.removeFromLeft(buttonWidth).withSizeKeepingCentre(120, 30));
+    freezeSidechainButton.setBounds(buttonArea.withSizeKeepingCentre(120, 30));
 
     bounds.removeFromTop(10); // Spacing
 
     // Latency label at bottom
     latencyLabel.setBounds(bounds.removeFromTop(20));
+    cpuLabel.setBounds(bounds.removeFromTop(20));
 }
 
 void AudioTransportEditor::timerCallback()
@@ -241,6 +359,24 @@ void AudioTransportEditor::timerCallback()
                                                        latencySamples, latencyMs);
     latencyLabel.setText(latencyText, juce::dontSendNotification);
 
+    // Engine load since the last refresh
+    auto stats = audioProcessor.getInstrumentation().read();
+    auto recent = stats - lastStats;
+    lastStats = stats;
+    if (recent.hops > 0)
+    {
+        juce::String cpuText = juce::String::formatted(
+            "DSP: %.1f%% of realtime | hop %.2f ms (max %.2f ms)",
+            100.0 * recent.load(audioProcessor.getSampleRate()),
+            recent.mean_hop_seconds() * 1000.0,
+            recent.hop_max / audio_transport::instrumentation::ticks_per_second() * 1000.0);
+        if (recent.plans > 0)
+            cpuText << juce::String::formatted(" | %.0f masses, %.0f transports",
+                                               recent.mean_masses(),
+                                               recent.mean_transport_entries());
+        cpuLabel.setText(cpuText, juce::dontSendNotification);
+    }
+
     // Update controls from parameters (in case automation changed them)
     // Only update if not currently being edited by user
     if (!morphSlider.isMouseButtonDown() && !morphSlider.isMouseOverOrDragging())
@@ -266,6 +402,8 @@ void AudioTransportEditor::timerCallback()
 
     // These don't need mouse checks
     bypassButton.setToggleState(audioProcessor.getBypassParameter()->get(), juce::dontSendNotification);
+    stereoLinkButton.setToggleState(audioProcessor.getStereoLinkParameter()->get(), juce::dontSendNotification);
+    freezeSidechainButton.setToggleState(audioProcessor.getFreezeSidechainParameter()->get(), juce::dontSendNotification);
 
     int modeIndex = audioProcessor.getMorphModeParameter()->getIndex();
     if (morphModeCombo.getSelectedItemIndex() != modeIndex)
@@ -274,4 +412,37 @@ void AudioTransportEditor::timerCallback()
     int algoIndex = audioProcessor.getAlgorithmParameter()->getIndex();
     if (algorithmCombo.getSelectedItemIndex() != algoIndex)
         algorithmCombo.setSelectedItemIndex(algoIndex, juce::dontSendNotification);
+
+    int precisionIndex = audioProcessor.getPrecisionParameter()->getIndex();
+    if (precisionCombo.getSelectedItemIndex() != precisionIndex)
+        precisionCombo.setSelectedItemIndex(precisionIndex, juce::dontSendNotification);
+
+    int latencyModeIndex = audioProcessor.getLatencyModeParameter()->getIndex();
+    if (latencyModeCombo.getSelectedItemIndex() != latencyModeIndex)
+        latencyModeCombo.setSelectedItemIndex(latencyModeIndex, juce::dontSendNotification);
+
+    int targetModeIndex = audioProcessor.getTargetModeParameter()->getIndex();
+    if (targetModeCombo.getSelectedItemIndex() != targetModeIndex)
+        targetModeCombo.setSelectedItemIndex(targetModeIndex, juce::dontSendNotification);
+
+    auto targetFile = audioProcessor.getTargetFile();
+    juce::String targetText = targetFile == juce::File() ? juce::String("Load Target...") : targetFile.getFileName();
+    if (targetButton.getButtonText() != targetText)
+        targetButton.setButtonText(targetText);
+    clearTargetButton.setEnabled(targetFile != juce::File());
+}
+
+void AudioTransportEditor::chooseTargetFile()
+{
+    // Asynchronous, so the host's message loop keeps running
+    targetChooser = std::make_unique<juce::FileChooser>(
+        "Choose a target recording",
+        audioProcessor.getTargetFile(),
+        "*.wav;*.aif;*.aiff;*.flac;*.ogg;*.mp3");
+    targetChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+                               [this] (const juce::FileChooser& chooser) {
+        auto file = chooser.getResult();
+        if (file != juce::File())
+            audioProcessor.setTargetFile(file);
+    });
 }
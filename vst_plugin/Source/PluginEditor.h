@@ -23,6 +23,7 @@ public:
 
 private:
     void timerCallback() override;
+    void chooseTargetFile();
 
     // Reference to processor
     AudioTransportProcessor& audioProcessor;
@@ -35,6 +36,8 @@ private:
     juce::Label windowSizeLabel;
 
     juce::TextButton bypassButton;
+    juce::TextButton stereoLinkButton;
+    juce::TextButton freezeSidechainButton;
 
     juce::ComboBox morphModeCombo;
     juce::Label morphModeLabel;
@@ -45,9 +48,26 @@ private:
     juce::ComboBox algorithmCombo;
     juce::Label algorithmLabel;
 
+    juce::ComboBox precisionCombo;
+    juce::Label precisionLabel;
+
+    juce::ComboBox latencyModeCombo;
+    juce::Label latencyModeLabel;
+
+    // Target file in place of the sidechain
+    juce::TextButton targetButton;
+    juce::TextButton clearTargetButton;
+    juce::ComboBox targetModeCombo;
+    juce::Label targetLabel;
+    std::unique_ptr<juce::FileChooser> targetChooser;
+
     juce::Label titleLabel;
     juce::Label versionLabel;
     juce::Label latencyLabel;
+    juce::Label cpuLabel;
+
+    // Engine timings at the previous refresh, to show the last 100 ms
+    audio_transport::instrumentation::snapshot lastStats;
 
     // No parameter attachments needed - we handle updates manually
 
@@ -1,6 +1,9 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <cmath>
 #include <cstring>
+#include <sstream>
 #include <vector>
 
 //==============================================================================
@@ -9,12 +12,12 @@ AudioTransportProcessor::AudioTransportProcessor()
      : AudioProcessor (BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::mono(), true)
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
-                       .withOutput ("Output", juce::AudioChannelSet::mono(), true)
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        // Add sidechain input
-                       .withInput  ("Sidechain", juce::AudioChannelSet::mono(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), true)
                        )
 #endif
 {
@@ -65,10 +68,53 @@ AudioTransportProcessor::AudioTransportProcessor()
         0,  // Default to CDF (faster)
         "Transport algorithm"
     ));
+
+    addParameter(precisionParam = new juce::AudioParameterChoice(
+        "precision",
+        "Precision",
+        juce::StringArray("Double", "Float"),
+        0,  // Default to double (reference output)
+        "Engine floating-point precision"
+    ));
+
+    addParameter(latencyModeParam = new juce::AudioParameterChoice(
+        "latencyMode",
+        "Latency",
+        juce::StringArray("Normal", "Low", "Pipelined"),
+        0,  // Default to resynthesizing whole windows
+        "Resynthesize only the last few milliseconds of each window, or "
+        "run whole windows on a worker thread"
+    ));
+
+    addParameter(stereoLinkParam = new juce::AudioParameterBool(
+        "stereoLink",
+        "Stereo Link",
+        true,
+        "Share one transport plan across channels"
+    ));
+
+    addParameter(freezeSidechainParam = new juce::AudioParameterBool(
+        "freezeSidechain",
+        "Freeze Sidechain",
+        false,
+        "Hold the sidechain spectrum"
+    ));
+
+    addParameter(targetModeParam = new juce::AudioParameterChoice(
+        "targetMode",
+        "Target Mode",
+        juce::StringArray("Averaged", "Time-indexed"),
+        0,  // Default to one spectrum for the whole file
+        "Morph toward the target file's mean spectrum, or step through it hop by hop"
+    ));
 }
 
 AudioTransportProcessor::~AudioTransportProcessor()
 {
+    engineBuilder.stopThread (5000);
+    cancelPendingUpdate();
+    delete pendingEngines.exchange (nullptr);
+    delete retiredEngines.exchange (nullptr);
 }
 
 //==============================================================================
@@ -138,109 +184,408 @@ void AudioTransportProcessor::changeProgramName (int index, const juce::String&
 //==============================================================================
 void AudioTransportProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::ignoreUnused(samplesPerBlock);
+    // Audio is stopped; stop the builder too so nothing is in flight
+    // while the sample rate changes
+    engineBuilder.stopThread (5000);
+    delete pendingEngines.exchange (nullptr);
+    delete retiredEngines.exchange (nullptr);
+    incomingEngines.reset();
 
     currentSampleRate = sampleRate;
-    rebuildProcessor();
+    maxBlockSize = juce::jmax (samplesPerBlock, 1);
+    numEngineChannels = juce::jmax (1, getMainBusNumOutputChannels());
+
+    // The first build happens here, synchronously
+    lastRequestedWindowSize = windowSizeParam->get();
+    lastRequestedPrecision = precisionParam->getIndex();
+    lastRequestedLatencyMode = latencyModeParam->getIndex();
+    lastRequestedTargetMode = targetModeParam->getIndex();
+    lastAlgorithm = algorithmParam->getIndex();
+    requestedWindowSize.store (lastRequestedWindowSize);
+    requestedPrecision.store (lastRequestedPrecision);
+    requestedLatencyMode.store (lastRequestedLatencyMode);
+    requestedTargetMode.store (lastRequestedTargetMode);
+    builtGeneration = requestGeneration.load();
+    engines = createEngines (lastRequestedWindowSize, lastRequestedPrecision, lastRequestedLatencyMode,
+                             lastRequestedTargetMode);
+
+    // Neither engine's latency reaches one window, and pipelining adds
+    // two hops (a quarter window at most) and a block, so this covers
+    // every window size and latency mode without reallocating
+    const int maxWindow = static_cast<int> (std::ceil (
+        windowSizeParam->range.end / 1000.0 * currentSampleRate));
+    maxDelaySamples = maxWindow + 2 * ((maxWindow + 3) / 4) + maxBlockSize + 16;
+    auto channels = static_cast<size_t> (numEngineChannels);
+    for (auto* buffers : { &mainDelayBuffers, &sidechainDelayBuffers, &incomingOutput })
+        buffers->assign (channels, std::vector<float>());
+    resizeBlockBuffers (juce::jmax (samplesPerBlock, 1));
+
+    mainPointers.assign (channels, nullptr);
+    sidechainPointers.assign (channels, nullptr);
+    outputPointers.assign (channels, nullptr);
+    incomingOutputPointers.assign (channels, nullptr);
+    lastK = -1.0f;
+
+    updateLatency();
+    reportedLatency = currentLatency.load();
+    setLatencySamples (reportedLatency);
+
+    engineBuilder.startThread();
+}
 
-    // Report latency to host
-    setLatencySamples(getLatencySamples());
+std::unique_ptr<AudioTransportProcessor::EngineSet>
+AudioTransportProcessor::createEngines (float windowSize, int precision, int latencyMode,
+                                        int targetMode)
+{
+    auto set = std::make_unique<EngineSet> (liveEngineSets);
+
+    // Low latency resynthesizes the last 6 ms of each window. The CDF
+    // engine keeps 75% overlap of that; the reassignment engine hops
+    // by half of it, which its phase tracking needs and which keeps it
+    // to four times the hops of the full window.
+    // Pipelined runs the normal engines' hops on worker threads,
+    // which costs two hops and a block of latency but leaves only
+    // copies in the audio callback.
+    const bool lowLatency = latencyMode == 1;
+    const double synthesisMs = lowLatency ? 6.0 : 0.0;
+    const int reassignmentHopDivisor = lowLatency ? 1 : 4;
+
+    // The reassignment engine's padded windows are rounded up to
+    // 2^a 3^b 5^c transforms; a window of, say, 200 ms at 44.1 kHz
+    // would otherwise be a transform with a prime factor of 1103.
+
+   #ifndef AUDIO_TRANSPORT_NO_FLOAT_ENGINES
+    if (precision == 1)
+    {
+        // Build both processors in single precision (fftwf)
+        set->cdf = std::make_unique<audio_transport::RealtimeAudioTransportFloat>(
+            currentSampleRate,
+            windowSize,
+            4,  // 75% overlap
+            2,  // 2x FFT zero-padding
+            synthesisMs
+        );
+
+        set->reassignment = std::make_unique<audio_transport::RealtimeReassignmentTransportFloat>(
+            currentSampleRate,
+            windowSize,
+            reassignmentHopDivisor,
+            2,  // 2x FFT zero-padding
+            synthesisMs,
+            audio_transport::fft_plans::smooth  // no large prime factors
+        );
+    }
+    else
+   #else
+    juce::ignoreUnused (precision);
+   #endif
+    {
+        // Build both processors
+        set->cdf = std::make_unique<audio_transport::RealtimeAudioTransport>(
+            currentSampleRate,
+            windowSize,
+            4,  // 75% overlap
+            2,  // 2x FFT zero-padding
+            synthesisMs
+        );
+
+        set->reassignment = std::make_unique<audio_transport::RealtimeReassignmentTransport>(
+            currentSampleRate,
+            windowSize,
+            reassignmentHopDivisor,
+            2,  // 2x FFT zero-padding
+            synthesisMs,
+            audio_transport::fft_plans::smooth  // no large prime factors
+        );
+    }
 
-    // Initialize delay buffers
-    updateDelayBuffers();
+    if (latencyMode == 2)
+    {
+        set->cdf = std::make_unique<audio_transport::PipelinedEngine> (std::move (set->cdf), maxBlockSize);
+        set->reassignment = std::make_unique<audio_transport::PipelinedEngine> (std::move (set->reassignment), maxBlockSize);
+    }
+
+    set->cdf->setNumChannels (numEngineChannels);
+    set->reassignment->setNumChannels (numEngineChannels);
+    set->cdf->setInstrumentation (&instrumentation);
+    set->reassignment->setInstrumentation (&instrumentation);
+    applyTarget (*set, targetMode);
+    return set;
 }
 
-void AudioTransportProcessor::rebuildProcessor()
+void AudioTransportProcessor::applyTarget (EngineSet& set, int targetMode)
 {
-    double windowSize = windowSizeParam->get();
+    const auto file = getTargetFile();
+    if (file == juce::File())
+        return;
+
+    using audio_transport::target_spectrum;
+    const auto playback = targetMode == 1 ? target_spectrum::mode::time_indexed
+                                          : target_spectrum::mode::averaged;
+    const auto library = juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+                             .getChildFile ("Audio Transport")
+                             .getChildFile ("Targets");
+
+    // Read only if some engine's analysis is not in the library yet
+    std::vector<float> audio;
+
+    for (auto* engine : { set.cdf.get(), set.reassignment.get() })
+    {
+        // Library entries are named for everything their analysis
+        // depends on, so an edited file or new settings analyse afresh
+        const auto analysis = engine->getTargetAnalysis();
+        juce::String key;
+        key << file.getFullPathName() << ":" << file.getLastModificationTime().toMilliseconds()
+            << ":" << (int) analysis.engine << ":" << analysis.sample_rate
+            << ":" << (int) analysis.fft_size << ":" << (int) analysis.window_size
+            << ":" << (int) analysis.synthesis_size << ":" << (int) analysis.hop_size
+            << ":" << targetMode;
+        const auto entry = library.getChildFile (file.getFileNameWithoutExtension() + "-"
+                                                 + juce::String::toHexString (key.hashCode64())
+                                                 + ".attarget");
+
+        std::shared_ptr<const target_spectrum> target;
+        auto stored = std::make_shared<target_spectrum>();
+        if (entry.existsAsFile() && stored->load (entry.getFullPathName().toStdString())
+            && stored->settings() == analysis && stored->playback() == playback)
+        {
+            target = stored;
+        }
+        else
+        {
+            if (audio.empty() && ! readTargetAudio (file, analysis.sample_rate, audio))
+                return;
+
+            target = engine->makeTarget (audio.data(), audio.size(), playback);
+            if (target != nullptr && library.createDirectory().wasOk())
+                target->save (entry.getFullPathName().toStdString());
+        }
 
-    // Build both processors
-    cdfProcessor = std::make_unique<audio_transport::RealtimeAudioTransport>(
-        currentSampleRate,
-        windowSize,
-        4,  // 75% overlap
-        2   // 2x FFT zero-padding
-    );
+        // A file shorter than one window has no target; the engine
+        // keeps following the sidechain
+        engine->setTarget (target);
+    }
+}
 
-    reassignmentProcessor = std::make_unique<audio_transport::RealtimeReassignmentTransport>(
-        currentSampleRate,
-        windowSize,
-        4,  // 75% overlap
-        2   // 2x FFT zero-padding
-    );
+bool AudioTransportProcessor::readTargetAudio (const juce::File& file, double sampleRate,
+                                               std::vector<float>& audio)
+{
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->numChannels == 0
+        || reader->sampleRate <= 0)
+        return false;
 
-    needsProcessorRebuild = false;
+    // At most ten minutes are analysed
+    const auto length = (int) juce::jmin<juce::int64> (reader->lengthInSamples,
+                                                       (juce::int64) (600.0 * reader->sampleRate));
+    const auto numChannels = (int) reader->numChannels;
+    juce::AudioBuffer<float> decoded (numChannels, length);
+    if (! reader->read (&decoded, 0, length, 0, true, true))
+        return false;
 
-    // Update latency reporting (use current algorithm's latency)
-    setLatencySamples(getLatencySamples());
+    // Mixed to mono, which is what every channel morphs toward
+    std::vector<float> mono ((size_t) length, 0.0f);
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        const float* samples = decoded.getReadPointer (channel);
+        for (int i = 0; i < length; ++i)
+            mono[(size_t) i] += samples[i] / (float) numChannels;
+    }
 
-    // Update delay buffers to match new latency
-    updateDelayBuffers();
+    if (reader->sampleRate == sampleRate)
+    {
+        audio = std::move (mono);
+        return true;
+    }
+
+    // and resampled to the engines' rate
+    const double ratio = reader->sampleRate / sampleRate;
+    audio.assign ((size_t) (length / ratio), 0.0f);
+    juce::LagrangeInterpolator interpolator;
+    interpolator.process (ratio, mono.data(), audio.data(), (int) audio.size());
+    return ! audio.empty();
+}
+
+void AudioTransportProcessor::setTargetFile (const juce::File& file)
+{
+    {
+        const juce::ScopedLock lock (targetLock);
+        if (file == targetFile)
+            return;
+        targetFile = file;
+    }
+
+    // The builder makes engines with (or without) the new target
+    requestGeneration.fetch_add (1);
+}
+
+juce::File AudioTransportProcessor::getTargetFile() const
+{
+    const juce::ScopedLock lock (targetLock);
+    return targetFile;
+}
+
+void AudioTransportProcessor::resizeBlockBuffers (int numSamples)
+{
+    // The rings start over empty, which only happens again if a host
+    // exceeds the block size it announced
+    for (auto* delayLines : { &mainDelayBuffers, &sidechainDelayBuffers })
+        for (auto& delayLine : *delayLines)
+            delayLine.assign (static_cast<size_t> (maxDelaySamples + numSamples), 0.0f);
+    delayBufferWritePos = 0;
+
+    for (auto& channel : incomingOutput)
+        channel.assign (static_cast<size_t> (numSamples), 0.0f);
+    kRamp.assign (static_cast<size_t> (numSamples), 0.0f);
+}
+
+void AudioTransportProcessor::requestEnginesIfChanged()
+{
+    float windowSize = windowSizeParam->get();
+    int precision = precisionParam->getIndex();
+    int latencyMode = latencyModeParam->getIndex();
+    int targetMode = targetModeParam->getIndex();
+
+    if (std::abs (windowSize - lastRequestedWindowSize) <= 0.5f
+        && precision == lastRequestedPrecision
+        && latencyMode == lastRequestedLatencyMode
+        && targetMode == lastRequestedTargetMode)
+        return;
+
+    lastRequestedWindowSize = windowSize;
+    lastRequestedPrecision = precision;
+    lastRequestedLatencyMode = latencyMode;
+    lastRequestedTargetMode = targetMode;
+    requestedWindowSize.store (windowSize);
+    requestedPrecision.store (precision);
+    requestedLatencyMode.store (latencyMode);
+    requestedTargetMode.store (targetMode);
+    requestGeneration.fetch_add (1);
+}
+
+void AudioTransportProcessor::acceptPendingEngines()
+{
+    // One transition at a time, and the outgoing set needs a free
+    // retired slot so it is never deleted on the audio thread
+    if (incomingEngines || retiredEngines.load() != nullptr)
+        return;
+
+    EngineSet* pending = pendingEngines.exchange (nullptr);
+    if (pending == nullptr)
+        return;
+
+    incomingEngines.reset (pending);
+
+    // Feed the new engine until its output is valid, then fade over a
+    // few of its hops, or switch if its latency differs
+    auto* incoming = incomingEngines->get (algorithmParam->getIndex());
+    int latency = engines ? engines->get (algorithmParam->getIndex())->getLatencySamples() : -1;
+    crossfade.start (latency, incoming->getLatencySamples(), incoming->getHopSize());
+}
+
+void AudioTransportProcessor::finishEngineSwap()
+{
+    crossfade.cancel();
+    retiredEngines.store (engines.release());
+    engines = std::move (incomingEngines);
+    updateLatency();
+}
+
+void AudioTransportProcessor::updateLatency()
+{
+    int latency = engines ? engines->get (algorithmParam->getIndex())->getLatencySamples() : 0;
+
+    // The dry delay follows immediately; the host hears about it from
+    // the builder thread
+    jassert (latency <= maxDelaySamples);
+    delaySamples = juce::jlimit (0, maxDelaySamples, latency);
+    currentLatency.store (latency);
+}
+
+void AudioTransportProcessor::EngineBuilder::run()
+{
+    while (! threadShouldExit())
+    {
+        owner.serviceEngineBuilder();
+        wait (10);
+    }
 }
 
-void AudioTransportProcessor::updateDelayBuffers()
+void AudioTransportProcessor::serviceEngineBuilder()
 {
-    // Get the current latency
-    int latency = getLatencySamples();
+    delete retiredEngines.exchange (nullptr);
+
+    unsigned int generation = requestGeneration.load();
+    if (generation != builtGeneration)
+    {
+        builtGeneration = generation;
+        auto set = createEngines (requestedWindowSize.load(), requestedPrecision.load(),
+                                  requestedLatencyMode.load(), requestedTargetMode.load());
 
-    if (latency < 1)
-        latency = 1;  // Minimum buffer size
+        // Replace a set the audio thread has not picked up yet
+        delete pendingEngines.exchange (set.release());
+    }
 
-    if (latency != delayBufferSize)
+    int latency = currentLatency.load();
+    if (latency != reportedLatency)
     {
-        delayBufferSize = latency;
-        // Buffer size exactly matches latency for circular buffer
-        mainDelayBuffer.resize(delayBufferSize, 0.0f);
-        sidechainDelayBuffer.resize(delayBufferSize, 0.0f);
-        delayBufferWritePos = 0;
-
-        // Clear buffers
-        std::fill(mainDelayBuffer.begin(), mainDelayBuffer.end(), 0.0f);
-        std::fill(sidechainDelayBuffer.begin(), sidechainDelayBuffer.end(), 0.0f);
+        reportedLatency = latency;
+        triggerAsyncUpdate();
     }
+
+    std::ostringstream warnings;
+    audio_transport::diagnostics::drain (diagnostics, warnings);
+    for (auto* set : liveEngineSets)
+        set->drainDiagnostics (warnings);
+    if (! warnings.str().empty())
+        juce::Logger::writeToLog (warnings.str());
+}
+
+void AudioTransportProcessor::handleAsyncUpdate()
+{
+    setLatencySamples (currentLatency.load());
 }
 
 void AudioTransportProcessor::releaseResources()
 {
-    if (cdfProcessor)
-        cdfProcessor->reset();
-    if (reassignmentProcessor)
-        reassignmentProcessor->reset();
+    if (engines)
+    {
+        engines->cdf->reset();
+        engines->reassignment->reset();
+    }
 
     // Clear delay buffers
-    std::fill(mainDelayBuffer.begin(), mainDelayBuffer.end(), 0.0f);
-    std::fill(sidechainDelayBuffer.begin(), sidechainDelayBuffer.end(), 0.0f);
+    for (auto* delayLines : { &mainDelayBuffers, &sidechainDelayBuffers })
+        for (auto& delayLine : *delayLines)
+            std::fill(delayLine.begin(), delayLine.end(), 0.0f);
     delayBufferWritePos = 0;
 }
 
 int AudioTransportProcessor::getLatencySamples() const
 {
-    // Return latency based on current algorithm selection
-    int algorithmIndex = algorithmParam->getIndex();
-
-    if (algorithmIndex == 0 && cdfProcessor)
-        return cdfProcessor->getLatencySamples();
-    else if (algorithmIndex == 1 && reassignmentProcessor)
-        return reassignmentProcessor->getLatencySamples();
-
-    return 0;
+    return currentLatency.load();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool AudioTransportProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
-    // We only support mono for now
-    if (layouts.getMainInputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainInputChannelSet() != juce::AudioChannelSet::disabled())
+    // Mono or stereo, with the same layout in and out
+    auto mainOutput = layouts.getMainOutputChannelSet();
+    if (mainOutput != juce::AudioChannelSet::mono()
+        && mainOutput != juce::AudioChannelSet::stereo())
         return false;
 
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-        && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::disabled())
+    if (layouts.getMainInputChannelSet() != mainOutput
+        && layouts.getMainInputChannelSet() != juce::AudioChannelSet::disabled())
         return false;
 
-    // Sidechain must be mono
-    if (layouts.getChannelSet(true, 1) != juce::AudioChannelSet::mono()
-        && layouts.getChannelSet(true, 1) != juce::AudioChannelSet::disabled())
+    // A mono sidechain feeds every channel
+    auto sidechain = layouts.getChannelSet(true, 1);
+    if (sidechain != juce::AudioChannelSet::mono()
+        && sidechain != juce::AudioChannelSet::stereo()
+        && sidechain != juce::AudioChannelSet::disabled())
         return false;
 
     return true;
@@ -252,33 +597,34 @@ void AudioTransportProcessor::processBlock (juce::AudioBuffer<float>& buffer,
 {
     juce::ignoreUnused(midiMessages);
     juce::ScopedNoDenormals noDenormals;
+    audio_transport::diagnostics::scope diagnosticsScope (diagnostics);
 
-    // Check if window size or algorithm changed
-    static float lastWindowSize = windowSizeParam->get();
-    static int lastAlgorithm = algorithmParam->getIndex();
+    // Window size, precision, latency or target changes are built off the audio thread;
+    // pick up finished engines if there are any
+    requestEnginesIfChanged();
+    acceptPendingEngines();
 
-    if (std::abs(windowSizeParam->get() - lastWindowSize) > 0.5f)
-    {
-        lastWindowSize = windowSizeParam->get();
-        needsProcessorRebuild = true;
-    }
-
-    if (algorithmParam->getIndex() != lastAlgorithm)
+    int algorithmIndex = algorithmParam->getIndex();
+    if (algorithmIndex != lastAlgorithm)
     {
-        lastAlgorithm = algorithmParam->getIndex();
-        // When algorithm changes, update latency and delay buffers
-        setLatencySamples(getLatencySamples());
-        updateDelayBuffers();
+        // Both algorithms are already built, so this is a hard switch
+        // like before; an unfinished crossfade completes with it
+        lastAlgorithm = algorithmIndex;
+        if (incomingEngines)
+            finishEngineSwap();
+        else
+            updateLatency();
     }
 
-    if (needsProcessorRebuild)
-        rebuildProcessor();
-
     // Get main input/output buffer
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
     auto numSamples = buffer.getNumSamples();
 
+    // Hosts may exceed the block size they announced
+    if (! incomingOutput.empty() && (size_t) numSamples > incomingOutput[0].size())
+        resizeBlockBuffers (numSamples);
+
     // Clear unused output channels
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, numSamples);
@@ -286,58 +632,98 @@ void AudioTransportProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     // Check for bypass
     if (bypassParam->get())
     {
-        // In bypass, just pass through the main input
+        // In bypass, just pass through the main input. Nothing is
+        // audible, so a pending engine change can complete at once
+        if (incomingEngines)
+            finishEngineSwap();
+        return;
+    }
+
+    // The engines were built for the main bus width
+    const int numChannels = numEngineChannels;
+    if (mainDelayBuffers.empty() || buffer.getNumChannels() < numChannels)
+    {
+        if (incomingEngines)
+            finishEngineSwap();
         return;
     }
 
     // Get sidechain buffer
-    auto* mainInput = buffer.getWritePointer(0);
     auto sidechainBuffer = getBusBuffer(buffer, true, 1);
 
+    // A target file stands in for the sidechain
+    const bool targetActive = engines && engines->hasTarget (algorithmIndex);
+
     // Check if sidechain is connected
-    if (sidechainBuffer.getNumChannels() == 0)
+    if (sidechainBuffer.getNumChannels() == 0 && ! targetActive)
     {
-        // No sidechain - just pass through or process with self
-        // For now, just pass through
+        // No sidechain - just pass through
+        if (incomingEngines)
+            finishEngineSwap();
         return;
     }
 
-    auto* sidechainInput = sidechainBuffer.getReadPointer(0);
+    // A mono sidechain is used for every channel. The engines ignore
+    // it while a target plays, so the main input fills in for a
+    // missing one
+    auto sidechainChannel = [&] (int channel)
+    {
+        if (sidechainBuffer.getNumChannels() == 0)
+            return buffer.getReadPointer (channel);
+        return sidechainBuffer.getReadPointer (juce::jmin (channel, sidechainBuffer.getNumChannels() - 1));
+    };
 
     // Latency-compensated dry signals
     // Delay dry signals to match the transport processor latency
-    // This prevents slap-delay artifacts when mixing dry with processed signals
-    std::vector<float> dryMain(numSamples);
-    std::vector<float> drySidechain(numSamples);
-
-    if (delayBufferSize > 0)
+    // This prevents slap-delay artifacts when mixing dry with processed signals.
+    // The block is copied into the rings, and its dry samples are read
+    // back delaySamples behind it, as at most two spans of each ring,
+    // so the engines are free to overwrite the host buffer
+    const int delayBufferSize = (int) mainDelayBuffers[0].size();
+    const int writeFirst = juce::jmin (numSamples, delayBufferSize - delayBufferWritePos);
+
+    for (int channel = 0; channel < numChannels; ++channel)
     {
-        // Process delay buffers sample-by-sample
-        for (int i = 0; i < numSamples; ++i)
-        {
-            // For circular buffer: read the oldest sample (at current write position)
-            // then write the new sample, overwriting the old one
-            dryMain[i] = mainDelayBuffer[delayBufferWritePos];
-            drySidechain[i] = sidechainDelayBuffer[delayBufferWritePos];
-
-            // Write new samples
-            mainDelayBuffer[delayBufferWritePos] = mainInput[i];
-            sidechainDelayBuffer[delayBufferWritePos] = sidechainInput[i];
+        const float* inputs[] = { buffer.getReadPointer (channel), sidechainChannel (channel) };
+        float* delayLines[] = { mainDelayBuffers[(size_t) channel].data(),
+                                sidechainDelayBuffers[(size_t) channel].data() };
 
-            // Advance position (circular)
-            delayBufferWritePos = (delayBufferWritePos + 1) % delayBufferSize;
+        for (int line = 0; line < 2; ++line)
+        {
+            std::memcpy (delayLines[line] + delayBufferWritePos, inputs[line],
+                         (size_t) writeFirst * sizeof (float));
+            std::memcpy (delayLines[line], inputs[line] + writeFirst,
+                         (size_t) (numSamples - writeFirst) * sizeof (float));
         }
     }
-    else
+
+    int dryReadPos = delayBufferWritePos - delaySamples;
+    if (dryReadPos < 0)
+        dryReadPos += delayBufferSize;
+    const int dryFirst = juce::jmin (numSamples, delayBufferSize - dryReadPos);
+
+    delayBufferWritePos += numSamples;
+    if (delayBufferWritePos >= delayBufferSize)
+        delayBufferWritePos -= delayBufferSize;
+
+    // Calls mix (output, dryMain, drySidechain, count) for each channel's
+    // output and the dry samples under it, span by span
+    auto forEachDrySpan = [&] (auto&& mix)
     {
-        // No latency compensation needed
-        std::memcpy(dryMain.data(), mainInput, numSamples * sizeof(float));
-        std::memcpy(drySidechain.data(), sidechainInput, numSamples * sizeof(float));
-    }
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float* output = buffer.getWritePointer (channel);
+            const float* dryMainChannel = mainDelayBuffers[(size_t) channel].data();
+            const float* drySidechainChannel = sidechainDelayBuffers[(size_t) channel].data();
+            mix (output, dryMainChannel + dryReadPos, drySidechainChannel + dryReadPos, dryFirst);
+            mix (output + dryFirst, dryMainChannel, drySidechainChannel, numSamples - dryFirst);
+        }
+    };
 
-    // Get parameters
+    // Get parameters. The target is not an input that can be heard
+    // dry or swapped, so it is always a full morph toward it
     float morphValue = morphParam->get();
-    int morphMode = morphModeParam->getIndex();
+    int morphMode = targetActive ? 0 : morphModeParam->getIndex();
     float dryWetPercent = dryWetParam->get() / 100.0f;
 
     // Calculate k value, input routing, and dry/wet blend based on morph mode
@@ -409,44 +795,76 @@ void AudioTransportProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         }
     }
 
-    // Set up input pointers (swap if needed)
-    const float* processMain = flipInputs ? sidechainInput : mainInput;
-    const float* processSidechain = flipInputs ? mainInput : sidechainInput;
+    // Ramp k from the last block's value, except where the inputs
+    // swap and k jumps by design
+    const bool rampK = lastK >= 0.0f && lastK != k && flipInputs == lastFlipInputs;
+    if (rampK)
+    {
+        const float step = (k - lastK) / (float) numSamples;
+        for (int i = 0; i < numSamples; ++i)
+            kRamp[(size_t) i] = lastK + step * (float) (i + 1);
+    }
+    lastK = k;
+    lastFlipInputs = flipInputs;
 
     // Process with optimal transport (using potentially swapped inputs)
-    int algorithmIndex = algorithmParam->getIndex();
-    bool hasProcessor = (algorithmIndex == 0 && cdfProcessor) ||
-                        (algorithmIndex == 1 && reassignmentProcessor);
+    auto* processor = engines ? engines->get(algorithmIndex) : nullptr;
 
-    if (hasProcessor && morphedBlend > 0.001f)
+    if (processor && morphedBlend > 0.001f)
     {
-        // Copy swapped inputs to temporary buffers for processing
-        std::vector<float> tempMain(numSamples);
-        std::vector<float> tempSidechain(numSamples);
-        std::memcpy(tempMain.data(), processMain, numSamples * sizeof(float));
-        std::memcpy(tempSidechain.data(), processSidechain, numSamples * sizeof(float));
-
-        // Use selected algorithm
-        if (algorithmIndex == 0)
+        // The engines process the host buffer in place, so swapping
+        // the inputs only swaps pointers
+        for (int channel = 0; channel < numChannels; ++channel)
         {
-            cdfProcessor->process(
-                tempMain.data(),
-                tempSidechain.data(),
-                mainInput,  // Output to main buffer
-                numSamples,
-                k
-            );
+            const float* mainInput = buffer.getReadPointer (channel);
+            const float* sidechainInput = sidechainChannel (channel);
+
+            auto c = (size_t) channel;
+            mainPointers[c] = flipInputs ? sidechainInput : mainInput;
+            sidechainPointers[c] = flipInputs ? mainInput : sidechainInput;
+            outputPointers[c] = buffer.getWritePointer (channel);  // Output to main buffer
+            incomingOutputPointers[c] = incomingOutput[c].data();
         }
-        else
+
+        auto channelMode = stereoLinkParam->get()
+            ? audio_transport::RealtimeEngine::ChannelMode::Linked
+            : audio_transport::RealtimeEngine::ChannelMode::Independent;
+
+        // The engines can only hold their own sidechain input, so the
+        // freeze follows the real sidechain only while it is unflipped
+        bool freezeSidechain = freezeSidechainParam->get() && ! flipInputs;
+
+        auto runEngine = [&] (audio_transport::RealtimeEngine& engine, float* const* outputs)
         {
-            reassignmentProcessor->process(
-                tempMain.data(),
-                tempSidechain.data(),
-                mainInput,  // Output to main buffer
-                numSamples,
-                k
-            );
-        }
+            engine.setChannelMode (channelMode);
+            engine.setSidechainFrozen (freezeSidechain);
+
+            // Offline renders call faster than realtime, so a worker
+            // has to be waited for there
+            if (auto* pipeline = dynamic_cast<audio_transport::PipelinedEngine*> (&engine))
+                pipeline->setWaitForWorker (isNonRealtime());
+            if (rampK)
+                engine.process (mainPointers.data(), sidechainPointers.data(), outputs,
+                                numChannels, numSamples, kRamp.data());
+            else
+                engine.process (mainPointers.data(), sidechainPointers.data(), outputs,
+                                numChannels, numSamples, k);
+        };
+
+        // A new engine runs first, while the buffer still holds the input
+        auto* incoming = incomingEngines ? incomingEngines->get(algorithmIndex) : nullptr;
+        if (incoming)
+            runEngine (*incoming, incomingOutputPointers.data());
+
+        // Use selected algorithm
+        runEngine (*processor, outputPointers.data());
+
+        // Keep the old output while the new engine primes, then fade
+        // or, across a latency change, switch with the dry delay at the
+        // end of the block (see engine_crossfade)
+        if (incoming && crossfade.mix (outputPointers.data(), incomingOutputPointers.data(),
+                                       numChannels, numSamples))
+            finishEngineSwap();
 
         // Apply gain compensation to prevent loudness increase at k=0.5
         // The transport algorithm can increase energy when blending maximally
@@ -464,25 +882,38 @@ void AudioTransportProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         }
 
         // Blend with dry signals
-        for (int i = 0; i < numSamples; ++i)
+        forEachDrySpan ([&] (float* mainOutput, const float* dryMainChannel,
+                             const float* drySidechainChannel, int count)
         {
-            float morphed = mainInput[i] * gainCompensation;
-            float output = morphed * morphedBlend
-                         + dryMain[i] * mainDryBlend
-                         + drySidechain[i] * sidechainDryBlend;
+            for (int i = 0; i < count; ++i)
+            {
+                float morphed = mainOutput[i] * gainCompensation;
+                float output = morphed * morphedBlend
+                             + dryMainChannel[i] * mainDryBlend
+                             + drySidechainChannel[i] * sidechainDryBlend;
 
-            // Apply dry/wet mix
-            mainInput[i] = dryMain[i] * (1.0f - dryWetPercent) + output * dryWetPercent;
-        }
+                // Apply dry/wet mix
+                mainOutput[i] = dryMainChannel[i] * (1.0f - dryWetPercent) + output * dryWetPercent;
+            }
+        });
     }
     else
     {
+        // The engines are not heard, so switch without a fade
+        if (incomingEngines)
+            finishEngineSwap();
+
         // Just blend dry signals
-        for (int i = 0; i < numSamples; ++i)
+        forEachDrySpan ([&] (float* mainOutput, const float* dryMainChannel,
+                             const float* drySidechainChannel, int count)
         {
-            float output = dryMain[i] * mainDryBlend + drySidechain[i] * sidechainDryBlend;
-            mainInput[i] = dryMain[i] * (1.0f - dryWetPercent) + output * dryWetPercent;
-        }
+            for (int i = 0; i < count; ++i)
+            {
+                float output = dryMainChannel[i] * mainDryBlend
+                             + drySidechainChannel[i] * sidechainDryBlend;
+                mainOutput[i] = dryMainChannel[i] * (1.0f - dryWetPercent) + output * dryWetPercent;
+            }
+        });
     }
 }
 
@@ -509,6 +940,12 @@ void AudioTransportProcessor::getStateInformation (juce::MemoryBlock& destData)
     stream.writeInt(morphModeParam->getIndex());
     stream.writeFloat(dryWetParam->get());
     stream.writeInt(algorithmParam->getIndex());
+    stream.writeInt(precisionParam->getIndex());
+    stream.writeBool(stereoLinkParam->get());
+    stream.writeBool(freezeSidechainParam->get());
+    stream.writeInt(latencyModeParam->getIndex());
+    stream.writeString(getTargetFile().getFullPathName());
+    stream.writeInt(targetModeParam->getIndex());
 }
 
 void AudioTransportProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -530,9 +967,33 @@ void AudioTransportProcessor::setStateInformation (const void* data, int sizeInB
 
         if (stream.getPosition() < sizeInBytes)
             algorithmParam->setValueNotifyingHost(stream.readInt() / (float)(algorithmParam->choices.size() - 1));
+
+        if (stream.getPosition() < sizeInBytes)
+            precisionParam->setValueNotifyingHost(stream.readInt() / (float)(precisionParam->choices.size() - 1));
+
+        if (stream.getPosition() < sizeInBytes)
+            stereoLinkParam->setValueNotifyingHost(stream.readBool() ? 1.0f : 0.0f);
+
+        if (stream.getPosition() < sizeInBytes)
+            freezeSidechainParam->setValueNotifyingHost(stream.readBool() ? 1.0f : 0.0f);
+
+        if (stream.getPosition() < sizeInBytes)
+            latencyModeParam->setValueNotifyingHost(stream.readInt() / (float)(latencyModeParam->choices.size() - 1));
+
+        if (stream.getPosition() < sizeInBytes)
+        {
+            // Saved by full path; an empty path is no target
+            auto path = stream.readString();
+            setTargetFile (juce::File::isAbsolutePath (path) ? juce::File (path) : juce::File());
+        }
+
+        if (stream.getPosition() < sizeInBytes)
+            targetModeParam->setValueNotifyingHost(stream.readInt() / (float)(targetModeParam->choices.size() - 1));
     }
 
-    needsProcessorRebuild = true;
+    // processBlock requests new engines for the restored window size,
+    // precision, latency and target modes; a restored target file is
+    // already being built
 }
 
 //==============================================================================
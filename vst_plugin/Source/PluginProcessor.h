@@ -3,15 +3,43 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <audio_transport/RealtimeAudioTransport.hpp>
 #include <audio_transport/RealtimeReassignmentTransport.hpp>
+#include <audio_transport/RealtimeEngine.hpp>
+#include <audio_transport/PipelinedEngine.hpp>
+#include <audio_transport/diagnostics.hpp>
+#include <audio_transport/engine_crossfade.hpp>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <ostream>
+#include <vector>
 
 //==============================================================================
 /**
     Audio Transport VST3 Plugin
 
     Morphs between main input and sidechain input using optimal transport.
+
+    Window-size, precision and latency changes rebuild the engines on a background
+    thread; the audio thread picks the new engines up through a lock-free
+    slot and crossfades to them, so parameter moves never block audio.
+
+    Mono and stereo are supported. With Stereo Link on, both channels
+    share one transport plan so the stereo image stays put while morphing.
+    Freeze Sidechain holds the sidechain's current spectrum, which also
+    saves its analysis while a pad or loop is held.
+
+    Latency Low rebuilds the engines to resynthesize only the last few
+    milliseconds of each window (see the engines' synthesis_ms), for
+    live monitoring; the host is told the resulting latency.
+
+    A target file replaces the sidechain: the engines morph toward the
+    spectrum of that recording, averaged or hop by hop (Target Mode), and
+    no sidechain needs to be connected. Each analysis is saved to a
+    library in the user's application data, so a file is only analysed
+    once for each window size, latency mode and sample rate.
 */
-class AudioTransportProcessor : public juce::AudioProcessor
+class AudioTransportProcessor : public juce::AudioProcessor,
+                                private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -59,15 +87,116 @@ public:
     juce::AudioParameterChoice* getMorphModeParameter() const { return morphModeParam; }
     juce::AudioParameterFloat* getDryWetParameter() const { return dryWetParam; }
     juce::AudioParameterChoice* getAlgorithmParameter() const { return algorithmParam; }
+    juce::AudioParameterChoice* getPrecisionParameter() const { return precisionParam; }
+    juce::AudioParameterChoice* getLatencyModeParameter() const { return latencyModeParam; }
+    juce::AudioParameterBool* getStereoLinkParameter() const { return stereoLinkParam; }
+    juce::AudioParameterBool* getFreezeSidechainParameter() const { return freezeSidechainParam; }
+    juce::AudioParameterChoice* getTargetModeParameter() const { return targetModeParam; }
+
+    // The recording morphed toward in place of the sidechain, or none
+    // (message thread). The engines are rebuilt with it in the background.
+    void setTargetFile (const juce::File& file);
+    juce::File getTargetFile() const;
 
-    // Latency reporting
+    // Latency of the engines currently producing output (any thread)
     int getLatencySamples() const;
 
+    // Stage timings of every engine this processor builds, recorded
+    // while enabled (the editor turns it on while it is open)
+    audio_transport::instrumentation::recorder& getInstrumentation() { return instrumentation; }
+
 private:
     //==============================================================================
-    // Audio Transport processors (CDF-based and Reassignment-based)
-    std::unique_ptr<audio_transport::RealtimeAudioTransport> cdfProcessor;
-    std::unique_ptr<audio_transport::RealtimeReassignmentTransport> reassignmentProcessor;
+    // Audio Transport processors (CDF-based and Reassignment-based) for
+    // one window size, built in double or float precision. Each set is
+    // listed in the registry it is built with while it exists, so the
+    // builder can drain its pipelines' diagnostics (see liveEngineSets)
+    struct EngineSet
+    {
+        explicit EngineSet (std::vector<EngineSet*>& r) : registry (r) { registry.push_back (this); }
+        ~EngineSet() { registry.erase (std::find (registry.begin(), registry.end(), this)); }
+
+        EngineSet (const EngineSet&) = delete;
+        EngineSet& operator= (const EngineSet&) = delete;
+
+        std::vector<EngineSet*>& registry;
+        std::unique_ptr<audio_transport::RealtimeEngine> cdf;
+        std::unique_ptr<audio_transport::RealtimeEngine> reassignment;
+
+        audio_transport::RealtimeEngine* get (int algorithmIndex) const
+        {
+            return algorithmIndex == 0 ? cdf.get() : reassignment.get();
+        }
+
+        bool hasTarget (int algorithmIndex) const
+        {
+            return get (algorithmIndex)->getTarget() != nullptr;
+        }
+
+        // Pipelined engines report from their workers into channels of
+        // their own
+        void drainDiagnostics (std::ostream& out)
+        {
+            for (auto* engine : { cdf.get(), reassignment.get() })
+                if (auto* pipeline = dynamic_cast<audio_transport::PipelinedEngine*> (engine))
+                    audio_transport::diagnostics::drain (pipeline->getDiagnostics(), out);
+        }
+    };
+
+    // Builds requested engine sets, frees retired ones and forwards
+    // latency changes to the message thread
+    class EngineBuilder : public juce::Thread
+    {
+    public:
+        explicit EngineBuilder (AudioTransportProcessor& p)
+            : juce::Thread ("Audio Transport engine builder"), owner (p) {}
+        void run() override;
+
+    private:
+        AudioTransportProcessor& owner;
+    };
+
+    // Shared by every engine set and declared before them, so it
+    // outlives all engines
+    audio_transport::instrumentation::recorder instrumentation;
+
+    // Every engine set that exists, wherever it is held, for the
+    // builder to drain. Sets are only built and deleted on the builder
+    // or while it is stopped, never on the audio thread, so only the
+    // builder touches this while it runs. Declared before the sets.
+    std::vector<EngineSet*> liveEngineSets;
+
+    // Audio thread only (and prepareToPlay while the builder is stopped)
+    std::unique_ptr<EngineSet> engines;          // producing output
+    std::unique_ptr<EngineSet> incomingEngines;  // being crossfaded in
+    audio_transport::engine_crossfade crossfade; // from engines to incomingEngines
+    float lastRequestedWindowSize = 0.0f;
+    int lastRequestedPrecision = 0;
+    int lastRequestedLatencyMode = 0;
+    int lastRequestedTargetMode = 0;
+    int lastAlgorithm = 0;
+
+    // Hand-off between the audio thread and the builder. Each slot holds
+    // at most one set and is only ever exchanged, never locked
+    std::atomic<EngineSet*> pendingEngines { nullptr };  // builder -> audio
+    std::atomic<EngineSet*> retiredEngines { nullptr };  // audio -> builder
+    std::atomic<float> requestedWindowSize { 100.0f };
+    std::atomic<int> requestedPrecision { 0 };
+    std::atomic<int> requestedLatencyMode { 0 };
+    std::atomic<int> requestedTargetMode { 0 };
+    std::atomic<unsigned int> requestGeneration { 0 };
+    unsigned int builtGeneration = 0;                     // builder only
+    std::atomic<int> currentLatency { 0 };
+    int reportedLatency = -1;                             // builder only
+
+    // Set on the message thread, read by the builder
+    mutable juce::CriticalSection targetLock;
+    juce::File targetFile;
+
+    // Numerical warnings from the audio thread, logged by the builder
+    audio_transport::diagnostics::channel diagnostics;
+
+    EngineBuilder engineBuilder { *this };
 
     // Parameters
     juce::AudioParameterFloat* morphParam;
@@ -76,20 +205,57 @@ private:
     juce::AudioParameterChoice* morphModeParam;
     juce::AudioParameterFloat* dryWetParam;
     juce::AudioParameterChoice* algorithmParam;
+    juce::AudioParameterChoice* precisionParam;
+    juce::AudioParameterChoice* latencyModeParam;
+    juce::AudioParameterBool* stereoLinkParam;
+    juce::AudioParameterBool* freezeSidechainParam;
+    juce::AudioParameterChoice* targetModeParam;
 
     // State
     double currentSampleRate = 44100.0;
-    bool needsProcessorRebuild = false;
+    int numEngineChannels = 1;  // main bus width, set in prepareToPlay
+    int maxBlockSize = 512;     // announced in prepareToPlay, for pipelined engines
 
-    // Delay buffers for latency compensation of dry signals
-    std::vector<float> mainDelayBuffer;
-    std::vector<float> sidechainDelayBuffer;
+    // Block-copy rings for latency compensation of dry signals (one per
+    // channel), sized once for the largest window plus one block so
+    // latency changes never reallocate. A block is copied in whole and
+    // its delayed dry samples are read straight from the ring
+    std::vector<std::vector<float>> mainDelayBuffers;
+    std::vector<std::vector<float>> sidechainDelayBuffers;
     int delayBufferWritePos = 0;
-    int delayBufferSize = 0;
+    int delaySamples = 0;
+    int maxDelaySamples = 0;
+
+    // Output of the engines being crossfaded in, one buffer per channel
+    std::vector<std::vector<float>> incomingOutput;
+
+    // Planar channel pointers into the host buffer, which the engines
+    // process in place
+    std::vector<const float*> mainPointers;
+    std::vector<const float*> sidechainPointers;
+    std::vector<float*> outputPointers;
+    std::vector<float*> incomingOutputPointers;
+
+    // Per-sample k for the engines, ramped over each block from the
+    // previous block's k so that automation moves smoothly between hops
+    // without the host splitting blocks. lastK is negative until the
+    // first block.
+    std::vector<float> kRamp;
+    float lastK = -1.0f;
+    bool lastFlipInputs = false;
 
     // Helper methods
-    void rebuildProcessor();
-    void updateDelayBuffers();
+    std::unique_ptr<EngineSet> createEngines (float windowSize, int precision, int latencyMode,
+                                              int targetMode);
+    void applyTarget (EngineSet& set, int targetMode);
+    bool readTargetAudio (const juce::File& file, double sampleRate, std::vector<float>& audio);
+    void resizeBlockBuffers (int numSamples);
+    void requestEnginesIfChanged();
+    void acceptPendingEngines();
+    void finishEngineSwap();
+    void updateLatency();
+    void serviceEngineBuilder();
+    void handleAsyncUpdate() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioTransportProcessor)
 };